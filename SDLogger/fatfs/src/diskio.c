@@ -13,8 +13,8 @@
 #include "sdcard.h"		/* Example: Header file of existing MMC/SDC contorl module */
 
 /* Definitions of physical drive number for each drive */
-#define ATA		1	/* Example: Map ATA harddisk to physical drive 1 */
-#define MMC		0	/* Example: Map MMC/SD card to physical drive 0 */
+#define MMC0	0	/* MMC/SD card on SSP0 is physical drive 0 */
+#define MMC1	1	/* MMC/SD card on SSP1 is physical drive 1 (SD_CARDS in SDLogger.h) */
 #define USB		2	/* Example: Map USB MSD to physical drive 2 */
 
 
@@ -28,10 +28,9 @@ DSTATUS disk_status (
 {
 	switch (pdrv)
 	{
-		case ATA :
-		break;
-		case MMC :
-			return (MMC_disk_status());
+		case MMC0 :
+		case MMC1 :
+			return (MMC_disk_status(pdrv));
 		case USB :
 		break;
 	}
@@ -50,11 +49,9 @@ DSTATUS disk_initialize (
 {
 	switch (pdrv)
 	{
-		case ATA :
-
-		break;
-		case MMC :
-			return (MMC_disk_initialize());
+		case MMC0 :
+		case MMC1 :
+			return (MMC_disk_initialize(pdrv));
 		case USB :
 		break;
 	}
@@ -76,11 +73,9 @@ DRESULT disk_read (
 {
 	switch (pdrv)
 	{
-		case ATA :
-
-		break;
-		case MMC :
-			return (MMC_disk_read(buff, sector, count));
+		case MMC0 :
+		case MMC1 :
+			return (MMC_disk_read(pdrv, buff, sector, count));
 		case USB :
 
 		break;
@@ -104,11 +99,9 @@ DRESULT disk_write (
 {
 	switch (pdrv)
 	{
-		case ATA :
-
-		break;
-		case MMC :
-			return (MMC_disk_write(buff, sector, count));
+		case MMC0 :
+		case MMC1 :
+			return (MMC_disk_write(pdrv, buff, sector, count));
 		break;
 		case USB :
 
@@ -132,11 +125,9 @@ DRESULT disk_ioctl (
 {
 	switch (pdrv)
 	{
-		case ATA :
-
-		break;
-		case MMC :
-			return (MMC_disk_ioctl(cmd, buff));
+		case MMC0 :
+		case MMC1 :
+			return (MMC_disk_ioctl(pdrv, cmd, buff));
 		case USB :
 
 		break;
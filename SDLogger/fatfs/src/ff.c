@@ -68,6 +68,20 @@
 #endif
 
 
+/* exFAT feature */
+#if _FS_EXFAT
+#if _USE_LFN || _FS_RPATH || _USE_LABEL
+#error _FS_EXFAT requires _USE_LFN, _FS_RPATH and _USE_LABEL to be 0
+#endif
+#define	NEXT_CLUST(obj, clst)		next_clust((obj)->fs, clst, (obj)->sclust, (obj)->stat, (obj)->ncont)
+#define	STRETCH_CHAIN(obj, clst)	create_xchain((obj)->fs, clst, (obj)->sclust, &(obj)->stat, &(obj)->ncont)
+#define	XDIR_OFS(dp)				((UINT)((dp)->index % (SS((dp)->fs) / SZ_DIRE)) * SZ_DIRE)
+#else
+#define	NEXT_CLUST(obj, clst)		get_fat((obj)->fs, clst)
+#define	STRETCH_CHAIN(obj, clst)	create_chain((obj)->fs, clst)
+#endif
+
+
 /* File access control feature */
 #if _FS_LOCK
 #if _FS_READONLY
@@ -428,6 +442,46 @@ typedef struct {
 #define	DDEM				0xE5	/* Deleted directory entry mark at DIR_Name[0] */
 #define	RDDEM				0x05	/* Replacement of the character collides with DDEM */
 
+#define	BPB_ZeroedEx		11		/* exFAT: Must be zero (53) */
+#define	BPB_VolOfsEx		64		/* exFAT: Volume offset from top of the drive [sector] (8) */
+#define	BPB_TotSecEx		72		/* exFAT: Volume size [sector] (8) */
+#define	BPB_FatOfsEx		80		/* exFAT: FAT offset from top of the volume [sector] (4) */
+#define	BPB_FatSzEx			84		/* exFAT: FAT size [sector] (4) */
+#define	BPB_DataOfsEx		88		/* exFAT: Data offset from top of the volume [sector] (4) */
+#define	BPB_NumClusEx		92		/* exFAT: Number of clusters (4) */
+#define	BPB_RootClusEx		96		/* exFAT: Root directory first cluster (4) */
+#define	BPB_VolIDEx			100		/* exFAT: Volume serial number (4) */
+#define	BPB_FSVerEx			104		/* exFAT: File system version (2) */
+#define	BPB_BytsPerSecEx	108		/* exFAT: Log2 of sector size [byte] (1) */
+#define	BPB_SecPerClusEx	109		/* exFAT: Log2 of cluster size [sector] (1) */
+#define	BPB_NumFATsEx		110		/* exFAT: Number of FATs (1) */
+
+#define	XDIR_Type			0		/* exFAT: Entry type (1) */
+#define	XDIR_NumSec			1		/* exFAT: Number of secondary entries (1) */
+#define	XDIR_SetSum			2		/* exFAT: Checksum of the entry set (2) */
+#define	XDIR_Attr			4		/* exFAT: Attribute (2) */
+#define	XDIR_CrtTime		8		/* exFAT: Created time and date (4) */
+#define	XDIR_ModTime		12		/* exFAT: Modified time and date (4) */
+#define	XDIR_AccTime		16		/* exFAT: Last accessed time and date (4) */
+#define	XDIR_CrtTime10		20		/* exFAT: Created time sub-second (1) */
+#define	XDIR_ModTime10		21		/* exFAT: Modified time sub-second (1) */
+#define	XDIR_GenFlags		1		/* exFAT: Flags of the stream extension entry (1) */
+#define	XDIR_NumName		3		/* exFAT: Number of name characters (1) */
+#define	XDIR_NameHash		4		/* exFAT: Hash of the up-cased name (2) */
+#define	XDIR_ValidFileSize	8		/* exFAT: Valid data length (8) */
+#define	XDIR_FstClus		20		/* exFAT: First cluster of the data, also of the bitmap (4) */
+#define	XDIR_FileSize		24		/* exFAT: Data length, also of the bitmap (8) */
+#define	XDIR_NameFlags		1		/* exFAT: Flags of the name extension entry (1) */
+#define	XDIR_Name			2		/* exFAT: Name characters in UTF-16 (30) */
+#define	ET_BITMAP			0x81	/* exFAT: Allocation bitmap entry */
+#define	ET_FILEDIR			0x85	/* exFAT: File and directory entry */
+#define	ET_STREAM			0xC0	/* exFAT: Stream extension entry */
+#define	ET_FILENAME			0xC1	/* exFAT: Name extension entry */
+#define	XF_ALLOC			0x01	/* exFAT: AllocationPossible flag in XDIR_GenFlags */
+#define	XF_NOFAT			0x02	/* exFAT: NoFatChain flag in XDIR_GenFlags */
+#define	XSFN_Flags			32		/* SFN image of an exFAT entry set: XDIR_GenFlags (1) */
+#define	XSFN_SizeHi			36		/* SFN image of an exFAT entry set: Higher 32-bit of file size (4) */
+
 
 
 
@@ -852,6 +906,13 @@ DWORD get_fat (	/* 0xFFFFFFFF:Disk error, 1:Internal error, 2..0x0FFFFFFF:Cluste
 			p = &fs->win[clst * 4 % SS(fs)];
 			val = LD_DWORD(p) & 0x0FFFFFFF;
 			break;
+#if _FS_EXFAT
+		case FS_EXFAT :
+			if (move_window(fs, fs->fatbase + (clst / (SS(fs) / 4))) != FR_OK) break;
+			p = &fs->win[clst * 4 % SS(fs)];
+			val = LD_DWORD(p) & 0x7FFFFFFF;	/* 0xFFFFFFFF (end of chain) is read as 0x7FFFFFFF */
+			break;
+#endif
 
 		default:
 			val = 1;	/* Internal error */
@@ -864,6 +925,32 @@ DWORD get_fat (	/* 0xFFFFFFFF:Disk error, 1:Internal error, 2..0x0FFFFFFF:Cluste
 
 
 
+#if _FS_EXFAT
+/*-----------------------------------------------------------------------*/
+/* exFAT: Get next cluster of an object                                  */
+/*-----------------------------------------------------------------------*/
+/* A contiguous object (stat 2) has no FAT chain and its clusters follow
+/  one another, so the FAT is not read. */
+
+static
+DWORD next_clust (	/* Same as get_fat() */
+	FATFS* fs,		/* File system object */
+	DWORD clst,		/* Current cluster# of the object */
+	DWORD sclust,	/* Top cluster# of the object */
+	BYTE stat,		/* Allocation status of the object (0:FAT chain, 2:contiguous) */
+	DWORD ncont		/* Number of clusters allocated to the contiguous object */
+)
+{
+	if (stat != 2) return get_fat(fs, clst);
+
+	if (clst < sclust || clst - sclust >= ncont) return 1;	/* Out of the object */
+	return (clst - sclust + 1 < ncont) ? clst + 1 : 0x7FFFFFFF;	/* Next cluster or end of the object */
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT access - Change value of a FAT entry                              */
 /*-----------------------------------------------------------------------*/
@@ -916,6 +1003,16 @@ FRESULT put_fat (	/* FR_OK(0):succeeded, !=0:error */
 			ST_DWORD(p, val);
 			fs->wflag = 1;
 			break;
+#if _FS_EXFAT
+		case FS_EXFAT :
+			res = move_window(fs, fs->fatbase + (clst / (SS(fs) / 4)));
+			if (res != FR_OK) break;
+			p = &fs->win[clst * 4 % SS(fs)];
+			if (val >= fs->n_fatent) val = 0xFFFFFFFF;	/* End of chain */
+			ST_DWORD(p, val);
+			fs->wflag = 1;
+			break;
+#endif
 
 		default :
 			res = FR_INT_ERR;
@@ -929,6 +1026,85 @@ FRESULT put_fat (	/* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if _FS_EXFAT && !_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* exFAT: Find a free cluster in the allocation bitmap                   */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD find_bitmap (	/* 0:No free cluster, 2..:Free cluster#, 0xFFFFFFFF:Disk error */
+	FATFS* fs,		/* File system object */
+	DWORD clst		/* Cluster# to start to search from */
+)
+{
+	DWORD val, n;
+	BYTE bm;
+
+
+	if (clst < 2 || clst >= fs->n_fatent) clst = 2;
+	val = clst - 2;				/* Bit index in the bitmap */
+	n = fs->n_fatent - 2;		/* Number of bits to be scanned */
+	while (n) {
+		if (move_window(fs, fs->bitbase + val / 8 / SS(fs)) != FR_OK) return 0xFFFFFFFF;
+		do {
+			bm = fs->win[val / 8 % SS(fs)];
+			if (bm == 0xFF && val % 8 == 0 && n >= 8 && val + 8 <= fs->n_fatent - 2) {
+				val += 8; n -= 8;	/* Skip a fully used byte */
+			} else {
+				if (!(bm & (1 << (val % 8)))) return val + 2;	/* Found a free cluster */
+				val++; n--;
+			}
+			if (val >= fs->n_fatent - 2) val = 0;	/* Wrap around */
+		} while (n && val % (SS(fs) * 8));
+	}
+	return 0;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* exFAT: Set or clear a run of bits in the allocation bitmap            */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT change_bitmap (	/* FR_OK(0):succeeded, !=0:error */
+	FATFS* fs,		/* File system object */
+	DWORD clst,		/* Cluster# to change from */
+	DWORD ncl,		/* Number of clusters to be changed */
+	int bv			/* Bit value to be set (0 or 1) */
+)
+{
+	DWORD val;
+	BYTE *p, bm;
+
+
+	if (clst < 2 || ncl > fs->n_fatent - clst) return FR_INT_ERR;
+	val = clst - 2;
+	while (ncl) {
+		if (move_window(fs, fs->bitbase + val / 8 / SS(fs)) != FR_OK) return FR_DISK_ERR;
+		do {
+			p = &fs->win[val / 8 % SS(fs)];
+			if (val % 8 == 0 && ncl >= 8) {		/* Whole byte */
+				if (*p != (bv ? 0x00 : 0xFF)) return FR_INT_ERR;	/* Inconsistent bitmap */
+				*p = bv ? 0xFF : 0x00;
+				val += 8; ncl -= 8;
+			} else {
+				bm = (BYTE)(1 << (val % 8));
+				if (((*p & bm) != 0) == (bv != 0)) return FR_INT_ERR;	/* Inconsistent bitmap */
+				*p ^= bm;
+				val++; ncl--;
+			}
+			fs->wflag = 1;
+		} while (ncl && val % (SS(fs) * 8));
+	}
+	return FR_OK;
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Remove a cluster chain                                 */
 /*-----------------------------------------------------------------------*/
@@ -940,7 +1116,9 @@ FRESULT remove_chain (	/* FR_OK(0):succeeded, !=0:error */
 )
 {
 	FRESULT res;
-	DWORD nxt;
+	DWORD nxt, n;
+	UINT es, i, ne;
+	BYTE *p;
 #if _USE_TRIM
 	DWORD scl = clst, ecl = clst, rt[2];
 #endif
@@ -951,17 +1129,60 @@ FRESULT remove_chain (	/* FR_OK(0):succeeded, !=0:error */
 	} else {
 		res = FR_OK;
 		while (clst < fs->n_fatent) {			/* Not a last link? */
-			nxt = get_fat(fs, clst);			/* Get cluster status */
-			if (nxt == 0) break;				/* Empty cluster? */
-			if (nxt == 1) { res = FR_INT_ERR; break; }	/* Internal error? */
-			if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
-			res = put_fat(fs, clst, 0);			/* Mark the cluster "empty" */
-			if (res != FR_OK) break;
-			if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSINFO */
-				fs->free_clust++;
-				fs->fsi_flag |= 1;
+			if (fs->fs_type == FS_FAT16 || fs->fs_type == FS_FAT32) {
+				/* Clear the links in the FAT sector in the window a run at a time:
+				   the entries of clst, clst+1, ... that each link to the next
+				   cluster go with one mem_set(), the last one of the run is
+				   cleared on its own as it may end the chain or leave the sector. */
+				es = (fs->fs_type == FS_FAT16) ? 2 : 4;	/* Entry size */
+				ne = SS(fs) / es;						/* Entries in a FAT sector */
+				res = move_window(fs, fs->fatbase + clst / ne);
+				if (res != FR_OK) break;
+				i = clst % ne;
+				for (n = 0; i + n + 1 < ne && clst + n + 1 < fs->n_fatent; n++) {
+					p = &fs->win[(i + n) * es];		/* A FAT32 entry with its upper bits set ends the run: mem_set() keeps none */
+					if (((es == 2) ? LD_WORD(p) : LD_DWORD(p)) != clst + n + 1) break;
+				}
+				p = &fs->win[(i + n) * es];
+				if (es == 2) {
+					nxt = LD_WORD(p);
+					if (nxt >= 2) { ST_WORD(p, 0); }
+				} else {
+					nxt = LD_DWORD(p);
+					if ((nxt & 0x0FFFFFFF) >= 2) { ST_DWORD(p, nxt & 0xF0000000); }
+					nxt &= 0x0FFFFFFF;
+				}
+				mem_set(&fs->win[i * es], 0, (UINT)n * es);
+				if (nxt >= 2) n++;
+				if (n) {
+					fs->wflag = 1;
+					if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSINFO once for the run */
+						fs->free_clust += n;
+						fs->fsi_flag |= 1;
+					}
+				}
+				if (nxt == 0) break;				/* Empty cluster? */
+				if (nxt == 1) { res = FR_INT_ERR; break; }	/* Internal error? */
+			} else {
+				nxt = get_fat(fs, clst);			/* Get cluster status */
+				if (nxt == 0) break;				/* Empty cluster? */
+				if (nxt == 1) { res = FR_INT_ERR; break; }	/* Internal error? */
+				if (nxt == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }	/* Disk error? */
+#if _FS_EXFAT
+				if (fs->fs_type == FS_EXFAT)
+					res = change_bitmap(fs, clst, 1, 0);	/* Mark the cluster "empty" in the bitmap */
+				else
+#endif
+					res = put_fat(fs, clst, 0);		/* Mark the cluster "empty" */
+				if (res != FR_OK) break;
+				n = 1;
+				if (fs->free_clust != 0xFFFFFFFF) {	/* Update FSINFO */
+					fs->free_clust++;
+					fs->fsi_flag |= 1;
+				}
 			}
 #if _USE_TRIM
+			ecl = clst + n - 1;		/* Last cluster removed */
 			if (ecl + 1 == nxt) {	/* Is next cluster contiguous? */
 				ecl = nxt;
 			} else {				/* End of contiguous clusters */ 
@@ -1043,6 +1264,121 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 
 
 
+#if _FS_EXFAT && !_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* exFAT: Stretch or Create a cluster chain of an object                 */
+/*-----------------------------------------------------------------------*/
+/* A new object is allocated contiguous (stat 2) and grows in place as long
+/  as the following cluster is free, touching only the allocation bitmap.
+/  When it cannot, the FAT chain of the object is built and it continues as
+/  an ordinary chain (stat 0). */
+
+static
+DWORD create_xchain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk error, >=2:New cluster# */
+	FATFS* fs,			/* File system object */
+	DWORD clst,			/* Cluster# to stretch, 0:Create a new chain */
+	DWORD sclust,		/* Top cluster# of the object */
+	BYTE* stat,			/* Allocation status of the object (updated) */
+	DWORD* ncont		/* Number of clusters of the contiguous object (updated) */
+)
+{
+	DWORD cs, ncl, cl;
+	FRESULT res;
+
+
+	if (fs->fs_type != FS_EXFAT) return create_chain(fs, clst);
+
+	if (clst == 0) {					/* Create a new chain */
+		ncl = find_bitmap(fs, fs->last_clust + 1);
+		if (ncl < 2 || ncl == 0xFFFFFFFF) return ncl;
+		res = change_bitmap(fs, ncl, 1, 1);
+		if (res == FR_OK) {
+			*stat = 2; *ncont = 1;
+		}
+	}
+	else if (*stat == 2) {				/* Stretch the contiguous object */
+		if (clst - sclust + 1 < *ncont) return clst + 1;	/* It is already followed by next cluster */
+		ncl = find_bitmap(fs, clst + 1);
+		if (ncl < 2 || ncl == 0xFFFFFFFF) return ncl;
+		res = change_bitmap(fs, ncl, 1, 1);
+		if (res == FR_OK) {
+			if (ncl == clst + 1) {		/* Grown in place */
+				(*ncont)++;
+			} else {					/* Fragmented: create the FAT chain of the object */
+				for (cl = sclust; res == FR_OK && cl < clst; cl++) res = put_fat(fs, cl, cl + 1);
+				if (res == FR_OK) res = put_fat(fs, clst, ncl);
+				if (res == FR_OK) res = put_fat(fs, ncl, 0xFFFFFFFF);
+				if (res == FR_OK) *stat = 0;
+			}
+		}
+	}
+	else {								/* Stretch the FAT chain */
+		cs = get_fat(fs, clst);
+		if (cs < 2) return 1;			/* Invalid value */
+		if (cs == 0xFFFFFFFF) return cs;	/* A disk error occurred */
+		if (cs < fs->n_fatent) return cs;	/* It is already followed by next cluster */
+		ncl = find_bitmap(fs, clst + 1);
+		if (ncl < 2 || ncl == 0xFFFFFFFF) return ncl;
+		res = change_bitmap(fs, ncl, 1, 1);
+		if (res == FR_OK) res = put_fat(fs, ncl, 0xFFFFFFFF);
+		if (res == FR_OK) res = put_fat(fs, clst, ncl);
+	}
+
+	if (res == FR_OK) {
+		fs->last_clust = ncl;
+		if (fs->free_clust != 0xFFFFFFFF) {
+			fs->free_clust--;
+			fs->fsi_flag |= 1;
+		}
+	} else {
+		ncl = (res == FR_DISK_ERR) ? 0xFFFFFFFF : 1;
+	}
+
+	return ncl;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* exFAT: Remove the cluster chain of an object                          */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT remove_xchain (	/* FR_OK(0):succeeded, !=0:error */
+	FATFS* fs,			/* File system object */
+	DWORD clst,			/* Cluster# to remove a chain from */
+	BYTE stat,			/* Allocation status of the object */
+	DWORD ncl			/* Number of clusters to remove at stat 2 */
+)
+{
+	FRESULT res;
+#if _USE_TRIM
+	DWORD rt[2];
+#endif
+
+
+	if (fs->fs_type != FS_EXFAT || stat != 2) return remove_chain(fs, clst);
+
+	res = change_bitmap(fs, clst, ncl, 0);	/* Contiguous: clear the run in the bitmap */
+	if (res == FR_OK && fs->free_clust != 0xFFFFFFFF) {
+		fs->free_clust += ncl;
+		fs->fsi_flag |= 1;
+	}
+#if _USE_TRIM
+	if (res == FR_OK) {
+		rt[0] = clust2sect(fs, clst);					/* Start sector */
+		rt[1] = rt[0] + ncl * fs->csize - 1;			/* End sector */
+		disk_ioctl(fs->drv, CTRL_TRIM, rt);				/* Erase the block */
+	}
+#endif
+	return res;
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT handling - Convert offset into cluster with link map table        */
 /*-----------------------------------------------------------------------*/
@@ -1051,14 +1387,14 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 static
 DWORD clmt_clust (	/* <2:Error, >=2:Cluster number */
 	FIL* fp,		/* Pointer to the file object */
-	DWORD ofs		/* File offset to be converted to cluster# */
+	FSIZE_t ofs		/* File offset to be converted to cluster# */
 )
 {
 	DWORD cl, ncl, *tbl;
 
 
 	tbl = fp->cltbl + 1;	/* Top of CLMT */
-	cl = ofs / SS(fp->fs) / fp->fs->csize;	/* Cluster order from top of the file */
+	cl = (DWORD)(ofs / SS(fp->fs) / fp->fs->csize);	/* Cluster order from top of the file */
 	for (;;) {
 		ncl = *tbl++;			/* Number of cluters in the fragment */
 		if (!ncl) return 0;		/* End of table? (error) */
@@ -1072,6 +1408,254 @@ DWORD clmt_clust (	/* <2:Error, >=2:Cluster number */
 
 
 
+#if _FS_EXFAT
+/*-----------------------------------------------------------------------*/
+/* exFAT: Load/Store an entry set as an SFN entry image                  */
+/*-----------------------------------------------------------------------*/
+/* An exFAT object is described by a set of a file entry, a stream extension
+/  entry and name entries. Its properties are mirrored into fs->dirbuf in
+/  the layout of an SFN entry, so that the rest of the module can handle it
+/  as a FAT directory entry. Only names fit in 8.3 format can be mirrored,
+/  the others get a blank name and are invisible. An entry set can span two
+/  sectors, the sector of the file entry and sect2. */
+
+static
+WORD xdir_sum (			/* Checksum of the entry set accumulated with an entry */
+	WORD sum,			/* Checksum of the preceding entries */
+	const BYTE* ent,	/* Pointer to the entry */
+	int primary			/* 1:The file entry, its checksum field is skipped */
+)
+{
+	UINT i;
+
+
+	for (i = 0; i < SZ_DIRE; i++) {
+		if (primary && (i == XDIR_SetSum || i == XDIR_SetSum + 1)) continue;
+		sum = (WORD)(((sum & 1) ? 0x8000 : 0) + (sum >> 1) + ent[i]);
+	}
+	return sum;
+}
+
+
+static
+BYTE* xdir_ent (	/* Pointer to the entry in the window, 0:Error */
+	FATFS* fs,		/* File system object */
+	DWORD sect,		/* Sector of the file entry */
+	DWORD sect2,	/* Sector following the file entry (0:none) */
+	UINT ofs		/* Offset of the entry from top of sect, can be over the sector */
+)
+{
+	if (ofs >= SS(fs)) {
+		sect = sect2; ofs -= SS(fs);
+	}
+	if (!sect || move_window(fs, sect) != FR_OK) return 0;
+	return fs->win + ofs;
+}
+
+
+static
+FRESULT ld_xdir (	/* FR_OK(0):succeeded, !=0:error */
+	FATFS* fs,		/* File system object */
+	DWORD sect,		/* Sector of the file entry */
+	DWORD sect2,	/* Sector following the file entry (0:none) */
+	UINT ofs		/* Offset of the file entry in the sector */
+)
+{
+	BYTE *ent, *sfn = fs->dirbuf;
+	UINT nsec, n, i, si, nc, dot, valid;
+	WORD sum, ssum, wc;
+
+
+	mem_set(sfn, 0, sizeof fs->dirbuf);
+	mem_set(sfn, ' ', 11);
+	ent = xdir_ent(fs, sect, sect2, ofs);
+	if (!ent) return FR_DISK_ERR;
+	nsec = ent[XDIR_NumSec];
+	if (nsec < 2 || ofs + (nsec + 1) * SZ_DIRE > (sect2 ? 2 : 1) * SS(fs)) {
+		sfn[DIR_Name] = 0;		/* Broken or too long entry set */
+		return FR_OK;
+	}
+	sfn[DIR_Attr] = ent[XDIR_Attr] & AM_MASK;
+	ST_DWORD(sfn + DIR_CrtTime, LD_DWORD(ent + XDIR_CrtTime));
+	ST_DWORD(sfn + DIR_WrtTime, LD_DWORD(ent + XDIR_ModTime));
+	ssum = LD_WORD(ent + XDIR_SetSum);
+	sum = xdir_sum(0, ent, 1);
+
+	valid = 1; si = nc = dot = 0;
+	for (n = 1; n <= nsec; n++) {
+		ent = xdir_ent(fs, sect, sect2, ofs + n * SZ_DIRE);
+		if (!ent) return FR_DISK_ERR;
+		sum = xdir_sum(sum, ent, 0);
+		if (n == 1) {			/* Stream extension entry */
+			if (ent[XDIR_Type] != ET_STREAM) valid = 0;
+			sfn[XSFN_Flags] = ent[XDIR_GenFlags];
+			nc = ent[XDIR_NumName];
+			ST_WORD(sfn + DIR_FstClusLO, LD_WORD(ent + XDIR_FstClus));
+			ST_WORD(sfn + DIR_FstClusHI, LD_WORD(ent + XDIR_FstClus + 2));
+			ST_DWORD(sfn + DIR_FileSize, LD_DWORD(ent + XDIR_FileSize));
+			ST_DWORD(sfn + XSFN_SizeHi, LD_DWORD(ent + XDIR_FileSize + 4));
+		} else if (ent[XDIR_Type] == ET_FILENAME) {	/* Name entry: fit the name into 8.3 format */
+			for (i = 0; i < 15 && nc; i++, nc--) {
+				wc = LD_WORD(ent + XDIR_Name + i * 2);
+				if (wc == '.') {
+					if (!si || dot) valid = 0;
+					dot = 1; si = 8;
+				} else if (wc <= ' ' || wc >= 0x7F || chk_chr("\"*+,:;<=>\?[]|", wc) || si >= (dot ? 11U : 8U)) {
+					valid = 0;
+				} else {
+					sfn[si++] = (BYTE)(IsLower(wc) ? wc - 0x20 : wc);
+				}
+			}
+		}
+	}
+	if (!valid || nc || !si || (dot && si == 8) || sum != ssum) sfn[DIR_Name] = 0;	/* Not visible */
+
+	return FR_OK;
+}
+
+
+#if !_FS_READONLY
+static
+FRESULT st_xdir (	/* FR_OK(0):succeeded, !=0:error */
+	FATFS* fs,		/* File system object */
+	DWORD sect,		/* Sector of the file entry */
+	DWORD sect2,	/* Sector following the file entry (0:none) */
+	UINT ofs		/* Offset of the file entry in the sector */
+)
+{
+	BYTE *ent, *sfn = fs->dirbuf;
+	UINT nsec, n;
+	WORD sum;
+
+
+	ent = xdir_ent(fs, sect, sect2, ofs);
+	if (!ent) return FR_DISK_ERR;
+	nsec = ent[XDIR_NumSec];
+	ST_WORD(ent + XDIR_Attr, sfn[DIR_Attr]);
+	ST_DWORD(ent + XDIR_CrtTime, LD_DWORD(sfn + DIR_CrtTime));
+	ST_DWORD(ent + XDIR_ModTime, LD_DWORD(sfn + DIR_WrtTime));
+	ST_DWORD(ent + XDIR_AccTime, LD_DWORD(sfn + DIR_WrtTime));
+	ent[XDIR_ModTime10] = 0;
+	fs->wflag = 1;
+	sum = xdir_sum(0, ent, 1);
+
+	for (n = 1; n <= nsec; n++) {
+		ent = xdir_ent(fs, sect, sect2, ofs + n * SZ_DIRE);
+		if (!ent) return FR_DISK_ERR;
+		if (n == 1) {			/* Stream extension entry */
+			ent[XDIR_GenFlags] = sfn[XSFN_Flags];
+			ST_WORD(ent + XDIR_FstClus, LD_WORD(sfn + DIR_FstClusLO));
+			ST_WORD(ent + XDIR_FstClus + 2, LD_WORD(sfn + DIR_FstClusHI));
+			ST_DWORD(ent + XDIR_FileSize, LD_DWORD(sfn + DIR_FileSize));
+			ST_DWORD(ent + XDIR_FileSize + 4, LD_DWORD(sfn + XSFN_SizeHi));
+			ST_DWORD(ent + XDIR_ValidFileSize, LD_DWORD(sfn + DIR_FileSize));
+			ST_DWORD(ent + XDIR_ValidFileSize + 4, LD_DWORD(sfn + XSFN_SizeHi));
+			fs->wflag = 1;
+		}
+		sum = xdir_sum(sum, ent, 0);
+	}
+
+	ent = xdir_ent(fs, sect, sect2, ofs);	/* Update the checksum */
+	if (!ent) return FR_DISK_ERR;
+	ST_WORD(ent + XDIR_SetSum, sum);
+	fs->wflag = 1;
+
+	return FR_OK;
+}
+#endif
+
+
+static
+FRESULT load_xdir (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp			/* Directory object pointing the file entry */
+)
+{
+	FATFS *fs = dp->fs;
+	DWORD clst;
+	UINT ofs = XDIR_OFS(dp);
+	FRESULT res;
+
+
+	res = move_window(fs, dp->sect);
+	if (res != FR_OK) return res;
+	dp->sect2 = 0;
+	if (ofs + (fs->win[ofs + XDIR_NumSec] + 1) * SZ_DIRE > SS(fs)) {	/* Does the set go over the sector? */
+		if ((dp->sect + 1 - fs->database) % fs->csize) {
+			dp->sect2 = dp->sect + 1;
+		} else {						/* and over the cluster */
+			clst = NEXT_CLUST(dp, dp->clust);
+			if (clst == 0xFFFFFFFF) return FR_DISK_ERR;
+			if (clst >= 2 && clst < fs->n_fatent) dp->sect2 = clust2sect(fs, clst);
+		}
+	}
+	res = ld_xdir(fs, dp->sect, dp->sect2, ofs);
+	dp->dir = fs->dirbuf;
+
+	return res;
+}
+
+
+static
+BYTE get_xstat (		/* Allocation status of the object (0:FAT chain, 2:contiguous) */
+	FATFS* fs,			/* File system object */
+	const BYTE* dir,	/* SFN image of the object */
+	DWORD* ncont		/* Number of clusters of the contiguous object */
+)
+{
+	FSIZE_t sz;
+	DWORD bcs;
+
+
+	*ncont = 0;
+	if (fs->fs_type != FS_EXFAT || !(dir[XSFN_Flags] & XF_NOFAT)) return 0;
+	bcs = (DWORD)fs->csize * SS(fs);
+	sz = (FSIZE_t)LD_DWORD(dir + XSFN_SizeHi) << 32 | LD_DWORD(dir + DIR_FileSize);
+	*ncont = (DWORD)((sz + bcs - 1) / bcs);
+	return 2;
+}
+
+
+static
+void enter_xdir (
+	DIR* dp			/* Directory object pointing the sub-directory to enter */
+)
+{
+	dp->stat = get_xstat(dp->fs, dp->dir, &dp->ncont);
+	dp->xsect = 0;
+	if (dp->fs->fs_type == FS_EXFAT) {	/* Keep the location of its entry set to update its size */
+		dp->xsect = dp->sect;
+		dp->xsect2 = dp->sect2;
+		dp->xofs = (WORD)XDIR_OFS(dp);
+	}
+}
+
+
+#if !_FS_READONLY
+static
+FRESULT grow_xdir (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp			/* Sub-directory stretched by a cluster */
+)
+{
+	FATFS *fs = dp->fs;
+	BYTE *sfn = fs->dirbuf;
+	FSIZE_t sz;
+	FRESULT res;
+
+
+	res = ld_xdir(fs, dp->xsect, dp->xsect2, dp->xofs);
+	if (res != FR_OK) return res;
+	sz = ((FSIZE_t)LD_DWORD(sfn + XSFN_SizeHi) << 32 | LD_DWORD(sfn + DIR_FileSize)) + (DWORD)fs->csize * SS(fs);
+	ST_DWORD(sfn + DIR_FileSize, (DWORD)sz);
+	ST_DWORD(sfn + XSFN_SizeHi, (DWORD)(sz >> 32));
+	sfn[XSFN_Flags] = (dp->stat == 2) ? XF_ALLOC | XF_NOFAT : XF_ALLOC;
+	return st_xdir(fs, dp->xsect, dp->xsect2, dp->xofs);
+}
+#endif
+#endif /* _FS_EXFAT */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Directory handling - Set directory index                              */
 /*-----------------------------------------------------------------------*/
@@ -1090,7 +1674,7 @@ FRESULT dir_sdi (	/* FR_OK(0):succeeded, !=0:error */
 	clst = dp->sclust;		/* Table start cluster (0:root) */
 	if (clst == 1 || clst >= dp->fs->n_fatent)	/* Check start cluster range */
 		return FR_INT_ERR;
-	if (!clst && dp->fs->fs_type == FS_FAT32)	/* Replace cluster# 0 with root cluster# if in FAT32 */
+	if (!clst && dp->fs->fs_type >= FS_FAT32)	/* Replace cluster# 0 with root cluster# if in FAT32/exFAT */
 		clst = dp->fs->dirbase;
 
 	if (clst == 0) {	/* Static table (root-directory in FAT12/16) */
@@ -1101,7 +1685,7 @@ FRESULT dir_sdi (	/* FR_OK(0):succeeded, !=0:error */
 	else {				/* Dynamic table (root-directory in FAT32 or sub-directory) */
 		ic = SS(dp->fs) / SZ_DIRE * dp->fs->csize;	/* Entries per cluster */
 		while (idx >= ic) {	/* Follow cluster chain */
-			clst = get_fat(dp->fs, clst);				/* Get next cluster */
+			clst = NEXT_CLUST(dp, clst);				/* Get next cluster */
 			if (clst == 0xFFFFFFFF) return FR_DISK_ERR;	/* Disk error */
 			if (clst < 2 || clst >= dp->fs->n_fatent)	/* Reached to end of table or internal error */
 				return FR_INT_ERR;
@@ -1150,13 +1734,13 @@ FRESULT dir_next (	/* FR_OK(0):succeeded, FR_NO_FILE:End of table, FR_DENIED:Cou
 		}
 		else {					/* Dynamic table */
 			if (((i / (SS(dp->fs) / SZ_DIRE)) & (dp->fs->csize - 1)) == 0) {	/* Cluster changed? */
-				clst = get_fat(dp->fs, dp->clust);				/* Get next cluster */
+				clst = NEXT_CLUST(dp, dp->clust);				/* Get next cluster */
 				if (clst <= 1) return FR_INT_ERR;
 				if (clst == 0xFFFFFFFF) return FR_DISK_ERR;
 				if (clst >= dp->fs->n_fatent) {					/* If it reached end of dynamic table, */
 #if !_FS_READONLY
 					if (!stretch) return FR_NO_FILE;			/* If do not stretch, report EOT */
-					clst = create_chain(dp->fs, dp->clust);		/* Stretch cluster chain */
+					clst = STRETCH_CHAIN(dp, dp->clust);		/* Stretch cluster chain */
 					if (clst == 0) return FR_DENIED;			/* No free cluster */
 					if (clst == 1) return FR_INT_ERR;
 					if (clst == 0xFFFFFFFF) return FR_DISK_ERR;
@@ -1170,6 +1754,9 @@ FRESULT dir_next (	/* FR_OK(0):succeeded, FR_NO_FILE:End of table, FR_DENIED:Cou
 						dp->fs->winsect++;
 					}
 					dp->fs->winsect -= c;						/* Rewind window offset */
+#if _FS_EXFAT
+					if (dp->xsect && grow_xdir(dp) != FR_OK) return FR_DISK_ERR;	/* Update the size of the sub-directory */
+#endif
 #else
 					if (!stretch) return FR_NO_FILE;			/* If do not stretch, report EOT (this is to suppress warning) */
 					return FR_NO_FILE;							/* Report EOT */
@@ -1203,6 +1790,7 @@ FRESULT dir_alloc (	/* FR_OK(0):succeeded, !=0:error */
 {
 	FRESULT res;
 	UINT n;
+	BYTE c;
 
 
 	res = dir_sdi(dp, 0);
@@ -1211,7 +1799,11 @@ FRESULT dir_alloc (	/* FR_OK(0):succeeded, !=0:error */
 		do {
 			res = move_window(dp->fs, dp->sect);
 			if (res != FR_OK) break;
-			if (dp->dir[0] == DDEM || dp->dir[0] == 0) {	/* Is it a free entry? */
+			c = dp->dir[0];
+#if _FS_EXFAT
+			if (dp->fs->fs_type == FS_EXFAT) c = (c & 0x80) ? 1 : 0;	/* exFAT entry is free when its InUse bit is 0 */
+#endif
+			if (c == DDEM || c == 0) {	/* Is it a free entry? */
 				if (++n == nent) break;	/* A block of contiguous free entries is found */
 			} else {
 				n = 0;					/* Not a blank entry. Restart to search */
@@ -1240,7 +1832,7 @@ DWORD ld_clust (	/* Returns the top cluster value of the SFN entry */
 	DWORD cl;
 
 	cl = LD_WORD(dir + DIR_FstClusLO);
-	if (fs->fs_type == FS_FAT32)
+	if (fs->fs_type >= FS_FAT32)	/* FAT32/exFAT */
 		cl |= (DWORD)LD_WORD(dir + DIR_FstClusHI) << 16;
 
 	return cl;
@@ -1468,6 +2060,23 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 	res = dir_sdi(dp, 0);			/* Rewind directory object */
 	if (res != FR_OK) return res;
 
+#if _FS_EXFAT
+	if (dp->fs->fs_type == FS_EXFAT) {	/* exFAT: compare the SFN image of each file entry */
+		do {
+			res = move_window(dp->fs, dp->sect);
+			if (res != FR_OK) break;
+			c = dp->dir[XDIR_Type];
+			if (c == 0) { res = FR_NO_FILE; break; }	/* Reached to end of table */
+			if (c == ET_FILEDIR) {
+				res = load_xdir(dp);
+				if (res != FR_OK) break;
+				if (dp->dir[DIR_Name] && !mem_cmp(dp->dir, dp->fn, 11)) break;
+			}
+			res = dir_next(dp, 0);		/* Next entry */
+		} while (res == FR_OK);
+		return res;
+	}
+#endif
 #if _USE_LFN
 	ord = sum = 0xFF; dp->lfn_idx = 0xFFFF;	/* Reset LFN sequence */
 #endif
@@ -1534,6 +2143,17 @@ FRESULT dir_read (
 		dir = dp->dir;					/* Ptr to the directory entry of current index */
 		c = dir[DIR_Name];
 		if (c == 0) { res = FR_NO_FILE; break; }	/* Reached to end of table */
+#if _FS_EXFAT
+		if (dp->fs->fs_type == FS_EXFAT) {	/* exFAT: a file entry with a visible name */
+			if (c == ET_FILEDIR && !vol) {
+				res = load_xdir(dp);
+				if (res != FR_OK || dp->dir[DIR_Name]) break;
+			}
+			res = dir_next(dp, 0);		/* Next entry */
+			if (res != FR_OK) break;
+			continue;
+		}
+#endif
 		a = dir[DIR_Attr] & AM_MASK;
 #if _USE_LFN	/* LFN configuration */
 		if (c == DDEM || (!_FS_RPATH && c == '.') || (int)((a & ~AM_ARC) == AM_VOL) != vol) {	/* An entry without valid data */
@@ -1573,6 +2193,63 @@ FRESULT dir_read (
 /*-----------------------------------------------------------------------*/
 /* Register an object to the directory                                   */
 /*-----------------------------------------------------------------------*/
+#if _FS_EXFAT && !_FS_READONLY
+static
+FRESULT xdir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry, FR_INVALID_NAME:not an ASCII name, FR_DISK_ERR:disk error */
+	DIR* dp				/* Target directory with object name to be created */
+)
+{
+	BYTE set[3 * SZ_DIRE], nm[12], c;
+	UINT i, n;
+	WORD hash, sum;
+	FRESULT res;
+
+
+	for (i = n = 0; i < 11; i++) {		/* Get the name from the SFN */
+		c = dp->fn[i];
+		if (c == ' ') continue;
+		if (c >= 0x80) return FR_INVALID_NAME;	/* Only ASCII names can be stored */
+		if (i == 8) nm[n++] = '.';
+		if (IsUpper(c) && (dp->fn[NSFLAG] & (i >= 8 ? NS_EXT : NS_BODY))) c += 0x20;
+		nm[n++] = c;
+	}
+
+	mem_set(set, 0, sizeof set);		/* Create the entry set: file, stream extension and name entry */
+	set[XDIR_Type] = ET_FILEDIR;
+	set[XDIR_NumSec] = 2;
+	set[SZ_DIRE + XDIR_Type] = ET_STREAM;
+	set[SZ_DIRE + XDIR_GenFlags] = XF_ALLOC;
+	set[SZ_DIRE + XDIR_NumName] = (BYTE)n;
+	set[2 * SZ_DIRE + XDIR_Type] = ET_FILENAME;
+	for (i = hash = 0; i < n; i++) {
+		c = nm[i];
+		ST_WORD(set + 2 * SZ_DIRE + XDIR_Name + i * 2, c);
+		if (IsLower(c)) c -= 0x20;		/* The hash is taken from the up-cased name */
+		hash = (WORD)(((hash & 1) ? 0x8000 : 0) + (hash >> 1) + c);
+		hash = (WORD)(((hash & 1) ? 0x8000 : 0) + (hash >> 1));
+	}
+	ST_WORD(set + SZ_DIRE + XDIR_NameHash, hash);
+	for (i = sum = 0; i < 3; i++) sum = xdir_sum(sum, set + i * SZ_DIRE, i == 0);
+	ST_WORD(set + XDIR_SetSum, sum);
+
+	res = dir_alloc(dp, 3);				/* Allocate entries for the set */
+	if (res == FR_OK) res = dir_sdi(dp, dp->index - 2);
+	for (i = 0; res == FR_OK; ) {		/* Store the set */
+		res = move_window(dp->fs, dp->sect);
+		if (res != FR_OK) break;
+		mem_cpy(dp->dir, set + i * SZ_DIRE, SZ_DIRE);
+		dp->fs->wflag = 1;
+		if (++i == 3) break;
+		res = dir_next(dp, 0);
+	}
+	if (res == FR_OK) res = dir_sdi(dp, dp->index - 2);
+	if (res == FR_OK) res = load_xdir(dp);	/* Create the SFN image of the new object */
+
+	return res;
+}
+#endif
+
+
 #if !_FS_READONLY
 static
 FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many SFN collision, FR_DISK_ERR:disk error */
@@ -1626,6 +2303,9 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 		}
 	}
 #else	/* Non LFN configuration */
+#if _FS_EXFAT
+	if (dp->fs->fs_type == FS_EXFAT) return xdir_register(dp);	/* Create an entry set */
+#endif
 	res = dir_alloc(dp, 1);		/* Allocate an entry for SFN */
 #endif
 
@@ -1677,6 +2357,22 @@ FRESULT dir_remove (	/* FR_OK:Succeeded, FR_DISK_ERR:A disk error */
 	}
 
 #else			/* Non LFN configuration */
+#if _FS_EXFAT
+	BYTE *ent;
+	UINT n, nsec, ofs;
+
+	if (dp->fs->fs_type == FS_EXFAT) {	/* Clear InUse bit of all entries in the set */
+		ofs = XDIR_OFS(dp);
+		for (n = nsec = 0; n <= nsec; n++) {
+			ent = xdir_ent(dp->fs, dp->sect, dp->sect2, ofs + n * SZ_DIRE);
+			if (!ent) return FR_DISK_ERR;
+			if (!n) nsec = ent[XDIR_NumSec];
+			ent[XDIR_Type] &= 0x7F;
+			dp->fs->wflag = 1;
+		}
+		return FR_OK;
+	}
+#endif
 	res = dir_sdi(dp, dp->index);
 	if (res == FR_OK) {
 		res = move_window(dp->fs, dp->sect);
@@ -1735,6 +2431,9 @@ void get_fileinfo (		/* No return code */
 		}
 		fno->fattrib = dir[DIR_Attr];				/* Attribute */
 		fno->fsize = LD_DWORD(dir + DIR_FileSize);	/* Size */
+#if _FS_EXFAT
+		if (dp->fs->fs_type == FS_EXFAT) fno->fsize |= (FSIZE_t)LD_DWORD(dir + XSFN_SizeHi) << 32;
+#endif
 		fno->fdate = LD_WORD(dir + DIR_WrtDate);	/* Date */
 		fno->ftime = LD_WORD(dir + DIR_WrtTime);	/* Time */
 	}
@@ -2069,6 +2768,9 @@ FRESULT follow_path (	/* FR_OK(0): successful, !=0: error code */
 		path++;
 	dp->sclust = 0;							/* Always start from the root directory */
 #endif
+#if _FS_EXFAT
+	dp->stat = 0; dp->xsect = 0;			/* exFAT root directory is a FAT chain and has no entry */
+#endif
 
 	if ((UINT)*path < ' ') {				/* Null path name is the origin directory itself */
 		res = dir_sdi(dp, 0);
@@ -2096,6 +2798,9 @@ FRESULT follow_path (	/* FR_OK(0): successful, !=0: error code */
 			if (!(dir[DIR_Attr] & AM_DIR)) {	/* It is not a sub-directory and cannot follow */
 				res = FR_NO_PATH; break;
 			}
+#if _FS_EXFAT
+			enter_xdir(dp);
+#endif
 			dp->sclust = ld_clust(dp->fs, dir);
 		}
 	}
@@ -2188,6 +2893,10 @@ BYTE check_fs (	/* 0:Valid FAT-BS, 1:Valid BS but not FAT, 2:Not a BS, 3:Disk er
 		return 0;
 	if ((LD_DWORD(&fs->win[BS_FilSysType32]) & 0xFFFFFF) == 0x544146)	/* Check "FAT" string */
 		return 0;
+#if _FS_EXFAT
+	if (!mem_cmp(&fs->win[BS_OEMName], "EXFAT   ", 8))	/* Check "EXFAT" string */
+		return 0;
+#endif
 
 	return 1;
 }
@@ -2195,6 +2904,90 @@ BYTE check_fs (	/* 0:Valid FAT-BS, 1:Valid BS but not FAT, 2:Not a BS, 3:Disk er
 
 
 
+#if _FS_EXFAT
+/*-----------------------------------------------------------------------*/
+/* exFAT: Initialize the file system object from the boot sector         */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT mount_exfat (	/* FR_OK(0): successful, !=0: not a supported exFAT volume */
+	FATFS* fs,			/* File system object with the boot sector in the window */
+	DWORD bsect			/* Volume start sector */
+)
+{
+	BYTE *dir;
+	DWORD tsect, dofs, nclst, clst, sect;
+	UINT i;
+	FRESULT res;
+
+
+	for (i = BPB_ZeroedEx; i < BPB_ZeroedEx + 53 && !fs->win[i]; i++) ;
+	if (i < BPB_ZeroedEx + 53) return FR_NO_FILESYSTEM;			/* (Must be zero) */
+	if (LD_WORD(fs->win + BPB_FSVerEx) != 0x100) return FR_NO_FILESYSTEM;	/* (Supports only version 1.0) */
+	if (fs->win[BPB_BytsPerSecEx] > 12 || (1U << fs->win[BPB_BytsPerSecEx]) != SS(fs))
+		return FR_NO_FILESYSTEM;								/* (Must be equal to the physical sector size) */
+	if (fs->win[BPB_SecPerClusEx] > 15) return FR_NO_FILESYSTEM;	/* (Supports up to 32768 sectors per cluster) */
+	if (fs->win[BPB_NumFATsEx] != 1) return FR_NO_FILESYSTEM;	/* (Supports only 1 FAT) */
+	if (LD_DWORD(fs->win + BPB_TotSecEx + 4)) return FR_NO_FILESYSTEM;	/* (Volume must be within 32-bit LBA) */
+	tsect = LD_DWORD(fs->win + BPB_TotSecEx);
+	if (bsect + tsect < bsect) return FR_NO_FILESYSTEM;
+
+	fs->csize = (WORD)(1U << fs->win[BPB_SecPerClusEx]);		/* Number of sectors per cluster */
+	fs->fsize = LD_DWORD(fs->win + BPB_FatSzEx);				/* Number of sectors per FAT */
+	fs->n_fats = 1;
+	fs->n_rootdir = 0;
+	dofs = LD_DWORD(fs->win + BPB_DataOfsEx);
+	nclst = LD_DWORD(fs->win + BPB_NumClusEx);					/* Number of clusters */
+	if (!nclst || nclst > 0x7FFFFFFD							/* (Invalid number of clusters) */
+		|| dofs > tsect || (tsect - dofs) / fs->csize < nclst	/* (Data area must be in the volume) */
+		|| fs->fsize < (nclst + 2 + SS(fs) / 4 - 1) / (SS(fs) / 4))	/* (FAT size must not be less than the size needed) */
+		return FR_NO_FILESYSTEM;
+	fs->n_fatent = nclst + 2;									/* Number of FAT entries */
+	fs->volbase = bsect;										/* Volume start sector */
+	fs->fatbase = bsect + LD_DWORD(fs->win + BPB_FatOfsEx);	/* FAT start sector */
+	fs->database = bsect + dofs;								/* Data start sector */
+	fs->dirbase = LD_DWORD(fs->win + BPB_RootClusEx);			/* Root directory start cluster */
+	if (fs->dirbase < 2 || fs->dirbase >= fs->n_fatent) return FR_NO_FILESYSTEM;
+#if !_FS_READONLY
+	fs->last_clust = fs->free_clust = 0xFFFFFFFF;				/* Initialize cluster allocation information */
+	fs->fsi_flag = 0x80;										/* (No FSINFO) */
+#endif
+
+	/* Find the allocation bitmap entry in the root directory */
+	fs->fs_type = FS_EXFAT;		/* (To follow the FAT chain of the root directory) */
+	clst = fs->dirbase;
+	sect = clust2sect(fs, clst);
+	i = 0;
+	for (;;) {
+		if (move_window(fs, sect) != FR_OK) { res = FR_DISK_ERR; break; }
+		dir = fs->win + i;
+		if (dir[XDIR_Type] == 0) { res = FR_NO_FILESYSTEM; break; }	/* (No allocation bitmap) */
+		if (dir[XDIR_Type] == ET_BITMAP) {
+			clst = LD_DWORD(dir + XDIR_FstClus);
+			fs->bitbase = clust2sect(fs, clst);
+			res = (fs->bitbase && LD_DWORD(dir + XDIR_FileSize) >= (nclst + 7) / 8) ? FR_OK : FR_NO_FILESYSTEM;
+			break;
+		}
+		i += SZ_DIRE;
+		if (i == SS(fs)) {			/* Next sector */
+			i = 0; sect++;
+			if (!((sect - fs->database) % fs->csize)) {	/* Next cluster */
+				clst = get_fat(fs, clst);
+				if (clst == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+				if (clst < 2 || clst >= fs->n_fatent) { res = FR_NO_FILESYSTEM; break; }
+				sect = clust2sect(fs, clst);
+			}
+		}
+	}
+	fs->fs_type = 0;
+
+	return res;
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Find logical drive and check if the volume is mounted                 */
 /*-----------------------------------------------------------------------*/
@@ -2213,6 +3006,9 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 	WORD nrsv;
 	FATFS *fs;
 	UINT i;
+#if _FS_EXFAT
+	FRESULT res;
+#endif
 
 
 	/* Get logical drive number from the path name */
@@ -2268,6 +3064,19 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 	if (fmt == 3) return FR_DISK_ERR;		/* An error occured in the disk I/O layer */
 	if (fmt) return FR_NO_FILESYSTEM;		/* No FAT volume is found */
 
+#if _FS_EXFAT
+	if (!mem_cmp(fs->win + BS_OEMName, "EXFAT   ", 8)) {	/* An exFAT volume is found */
+		res = mount_exfat(fs, bsect);
+		if (res != FR_OK) return res;
+		fs->fs_type = FS_EXFAT;
+		fs->id = ++Fsid;	/* File system mount ID */
+#if _FS_LOCK
+		clear_lock(fs);
+#endif
+		return FR_OK;
+	}
+#endif
+
 	/* An FAT volume is found. Following code initializes the file system object */
 
 	if (LD_WORD(fs->win + BPB_BytsPerSec) != SS(fs))	/* (BPB_BytsPerSec must be equal to the physical sector size) */
@@ -2458,6 +3267,10 @@ FRESULT f_open (
 	DEFINE_NAMEBUF;
 #if !_FS_READONLY
 	DWORD dw, cl;
+#if _FS_EXFAT
+	DWORD nc;
+	BYTE st;
+#endif
 #endif
 
 
@@ -2507,19 +3320,39 @@ FRESULT f_open (
 			}
 			if (res == FR_OK && (mode & FA_CREATE_ALWAYS)) {	/* Truncate it if overwrite mode */
 				dw = GET_FATTIME();
-				ST_DWORD(dir + DIR_CrtTime, dw);/* Set created time */
-				ST_DWORD(dir + DIR_WrtTime, dw);/* Set modified time */
-				dir[DIR_Attr] = 0;				/* Reset attribute */
-				ST_DWORD(dir + DIR_FileSize, 0);/* Reset file size */
-				cl = ld_clust(dj.fs, dir);		/* Get cluster chain */
-				st_clust(dir, 0);				/* Reset cluster */
-				dj.fs->wflag = 1;
-				if (cl) {						/* Remove the cluster chain if exist */
-					dw = dj.fs->winsect;
-					res = remove_chain(dj.fs, cl);
-					if (res == FR_OK) {
-						dj.fs->last_clust = cl - 1;	/* Reuse the cluster hole */
-						res = move_window(dj.fs, dw);
+#if _FS_EXFAT
+				if (dj.fs->fs_type == FS_EXFAT) {
+					st = get_xstat(dj.fs, dir, &nc);	/* Get allocation of the old data */
+					cl = ld_clust(dj.fs, dir);
+					ST_DWORD(dir + DIR_CrtTime, dw);
+					ST_DWORD(dir + DIR_WrtTime, dw);
+					dir[DIR_Attr] = 0;
+					ST_DWORD(dir + DIR_FileSize, 0);
+					ST_DWORD(dir + XSFN_SizeHi, 0);
+					dir[XSFN_Flags] = XF_ALLOC;
+					st_clust(dir, 0);
+					res = st_xdir(dj.fs, dj.sect, dj.sect2, XDIR_OFS(&dj));	/* Update the entry set */
+					if (res == FR_OK && cl) {		/* Remove the old data if exist */
+						res = remove_xchain(dj.fs, cl, st, nc);
+						if (res == FR_OK) dj.fs->last_clust = cl - 1;	/* Reuse the cluster hole */
+					}
+				} else
+#endif
+				{
+					ST_DWORD(dir + DIR_CrtTime, dw);/* Set created time */
+					ST_DWORD(dir + DIR_WrtTime, dw);/* Set modified time */
+					dir[DIR_Attr] = 0;				/* Reset attribute */
+					ST_DWORD(dir + DIR_FileSize, 0);/* Reset file size */
+					cl = ld_clust(dj.fs, dir);		/* Get cluster chain */
+					st_clust(dir, 0);				/* Reset cluster */
+					dj.fs->wflag = 1;
+					if (cl) {						/* Remove the cluster chain if exist */
+						dw = dj.fs->winsect;
+						res = remove_chain(dj.fs, cl);
+						if (res == FR_OK) {
+							dj.fs->last_clust = cl - 1;	/* Reuse the cluster hole */
+							res = move_window(dj.fs, dw);
+						}
 					}
 				}
 			}
@@ -2539,6 +3372,13 @@ FRESULT f_open (
 				mode |= FA__WRITTEN;
 			fp->dir_sect = dj.fs->winsect;		/* Pointer to the directory entry */
 			fp->dir_ptr = dir;
+#if _FS_EXFAT
+			if (dj.fs->fs_type == FS_EXFAT) {	/* Location of the entry set */
+				fp->dir_sect = dj.sect;
+				fp->dir_sect2 = dj.sect2;
+				fp->dir_ptr = dj.fs->win + XDIR_OFS(&dj);
+			}
+#endif
 #if _FS_LOCK
 			fp->lockid = inc_lock(&dj, (mode & ~FA_READ) ? 1 : 0);
 			if (!fp->lockid) res = FR_INT_ERR;
@@ -2563,6 +3403,10 @@ FRESULT f_open (
 			fp->err = 0;						/* Clear error flag */
 			fp->sclust = ld_clust(dj.fs, dir);	/* File start cluster */
 			fp->fsize = LD_DWORD(dir + DIR_FileSize);	/* File size */
+#if _FS_EXFAT
+			if (dj.fs->fs_type == FS_EXFAT) fp->fsize |= (FSIZE_t)LD_DWORD(dir + XSFN_SizeHi) << 32;
+			fp->stat = get_xstat(dj.fs, dir, &fp->ncont);	/* Contiguous or FAT chain */
+#endif
 			fp->fptr = 0;						/* File pointer */
 			fp->dsect = 0;
 #if _USE_FASTSEEK
@@ -2591,9 +3435,10 @@ FRESULT f_read (
 )
 {
 	FRESULT res;
-	DWORD clst, sect, remain;
-	UINT rcnt, cc;
-	BYTE csect, *rbuff = (BYTE*)buff;
+	DWORD clst, sect;
+	FSIZE_t remain;
+	UINT rcnt, cc, csect;
+	BYTE *rbuff = (BYTE*)buff;
 
 
 	*br = 0;	/* Clear read byte counter */
@@ -2610,7 +3455,7 @@ FRESULT f_read (
 	for ( ;  btr;								/* Repeat until all data read */
 		rbuff += rcnt, fp->fptr += rcnt, *br += rcnt, btr -= rcnt) {
 		if ((fp->fptr % SS(fp->fs)) == 0) {		/* On the sector boundary? */
-			csect = (BYTE)(fp->fptr / SS(fp->fs) & (fp->fs->csize - 1));	/* Sector offset in the cluster */
+			csect = (UINT)(fp->fptr / SS(fp->fs) & (fp->fs->csize - 1));	/* Sector offset in the cluster */
 			if (!csect) {						/* On the cluster boundary? */
 				if (fp->fptr == 0) {			/* On the top of the file? */
 					clst = fp->sclust;			/* Follow from the origin */
@@ -2620,7 +3465,7 @@ FRESULT f_read (
 						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the CLMT */
 					else
 #endif
-						clst = get_fat(fp->fs, fp->clust);	/* Follow cluster chain on the FAT */
+						clst = NEXT_CLUST(fp, fp->clust);	/* Follow cluster chain on the FAT */
 				}
 				if (clst < 2) ABORT(fp->fs, FR_INT_ERR);
 				if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
@@ -2693,9 +3538,8 @@ FRESULT f_write (
 {
 	FRESULT res;
 	DWORD clst, sect;
-	UINT wcnt, cc;
+	UINT wcnt, cc, csect;
 	const BYTE *wbuff = (const BYTE*)buff;
-	BYTE csect;
 
 
 	*bw = 0;	/* Clear write byte counter */
@@ -2706,24 +3550,28 @@ FRESULT f_write (
 		LEAVE_FF(fp->fs, (FRESULT)fp->err);
 	if (!(fp->flag & FA_WRITE))				/* Check access mode */
 		LEAVE_FF(fp->fs, FR_DENIED);
-	if (fp->fptr + btw < fp->fptr) btw = 0;	/* File size cannot reach 4GB */
+	if ((DWORD)(fp->fptr + btw) < (DWORD)fp->fptr	/* File size cannot reach 4GB on FAT volume */
+#if _FS_EXFAT
+		&& fp->fs->fs_type != FS_EXFAT
+#endif
+		) btw = 0;
 
 	for ( ;  btw;							/* Repeat until all data written */
 		wbuff += wcnt, fp->fptr += wcnt, *bw += wcnt, btw -= wcnt) {
 		if ((fp->fptr % SS(fp->fs)) == 0) {	/* On the sector boundary? */
-			csect = (BYTE)(fp->fptr / SS(fp->fs) & (fp->fs->csize - 1));	/* Sector offset in the cluster */
+			csect = (UINT)(fp->fptr / SS(fp->fs) & (fp->fs->csize - 1));	/* Sector offset in the cluster */
 			if (!csect) {					/* On the cluster boundary? */
 				if (fp->fptr == 0) {		/* On the top of the file? */
 					clst = fp->sclust;		/* Follow from the origin */
 					if (clst == 0)			/* When no cluster is allocated, */
-						clst = create_chain(fp->fs, 0);	/* Create a new cluster chain */
+						clst = STRETCH_CHAIN(fp, 0);	/* Create a new cluster chain */
 				} else {					/* Middle or end of the file */
 #if _USE_FASTSEEK
 					if (fp->cltbl)
 						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the CLMT */
 					else
 #endif
-						clst = create_chain(fp->fs, fp->clust);	/* Follow or stretch cluster chain on the FAT */
+						clst = STRETCH_CHAIN(fp, fp->clust);	/* Follow or stretch cluster chain on the FAT */
 				}
 				if (clst == 0) break;		/* Could not allocate a new cluster (disk full) */
 				if (clst == 1) ABORT(fp->fs, FR_INT_ERR);
@@ -2826,6 +3674,27 @@ FRESULT f_sync (
 			}
 #endif
 			/* Update the directory entry */
+#if _FS_EXFAT
+			if (fp->fs->fs_type == FS_EXFAT) {
+				res = ld_xdir(fp->fs, fp->dir_sect, fp->dir_sect2, (UINT)(fp->dir_ptr - fp->fs->win));
+				if (res == FR_OK) {
+					dir = fp->fs->dirbuf;
+					dir[DIR_Attr] |= AM_ARC;					/* Set archive bit */
+					ST_DWORD(dir + DIR_FileSize, (DWORD)fp->fsize);	/* Update file size */
+					ST_DWORD(dir + XSFN_SizeHi, (DWORD)(fp->fsize >> 32));
+					st_clust(dir, fp->sclust);					/* Update start cluster */
+					dir[XSFN_Flags] = (fp->stat == 2) ? XF_ALLOC | XF_NOFAT : XF_ALLOC;	/* Contiguous or FAT chain */
+					tm = GET_FATTIME();							/* Update modified time */
+					ST_DWORD(dir + DIR_WrtTime, tm);
+					res = st_xdir(fp->fs, fp->dir_sect, fp->dir_sect2, (UINT)(fp->dir_ptr - fp->fs->win));
+				}
+				if (res == FR_OK) {
+					fp->flag &= ~FA__WRITTEN;
+					res = sync_fs(fp->fs);
+				}
+				LEAVE_FF(fp->fs, res);
+			}
+#endif
 			res = move_window(fp->fs, fp->dir_sect);
 			if (res == FR_OK) {
 				dir = fp->dir_ptr;
@@ -3028,11 +3897,12 @@ FRESULT f_getcwd (
 
 FRESULT f_lseek (
 	FIL* fp,		/* Pointer to the file object */
-	DWORD ofs		/* File pointer from top of file */
+	FSIZE_t ofs		/* File pointer from top of file */
 )
 {
 	FRESULT res;
-	DWORD clst, bcs, nsect, ifptr;
+	DWORD clst, bcs, nsect;
+	FSIZE_t ifptr;
 #if _USE_FASTSEEK
 	DWORD cl, pcl, ncl, tcl, dsc, tlen, ulen, *tbl;
 #endif
@@ -3055,7 +3925,7 @@ FRESULT f_lseek (
 					tcl = cl; ncl = 0; ulen += 2;	/* Top, length and used items */
 					do {
 						pcl = cl; ncl++;
-						cl = get_fat(fp->fs, cl);
+						cl = NEXT_CLUST(fp, cl);
 						if (cl <= 1) ABORT(fp->fs, FR_INT_ERR);
 						if (cl == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
 					} while (cl == pcl + 1);
@@ -3078,7 +3948,7 @@ FRESULT f_lseek (
 				fp->clust = clmt_clust(fp, ofs - 1);
 				dsc = clust2sect(fp->fs, fp->clust);
 				if (!dsc) ABORT(fp->fs, FR_INT_ERR);
-				dsc += (ofs - 1) / SS(fp->fs) & (fp->fs->csize - 1);
+				dsc += (DWORD)((ofs - 1) / SS(fp->fs)) & (fp->fs->csize - 1);
 				if (fp->fptr % SS(fp->fs) && dsc != fp->dsect) {	/* Refill sector cache if needed */
 #if !_FS_TINY
 #if !_FS_READONLY
@@ -3105,6 +3975,9 @@ FRESULT f_lseek (
 			 && !(fp->flag & FA_WRITE)
 #endif
 			) ofs = fp->fsize;
+#if _FS_EXFAT
+		if (fp->fs->fs_type != FS_EXFAT && ofs > 0xFFFFFFFF) ofs = 0xFFFFFFFF;	/* Clip at 4GB on FAT volume */
+#endif
 
 		ifptr = fp->fptr;
 		fp->fptr = nsect = 0;
@@ -3112,14 +3985,14 @@ FRESULT f_lseek (
 			bcs = (DWORD)fp->fs->csize * SS(fp->fs);	/* Cluster size (byte) */
 			if (ifptr > 0 &&
 				(ofs - 1) / bcs >= (ifptr - 1) / bcs) {	/* When seek to same or following cluster, */
-				fp->fptr = (ifptr - 1) & ~(bcs - 1);	/* start from the current cluster */
+				fp->fptr = (ifptr - 1) & ~(FSIZE_t)(bcs - 1);	/* start from the current cluster */
 				ofs -= fp->fptr;
 				clst = fp->clust;
 			} else {									/* When seek to back cluster, */
 				clst = fp->sclust;						/* start from the first cluster */
 #if !_FS_READONLY
 				if (clst == 0) {						/* If no cluster chain, create a new chain */
-					clst = create_chain(fp->fs, 0);
+					clst = STRETCH_CHAIN(fp, 0);
 					if (clst == 1) ABORT(fp->fs, FR_INT_ERR);
 					if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
 					fp->sclust = clst;
@@ -3131,13 +4004,13 @@ FRESULT f_lseek (
 				while (ofs > bcs) {						/* Cluster following loop */
 #if !_FS_READONLY
 					if (fp->flag & FA_WRITE) {			/* Check if in write mode or not */
-						clst = create_chain(fp->fs, clst);	/* Force stretch if in write mode */
+						clst = STRETCH_CHAIN(fp, clst);	/* Force stretch if in write mode */
 						if (clst == 0) {				/* When disk gets full, clip file size */
 							ofs = bcs; break;
 						}
 					} else
 #endif
-						clst = get_fat(fp->fs, clst);	/* Follow cluster chain if not in write mode */
+						clst = NEXT_CLUST(fp, clst);	/* Follow cluster chain if not in write mode */
 					if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
 					if (clst <= 1 || clst >= fp->fs->n_fatent) ABORT(fp->fs, FR_INT_ERR);
 					fp->clust = clst;
@@ -3148,7 +4021,7 @@ FRESULT f_lseek (
 				if (ofs % SS(fp->fs)) {
 					nsect = clust2sect(fp->fs, clst);	/* Current sector */
 					if (!nsect) ABORT(fp->fs, FR_INT_ERR);
-					nsect += ofs / SS(fp->fs);
+					nsect += (DWORD)(ofs / SS(fp->fs));
 				}
 			}
 		}
@@ -3205,10 +4078,14 @@ FRESULT f_opendir (
 		FREE_BUF();
 		if (res == FR_OK) {						/* Follow completed */
 			if (dp->dir) {						/* It is not the origin directory itself */
-				if (dp->dir[DIR_Attr] & AM_DIR)	/* The object is a sub directory */
+				if (dp->dir[DIR_Attr] & AM_DIR) {	/* The object is a sub directory */
+#if _FS_EXFAT
+					enter_xdir(dp);
+#endif
 					dp->sclust = ld_clust(fs, dp->dir);
-				else							/* The object is a file */
+				} else {						/* The object is a file */
 					res = FR_NO_PATH;
+				}
 			}
 			if (res == FR_OK) {
 				dp->id = fs->id;
@@ -3412,6 +4289,10 @@ FRESULT f_getfree (
 	DWORD nfree, clst, sect, stat;
 	UINT i;
 	BYTE fat, *p;
+#if _FS_EXFAT
+	BYTE bm;
+	UINT b;
+#endif
 
 
 	/* Get logical drive number */
@@ -3425,6 +4306,24 @@ FRESULT f_getfree (
 			/* Get number of free clusters */
 			fat = fs->fs_type;
 			nfree = 0;
+#if _FS_EXFAT
+			if (fat == FS_EXFAT) {	/* exFAT: Count the clear bits in the allocation bitmap */
+				clst = fs->n_fatent - 2; sect = fs->bitbase;
+				i = 0;
+				do {
+					if (!i) {
+						res = move_window(fs, sect++);
+						if (res != FR_OK) break;
+					}
+					bm = fs->win[i];
+					for (b = 8; b && clst; b--, clst--) {
+						if (!(bm & 1)) nfree++;
+						bm >>= 1;
+					}
+					i = (i + 1) % SS(fs);
+				} while (clst);
+			} else
+#endif
 			if (fat == FS_FAT12) {	/* Sector unalighed entries: Search FAT via regular routine. */
 				clst = 2;
 				do {
@@ -3489,16 +4388,29 @@ FRESULT f_truncate (
 			fp->fsize = fp->fptr;	/* Set file size to current R/W point */
 			fp->flag |= FA__WRITTEN;
 			if (fp->fptr == 0) {	/* When set file size to zero, remove entire cluster chain */
+#if _FS_EXFAT
+				res = remove_xchain(fp->fs, fp->sclust, fp->stat, fp->ncont);
+				fp->stat = 0;
+#else
 				res = remove_chain(fp->fs, fp->sclust);
+#endif
 				fp->sclust = 0;
 			} else {				/* When truncate a part of the file, remove remaining clusters */
-				ncl = get_fat(fp->fs, fp->clust);
+				ncl = NEXT_CLUST(fp, fp->clust);
 				res = FR_OK;
 				if (ncl == 0xFFFFFFFF) res = FR_DISK_ERR;
 				if (ncl == 1) res = FR_INT_ERR;
 				if (res == FR_OK && ncl < fp->fs->n_fatent) {
-					res = put_fat(fp->fs, fp->clust, 0x0FFFFFFF);
-					if (res == FR_OK) res = remove_chain(fp->fs, ncl);
+#if _FS_EXFAT
+					if (fp->stat == 2) {	/* Contiguous: release the clusters following the current one */
+						res = remove_xchain(fp->fs, ncl, 2, fp->ncont - (fp->clust - fp->sclust + 1));
+						if (res == FR_OK) fp->ncont = fp->clust - fp->sclust + 1;
+					} else
+#endif
+					{
+						res = put_fat(fp->fs, fp->clust, 0x0FFFFFFF);
+						if (res == FR_OK) res = remove_chain(fp->fs, ncl);
+					}
 				}
 			}
 #if !_FS_TINY
@@ -3531,6 +4443,10 @@ FRESULT f_unlink (
 	DIR dj, sdj;
 	BYTE *dir;
 	DWORD dclst = 0;
+#if _FS_EXFAT
+	DWORD nc;
+	BYTE st;
+#endif
 	DEFINE_NAMEBUF;
 
 
@@ -3554,6 +4470,9 @@ FRESULT f_unlink (
 			}
 			if (res == FR_OK) {
 				dclst = ld_clust(dj.fs, dir);
+#if _FS_EXFAT
+				st = get_xstat(dj.fs, dir, &nc);	/* Contiguous or FAT chain */
+#endif
 				if (dclst && (dir[DIR_Attr] & AM_DIR)) {	/* Is it a sub-directory ? */
 #if _FS_RPATH
 					if (dclst == dj.fs->cdir) {		 		/* Is it the current directory? */
@@ -3562,12 +4481,30 @@ FRESULT f_unlink (
 #endif
 					{
 						mem_cpy(&sdj, &dj, sizeof (DIR));	/* Open the sub-directory */
+#if _FS_EXFAT
+						enter_xdir(&sdj);
+#endif
 						sdj.sclust = dclst;
-						res = dir_sdi(&sdj, 2);
-						if (res == FR_OK) {
-							res = dir_read(&sdj, 0);			/* Read an item (excluding dot entries) */
-							if (res == FR_OK) res = FR_DENIED;	/* Not empty? (cannot remove) */
-							if (res == FR_NO_FILE) res = FR_OK;	/* Empty? (can remove) */
+#if _FS_EXFAT
+						if (dj.fs->fs_type == FS_EXFAT) {	/* Any file entry, visible or not, makes it not empty */
+							res = dir_sdi(&sdj, 0);
+							while (res == FR_OK) {
+								res = move_window(sdj.fs, sdj.sect);
+								if (res != FR_OK) break;
+								if (sdj.dir[XDIR_Type] == 0) break;
+								if (sdj.dir[XDIR_Type] == ET_FILEDIR) res = FR_DENIED;
+								else res = dir_next(&sdj, 0);
+							}
+							if (res == FR_NO_FILE) res = FR_OK;
+						} else
+#endif
+						{
+							res = dir_sdi(&sdj, 2);
+							if (res == FR_OK) {
+								res = dir_read(&sdj, 0);			/* Read an item (excluding dot entries) */
+								if (res == FR_OK) res = FR_DENIED;	/* Not empty? (cannot remove) */
+								if (res == FR_NO_FILE) res = FR_OK;	/* Empty? (can remove) */
+							}
 						}
 					}
 				}
@@ -3575,7 +4512,11 @@ FRESULT f_unlink (
 			if (res == FR_OK) {
 				res = dir_remove(&dj);		/* Remove the directory entry */
 				if (res == FR_OK && dclst)	/* Remove the cluster chain if exist */
+#if _FS_EXFAT
+					res = remove_xchain(dj.fs, dclst, st, nc);
+#else
 					res = remove_chain(dj.fs, dclst);
+#endif
 				if (res == FR_OK) res = sync_fs(dj.fs);
 			}
 		}
@@ -3598,8 +4539,13 @@ FRESULT f_mkdir (
 {
 	FRESULT res;
 	DIR dj;
-	BYTE *dir, n;
+	BYTE *dir;
+	UINT n;
 	DWORD dsc, dcl, pcl, tm = GET_FATTIME();
+#if _FS_EXFAT
+	DWORD nc;
+	BYTE st;
+#endif
 	DEFINE_NAMEBUF;
 
 
@@ -3612,7 +4558,11 @@ FRESULT f_mkdir (
 		if (_FS_RPATH && res == FR_NO_FILE && (dj.fn[NSFLAG] & NS_DOT))
 			res = FR_INVALID_NAME;
 		if (res == FR_NO_FILE) {				/* Can create a new directory */
+#if _FS_EXFAT
+			dcl = create_xchain(dj.fs, 0, 0, &st, &nc);	/* Allocate a cluster for the new directory table */
+#else
 			dcl = create_chain(dj.fs, 0);		/* Allocate a cluster for the new directory table */
+#endif
 			res = FR_OK;
 			if (dcl == 0) res = FR_DENIED;		/* No space to allocate a new cluster */
 			if (dcl == 1) res = FR_INT_ERR;
@@ -3623,16 +4573,21 @@ FRESULT f_mkdir (
 				dsc = clust2sect(dj.fs, dcl);
 				dir = dj.fs->win;
 				mem_set(dir, 0, SS(dj.fs));
-				mem_set(dir + DIR_Name, ' ', 11);	/* Create "." entry */
-				dir[DIR_Name] = '.';
-				dir[DIR_Attr] = AM_DIR;
-				ST_DWORD(dir + DIR_WrtTime, tm);
-				st_clust(dir, dcl);
-				mem_cpy(dir + SZ_DIRE, dir, SZ_DIRE); 	/* Create ".." entry */
-				dir[SZ_DIRE + 1] = '.'; pcl = dj.sclust;
-				if (dj.fs->fs_type == FS_FAT32 && pcl == dj.fs->dirbase)
-					pcl = 0;
-				st_clust(dir + SZ_DIRE, pcl);
+#if _FS_EXFAT
+				if (dj.fs->fs_type != FS_EXFAT)		/* (exFAT directory has no dot entries) */
+#endif
+				{
+					mem_set(dir + DIR_Name, ' ', 11);	/* Create "." entry */
+					dir[DIR_Name] = '.';
+					dir[DIR_Attr] = AM_DIR;
+					ST_DWORD(dir + DIR_WrtTime, tm);
+					st_clust(dir, dcl);
+					mem_cpy(dir + SZ_DIRE, dir, SZ_DIRE); 	/* Create ".." entry */
+					dir[SZ_DIRE + 1] = '.'; pcl = dj.sclust;
+					if (dj.fs->fs_type == FS_FAT32 && pcl == dj.fs->dirbase)
+						pcl = 0;
+					st_clust(dir + SZ_DIRE, pcl);
+				}
 				for (n = dj.fs->csize; n; n--) {	/* Write dot entries and clear following sectors */
 					dj.fs->winsect = dsc++;
 					dj.fs->wflag = 1;
@@ -3643,13 +4598,26 @@ FRESULT f_mkdir (
 			}
 			if (res == FR_OK) res = dir_register(&dj);	/* Register the object to the directoy */
 			if (res != FR_OK) {
+#if _FS_EXFAT
+				remove_xchain(dj.fs, dcl, st, nc);	/* Could not register, remove cluster chain */
+#else
 				remove_chain(dj.fs, dcl);			/* Could not register, remove cluster chain */
+#endif
 			} else {
 				dir = dj.dir;
 				dir[DIR_Attr] = AM_DIR;				/* Attribute */
 				ST_DWORD(dir + DIR_WrtTime, tm);	/* Created time */
 				st_clust(dir, dcl);					/* Table start cluster */
 				dj.fs->wflag = 1;
+#if _FS_EXFAT
+				if (dj.fs->fs_type == FS_EXFAT) {	/* A contiguous directory of one cluster */
+					ST_DWORD(dir + DIR_CrtTime, tm);
+					ST_DWORD(dir + DIR_FileSize, (DWORD)dj.fs->csize * SS(dj.fs));
+					dir[XSFN_Flags] = XF_ALLOC | XF_NOFAT;
+					res = st_xdir(dj.fs, dj.sect, dj.sect2, XDIR_OFS(&dj));
+				}
+				if (res == FR_OK)
+#endif
 				res = sync_fs(dj.fs);
 			}
 		}
@@ -3693,6 +4661,11 @@ FRESULT f_chmod (
 				mask &= AM_RDO|AM_HID|AM_SYS|AM_ARC;	/* Valid attribute mask */
 				dir[DIR_Attr] = (attr & mask) | (dir[DIR_Attr] & (BYTE)~mask);	/* Apply attribute change */
 				dj.fs->wflag = 1;
+#if _FS_EXFAT
+				if (dj.fs->fs_type == FS_EXFAT)
+					res = st_xdir(dj.fs, dj.sect, dj.sect2, XDIR_OFS(&dj));
+				if (res == FR_OK)
+#endif
 				res = sync_fs(dj.fs);
 			}
 		}
@@ -3715,7 +4688,11 @@ FRESULT f_rename (
 {
 	FRESULT res;
 	DIR djo, djn;
+#if _FS_EXFAT
+	BYTE buf[29], *dir;		/* (Also the exFAT part of the SFN image) */
+#else
 	BYTE buf[21], *dir;
+#endif
 	DWORD dw;
 	DEFINE_NAMEBUF;
 
@@ -3736,6 +4713,9 @@ FRESULT f_rename (
 				res = FR_NO_FILE;
 			} else {
 				mem_cpy(buf, djo.dir + DIR_Attr, 21);	/* Save information about object except name */
+#if _FS_EXFAT
+				if (djo.fs->fs_type == FS_EXFAT) mem_cpy(buf, djo.dir + DIR_Attr, sizeof buf);
+#endif
 				mem_cpy(&djn, &djo, sizeof (DIR));		/* Duplicate the directory object */
 				if (get_ldnumber(&path_new) >= 0)		/* Snip drive number off and ignore it */
 					res = follow_path(&djn, path_new);	/* and make sure if new object name is not conflicting */
@@ -3746,6 +4726,18 @@ FRESULT f_rename (
 					res = dir_register(&djn);			/* Register the new entry */
 					if (res == FR_OK) {
 /* Start of critical section where any interruption can cause a cross-link */
+#if _FS_EXFAT
+						if (djo.fs->fs_type == FS_EXFAT) {	/* Copy it into the new entry set (no .. entry) */
+							dir = djn.dir;
+							mem_cpy(dir + 13, buf + 2, sizeof buf - 2);
+							dir[DIR_Attr] = buf[0] | AM_ARC;
+							res = st_xdir(djn.fs, djn.sect, djn.sect2, XDIR_OFS(&djn));
+							if (res == FR_OK) res = dir_remove(&djo);
+							if (res == FR_OK) res = sync_fs(djo.fs);
+							FREE_BUF();
+							LEAVE_FF(djo.fs, res);
+						}
+#endif
 						dir = djn.dir;					/* Copy information about object except name */
 						mem_cpy(dir + 13, buf + 2, 19);
 						dir[DIR_Attr] = buf[0] | AM_ARC;
@@ -3813,6 +4805,11 @@ FRESULT f_utime (
 				ST_WORD(dir + DIR_WrtTime, fno->ftime);
 				ST_WORD(dir + DIR_WrtDate, fno->fdate);
 				dj.fs->wflag = 1;
+#if _FS_EXFAT
+				if (dj.fs->fs_type == FS_EXFAT)
+					res = st_xdir(dj.fs, dj.sect, dj.sect2, XDIR_OFS(&dj));
+				if (res == FR_OK)
+#endif
 				res = sync_fs(dj.fs);
 			}
 		}
@@ -4005,9 +5002,9 @@ FRESULT f_forward (
 )
 {
 	FRESULT res;
-	DWORD remain, clst, sect;
-	UINT rcnt;
-	BYTE csect;
+	DWORD clst, sect;
+	FSIZE_t remain;
+	UINT rcnt, csect;
 
 
 	*bf = 0;	/* Clear transfer byte counter */
@@ -4024,11 +5021,11 @@ FRESULT f_forward (
 
 	for ( ;  btf && (*func)(0, 0);					/* Repeat until all data transferred or stream becomes busy */
 		fp->fptr += rcnt, *bf += rcnt, btf -= rcnt) {
-		csect = (BYTE)(fp->fptr / SS(fp->fs) & (fp->fs->csize - 1));	/* Sector offset in the cluster */
+		csect = (UINT)(fp->fptr / SS(fp->fs) & (fp->fs->csize - 1));	/* Sector offset in the cluster */
 		if ((fp->fptr % SS(fp->fs)) == 0) {			/* On the sector boundary? */
 			if (!csect) {							/* On the cluster boundary? */
 				clst = (fp->fptr == 0) ?			/* On the top of the file? */
-					fp->sclust : get_fat(fp->fs, fp->clust);
+					fp->sclust : NEXT_CLUST(fp, fp->clust);
 				if (clst <= 1) ABORT(fp->fs, FR_INT_ERR);
 				if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
 				fp->clust = clst;					/* Update current cluster */
@@ -4074,6 +5071,7 @@ FRESULT f_mkfs (
 	UINT i;
 	DWORD b_vol, b_fat, b_dir, b_data;	/* LBA */
 	DWORD n_vol, n_rsv, n_fat, n_dir;	/* Size */
+	DWORD sz_blk;						/* Erase block (AU) size */
 	FATFS *fs;
 	DSTATUS stat;
 #if _USE_TRIM
@@ -4099,6 +5097,9 @@ FRESULT f_mkfs (
 	if (disk_ioctl(pdrv, GET_SECTOR_SIZE, &SS(fs)) != RES_OK || SS(fs) > _MAX_SS || SS(fs) < _MIN_SS)
 		return FR_DISK_ERR;
 #endif
+	/* Get erase block size. It need not be a power of 2 (SDXC AUs of 12MB and 24MB) */
+	if (disk_ioctl(pdrv, GET_BLOCK_SIZE, &sz_blk) != RES_OK || !sz_blk || sz_blk > 0x20000) sz_blk = 1;
+
 	if (_MULTI_PARTITION && part) {
 		/* Get partition information from partition table in the MBR */
 		if (disk_read(pdrv, fs->win, 0, 1) != RES_OK) return FR_DISK_ERR;
@@ -4114,6 +5115,7 @@ FRESULT f_mkfs (
 		b_vol = (sfd) ? 0 : 63;		/* Volume start sector */
 		n_vol -= b_vol;				/* Volume size */
 	}
+	if (sz_blk >= n_vol / 16) sz_blk = 1;	/* Too large to align to */
 
 	if (au & (au - 1)) au = 0;
 	if (!au) {						/* AU auto selection */
@@ -4142,21 +5144,23 @@ FRESULT f_mkfs (
 		n_rsv = 1;
 		n_dir = (DWORD)N_ROOTDIR * SZ_DIRE / SS(fs);
 	}
+	if (!sfd && !(_MULTI_PARTITION && part)) {
+		/* Move the partition start so that the FAT area starts on an erase block boundary */
+		n = (b_vol + n_rsv + sz_blk - 1) / sz_blk * sz_blk - n_rsv;
+		n_vol -= n - b_vol;
+		b_vol = n;
+	}
 	b_fat = b_vol + n_rsv;				/* FAT area start sector */
 	b_dir = b_fat + n_fat * N_FATS;		/* Directory area start sector */
 	b_data = b_dir + n_dir;				/* Data area start sector */
 	if (n_vol < b_data + au - b_vol) return FR_MKFS_ABORTED;	/* Too small volume */
 
-	/* Align data start sector to erase block boundary (for flash memory media) */
-	if (disk_ioctl(pdrv, GET_BLOCK_SIZE, &n) != RES_OK || !n || n > 32768) n = 1;
-	n = (b_data + n - 1) & ~(n - 1);	/* Next nearest erase block from current data start */
-	n = (n - b_data) / N_FATS;
-	if (fmt == FS_FAT32) {		/* FAT32: Move FAT offset */
-		n_rsv += n;
-		b_fat += n;
-	} else {					/* FAT12/16: Expand FAT size */
-		n_fat += n;
-	}
+	/* Align data start sector to erase block boundary (for flash memory media).
+	   The FATs are expanded, so the FAT area start stays where it is. */
+	n = (b_data + sz_blk - 1) / sz_blk * sz_blk;	/* Next nearest erase block from current data start */
+	n = (n - b_data + N_FATS - 1) / N_FATS;
+	n_fat += n;
+	if (fmt != FS_FAT32 && n_fat > 0xFFFF) return FR_MKFS_ABORTED;
 
 	/* Determine number of clusters and final check of validity of the FAT sub-type */
 	n_clst = (n_vol - n_rsv - n_fat * N_FATS - n_dir) / au;
@@ -4188,15 +5192,16 @@ FRESULT f_mkfs (
 		} else {	/* Create partition table (FDISK) */
 			mem_set(fs->win, 0, SS(fs));
 			tbl = fs->win + MBR_Table;	/* Create partition table for single partition in the drive */
-			tbl[1] = 1;						/* Partition start head */
-			tbl[2] = 1;						/* Partition start sector */
-			tbl[3] = 0;						/* Partition start cylinder */
+			n = b_vol / 63;
+			tbl[1] = (BYTE)(n % 255);		/* Partition start head */
+			tbl[2] = (BYTE)((b_vol % 63 + 1) | ((n / 255) >> 2 & 0xC0));	/* Partition start sector */
+			tbl[3] = (BYTE)(n / 255);		/* Partition start cylinder */
 			tbl[4] = sys;					/* System type */
 			tbl[5] = 254;					/* Partition end head */
 			n = (b_vol + n_vol) / 63 / 255;
 			tbl[6] = (BYTE)(n >> 2 | 63);	/* Partition end sector */
 			tbl[7] = (BYTE)n;				/* End cylinder */
-			ST_DWORD(tbl + 8, 63);			/* Partition start in LBA */
+			ST_DWORD(tbl + 8, b_vol);		/* Partition start in LBA */
 			ST_DWORD(tbl + 12, n_vol);		/* Partition size in LBA */
 			ST_WORD(fs->win + BS_55AA, 0xAA55);	/* MBR signature */
 			if (disk_write(pdrv, fs->win, 0, 1) != RES_OK)	/* Write it to the MBR */
@@ -73,16 +73,26 @@ typedef char TCHAR;
 
 
 
+/* Type of file size variables */
+
+#if _FS_EXFAT
+typedef QWORD FSIZE_t;
+#else
+typedef DWORD FSIZE_t;
+#endif
+
+
+
 /* File system object structure (FATFS) */
 
 typedef struct {
 	BYTE	fs_type;		/* FAT sub-type (0:Not mounted) */
 	BYTE	drv;			/* Physical drive number */
-	BYTE	csize;			/* Sectors per cluster (1,2,4...128) */
 	BYTE	n_fats;			/* Number of FAT copies (1 or 2) */
 	BYTE	wflag;			/* win[] flag (b0:dirty) */
 	BYTE	fsi_flag;		/* FSINFO flags (b7:disabled, b0:dirty) */
 	WORD	id;				/* File system mount ID */
+	WORD	csize;			/* Sectors per cluster (1,2,4...128, up to 32768 at exFAT) */
 	WORD	n_rootdir;		/* Number of root directory entries (FAT12/16) */
 #if _MAX_SS != _MIN_SS
 	WORD	ssize;			/* Bytes per sector (512, 1024, 2048 or 4096) */
@@ -104,6 +114,10 @@ typedef struct {
 	DWORD	dirbase;		/* Root directory start sector (FAT32:Cluster#) */
 	DWORD	database;		/* Data start sector */
 	DWORD	winsect;		/* Current sector appearing in the win[] */
+#if _FS_EXFAT
+	DWORD	bitbase;		/* Allocation bitmap start sector (exFAT) */
+	BYTE	dirbuf[40];		/* SFN image of the last exFAT entry set found (exFAT) */
+#endif
 	BYTE	win[_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
 } FATFS;
 
@@ -116,14 +130,21 @@ typedef struct {
 	WORD	id;				/* Owner file system mount ID (**do not change order**) */
 	BYTE	flag;			/* Status flags */
 	BYTE	err;			/* Abort flag (error code) */
-	DWORD	fptr;			/* File read/write pointer (Zeroed on file open) */
-	DWORD	fsize;			/* File size */
+	FSIZE_t	fptr;			/* File read/write pointer (Zeroed on file open) */
+	FSIZE_t	fsize;			/* File size */
 	DWORD	sclust;			/* File start cluster (0:no cluster chain, always 0 when fsize is 0) */
 	DWORD	clust;			/* Current cluster of fpter (not valid when fprt is 0) */
 	DWORD	dsect;			/* Sector number appearing in buf[] (0:invalid) */
+#if _FS_EXFAT
+	BYTE	stat;			/* Allocation status (0:FAT chain, 2:contiguous without FAT chain) (exFAT) */
+	DWORD	ncont;			/* Number of clusters allocated at stat 2 (exFAT) */
+#endif
 #if !_FS_READONLY
 	DWORD	dir_sect;		/* Sector number containing the directory entry */
 	BYTE*	dir_ptr;		/* Pointer to the directory entry in the win[] */
+#if _FS_EXFAT
+	DWORD	dir_sect2;		/* Sector number containing the rest of the entry set (0:none) (exFAT) */
+#endif
 #endif
 #if _USE_FASTSEEK
 	DWORD*	cltbl;			/* Pointer to the cluster link map table (Nulled on file open) */
@@ -149,6 +170,14 @@ typedef struct {
 	DWORD	sect;			/* Current sector */
 	BYTE*	dir;			/* Pointer to the current SFN entry in the win[] */
 	BYTE*	fn;				/* Pointer to the SFN (in/out) {file[8],ext[3],status[1]} */
+#if _FS_EXFAT
+	DWORD	sect2;			/* Sector number containing the rest of the found entry set (0:none) (exFAT) */
+	BYTE	stat;			/* Table allocation status (0:FAT chain, 2:contiguous without FAT chain) (exFAT) */
+	DWORD	ncont;			/* Number of clusters allocated at stat 2 (exFAT) */
+	DWORD	xsect;			/* Sector number containing the entry set of the table (0:root) (exFAT) */
+	DWORD	xsect2;			/* Sector number containing the rest of it (0:none) (exFAT) */
+	WORD	xofs;			/* Offset of the entry set in the xsect (exFAT) */
+#endif
 #if _FS_LOCK
 	UINT	lockid;			/* File lock ID (index of file semaphore table Files[]) */
 #endif
@@ -166,7 +195,7 @@ typedef struct {
 /* File information structure (FILINFO) */
 
 typedef struct {
-	DWORD	fsize;			/* File size */
+	FSIZE_t	fsize;			/* File size */
 	WORD	fdate;			/* Last modified date */
 	WORD	ftime;			/* Last modified time */
 	BYTE	fattrib;		/* Attribute */
@@ -214,7 +243,7 @@ FRESULT f_close (FIL* fp);											/* Close an open file object */
 FRESULT f_read (FIL* fp, void* buff, UINT btr, UINT* br);			/* Read data from a file */
 FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);	/* Write data to a file */
 FRESULT f_forward (FIL* fp, UINT(*func)(const BYTE*,UINT), UINT btf, UINT* bf);	/* Forward data to the stream */
-FRESULT f_lseek (FIL* fp, DWORD ofs);								/* Move file pointer of a file object */
+FRESULT f_lseek (FIL* fp, FSIZE_t ofs);								/* Move file pointer of a file object */
 FRESULT f_truncate (FIL* fp);										/* Truncate file */
 FRESULT f_sync (FIL* fp);											/* Flush cached data of a writing file */
 FRESULT f_opendir (DIR* dp, const TCHAR* path);						/* Open a directory */
@@ -309,6 +338,7 @@ int ff_del_syncobj (_SYNC_t sobj);				/* Delete a sync object */
 #define FS_FAT12	1
 #define FS_FAT16	2
 #define FS_FAT32	3
+#define FS_EXFAT	4
 
 
 /* File attribute bits for directory entry */
@@ -324,7 +354,7 @@ int ff_del_syncobj (_SYNC_t sobj);				/* Delete a sync object */
 
 
 /* Fast seek feature */
-#define CREATE_LINKMAP	0xFFFFFFFF
+#define CREATE_LINKMAP	((FSIZE_t)0 - 1)
 
 
 
@@ -15,7 +15,7 @@
 /  and optional writing functions as well. */
 
 
-#define _FS_MINIMIZE	2
+#define _FS_MINIMIZE	0
 /* This option defines minimization level to remove some basic API functions.
 /
 /   0: All basic functions are enabled.
@@ -39,11 +39,14 @@
 /  f_findfirst() and f_findnext(). (0:Disable or 1:Enable) */
 
 
-#define	_USE_MKFS		0
-/* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
+#define	_USE_MKFS		1
+/* This option switches f_mkfs() function. (0:Disable or 1:Enable)
+/  The volume is laid out on the erase block (AU) of GET_BLOCK_SIZE: the
+/  partition is moved so that the FAT starts on an AU boundary and the FAT
+/  is expanded so that the data area does too (volfmt.h). */
 
 
-#define	_USE_FASTSEEK	0
+#define	_USE_FASTSEEK	1
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
 
@@ -138,7 +141,7 @@
 / Drive/Volume Configurations
 /---------------------------------------------------------------------------*/
 
-#define _VOLUMES	1
+#define _VOLUMES	2
 /* Number of volumes (logical drives) to be used. */
 
 
@@ -169,10 +172,11 @@
 /  disk_ioctl() function. */
 
 
-#define	_USE_TRIM	0
+#define	_USE_TRIM	1
 /* This option switches ATA-TRIM feature. (0:Disable or 1:Enable)
 /  To enable Trim feature, also CTRL_TRIM command should be implemented to the
-/  disk_ioctl() function. */
+/  disk_ioctl() function. The SD driver erases the freed clusters (CMD38), so
+/  the card does not have to keep their old data. */
 
 
 #define _FS_NOFSINFO	0
@@ -187,6 +191,19 @@
 */
 
 
+#define	_FS_EXFAT	1
+/* This option switches support of exFAT volumes, the format of SDXC cards (64GB
+/  and over). (0:Disable or 1:Enable)
+/  When enabled, the file size and file pointer (FSIZE_t) are 64-bit and a file can
+/  grow beyond 4GB on an exFAT volume. New files are allocated as contiguous files
+/  without FAT chain (NoFatChain), so a file written sequentially causes no FAT
+/  update at all; it gets a FAT chain only when it cannot grow in place.
+/  At the non-LFN configuration, only names in 8.3 format are visible on exFAT
+/  volumes. _USE_LFN, _FS_RPATH and _USE_LABEL must be 0.
+/  VolumeFlags (dirty) and PercentInUse are not kept up to date. tools/exfatcheck.c
+/  runs this code against volumes checked by a parser of its own. */
+
+
 
 /*---------------------------------------------------------------------------/
 / System Configurations
@@ -200,7 +217,7 @@
 /  data transfer. */
 
 
-#define _FS_NORTC	1
+#define _FS_NORTC	0
 #define _NORTC_MON	1
 #define _NORTC_MDAY	1
 #define _NORTC_YEAR	2015
@@ -9,6 +9,7 @@
 
 #include <windows.h>
 #include <tchar.h>
+typedef unsigned __int64 QWORD;
 
 #else			/* Embedded platform */
 
@@ -28,6 +29,9 @@ typedef unsigned int	UINT;
 typedef long			LONG;
 typedef unsigned long	DWORD;
 
+/* This type MUST be 64-bit (Remove this for C89 compatibility) */
+typedef unsigned long long QWORD;
+
 #endif
 
 #endif
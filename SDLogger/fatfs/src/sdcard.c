@@ -15,43 +15,105 @@
  ******************************************************************************/
 
 #include "stdbool.h"
+#include <string.h>
 
 #include "lpc17xx_pinsel.h"
 #include "lpc17xx_gpio.h"
 #include "lpc17xx_ssp.h"
+#include "lpc17xx_gpdma.h"
 
 #include "diskio.h"
 #include "sdcard.h"
 
 #include "SDLogger.h"
+#include "dma.h"
 
-static bool SendDatatoSDCard(uint8_t *data, uint8_t size);
-static bool ReceiveDatafromSDCard(uint8_t *data, uint8_t size);
-static void SSELSelect(void);
-static void SSELUnselect(void);
+#if SD_CARDS > 1 && USE_WAVREC
+#error The chip select of the second card (P0.6) is I2SRX_SDA of the WAV recorder.
+#endif
+
+/* Channel registers of a GPDMA channel */
+#define SD_DMA(ch)			((LPC_GPDMACH_TypeDef *)(LPC_GPDMACH0_BASE + 0x20 * (ch)))
+
+/* Byte transfers in bursts of half the SSP FIFO */
+#define BLOCK_CONTROL(n)	(GPDMA_DMACCxControl_TransferSize(n) \
+							| GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_4) | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_4) \
+							| GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_BYTE) | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_BYTE))
+
+static bool SendDatatoSDCard(SDCARD *sd, uint8_t *data, uint8_t size);
+static bool ReceiveDatafromSDCard(SDCARD *sd, uint8_t *data, uint8_t size);
+static bool TransferBlock(SDCARD *sd, const uint8_t *tx, uint8_t *rx, uint32_t len);
+static void SSELSelect(SDCARD *sd);
+static void SSELUnselect(SDCARD *sd);
+#if SD_READAHEAD
+static void DropPool(SDCARD *sd, DWORD sector, DWORD count);
+#endif
 
 /* Local variables */
-static volatile DSTATUS status = STA_NOINIT;	/* Disk status */
-static volatile WORD Timer1, Timer2;			/* 100Hz decrement timer stopped at zero (disk_timerproc()) */
+static SDCARD Card[SD_CARDS] =		/* Cards by physical drive number */
+{
+	{ SD0_SSP, SD0_SSELPORTNUM, SD0_SSELPIN, { 15, 17, 18 }, DMA_CH_SD0_RX, DMA_CH_SD0_TX,
+	  GPDMA_CONN_SSP0_Rx, GPDMA_CONN_SSP0_Tx, STA_NOINIT },
+#if SD_CARDS > 1
+	{ SD1_SSP, SD1_SSELPORTNUM, SD1_SSELPIN, { 7, 8, 9 }, DMA_CH_SD1_RX, DMA_CH_SD1_TX,
+	  GPDMA_CONN_SSP1_Rx, GPDMA_CONN_SSP1_Tx, STA_NOINIT },
+#endif
+};
+
+/* AU_SIZE of the SD status in sectors; SDXC adds non powers of 2 */
+static const uint32_t AuSectors[16] =
+{
+	16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192,
+	16384, 24576, 32768, 49152, 65536, 131072
+};
+
+#if SD_READAHEAD
+/* Read pool: the sectors read ahead by a sequential single sector read, and
+the last other single sector read. That is mostly the FAT sector f_read()
+reads again at each cluster, as the file data took the window (_FS_TINY):
+served from here, it leaves the CMD18 of the file data open. */
+static uint8_t RaBuf[SD_READAHEAD + 1][SECTOR_SIZE];
+static SDCARD *RaCard;				/* Card of the sectors read ahead, NULL if none */
+static DWORD RaSect;				/* First sector read ahead */
+static UINT RaCount;				/* Number of sectors read ahead */
+static SDCARD *OneCard;				/* Card of the other sector, NULL if none */
+static DWORD OneSect;				/* The other sector, in RaBuf[SD_READAHEAD] */
+#endif
 
-BYTE CardType;
-CARDCONFIG CardConfig;
+static SD_TICK_HOOK TickHook;		/* Called from the SysTick after disk_timerproc() */
 
-DSTATUS MMC_disk_initialize(void)
+DSTATUS MMC_disk_initialize(BYTE pdrv)
 {
+	SDCARD *sd;
+
+	if (pdrv >= SD_CARDS) return STA_NOINIT;
+	sd = &Card[pdrv];
+
 	SysTick_Config(SystemCoreClock/100);	/* Generate interrupt each 10 ms */
+	DMA_Init();								/* Data blocks are moved by the GPDMA */
 
-	if (SD_Init() && SD_ReadConfiguration()) status &= ~STA_NOINIT;
+	sd->reading = false;
+	sd->busytime = 50;
+#if SD_READAHEAD
+	if (RaCard == sd) RaCard = NULL;
+	if (OneCard == sd) OneCard = NULL;
+#endif
+	if (SD_Init(sd) && SD_ReadConfiguration(sd)) sd->status &= ~STA_NOINIT;
 
-	return status;
+	return sd->status;
 }
 
-DRESULT MMC_disk_ioctl (BYTE cmd, void *buff)
+DRESULT MMC_disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
 {
 	DRESULT res;
 	BYTE n, *ptr = buff;
+	DWORD *dp;
+	SDCARD *sd;
+
+	if (pdrv >= SD_CARDS) return RES_PARERR;
+	sd = &Card[pdrv];
 
-	if (status & STA_NOINIT)
+	if (sd->status & STA_NOINIT)
 	{
 		return RES_NOTRDY;
 	}
@@ -61,60 +123,138 @@ DRESULT MMC_disk_ioctl (BYTE cmd, void *buff)
 	switch (cmd)
 	{
 		case CTRL_SYNC :		/* Make sure that no pending write process */
-			SSELSelect();
-			if (SD_WaitForReady() == true) res = RES_OK;
+			SD_StopRead(sd);
+			SSELSelect(sd);
+			if (SD_WaitForReady(sd) == true) res = RES_OK;
 		break;
 		case GET_SECTOR_COUNT:	/* Get number of sectors on the disk (DWORD) */
-			*(DWORD*)buff = CardConfig.sectorcnt;
+			*(DWORD*)buff = sd->CardConfig.sectorcnt;
 			res = RES_OK;
 		break;
 		case GET_SECTOR_SIZE :	/* Get R/W sector size (WORD) */
-			*(WORD*)buff = CardConfig.sectorsize;	//512;
+			*(WORD*)buff = sd->CardConfig.sectorsize;	//512;
 			res = RES_OK;
 		break;
 		case GET_BLOCK_SIZE :	/* Get erase block size in unit of sector (DWORD) */
-			*(DWORD*)buff = CardConfig.blocksize;
+			*(DWORD*)buff = sd->CardConfig.blocksize;
 			res = RES_OK;
 		break;
+		case CTRL_TRIM :		/* Erase a block of sectors (DWORD[2]: first and last), without waiting */
+			dp = buff;
+			if (dp[1] < dp[0] || dp[1] >= sd->CardConfig.sectorcnt) break;
+#if SD_READAHEAD
+			DropPool(sd, dp[0], dp[1] - dp[0] + 1);
+#endif
+			if (SD_EraseSector(sd, dp[0], dp[1]) == true) res = RES_OK;
+		break;
 		case MMC_GET_TYPE :		/* Get card type flags (1 byte) */
-			*ptr = CardType;
+			*ptr = sd->CardType;
 			res = RES_OK;
 		break;
 		case MMC_GET_CSD :		/* Receive CSD as a data block (16 bytes) */
-			for (n = 0;n < 16; n++) *(ptr+n) = CardConfig.csd[n];
+			for (n = 0;n < 16; n++) *(ptr+n) = sd->CardConfig.csd[n];
 			res = RES_OK;
 		break;
 		case MMC_GET_CID :		/* Receive CID as a data block (16 bytes) */
-			for (n = 0; n < 16; n++) *(ptr+n) = CardConfig.cid[n];
+			for (n = 0; n < 16; n++) *(ptr+n) = sd->CardConfig.cid[n];
 			res = RES_OK;
 		break;
 		case MMC_GET_OCR :		/* Receive OCR as an R3 resp (4 bytes) */
-			for (n = 0; n < 4; n++) *(ptr+n) = CardConfig.ocr[n];
+			for (n = 0; n < 4; n++) *(ptr+n) = sd->CardConfig.ocr[n];
 			res = RES_OK;
 		break;
 		case MMC_GET_SDSTAT :	/* Receive SD status as a data block (64 bytes) */
-			for (n = 0; n < 64; n++) *(ptr+n) = CardConfig.status[n];
+			for (n = 0; n < 64; n++) *(ptr+n) = sd->CardConfig.status[n];
+			res = RES_OK;
+		break;
+		case MMC_GET_BUSY :		/* Card still programming the last write (1 byte), without waiting */
+			if (sd->reading)
+			{
+				*ptr = 0;		/* Sending data: no write pending, and the bus is not read */
+			}
+			else
+			{
+				SSELSelect(sd);
+				ReceiveDatafromSDCard(sd, &n, 1);
+				*ptr = (n != 0xFF);
+			}
 			res = RES_OK;
 		break;
 		default:
 			res = RES_PARERR;
 		break;
 	}
-	SSELUnselect();
+	SSELUnselect(sd);
 	return res;
 }
 
 /*-----------------------------------------------------------------------*/
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
-DRESULT MMC_disk_read(BYTE *buff, DWORD sector, UINT count)
+/* A read that starts where the last one of the card ended continues its
+/  CMD18 (SD_ReadSector()). If it is a single sector, as the reads of
+/  move_window() are, SD_READAHEAD sectors are read into the pool and the
+/  next reads of the file are served from it with no bus access. Any other
+/  single sector is kept in the pool too. */
+DRESULT MMC_disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
 {
-	if (status & STA_NOINIT)
+	SDCARD *sd;
+#if SD_READAHEAD
+	DWORD n;
+#endif
+
+	if (pdrv >= SD_CARDS) return RES_PARERR;
+	sd = &Card[pdrv];
+
+	if (sd->status & STA_NOINIT)
 	{
 		return RES_NOTRDY;
 	}
 
-	if (SD_ReadSector (sector, buff, count) == true)
+#if SD_READAHEAD
+	/* Sectors in the pool */
+	while (count && RaCard == sd && sector - RaSect < RaCount)
+	{
+		memcpy(buff, RaBuf[sector - RaSect], SECTOR_SIZE);
+		buff += SECTOR_SIZE;
+		sector++;
+		count--;
+	}
+	if (count == 0) return RES_OK;
+
+	if (count == 1 && sector < sd->CardConfig.sectorcnt)
+	{
+		if (OneCard == sd && sector == OneSect)
+		{
+			memcpy(buff, RaBuf[SD_READAHEAD], SECTOR_SIZE);
+			return RES_OK;
+		}
+
+		/* Sequential single sector, after the last read or the sectors read
+		ahead: read ahead */
+		if ((sd->reading && sector == sd->rdnext) || (RaCard == sd && sector == RaSect + RaCount))
+		{
+			n = sd->CardConfig.sectorcnt - sector;
+			if (n > SD_READAHEAD) n = SD_READAHEAD;
+			RaCard = NULL;
+			if (SD_ReadSector (sd, sector, RaBuf[0], n) == false) return RES_ERROR;
+			RaCard = sd;
+			RaSect = sector;
+			RaCount = n;
+			memcpy(buff, RaBuf[0], SECTOR_SIZE);
+			return RES_OK;
+		}
+
+		OneCard = NULL;
+		if (SD_ReadSector (sd, sector, RaBuf[SD_READAHEAD], 1) == false) return RES_ERROR;
+		OneCard = sd;
+		OneSect = sector;
+		memcpy(buff, RaBuf[SD_READAHEAD], SECTOR_SIZE);
+		return RES_OK;
+	}
+#endif
+
+	if (SD_ReadSector (sd, sector, buff, count) == true)
 	{
 		return RES_OK;
 	}
@@ -125,19 +265,30 @@ DRESULT MMC_disk_read(BYTE *buff, DWORD sector, UINT count)
 /*-----------------------------------------------------------------------*/
 /* Get Disk Status                                                       */
 /*-----------------------------------------------------------------------*/
-DSTATUS MMC_disk_status(void)
+DSTATUS MMC_disk_status(BYTE pdrv)
 {
-	return status;
+	if (pdrv >= SD_CARDS) return STA_NOINIT;
+
+	return Card[pdrv].status;
 }
 
 /*-----------------------------------------------------------------------*/
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
-DRESULT MMC_disk_write(const BYTE *buff, DWORD sector, UINT count)
+/* The write returns while the card is still programming the last block.
+/  The busy time is waited before the next command to the same card, so
+/  the other card can be written meanwhile. CTRL_SYNC waits for it. */
+DRESULT MMC_disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
 {
-	if (status & STA_NOINIT) return RES_NOTRDY;
+	if (pdrv >= SD_CARDS) return RES_PARERR;
+
+	if (Card[pdrv].status & STA_NOINIT) return RES_NOTRDY;
+
+#if SD_READAHEAD
+	DropPool(&Card[pdrv], sector, count);
+#endif
 
-	if (SD_WriteSector(sector, buff, count) == true)
+	if (SD_WriteSector(&Card[pdrv], sector, buff, count) == true)
 	{
 		return RES_OK;
 	}
@@ -147,13 +298,13 @@ DRESULT MMC_disk_write(const BYTE *buff, DWORD sector, UINT count)
 /**
   * @brief  Initializes the memory card.
   *
-  * @param  None
+  * @param  sd: Card to initialize.
   * @retval true: Init OK.
   *         false: Init failed.
   *
   * Note: Refer to the init flow at http://elm-chan.org/docs/mmc/sdinit.png
   */
-bool SD_Init (void)
+bool SD_Init (SDCARD *sd)
 {
 	PINSEL_CFG_Type PinCfg;
 	SSP_CFG_Type SSP_ConfigStruct;
@@ -161,46 +312,45 @@ bool SD_Init (void)
 
     /* Init SPI interface */
     /*
-	 * Initialize SSP0 pin connect
-	 * P0.15 - SCK;
-	 * P0.16 - SSEL //dummy
-	 * P0.17 - MISO
-	 * P0.18 - MOSI
+	 * Initialize SSP pin connect
+	 * SSP0: P0.15 - SCK, P0.17 - MISO, P0.18 - MOSI
+	 * SSP1: P0.7 - SCK, P0.8 - MISO, P0.9 - MOSI
+	 * SSEL is a GPIO (see SDLogger.h)
 	 */
 	PinCfg.Funcnum = 2;
 	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
 	PinCfg.Pinmode = PINSEL_PINMODE_PULLUP;
 	PinCfg.Portnum = 0;
-	PinCfg.Pinnum = 15;
-	PINSEL_ConfigPin(&PinCfg);
-	PinCfg.Pinnum = 18;
-	PINSEL_ConfigPin(&PinCfg);
-	PinCfg.Pinnum = 17;
-	PINSEL_ConfigPin(&PinCfg);
+	for (i = 0; i < 3; i++)
+	{
+		PinCfg.Pinnum = sd->pins[i];
+		PINSEL_ConfigPin(&PinCfg);
+	}
 	PinCfg.Funcnum = 0;							/* We need to use this because SSEL is made outside. */
-	PinCfg.Pinnum = 16;
+	PinCfg.Portnum = sd->sselport;
+	PinCfg.Pinnum = sd->sselpin;
 	PINSEL_ConfigPin(&PinCfg);
 
-	GPIO_SetDir(SSELPORTNUM, (1 << SSELPIN), 1);
+	GPIO_SetDir(sd->sselport, (1 << sd->sselpin), 1);
 
 	SSP_ConfigStructInit(&SSP_ConfigStruct);	/* Initialize SSP configuration structure to default. */
 	SSP_ConfigStruct.ClockRate = 400000;		/* Changed velocity to 400KHz. */
-	SSP_Init(SDSSP, &SSP_ConfigStruct);			/* Initialize SSP peripheral with parameter given in structure above. */
-	SSP_Cmd(SDSSP, ENABLE);						/* Enable SSP peripheral. */
+	SSP_Init(sd->ssp, &SSP_ConfigStruct);		/* Initialize SSP peripheral with parameter given in structure above. */
+	SSP_Cmd(sd->ssp, ENABLE);					/* Enable SSP peripheral. */
 
     /* Set card type to unknown */
-    CardType = CARDTYPE_UNKNOWN;
+    sd->CardType = CARDTYPE_UNKNOWN;
 
     /* Before reset, Send at least 74 clocks at low frequency (between 100kHz and 400kHz) with CS high and DI (MISO) high. */
-    SSELUnselect();
+    SSELUnselect(sd);
     buf[0] = 0xff;
-    for (i = 0; i < 10; i++) SendDatatoSDCard(&buf[0], 1);
+    for (i = 0; i < 10; i++) SendDatatoSDCard(sd, &buf[0], 1);
 
     /* Send CMD0 with CS low to enter SPI mode and reset the card.
     The card will enter SPI mode if CS is low during the reception of CMD0. 
     Since the CMD0 (and CMD8) must be sent as a native command, the CRC field
     must have a valid value. */
-    if (SD_SendCommand (GO_IDLE_STATE, 0, NULL, 0) != R1_IN_IDLE_STATE) // CMD0
+    if (SD_SendCommand (sd, GO_IDLE_STATE, 0, NULL, 0) != R1_IN_IDLE_STATE) // CMD0
     {
         goto init_end;
     }
@@ -210,10 +360,10 @@ bool SD_Init (void)
     /* Card type identification Start ... */
 
     /* Check the card type, needs around 1000ms */    
-    r1 = SD_SendCommand (SEND_IF_COND, 0x1AA, buf, 4);  // CMD8
+    r1 = SD_SendCommand (sd, SEND_IF_COND, 0x1AA, buf, 4);  // CMD8
     if (r1 & 0x80) goto init_end;
 
-    Timer1 = 100; // 1000ms
+    sd->Timer1 = 100; // 1000ms
     if (r1 == R1_IN_IDLE_STATE)
     { 	/* It's V2.0 or later SD card */
         if (buf[2] != 0x01 || buf[3] != 0xAA) goto init_end;
@@ -221,53 +371,53 @@ bool SD_Init (void)
         /* The card is SD V2 and can work at voltage range of 2.7 to 3.6V */
         do
         {
-            r1 = SD_SendACommand (SD_SEND_OP_COND, 0x40000000, NULL, 0);  // ACMD41
+            r1 = SD_SendACommand (sd, SD_SEND_OP_COND, 0x40000000, NULL, 0);  // ACMD41
             if      (r1 == 0x00) break;
             else if (r1 > 0x01)  goto init_end;            
-        } while (Timer1);
+        } while (sd->Timer1);
 
-        if (Timer1 && SD_SendCommand (READ_OCR, 0, buf, 4) == R1_NO_ERROR)  // CMD58
+        if (sd->Timer1 && SD_SendCommand (sd, READ_OCR, 0, buf, 4) == R1_NO_ERROR)  // CMD58
         {
-            CardType = (buf[0] & 0x40) ? CARDTYPE_SDV2_HC : CARDTYPE_SDV2_SC;
+            sd->CardType = (buf[0] & 0x40) ? CARDTYPE_SDV2_HC : CARDTYPE_SDV2_SC;
         }
     }
     else
     { 	/* It's Ver1.x SD card or MMC card */
         /* Check if it is SD card */
-        if (SD_SendCommand (APP_CMD, 0, NULL, 0) & R1_ILLEGAL_CMD)
+        if (SD_SendCommand (sd, APP_CMD, 0, NULL, 0) & R1_ILLEGAL_CMD)
         {   
-            CardType = CARDTYPE_MMC; 
-            while (Timer1 && SD_SendCommand (SEND_OP_COND, 0, NULL, 0));
+            sd->CardType = CARDTYPE_MMC; 
+            while (sd->Timer1 && SD_SendCommand (sd, SEND_OP_COND, 0, NULL, 0));
         }  
         else 
         {   
-            CardType = CARDTYPE_SDV1; 
-            while (Timer1 && SD_SendACommand (SD_SEND_OP_COND, 0, NULL, 0));
+            sd->CardType = CARDTYPE_SDV1; 
+            while (sd->Timer1 && SD_SendACommand (sd, SD_SEND_OP_COND, 0, NULL, 0));
         }
 
-        if (Timer1 == 0) CardType = CARDTYPE_UNKNOWN;
+        if (sd->Timer1 == 0) sd->CardType = CARDTYPE_UNKNOWN;
     }
 
     /* For SDHC or SDXC, block length is fixed to 512 bytes, for others,
     the block length is set to 512 manually. */
-    if (CardType == CARDTYPE_MMC || CardType == CARDTYPE_SDV1 || CardType == CARDTYPE_SDV2_SC )
+    if (sd->CardType == CARDTYPE_MMC || sd->CardType == CARDTYPE_SDV1 || sd->CardType == CARDTYPE_SDV2_SC )
     {
-        if (SD_SendCommand (SET_BLOCKLEN, SECTOR_SIZE, NULL, 0) != R1_NO_ERROR) CardType = CARDTYPE_UNKNOWN;
+        if (SD_SendCommand (sd, SET_BLOCKLEN, SECTOR_SIZE, NULL, 0) != R1_NO_ERROR) sd->CardType = CARDTYPE_UNKNOWN;
     }
 
 init_end:              
-   SSELUnselect();
+   SSELUnselect(sd);
 
-    if (CardType == CARDTYPE_UNKNOWN)
+    if (sd->CardType == CARDTYPE_UNKNOWN)
     {
         return (false);
     }
     else     /* Init OK. use high speed during data transaction stage. */
     {
-    	SSP_Cmd(SDSSP, DISABLE);
-    	SSP_ConfigStruct.ClockRate = 2000000;		/* Changed velocity to 20MHz. */
-		SSP_Init(SDSSP, &SSP_ConfigStruct);			/* Initialize SSP peripheral with parameter given in structure above. */
-		SSP_Cmd(SDSSP, ENABLE);
+    	SSP_Cmd(sd->ssp, DISABLE);
+    	SSP_ConfigStruct.ClockRate = SDCLOCK;		/* High speed, see SDLogger.h. */
+		SSP_Init(sd->ssp, &SSP_ConfigStruct);			/* Initialize SSP peripheral with parameter given in structure above. */
+		SSP_Cmd(sd->ssp, ENABLE);
         return (true);
     }
 }
@@ -275,21 +425,25 @@ init_end:
 /**
   * @brief  Wait for the card is ready. 
   *
-  * @param  None
+  * @param  sd: Card.
   * @retval true: Card is ready for read commands.
   *         false: Card is not ready
   */
-bool SD_WaitForReady (void)
+bool SD_WaitForReady (SDCARD *sd)
 {
 	uint8_t data = 0;
 
-    Timer2 = 50;    // 500ms
-    ReceiveDatafromSDCard(&data, 1);
+    sd->Timer2 = sd->busytime;    // 500ms, or the timeout of the last erase
+    ReceiveDatafromSDCard(sd, &data, 1);
     do
     {
-    	ReceiveDatafromSDCard(&data, 1);
-        if (data == 0xFF) return true;
-    } while (Timer2);
+    	ReceiveDatafromSDCard(sd, &data, 1);
+        if (data == 0xFF)
+        {
+            sd->busytime = 50;
+            return true;
+        }
+    } while (sd->Timer2);
 
     return false;
 }
@@ -297,6 +451,7 @@ bool SD_WaitForReady (void)
 /**
   * @brief  Send a command and receive a response with specified format. 
   *
+  * @param  sd: Card.
   * @param  cmd: Specifies the command index.
   * @param  arg: Specifies the argument.
   * @param  buf: Pointer to byte array to store the response content.
@@ -306,16 +461,16 @@ bool SD_WaitForReady (void)
   *             0x81: Card is not ready
   *             0x82: command response time out error
   */
-uint8_t SD_SendCommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len) 
+uint8_t SD_SendCommand (SDCARD *sd, uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len) 
 {
     uint8_t r1, i;
     uint8_t crc_stop;
 
     /* The CS signal must be kept low during a transaction */
-    SSELSelect();
+    SSELSelect(sd);
 
     /* Wait until the card is ready to read (DI signal is High) */
-    if (SD_WaitForReady() == false) return 0x81;
+    if (SD_WaitForReady(sd) == false) return 0x81;
 
     /* Prepare CRC7 + stop bit. For cmd GO_IDLE_STATE and SEND_IF_COND, 
     the CRC7 should be valid, otherwise, the CRC7 will be ignored. */
@@ -325,22 +480,22 @@ uint8_t SD_SendCommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len)
 
     /* Send 6-byte command with CRC. */
     cmd |= 0x40;
-    SendDatatoSDCard(&cmd, 1);
+    SendDatatoSDCard(sd, &cmd, 1);
     r1 = (arg >> 24);
-    SendDatatoSDCard(&r1, 1);
+    SendDatatoSDCard(sd, &r1, 1);
     r1 = (arg >> 16);
-    SendDatatoSDCard(&r1, 1);
+    SendDatatoSDCard(sd, &r1, 1);
     r1 = (arg >> 8);
-    SendDatatoSDCard(&r1, 1);
+    SendDatatoSDCard(sd, &r1, 1);
     //
-    SendDatatoSDCard(&arg, 1);
-    SendDatatoSDCard(&crc_stop, 1); /* Valid or dummy CRC plus stop bit */
+    SendDatatoSDCard(sd, &arg, 1);
+    SendDatatoSDCard(sd, &crc_stop, 1); /* Valid or dummy CRC plus stop bit */
    
     /* The command response time (Ncr) is 0 to 8 bytes for SDC, 
     1 to 8 bytes for MMC. */
     for (i = 8; i; i--)
     {
-        ReceiveDatafromSDCard(&r1, 1);
+        ReceiveDatafromSDCard(sd, &r1, 1);
         if (r1 != 0xFF) break;   /* received valid response */      
     }
     if (i == 0)  return (0x82); /* command response time out error */
@@ -350,7 +505,7 @@ uint8_t SD_SendCommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len)
     {
     	do
         {
-        	ReceiveDatafromSDCard(buf, 1);
+        	ReceiveDatafromSDCard(sd, buf, 1);
         	buf++;
         } while (--len);
     }
@@ -361,6 +516,7 @@ uint8_t SD_SendCommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len)
   * @brief  Send an application specific command for SD card 
   *         and receive a response with specified format. 
   *
+  * @param  sd: Card.
   * @param  cmd: Specifies the command index.
   * @param  arg: Specifies the argument.
   * @param  buf: Pointer to byte array to store the response content.
@@ -372,122 +528,197 @@ uint8_t SD_SendCommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len)
   *
   * Note: All the application specific commands should be precdeded with APP_CMD
   */
-uint8_t SD_SendACommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len)
+uint8_t SD_SendACommand (SDCARD *sd, uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len)
 {
     uint8_t r1;
 
     /* Send APP_CMD (CMD55) first */
-	r1 = SD_SendCommand(APP_CMD, 0, NULL, 0);
+	r1 = SD_SendCommand (sd, APP_CMD, 0, NULL, 0);
 	if (r1 > 1) return r1;    
     
-    return (SD_SendCommand (cmd, arg, buf, len));
+    return (SD_SendCommand (sd, cmd, arg, buf, len));
 }
 
 /**
   * @brief  Read single or multiple sector(s) from memory card.
   *
+  * @param  sd:   Card.
   * @param  sect: Specifies the starting sector index to read
   * @param  buf:  Pointer to byte array to store the data
   * @param  cnt:  Specifies the count of sectors to read
   * @retval true or false.
+  *
+  * Note: The read is a READ_MULTIPLE_BLOCK left open on return. A read
+  * that starts at the next sector continues it with no command; any other
+  * read, a write or CTRL_SYNC stops it first (SD_StopRead()).
   */
-bool SD_ReadSector (uint32_t sect, uint8_t *buf, uint32_t cnt)
+bool SD_ReadSector (SDCARD *sd, uint32_t sect, uint8_t *buf, uint32_t cnt)
 {
-    bool flag;
-
-    /* Convert sector-based address to byte-based address for non SDHC */
-    if (CardType != CARDTYPE_SDV2_HC) sect <<= 9;
+    uint32_t addr;
 
-    flag = false;
+    if (sd->reading && sect != sd->rdnext) SD_StopRead(sd);
 
-    if (cnt > 1) /* Read multiple block */
+    if (sd->reading)
     {
-		if (SD_SendCommand(READ_MULTIPLE_BLOCK, sect, NULL, 0) == R1_NO_ERROR) 
-        {            
-			do
-			{
-				if (SD_RecvDataBlock(buf, SECTOR_SIZE) == false) break;
-				buf += SECTOR_SIZE;
-			} while (--cnt);
-
-			/* Stop transmission */
-            SD_SendCommand(STOP_TRANSMISSION, 0, NULL, 0);				
-
-            /* Wait for the card is ready */
-            if (SD_WaitForReady() && cnt==0) flag = true;
-        }
+        SSELSelect(sd);
     }
-    else   /* Read single block */
-    {        
-        if (SD_SendCommand(READ_SINGLE_BLOCK, sect, NULL, 0) == R1_NO_ERROR)
+    else
+    {
+        /* Convert sector-based address to byte-based address for non SDHC */
+        addr = (sd->CardType != CARDTYPE_SDV2_HC) ? sect << 9 : sect;
+
+        if (SD_SendCommand (sd, READ_MULTIPLE_BLOCK, addr, NULL, 0) != R1_NO_ERROR)
         {
-        	if(SD_RecvDataBlock(buf, SECTOR_SIZE) == true)
-			{
-				flag = true;
-			}
+            SSELUnselect(sd);
+            return (false);
         }
+        sd->reading = true;
+        sd->rdnext = sect;
     }
 
+    do
+    {
+        if (SD_RecvDataBlock (sd, buf, SECTOR_SIZE) == false) break;
+        buf += SECTOR_SIZE;
+        sd->rdnext++;
+    } while (--cnt);
+
+    /* A block not received ends the read */
+    if (cnt) SD_StopRead(sd);
+
     /* De-select the card */
-    SSELUnselect();
+    SSELUnselect(sd);
 
-    return (flag);
+    return (cnt == 0);
+}
+
+/**
+  * @brief  Stop the open multiple block read of the card, if any.
+  *
+  * @param  sd: Card.
+  * @retval None
+  */
+void SD_StopRead (SDCARD *sd)
+{
+    if (sd->reading == false) return;
+    sd->reading = false;
+
+    /* Stop transmission */
+    SD_SendCommand (sd, STOP_TRANSMISSION, 0, NULL, 0);
+
+    /* Wait for the card is ready */
+    SD_WaitForReady(sd);
+    SSELUnselect(sd);
 }
 
 /**
   * @brief  Write single or multiple sectors to SD/MMC. 
   *
+  * @param  sd:   Card.
   * @param  sect: Specifies the starting sector index to write
   * @param  buf: Pointer to the data array to be written
   * @param  cnt: Specifies the number sectors to be written
   * @retval true or false
   */
-bool SD_WriteSector (uint32_t sect, const uint8_t *buf, uint32_t cnt)
+bool SD_WriteSector (SDCARD *sd, uint32_t sect, const uint8_t *buf, uint32_t cnt)
 {
     bool flag = false;
     uint8_t cmd = 0xFD;
 
+    SD_StopRead(sd);
+
     /* Convert sector-based address to byte-based address for non SDHC */
-    if (CardType != CARDTYPE_SDV2_HC) sect <<= 9; 
+    if (sd->CardType != CARDTYPE_SDV2_HC) sect <<= 9; 
 
     if (cnt > 1)  /* write multiple block */
     { 
-        if (SD_SendCommand (WRITE_MULTIPLE_BLOCK, sect, NULL, 0) == R1_NO_ERROR)
+        if (SD_SendCommand (sd, WRITE_MULTIPLE_BLOCK, sect, NULL, 0) == R1_NO_ERROR)
         {
             do
             {
-                if (SD_SendDataBlock(buf, 0xFC, SECTOR_SIZE) == false)  break;
+                if (SD_SendDataBlock (sd, buf, 0xFC, SECTOR_SIZE) == false)  break;
                 buf += SECTOR_SIZE;
             } while (--cnt);
 
-            /* Send Stop Transmission Token. */
-            SendDatatoSDCard(&cmd, 1);
-        
-            /* Wait for complete */
-            if (SD_WaitForReady() && cnt==0) flag = true;
+            /* Send Stop Transmission Token when the last block is programmed.
+            The busy of the stop is waited by the next command. */
+            if (SD_WaitForReady(sd) && cnt==0) flag = true;
+            SendDatatoSDCard(sd, &cmd, 1);
         }
     }
     else  /* write single block */
     {
-        if ((SD_SendCommand (WRITE_SINGLE_BLOCK, sect, NULL, 0) == R1_NO_ERROR) && (SD_SendDataBlock (buf, 0xFE, SECTOR_SIZE) == true))
+        if ((SD_SendCommand (sd, WRITE_SINGLE_BLOCK, sect, NULL, 0) == R1_NO_ERROR) && (SD_SendDataBlock (sd, buf, 0xFE, SECTOR_SIZE) == true))
         {
             flag = true;
         }
     }
 
     /* De-select the card */
-    SSELUnselect();
+    SSELUnselect(sd);
 
     return (flag);
 }
 
 /**
-  * @brief  Read card configuration and fill structure CardConfig.
+  * @brief  Erase a range of sectors (CMD32, CMD33 and CMD38).
+  *
+  * @param  sd:    Card.
+  * @param  start: First sector to erase
+  * @param  end:   Last sector to erase
+  * @retval true or false
   *
-  * @param  None
+  * Note: Like a write, the erase returns while the card is busy. The busy
+  * is waited before the next command, with the erase timeout of the card
+  * from the SD status (250ms per AU if the card gives none).
+  */
+bool SD_EraseSector (SDCARD *sd, uint32_t start, uint32_t end)
+{
+    bool flag = false;
+    uint32_t size, tmo, aus;
+
+    /* Sector erase is an SD card command; SDSC cards need ERASE_BLK_EN */
+    if (sd->CardType != CARDTYPE_SDV1 && sd->CardType != CARDTYPE_SDV2_SC && sd->CardType != CARDTYPE_SDV2_HC) return (false);
+    if (((sd->CardConfig.csd[0] >> 6) == 0) && !(sd->CardConfig.csd[10] & 0x40)) return (false);
+
+    SD_StopRead(sd);
+
+    aus = (end - start) / sd->CardConfig.blocksize + 2;     /* AUs touched, at most */
+
+    /* Convert sector-based address to byte-based address for non SDHC */
+    if (sd->CardType != CARDTYPE_SDV2_HC)
+    {
+        start <<= 9;
+        end <<= 9;
+    }
+
+    if ((SD_SendCommand (sd, ERASE_WR_BLK_START, start, NULL, 0) == R1_NO_ERROR)
+        && (SD_SendCommand (sd, ERASE_WR_BLK_END, end, NULL, 0) == R1_NO_ERROR)
+        && (SD_SendCommand (sd, ERASE, 0, NULL, 0) == R1_NO_ERROR))
+    {
+        /* ERASE_SIZE AUs take ERASE_TIMEOUT seconds, plus ERASE_OFFSET */
+        size = ((uint32_t)sd->CardConfig.status[11] << 8) | sd->CardConfig.status[12];
+        tmo = sd->CardConfig.status[13] >> 2;
+        if (size && tmo) tmo = aus * tmo * 100 / size + (sd->CardConfig.status[13] & 3) * 100;
+        else tmo = aus * 25;
+        tmo += 50;
+        sd->busytime = (tmo > 0xFFFF) ? 0xFFFF : tmo;
+        flag = true;
+    }
+
+    /* De-select the card */
+    SSELUnselect(sd);
+
+    return (flag);
+}
+
+/**
+  * @brief  Read card configuration and fill structure CardConfig of the card.
+  *
+  * @param  sd: Card.
   * @retval true or false.
   */
-bool SD_ReadConfiguration ()
+bool SD_ReadConfiguration (SDCARD *sd)
 {
     uint8_t buf[16];
     uint32_t i, c_size, c_size_mult, read_bl_len;
@@ -496,51 +727,51 @@ bool SD_ReadConfiguration ()
     retv = false;
 
     /* Read OCR */
-    if (SD_SendCommand(READ_OCR, 0, CardConfig.ocr, 4) != R1_NO_ERROR) goto end;
+    if (SD_SendCommand (sd, READ_OCR, 0, sd->CardConfig.ocr, 4) != R1_NO_ERROR) goto end;
 
     /* Read CID */
-    if ((SD_SendCommand(SEND_CID, 0, NULL, 0) != R1_NO_ERROR) || SD_RecvDataBlock (CardConfig.cid, 16)==false) goto end;
+    if ((SD_SendCommand (sd, SEND_CID, 0, NULL, 0) != R1_NO_ERROR) || SD_RecvDataBlock (sd, sd->CardConfig.cid, 16)==false) goto end;
 
     /* Read CSD */
-    if ((SD_SendCommand(SEND_CSD, 0, NULL, 0) != R1_NO_ERROR) || SD_RecvDataBlock (CardConfig.csd, 16)==false) goto end;
+    if ((SD_SendCommand (sd, SEND_CSD, 0, NULL, 0) != R1_NO_ERROR) || SD_RecvDataBlock (sd, sd->CardConfig.csd, 16)==false) goto end;
 
     /* sector size */
-    CardConfig.sectorsize = 512;
+    sd->CardConfig.sectorsize = 512;
     
     /* sector count */
-    if (((CardConfig.csd[0] >> 6) & 0x3) == 0x1) /* CSD V2.0 (for High/eXtended Capacity) */
+    if (((sd->CardConfig.csd[0] >> 6) & 0x3) == 0x1) /* CSD V2.0 (for High/eXtended Capacity) */
     {
         /* Read C_SIZE */
-        c_size =  (((uint32_t)CardConfig.csd[7]<<16) + ((uint32_t)CardConfig.csd[8]<<8) + CardConfig.csd[9]) & 0x3FFFFF;
+        c_size =  (((uint32_t)sd->CardConfig.csd[7]<<16) + ((uint32_t)sd->CardConfig.csd[8]<<8) + sd->CardConfig.csd[9]) & 0x3FFFFF;
         /* Calculate sector count */
-       CardConfig.sectorcnt = (c_size + 1) * 1024;
+       sd->CardConfig.sectorcnt = (c_size + 1) * 1024;
 
     }
     else   /* CSD V1.0 (for Standard Capacity) */
     {
         /* C_SIZE */
-        c_size = (((uint32_t)(CardConfig.csd[6]&0x3)<<10) + ((uint32_t)CardConfig.csd[7]<<2) + (CardConfig.csd[8]>>6)) & 0xFFF;
+        c_size = (((uint32_t)(sd->CardConfig.csd[6]&0x3)<<10) + ((uint32_t)sd->CardConfig.csd[7]<<2) + (sd->CardConfig.csd[8]>>6)) & 0xFFF;
         /* C_SIZE_MUTE */
-        c_size_mult = ((CardConfig.csd[9]&0x3)<<1) + ((CardConfig.csd[10]&0x80)>>7);
+        c_size_mult = ((sd->CardConfig.csd[9]&0x3)<<1) + ((sd->CardConfig.csd[10]&0x80)>>7);
         /* READ_BL_LEN */
-        read_bl_len = CardConfig.csd[5] & 0xF;
-        CardConfig.sectorcnt = (c_size+1) << (read_bl_len + c_size_mult - 7);        
+        read_bl_len = sd->CardConfig.csd[5] & 0xF;
+        sd->CardConfig.sectorcnt = (c_size+1) << (read_bl_len + c_size_mult - 7);        
     }
 
     /* Get erase block size in unit of sector */
-    switch (CardType)
+    switch (sd->CardType)
     {
         case CARDTYPE_SDV2_SC:
         case CARDTYPE_SDV2_HC:
-            if ((SD_SendACommand (SD_STATUS, 0, buf, 1) !=  R1_NO_ERROR) || SD_RecvDataBlock(buf, 16) == false) goto end;      /* Read partial block */
-            for (i=64-16;i;i--) ReceiveDatafromSDCard(NULL, 1); /* Purge trailing data */
-            CardConfig.blocksize = 16UL << (buf[10] >> 4); /* Calculate block size based on AU size */
+            if ((SD_SendACommand (sd, SD_STATUS, 0, buf, 1) !=  R1_NO_ERROR) || SD_RecvDataBlock (sd, sd->CardConfig.status, 16) == false) goto end;      /* Read partial block: AU and erase fields */
+            for (i=64-16;i;i--) ReceiveDatafromSDCard(sd, NULL, 1); /* Purge trailing data */
+            sd->CardConfig.blocksize = AuSectors[sd->CardConfig.status[10] >> 4]; /* Calculate block size based on AU size */
             break;
         case CARDTYPE_MMC:
-            CardConfig.blocksize = ((uint16_t)((CardConfig.csd[10] & 124) >> 2) + 1) * (((CardConfig.csd[10] & 3) << 3) + ((CardConfig.csd[11] & 224) >> 5) + 1);
+            sd->CardConfig.blocksize = ((uint16_t)((sd->CardConfig.csd[10] & 124) >> 2) + 1) * (((sd->CardConfig.csd[10] & 3) << 3) + ((sd->CardConfig.csd[11] & 224) >> 5) + 1);
             break;
         case CARDTYPE_SDV1:
-            CardConfig.blocksize = (((CardConfig.csd[10] & 63) << 1) + ((uint16_t)(CardConfig.csd[11] & 128) >> 7) + 1) << ((CardConfig.csd[13] >> 6) - 1);
+            sd->CardConfig.blocksize = (((sd->CardConfig.csd[10] & 63) << 1) + ((uint16_t)(sd->CardConfig.csd[11] & 128) >> 7) + 1) << ((sd->CardConfig.csd[13] >> 6) - 1);
             break;
         default:
             goto end;                
@@ -548,7 +779,7 @@ bool SD_ReadConfiguration ()
 
     retv = true;
 end:
-    SSELUnselect();
+    SSELUnselect(sd);
 
     return retv;
 }
@@ -556,94 +787,74 @@ end:
 /**
   * @brief  Receive a data block with specified length from SD/MMC. 
   *
+  * @param  sd: Card.
   * @param  buf: Pointer to the data array to store the received data
   * @param  len: Specifies the length (in byte) to be received.
   *              The value should be a multiple of 4.
   * @retval true or false
   */
-bool SD_RecvDataBlock (uint8_t *buf, uint32_t len)
+bool SD_RecvDataBlock (SDCARD *sd, uint8_t *buf, uint32_t len)
 {
     uint8_t datatoken;
 
     /* Read data token (0xFE) */
-	Timer1 = 10;   /* Data Read Timeout: 100ms */
+	sd->Timer1 = 10;   /* Data Read Timeout: 100ms */
 	do
 	{
-		ReceiveDatafromSDCard(&datatoken, 1);
+		ReceiveDatafromSDCard(sd, &datatoken, 1);
         if (datatoken == 0xFE) break;
-	} while (Timer1);
+	} while (sd->Timer1);
 
 	if(datatoken != 0xFE) return (false);	/* data read timeout */
 
     /* Read data block */
-#ifdef USE_FIFO
-	ReceiveDatafromSDCard(buf, len);
-#else
-    uint32_t i = 0;
-
-    for (i = 0; i < len; i++)
-    {
-    	ReceiveDatafromSDCard(&buf[i], 1);
-    }
-#endif
+    if (TransferBlock(sd, NULL, buf, len) == false) return (false);
 
     datatoken = 0xff;
     /* 2 bytes CRC will be discarded. */
-    ReceiveDatafromSDCard(&datatoken, 1);
-    ReceiveDatafromSDCard(&datatoken, 1);
+    ReceiveDatafromSDCard(sd, &datatoken, 1);
+    ReceiveDatafromSDCard(sd, &datatoken, 1);
     return (true);
 }
 
 /**
   * @brief  Send a data block with specified length to SD/MMC. 
   *
+  * @param  sd: Card.
   * @param  buf: Pointer to the data array to store the received data
   * @param  tkn: Specifies the token to send before the data block
   * @param  len: Specifies the length (in byte) to send.
   *              The value should be 512 for memory card.
   * @retval true or false
+  *
+  * Note: The card is busy programming the block on return. The busy is
+  * waited before the next block or command.
   */
-bool SD_SendDataBlock (const uint8_t *buf, uint8_t tkn, uint32_t len)
+bool SD_SendDataBlock (SDCARD *sd, const uint8_t *buf, uint8_t tkn, uint32_t len)
 {
     uint8_t recv = 0xff;
+
+    /* Wait for the previous block of a multiple block write to complete. */
+    if (SD_WaitForReady(sd) == false) return (false);
     
     /* Send Start Block Token */
-    SendDatatoSDCard(&tkn, 1);
+    SendDatatoSDCard(sd, &tkn, 1);
 
     /* Send data block */
-#ifdef USE_FIFO
-    SendDatatoSDCard(buf, len);
-#else
-    uint32_t i = 0;
-
-    for (i = 0; i < len; i++) 
-    {
-    	SendDatatoSDCard(&buf[i], 1);
-    }
-#endif
+    if (TransferBlock(sd, buf, NULL, len) == false) return (false);
 
     /* Send 2 bytes dummy CRC */
-    SendDatatoSDCard(&recv, 1);
-    SendDatatoSDCard(&recv, 1);
+    SendDatatoSDCard(sd, &recv, 1);
+    SendDatatoSDCard(sd, &recv, 1);
 
     /* Read data response to check if the data block has been accepted. */
-    ReceiveDatafromSDCard(&recv, 1);
+    ReceiveDatafromSDCard(sd, &recv, 1);
     if ((recv & 0x0F) != 0x05)
     {
         return (false); /* write error */
     }
 
-    /* Wait for write complete. */
-    Timer1 = 20;  // 200ms
-    do
-    {
-    	ReceiveDatafromSDCard(&recv, 1);
-        if (recv == 0xFF) break;  
-    } while (Timer1);
-
-    if (recv == 0xFF) return true;       /* write complete */
-    else              return (false);    /* write time out */
-
+    return (true);
 }
 
 /*-----------------------------------------------------------------------*/
@@ -655,20 +866,31 @@ bool SD_SendDataBlock (const uint8_t *buf, uint8_t tkn, uint32_t len)
 void disk_timerproc (void)
 {
     WORD n;
+    SDCARD *sd;
 
-	n = Timer1;						/* 100Hz decrement timer stopped at 0 */
-	if (n) Timer1 = --n;
-	n = Timer2;
-	if (n) Timer2 = --n;
+	for (sd = Card; sd < &Card[SD_CARDS]; sd++)
+	{
+		n = sd->Timer1;					/* 100Hz decrement timer stopped at 0 */
+		if (n) sd->Timer1 = --n;
+		n = sd->Timer2;
+		if (n) sd->Timer2 = --n;
+	}
 }
 
 /* SysTick Interrupt Handler (10ms)    */
 void SysTick_Handler(void)
 {
    disk_timerproc(); 				/* Disk timer function (100Hz) */
+   if (TickHook) TickHook();		/* Application time base (100Hz) */
+}
+
+/* Lets the application share the 10ms SysTick of the driver. */
+void SD_SetTickHook (SD_TICK_HOOK hook)
+{
+	TickHook = hook;
 }
 
-static bool SendDatatoSDCard(uint8_t *data, uint8_t size)
+static bool SendDatatoSDCard(SDCARD *sd, uint8_t *data, uint8_t size)
 {
 	SSP_DATA_SETUP_Type Transfer;
 
@@ -676,14 +898,14 @@ static bool SendDatatoSDCard(uint8_t *data, uint8_t size)
 	Transfer.rx_data = NULL;
 	Transfer.length = size;
 
-	if(SSP_ReadWrite (SDSSP, &Transfer, SSP_TRANSFER_POLLING) == 0)
+	if(SSP_ReadWrite (sd->ssp, &Transfer, SSP_TRANSFER_POLLING) == 0)
 	{
 		return(true);
 	}
 	return(false);
 }
 
-static bool ReceiveDatafromSDCard(uint8_t *data, uint8_t size)
+static bool ReceiveDatafromSDCard(SDCARD *sd, uint8_t *data, uint8_t size)
 {
 	SSP_DATA_SETUP_Type Transfer;
 
@@ -691,22 +913,74 @@ static bool ReceiveDatafromSDCard(uint8_t *data, uint8_t size)
 	Transfer.rx_data = data;
 	Transfer.length = size;
 
-	if(SSP_ReadWrite (SDSSP, &Transfer, SSP_TRANSFER_POLLING) == 0)
+	if(SSP_ReadWrite (sd->ssp, &Transfer, SSP_TRANSFER_POLLING) == 0)
 	{
 		return(true);
 	}
 	return(false);
 }
 
-static void SSELSelect(void)
+/* Moves a data block over the SSP with the two GPDMA channels of the card.
+tx NULL sends 0xFF (read), rx NULL drops the received bytes (write). */
+static bool TransferBlock(SDCARD *sd, const uint8_t *tx, uint8_t *rx, uint32_t len)
+{
+	static uint8_t Ones = 0xFF;			/* Source of a read */
+	static uint8_t Sink;				/* Destination of the bytes received on a write */
+	LPC_GPDMACH_TypeDef *chrx = SD_DMA(sd->dmarx);
+	LPC_GPDMACH_TypeDef *chtx = SD_DMA(sd->dmatx);
+	uint32_t mask = (1 << sd->dmarx) | (1 << sd->dmatx);
+	bool ok;
+
+	LPC_GPDMA->DMACIntTCClear = mask;
+	LPC_GPDMA->DMACIntErrClr = mask;
+
+	chrx->DMACCSrcAddr = (uint32_t)&sd->ssp->DR;
+	chrx->DMACCDestAddr = rx ? (uint32_t)rx : (uint32_t)&Sink;
+	chrx->DMACCLLI = 0;
+	chrx->DMACCControl = BLOCK_CONTROL(len) | (rx ? GPDMA_DMACCxControl_DI : 0);
+	chrx->DMACCConfig = GPDMA_DMACCxConfig_SrcPeripheral(sd->connrx)
+						| GPDMA_DMACCxConfig_TransferType(GPDMA_TRANSFERTYPE_P2M);
+
+	chtx->DMACCSrcAddr = tx ? (uint32_t)tx : (uint32_t)&Ones;
+	chtx->DMACCDestAddr = (uint32_t)&sd->ssp->DR;
+	chtx->DMACCLLI = 0;
+	chtx->DMACCControl = BLOCK_CONTROL(len) | (tx ? GPDMA_DMACCxControl_SI : 0);
+	chtx->DMACCConfig = GPDMA_DMACCxConfig_DestPeripheral(sd->conntx)
+						| GPDMA_DMACCxConfig_TransferType(GPDMA_TRANSFERTYPE_M2P);
+
+	sd->ssp->DMACR = SSP_DMA_RX | SSP_DMA_TX;
+	chrx->DMACCConfig |= GPDMA_DMACCxConfig_E;	/* Receiver first, it must not miss a byte */
+	chtx->DMACCConfig |= GPDMA_DMACCxConfig_E;
+
+	sd->Timer1 = 10;					/* 100ms, the block takes less than 1ms */
+	while ((LPC_GPDMA->DMACEnbldChns & (1 << sd->dmarx)) && sd->Timer1);
+
+	ok = !(LPC_GPDMA->DMACEnbldChns & mask) && !(LPC_GPDMA->DMACRawIntErrStat & mask);
+	chrx->DMACCConfig &= ~GPDMA_DMACCxConfig_E;
+	chtx->DMACCConfig &= ~GPDMA_DMACCxConfig_E;
+	sd->ssp->DMACR = 0;
+
+	return ok;
+}
+
+#if SD_READAHEAD
+/* Drops the sectors of the read pool in a range written or erased. */
+static void DropPool(SDCARD *sd, DWORD sector, DWORD count)
+{
+	if (RaCard == sd && sector < RaSect + RaCount && sector + count > RaSect) RaCard = NULL;
+	if (OneCard == sd && OneSect - sector < count) OneCard = NULL;
+}
+#endif
+
+static void SSELSelect(SDCARD *sd)
 {
-	GPIO_ClearValue(SSELPORTNUM, (1 << SSELPIN));
+	GPIO_ClearValue(sd->sselport, (1 << sd->sselpin));
 }
 
-static void SSELUnselect(void)
+static void SSELUnselect(SDCARD *sd)
 {
-	GPIO_SetValue(SSELPORTNUM, (1 << SSELPIN));
-	ReceiveDatafromSDCard(NULL, 1);
+	GPIO_SetValue(sd->sselport, (1 << sd->sselpin));
+	ReceiveDatafromSDCard(sd, NULL, 1);
 }
 
 /* --------------------------------- End Of File ------------------------------ */
@@ -16,8 +16,6 @@
 #include "stdbool.h"
 #include "LPC17xx.h"			/* LPC17xx Definitions */
 
-//#define USE_FIFO - We have errors here....
-
 #ifndef NULL
  #ifdef __cplusplus              // EC++
   #define NULL          0
@@ -40,6 +38,9 @@
 #define READ_MULTIPLE_BLOCK     18
 #define WRITE_SINGLE_BLOCK      24
 #define WRITE_MULTIPLE_BLOCK    25
+#define ERASE_WR_BLK_START      32
+#define ERASE_WR_BLK_END        33
+#define ERASE                   38
 #define APP_CMD                 55
 #define READ_OCR                58
 #define CRC_ON_OFF              59
@@ -82,22 +83,46 @@ typedef struct tagCARDCONFIG
     uint8_t  status[64];    /* Status */
 } CARDCONFIG;
 
-DSTATUS MMC_disk_status(void);
-DSTATUS MMC_disk_initialize(void);
-DRESULT MMC_disk_read(BYTE *buff, DWORD sector, UINT count);
-DRESULT MMC_disk_write(const BYTE *buff, DWORD sector, UINT count);
-DRESULT MMC_disk_ioctl (BYTE cmd, void *buff);	/* Always add in diskio.c */
+/* SD/MMC card on its own SSP port, one per physical drive (see SDLogger.h) */
+typedef struct tagSDCARD
+{
+    LPC_SSP_TypeDef *ssp;   /* SSP port */
+    uint8_t  sselport;      /* GPIO port of the chip select */
+    uint8_t  sselpin;       /* GPIO pin of the chip select */
+    uint8_t  pins[3];       /* SCK, MISO and MOSI pins on port 0 (function 2) */
+    uint8_t  dmarx, dmatx;  /* GPDMA channels of the data blocks (dma.h) */
+    uint8_t  connrx, conntx;    /* GPDMA connections of the SSP */
+    volatile DSTATUS status;    /* Disk status */
+    volatile WORD Timer1, Timer2;   /* 100Hz decrement timers stopped at zero (disk_timerproc()) */
+    WORD busytime;          /* Timeout of the next busy wait, 10ms units (longer after an erase) */
+    BYTE CardType;          /* CARDTYPE_xxx */
+    bool reading;           /* A CMD18 is open (SD_ReadSector()) */
+    uint32_t rdnext;        /* Next sector of the open CMD18 */
+    CARDCONFIG CardConfig;
+} SDCARD;
+
+/* Called every 10ms from the SysTick interrupt of the driver */
+typedef void (*SD_TICK_HOOK)(void);
+
+DSTATUS MMC_disk_status(BYTE pdrv);
+DSTATUS MMC_disk_initialize(BYTE pdrv);
+DRESULT MMC_disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count);
+DRESULT MMC_disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count);
+DRESULT MMC_disk_ioctl (BYTE pdrv, BYTE cmd, void *buff);	/* Always add in diskio.c */
 
 /* Public functions */
-bool SD_Init (void);
-bool SD_ReadSector (uint32_t sect, uint8_t *buf, uint32_t cnt);
-bool SD_WriteSector (uint32_t sect, const uint8_t *buf, uint32_t cnt);
-bool SD_ReadConfiguration (void);
-uint8_t SD_SendCommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len);
-uint8_t SD_SendACommand (uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len);
-bool SD_RecvDataBlock (uint8_t *buf, uint32_t len);
-bool SD_SendDataBlock (const uint8_t *buf, uint8_t tkn, uint32_t len);
-bool SD_WaitForReady (void);
+bool SD_Init (SDCARD *sd);
+bool SD_ReadSector (SDCARD *sd, uint32_t sect, uint8_t *buf, uint32_t cnt);
+void SD_StopRead (SDCARD *sd);
+bool SD_WriteSector (SDCARD *sd, uint32_t sect, const uint8_t *buf, uint32_t cnt);
+bool SD_EraseSector (SDCARD *sd, uint32_t start, uint32_t end);
+bool SD_ReadConfiguration (SDCARD *sd);
+uint8_t SD_SendCommand (SDCARD *sd, uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len);
+uint8_t SD_SendACommand (SDCARD *sd, uint8_t cmd, uint32_t arg, uint8_t *buf, uint32_t len);
+bool SD_RecvDataBlock (SDCARD *sd, uint8_t *buf, uint32_t len);
+bool SD_SendDataBlock (SDCARD *sd, const uint8_t *buf, uint8_t tkn, uint32_t len);
+bool SD_WaitForReady (SDCARD *sd);
+void SD_SetTickHook (SD_TICK_HOOK hook);
 // void disk_timerproc (void); - Use if RTC on.
 
 #endif // __SD_H
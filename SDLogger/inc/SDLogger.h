@@ -69,11 +69,55 @@
 #define DEBUGP(msg)			{ ; }
 #endif
 
-#define	SDSSP				LPC_SSP0
+/* SD cards, one per physical drive (sdcard.c): drive 0: on SSP0 and drive
+1: on SSP1, each with its own GPDMA channels. The chip selects are GPIOs. */
+#define SD_CARDS			2
 
-#define SSELPORT			LPC_GPIO0
-#define SSELPORTNUM			0
-#define SSELPIN				16
+#define	SD0_SSP				LPC_SSP0
+#define SD0_SSELPORTNUM		0
+#define SD0_SSELPIN			16
+
+#define	SD1_SSP				LPC_SSP1
+#define SD1_SSELPORTNUM		0
+#define SD1_SSELPIN			6
+
+#define SDCLOCK				12500000		/* SPI clock after the card init (max. PCLK_SSP / 2) */
+#define SD_READAHEAD		4				/* Sectors read at a time by sequential single sector reads (0: no read pool) */
+
+/* AU aligned format of the cards on "format = 1" in SDLOGGER.CFG (volfmt.h) */
+#define USE_VOLFMT			1
+
+/* ADC burst capture (adclog.h) */
+#define USE_ADCLOG			1
+#define ADCLOG_CHMASK		0xFF			/* AD0.0 to AD0.7 */
+#define ADCLOG_RATE			10000			/* Samples/s per channel */
+
+/* CAN capture, configured in SDLOGGER.CFG (canlog.h) */
+#define USE_CANLOG			1
+
+/* Serial line sniffer on UART2, configured in SDLOGGER.CFG (uartlog.h) */
+#define USE_UARTLOG			1
+
+/* I2C bus monitor on I2C0, configured in SDLOGGER.CFG (i2clog.h) */
+#define USE_I2CLOG			1
+
+/* I2S WAV recorder, configured in SDLOGGER.CFG (wavrec.h). Its DMA ring
+takes the AHB SRAM of USE_ADCLOG, so only one of them can be on. */
+#define USE_WAVREC			0
+
+/* Ethernet capture to pcapng, configured in SDLOGGER.CFG (ethcap.h). Its
+frame ring also needs AHB SRAM, so it excludes USE_ADCLOG as well. */
+#define USE_ETHCAP			0
+
+/* Encoder and MCI edge capture, configured in SDLOGGER.CFG (motionlog.h) */
+#define USE_MOTIONLOG		1
+
+/* Human readable text log in LOG.TXT (txtlog.h) */
+#define USE_TXTLOG			0
+
+/* Raw sector ring in RINGLOG.DAT for the channels set to it, as with
+ADCLOG_RING (ringlog.h) */
+#define USE_RINGLOG			0
 
 
 /*******************************************************************************
@@ -0,0 +1,80 @@
+#ifndef ADCLOG_H_
+#define ADCLOG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file adclog.h
+ * @headerfile adclog.h
+ * @date Oct 18, 2026
+ *
+ * @brief Multi-channel ADC capture in burst mode.
+ *
+ * The ADC converts the selected channels one after the other in burst mode.
+ * Every conversion raises a DMA request and the GPDMA copies ADGDR into a
+ * ring of ADCLOG_BUFS buffers chained by linked list items, so the capture
+ * runs with no CPU work at all. The DMA interrupt timestamps each buffer
+ * as it completes and hands it to ADCLOG_Task(), which packs the results
+ * to 16 bits out of the ring, oldest buffer first, and passes them to the
+ * logger as one record (LOGREC_CH_ADC, see logformat.h). The logger may
+ * wait for the card while it takes the record; the DMA goes on meanwhile.
+ *
+ * With ADCLOG_PACK the samples are delta coded first, in place: the
+ * difference to the previous sample of the same channel is zigzag coded
+ * and bit packed in groups of LOGADC_GROUP with the width of the largest
+ * one. Slow signals take 2 to 6 bits per sample instead of 16. The coding
+ * takes about 30 cycles per sample, 2.5% of the CPU at 80kS/s. A buffer
+ * with an overrun, or whose channels are out of the burst order, is logged
+ * as it is.
+ *
+ * With ADCLOG_RING the records go to the raw sector ring (ringlog.h)
+ * instead of the log segments, for rates where the write latency has to
+ * be bounded by the card alone. RING_Init() must then run before
+ * ADCLOG_Start().
+ *
+ * The buffer ring has to cover the longest stall of the main loop, which
+ * is the busy time of the card. With the default of 4 x 1024 samples at
+ * 8 channels x 10kS/s that is 51ms: tools/adcsim.c logs without a loss
+ * through card stalls of 50ms and loses buffers from 52ms on, each one
+ * counted by ADCLOG_Lost() and flagged in the log. The buffers live in the
+ * AHB SRAM; the record being logged takes 2KB of RAM besides.
+ *
+ * @pre
+ *   The logger must be running. The burst rate is derived from the ADC
+ *   clock divider and is only as exact as PCLK allows; the effective rate
+ *   is logged in the LOGREC_ADC_FL_CONFIG record written on start.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+#include "stdbool.h"
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define ADCLOG_BUFS			4						/* DMA buffers in the ring */
+#define ADCLOG_BUF_SAMPLES	1024					/* Conversions per buffer (max. 4095) */
+#define ADCLOG_MAX_RATE		200000					/* Conversions/s of the ADC */
+#define ADCLOG_PACK			1						/* 1: delta code the samples */
+#define ADCLOG_RING			0						/* 1: records go to the raw sector ring (ringlog.h) */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+bool ADCLOG_Init (uint8_t chmask, uint32_t rate);
+FRESULT ADCLOG_Start (void);
+void ADCLOG_Stop (void);
+FRESULT ADCLOG_Task (void);
+uint32_t ADCLOG_Lost (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
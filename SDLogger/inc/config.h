@@ -0,0 +1,58 @@
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file config.h
+ * @headerfile config.h
+ * @date Oct 18, 2026
+ *
+ * @brief Configuration file on the card.
+ *
+ * CFG_FILENAME is a text file with one "key = value" setting per line.
+ * Blank lines and lines starting with '#' are ignored, and so are keys
+ * that no module knows about. A key may appear more than once (lists).
+ * Each module walks the file with CFG_Parse() and picks its own keys:
+ *
+ * @code
+ *   # CAN capture
+ *   can1 = 1000000
+ *   canfilter = 1 std 0x100-0x1FF
+ * @endcode
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+#include "stdbool.h"
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define CFG_FILENAME		"SDLOGGER.CFG"
+#define CFG_LINE_MAX		80						/* Longer lines are cut */
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Called for each setting; both strings are trimmed. */
+typedef void (*CFG_HANDLER)(const char *key, const char *value);
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT CFG_Parse (CFG_HANDLER handler);
+bool CFG_GetUint (const char **str, uint32_t *val);
+bool CFG_GetWord (const char **str, const char *word);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
@@ -0,0 +1,33 @@
+#ifndef CRC16_H_
+#define CRC16_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file crc16.h
+ * @headerfile crc16.h
+ * @date Oct 18, 2026
+ *
+ * @brief CRC-16/CCITT (polynomial 0x1021, MSB first).
+ *
+ * Table driven, about one table lookup per byte. Used to validate the
+ * journaled log sectors. Has no target dependency, so host tools can
+ * build it as is.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define CRC16_INIT			0xFFFF
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+uint16_t CRC16_Update (uint16_t crc, const void *data, uint32_t len);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
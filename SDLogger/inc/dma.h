@@ -0,0 +1,54 @@
+#ifndef DMA_H_
+#define DMA_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file dma.h
+ * @headerfile dma.h
+ * @date Oct 18, 2026
+ *
+ * @brief GPDMA channel allocation and shared interrupt dispatch.
+ *
+ * GPDMA_Init() resets every channel, so it is only called once, from
+ * DMA_Init(). The single DMA interrupt is dispatched here to the handler
+ * attached to each channel. Lower channel numbers have higher priority on
+ * the bus, and the assignments below are fixed at compile time.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+#include "stdbool.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define DMA_CHANNELS		8
+
+/* Channel assignments */
+#define DMA_CH_SD0_RX		0		/* SD card data blocks on SSP0 (sdcard.c) */
+#define DMA_CH_SD0_TX		1
+#define DMA_CH_ADC			2		/* ADC burst capture (adclog.c) */
+#define DMA_CH_UART			3		/* Serial line sniffer (uartlog.c) */
+#define DMA_CH_I2S			4		/* I2S WAV recorder (wavrec.c) */
+#define DMA_CH_SD1_RX		5		/* SD card data blocks on SSP1 (sdcard.c) */
+#define DMA_CH_SD1_TX		6
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Called from the DMA interrupt on terminal count or error of a channel. */
+typedef void (*DMA_HANDLER)(bool error);
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+void DMA_Init (void);
+void DMA_Attach (uint8_t ch, DMA_HANDLER handler);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
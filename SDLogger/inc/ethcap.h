@@ -0,0 +1,85 @@
+#ifndef ETHCAP_H_
+#define ETHCAP_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file ethcap.h
+ * @headerfile ethcap.h
+ * @date Oct 18, 2026
+ *
+ * @brief Ethernet frame capture to pcapng files (RMII on port 1).
+ *
+ * The EMAC receives every frame in promiscuous mode. ENET_IRQHandler()
+ * timestamps each frame, copies it, truncated to the snap length, from its
+ * RX descriptor to a ring in AHB SRAM and hands the descriptor back to the
+ * EMAC at once: the EMAC driver only has EMAC_NUM_RX_FRAG descriptors.
+ *
+ * ETHCAP_Task() turns the frames into Enhanced Packet Blocks with
+ * nanosecond timestamps and packs them end to end into a staging buffer,
+ * written to the file (ETHnnnnn.PCN) ETHCAP_STAGE bytes at a time; an EPB
+ * may run over into the next write. Every ETHCAP_FLUSH_SECONDS the frames
+ * staged are written too, up to a sector boundary filled by a padding
+ * block, of a block type reserved for local use that pcapng readers skip,
+ * and the file is synced.
+ *
+ * Frames dropped with a full ring or by an EMAC overrun are counted by
+ * ETHCAP_Dropped() and reported in the epb_dropcount option of the EPB of
+ * the frame that follows them. ETHCAP_Close() ends the file with an
+ * Interface Statistics Block whose isb_ifdrop holds ETHCAP_Dropped(), the
+ * frames dropped after the last EPB included. Frames received with errors
+ * are not captured.
+ *
+ * The capture is configured in the configuration file (config.h):
+ *
+ * @code
+ *   eth = 1                            # 0 or absent: capture off
+ *   ethsnap = 128                      # bytes kept of each frame
+ * @endcode
+ *
+ * Run by tools/ethsim.c against the card model of tools/host, the card
+ * takes 1.25MB/s of pcapng. With ethsnap = 128 the capture loses nothing
+ * up to 60% load with mixed lengths (9300 frames/s), 95% with full frames
+ * (7700 frames/s) and 9% with the shortest ones (13400 frames/s); whole
+ * frames are kept up to 10% load (810 frames/s). The ring rides out card
+ * stalls up to 25ms at 30% load with mixed lengths and ethsnap = 128, and
+ * up to 20ms with whole frames at 5% load. The CPU time of the interrupt,
+ * which runs once per frame, is not modelled.
+ *
+ * @pre
+ *   The volume must be mounted.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define ETHCAP_RING			16384					/* Frame ring, bytes */
+#define ETHCAP_STAGE		2048					/* Bytes per write (sector multiple) */
+#define ETHCAP_FLUSH_SECONDS	1					/* Staged frames are written at least this often */
+
+#define ETHCAP_NAME_PREFIX	"ETH"					/* ETHnnnnn.PCN */
+#define ETHCAP_NAME_EXT		".PCN"
+#define ETHCAP_NAME_DIGITS	5
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT ETHCAP_Init (void);
+FRESULT ETHCAP_Task (void);
+FRESULT ETHCAP_Close (void);
+uint32_t ETHCAP_Dropped (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
@@ -0,0 +1,78 @@
+#ifndef I2CLOG_H_
+#define I2CLOG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file i2clog.h
+ * @headerfile i2clog.h
+ * @date Oct 18, 2026
+ *
+ * @brief I2C bus monitor on I2C0 (SDA0 on P0.27, SCL0 on P0.28).
+ *
+ * I2C0 runs in monitor mode with MATCH_ALL: it never drives the bus, and
+ * interrupts after every address and data byte of any transfer. The
+ * interrupt reads the byte from the data buffer register, which holds it
+ * for the next nine bit times (22 us at 400 kHz), and queues a 16-bit event
+ * (see LOGI2C_xxx in logformat.h). Only address events are timestamped; the
+ * bytes of a transfer follow each other at the bus rate. I2CLOG_Task()
+ * packs the events into LOGREC_CH_I2C records, each kept until it is full
+ * or 100ms old: a record per pass of the main loop would spend more on
+ * its header than on its events.
+ *
+ * An event that finds the ring full, or an address event that finds no
+ * room for its time, is counted by I2CLOG_Lost(). The events after it are
+ * dropped up to the next address event, and the record holding that one
+ * carries LOGREC_I2C_FL_LOST, so the log goes on at the start of a
+ * transfer.
+ *
+ * The settings are read from the configuration file (config.h):
+ *
+ * @code
+ *   i2c = 400000                       # bus rate, 0 or absent: monitor off
+ *   i2cstretch = 0                     # 1: hold SCL low until read
+ * @endcode
+ *
+ * With i2cstretch the interrupt can never miss a byte, but it slows down
+ * the bus while the interrupt is delayed; a full ring still loses events.
+ * A transfer ended by a NACK, such as a read ended by the master, has no
+ * STOP event, as the monitor stops following the bus after the NACK.
+ *
+ * At 400 kHz a busy bus gives 44000 events/s, so the ring lasts 23ms
+ * while the main loop waits for the card. Run by tools/i2csim.c against
+ * the card model of tools/host, with back to back transactions of 8
+ * events on average, the monitor loses no event with card stalls up to
+ * 20ms; longer stalls lose events, counted and flagged.
+ *
+ * @pre
+ *   The volume must be mounted and the logger running.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define I2CLOG_RING			1024					/* Events buffered (power of 2) */
+#define I2CLOG_STAMPS		256						/* Address events buffered (power of 2) */
+#define I2CLOG_BATCH		512						/* Maximum record payload */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT I2CLOG_Init (void);
+FRESULT I2CLOG_Task (void);
+uint32_t I2CLOG_Lost (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
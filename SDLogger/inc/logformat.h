@@ -0,0 +1,531 @@
+#ifndef LOGFORMAT_H_
+#define LOGFORMAT_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file logformat.h
+ * @headerfile logformat.h
+ * @date Oct 18, 2026
+ *
+ * @brief On-card layout of the log segment files.
+ *
+ * The logger writes its stream into numbered segment files (LOGnnnnn.DAT).
+ * Sector 0 of every segment holds a LOGSEGHDR and is followed by data
+ * sectors. Each data sector starts with a LOGSECHDR that carries the
+ * segment number, the sector index, the payload length and a CRC, so the
+ * data sectors form an append journal: the segment header is only
+ * rewritten now and then with the number of committed sectors, and after
+ * a power loss the sectors written past that point are found by checking
+ * the sector headers one after the other. The log stream is the
+ * concatenation of the sector payloads.
+ *
+ * The stream is a sequence of records, each one a LOGRECHDR followed by
+ * LOGRECHDR.len bytes. Records may cross sector and segment boundaries.
+ *
+ * In a segment flagged LOGSEG_FL_INDEX the sectors between the header and
+ * LOGSEGHDR.hdrsize are index pages, written once each as they fill up.
+ * A page is sealed like a data sector, with LOGIDX_MAGIC and the page
+ * number in LOGSECHDR.seq, and holds LOGIDXENT entries in time order: the
+ * first record starting in each span of a fixed number of data sectors.
+ * Pages not written yet fail the check. In a segment that was not closed
+ * the entries of the last, partial page are missing.
+ *
+ * In a segment flagged LOGSEG_FL_LZ the payload of every data sector is a
+ * compressed block instead: a LOGLZHDR, LOGLZHDR.zlen bytes of LZ
+ * sequences and zero padding up to LOGSEC_PAYLOAD, which is always the
+ * sector length. A sector whose block would not carry more of the stream
+ * than the payload itself is stored instead: sealed with LOGSEC_RAW_MAGIC,
+ * it holds LOGSECHDR.len stream bytes as a plain sector does, and may be
+ * short without being the last one. A block only refers to its own bytes, so each sector can
+ * be expanded alone with LOGLZ_Unpack(); the stream is then the
+ * concatenation of the expanded blocks.
+ *
+ * A segment striped over several cards is a set of member files with the
+ * same name, one per volume, flagged LOGSEG_FL_STRIPE. They share the
+ * segment number, the nonce and hdrsize, and sector 0 holds a
+ * LOGSTRIPEHDR after the LOGSEGHDR. Each data sector is written to one of
+ * the members, in runs of up to LOGSTRIPEHDR.unit sectors, and
+ * LOGSECHDR.seq numbers the sectors across the whole set: it increases
+ * along a member file, with the gaps taken by the other members.
+ * LOGSEGHDR.committed counts the sectors of the member itself. The index
+ * pages, which also number the sectors across the set, are only written
+ * to member 0. Merging the members by LOGSECHDR.seq gives the segment as
+ * a single card would hold it. A mirrored segment (LOGSEG_FL_MIRROR) is
+ * instead a plain segment file on each card; the copies only differ in
+ * the sectors one of them had not written yet at a power loss.
+ *
+ * The raw sector ring (LOGRING_NAME, see ringlog.h) is a single contiguous
+ * file written by LBA, as a circular log. Sector 0 holds a LOGRINGHDR,
+ * written once when the file is created; each following sector starts
+ * with a LOGRINGSEC that numbers it in the stream (LOGRINGSEC.seq, never
+ * reused) and tells where the first record starting in it is. The oldest
+ * sectors are overwritten as the ring wraps, and a start up begins a new
+ * run at the sector after the newest one, so the stream is the payloads
+ * in seq order: it is cut at gaps in seq and where the run changes, and
+ * picks up again at the LOGRINGSEC.first of the next sector. A channel
+ * given a ring of its own has it in RINGCHnn.DAT, nn being its
+ * LOGREC_CH_xxx number, in the same format.
+ *
+ * This header has no dependency on FatFs or on the LPC17xx headers, so it
+ * can be shared with host-side tools that parse card images.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "crc16.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define LOGSEG_MAGIC		0x474C4453UL	/* "SDLG" read as little-endian */
+#define LOGSEG_VERSION		3
+#define LOGSEG_HDR_SIZE		512				/* Header occupies one whole sector */
+#define LOGSEG_SECT_SIZE	512				/* Data sector size */
+
+#define LOGSEC_MAGIC		0x4453			/* "SD" read as little-endian */
+#define LOGSEC_RAW_MAGIC	0x5253			/* "SR": stored sector of an LZ segment */
+#define LOGSEC_PAYLOAD		(LOGSEG_SECT_SIZE - sizeof(LOGSECHDR))
+
+#define LOGSEG_NAME_PREFIX	"LOG"			/* LOGnnnnn.DAT */
+#define LOGSEG_NAME_EXT		".DAT"
+#define LOGSEG_NAME_DIGITS	5
+
+#define LOGRING_NAME		"RINGLOG.DAT"
+#define LOGRING_CH_PREFIX	"RINGCH"		/* RINGCHnn.DAT: ring of channel nn */
+#define LOGRING_MAGIC		0x47524453UL	/* "SDRG" read as little-endian */
+#define LOGRING_VERSION		1
+#define LOGRING_SEC_MAGIC	0x5252			/* "RR" read as little-endian */
+#define LOGRING_PAYLOAD		(LOGSEG_SECT_SIZE - sizeof(LOGRINGSEC))
+#define LOGRING_NONE		0xFFFF			/* LOGRINGSEC.first: no record starts in the sector */
+
+/* LOGSEGHDR.flags */
+#define LOGSEG_FL_CLOSED	0x0001			/* Segment was finalized and truncated */
+#define LOGSEG_FL_BYTIME	0x0002			/* Rotated out by the time limit */
+#define LOGSEG_FL_BYSIZE	0x0004			/* Rotated out by the size limit */
+#define LOGSEG_FL_LZ		0x0008			/* Sector payloads are LZ blocks */
+#define LOGSEG_FL_INDEX		0x0010			/* Index pages follow the header */
+#define LOGSEG_FL_STRIPE	0x0020			/* Member of a striped segment (LOGSTRIPEHDR) */
+#define LOGSEG_FL_MIRROR	0x0040			/* Also written in full to another card */
+
+#define LOGIDX_MAGIC		0x5849			/* "IX" read as little-endian */
+#define LOGIDX_ENTRIES		24				/* Entries per page, LOGSEC_PAYLOAD / sizeof(LOGIDXENT) */
+
+/* LZ block: a sequence of tokens, each one followed by its literals and,
+unless the literals complete the block, by a match:
+   uint8_t  token     literal count (high nibble), match length - 4 (low)
+   uint8_t  ext[]     a nibble of 15 is followed by bytes added to it, up
+                      to and including the first byte that is not 255
+   uint8_t  lit[]     literals
+   uint16_t offset    match distance back in the expanded block, 1 or more
+   uint8_t  ext[]     extension of the match length, as above
+A match may overlap the bytes it produces. */
+#define LOGLZ_MINMATCH		4
+#define LOGLZ_MAX_RAW		8192			/* Expanded block size limit (history window) */
+#define LOGLZ_MAX_ZLEN		(LOGSEC_PAYLOAD - sizeof(LOGLZHDR))
+
+/* LOGRECHDR.chan */
+#define LOGREC_CH_TEXT		0				/* Free text (LOG_Puts) */
+#define LOGREC_CH_ADC		1				/* ADC samples (adclog.c) */
+#define LOGREC_CH_CAN		2				/* CAN frames (canlog.c) */
+#define LOGREC_CH_UART		3				/* Serial line bytes (uartlog.c) */
+#define LOGREC_CH_I2C		4				/* I2C bus events (i2clog.c) */
+#define LOGREC_CH_MOTION	5				/* Encoder position and MCI edges (motionlog.c) */
+
+/* LOGRECHDR.flags of LOGREC_CH_ADC */
+#define LOGREC_ADC_FL_CONFIG	0x01		/* Payload is a LOGADCCFG */
+#define LOGREC_ADC_FL_LOST		0x02		/* Buffers were lost before this one */
+#define LOGREC_ADC_FL_PACKED	0x04		/* Payload is a packed block, else raw samples */
+
+/* ADC sample: 12-bit result, channel and overrun flag in 16 bits. The
+record timestamp is the time of the last sample. */
+#define LOGADC_VALUE(s)		((s) & 0x0FFF)
+#define LOGADC_CHAN(s)		(((s) >> 12) & 0x7)
+#define LOGADC_OVERRUN		0x8000
+
+/* Packed ADC block: a LOGADCPACK, the first sample of each of the nch
+channels (uint16_t, as above), then the following samples in groups of
+LOGADC_GROUP: a width byte w and LOGADC_GROUP values of w bits packed LSB
+first, 4 * w bytes. A value is the zigzag coded difference between a
+sample and the previous one of its channel. The channels follow each other
+in the burst order, ascending over LOGADCCFG.chmask and starting at
+LOGADCPACK.chan. The last group is padded with zero values. Samples have
+no time of their own, they follow at LOGADCCFG.rate; blocks with an
+overrun are never packed. */
+#define LOGADC_GROUP		32
+#define LOGADC_ZIGZAG(d)	LOGMOT_ZIGZAG(d)
+#define LOGADC_UNZIGZAG(z)	LOGMOT_UNZIGZAG(z)
+
+/* LOGRECHDR.flags of LOGREC_CH_CAN */
+#define LOGREC_CAN_FL_CONFIG	0x01		/* Payload is a LOGCANCFG */
+#define LOGREC_CAN_FL_LOST		0x02		/* Frames were lost before this record */
+
+/* CAN frame in a LOGREC_CH_CAN record, with no padding:
+   uint32_t dt      nanoseconds after the record timestamp
+   uint32_t idf     identifier and LOGCAN_xxx flags
+   uint8_t  dlc     data length code
+   uint8_t  data[]  LOGCAN_DATALEN() bytes */
+#define LOGCAN_HDR_SIZE		9
+#define LOGCAN_EXT			0x80000000UL	/* 29-bit identifier */
+#define LOGCAN_RTR			0x40000000UL	/* Remote frame */
+#define LOGCAN_BUS2			0x20000000UL	/* Received on CAN2 */
+#define LOGCAN_ID(idf)		((idf) & 0x1FFFFFFFUL)
+#define LOGCAN_DATALEN(idf, dlc)	(((idf) & LOGCAN_RTR) ? 0 : ((dlc) > 8 ? 8 : (dlc)))
+
+/* LOGRECHDR.flags of LOGREC_CH_UART. The payload is the received bytes. */
+#define LOGREC_UART_FL_CONFIG	0x01		/* Payload is a LOGUARTCFG */
+#define LOGREC_UART_FL_LOST		0x02		/* Bytes were lost before this record */
+#define LOGREC_UART_FL_IDLE		0x04		/* The line went idle after the last byte */
+#define LOGREC_UART_FL_ERROR	0x08		/* Parity, framing or break in this record */
+
+/* LOGRECHDR.flags of LOGREC_CH_I2C */
+#define LOGREC_I2C_FL_CONFIG	0x01		/* Payload is a LOGI2CCFG */
+#define LOGREC_I2C_FL_LOST		0x02		/* Events were lost before this record */
+
+/* I2C bus event in a LOGREC_CH_I2C record: a 16-bit word with the kind,
+the acknowledge and the byte on the bus. An address event, which follows a
+START or a repeated START, is followed by a uint32_t with its time in ns
+after the record timestamp. The record timestamp is the time of the first
+address event, or of the transaction still in progress. */
+#define LOGI2C_KIND(e)		((e) & 0xC000)
+#define LOGI2C_DATA			0x0000			/* Data byte */
+#define LOGI2C_ADDR			0x4000			/* START and address byte, R/W in bit 0 */
+#define LOGI2C_STOP			0x8000			/* STOP or repeated START ending a transfer */
+#define LOGI2C_ERROR		0xC000			/* Illegal START or STOP on the bus */
+#define LOGI2C_NACK			0x0100			/* Byte not acknowledged */
+#define LOGI2C_BYTE(e)		((e) & 0x00FF)
+#define LOGI2C_ADDR_SIZE	6				/* Event and time of an address event */
+
+/* LOGRECHDR.flags of LOGREC_CH_MOTION */
+#define LOGREC_MOT_FL_CONFIG	0x01		/* Payload is a LOGMOTCFG */
+#define LOGREC_MOT_FL_LOST		0x02		/* Samples or edges were lost before this record */
+#define LOGREC_MOT_FL_EDGES		0x04		/* Payload is MCI edges, else a position block */
+
+/* Position block: a LOGMOTPOS, then the difference of each following
+sample to the previous one as a zigzag LEB128 varint. The record timestamp
+is the time of the first sample; the samples follow at LOGMOTCFG.rate. */
+#define LOGMOT_ZIGZAG(d)	(((uint32_t)(d) << 1) ^ (uint32_t)((int32_t)(d) >> 31))
+#define LOGMOT_UNZIGZAG(z)	((int32_t)(((z) >> 1) ^ (0 - ((z) & 1))))
+
+/* MCI edge in a LOGREC_MOT_FL_EDGES record, with no padding:
+   uint32_t dt      ns after the record timestamp
+   uint8_t  mci     input, 0 to 2
+   uint8_t  level   input level after the edge */
+#define LOGMOT_EDGE_SIZE	6
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Segment header, stored little-endian at offset 0 of each segment. */
+typedef struct tagLOGSEGHDR
+{
+	uint32_t magic;			/* LOGSEG_MAGIC */
+	uint16_t version;		/* LOGSEG_VERSION */
+	uint16_t hdrsize;		/* Offset of the first payload byte (LOGSEG_HDR_SIZE) */
+	uint32_t seq;			/* Segment sequence number, same as in the file name */
+	uint32_t created;		/* FAT timestamp when the segment was created */
+	uint32_t prealloc;		/* Bytes preallocated for the segment, header included */
+	uint32_t committed;		/* Data sectors known to be valid */
+	uint32_t flags;			/* LOGSEG_FL_xxx */
+	uint32_t nonce;			/* Tells this segment's sectors from stale ones */
+	uint32_t check;			/* ~(sum of the preceding 32-bit words) */
+} LOGSEGHDR;
+
+/* Data sector header, stored little-endian at offset 0 of each data sector. */
+typedef struct tagLOGSECHDR
+{
+	uint16_t magic;			/* LOGSEC_MAGIC */
+	uint16_t len;			/* Payload bytes in this sector (< LOGSEC_PAYLOAD: last sector) */
+	uint32_t segseq;		/* LOGSEGHDR.seq of the owning segment */
+	uint32_t seq;			/* Index of the sector in the segment, from 0 */
+	uint16_t nonce;			/* Low half of LOGSEGHDR.nonce */
+	uint16_t crc;			/* CRC-16 over the header (crc = 0) and the payload */
+} LOGSECHDR;
+
+/* Ring file header, stored little-endian in sector 0 of LOGRING_NAME. */
+typedef struct tagLOGRINGHDR
+{
+	uint32_t magic;			/* LOGRING_MAGIC */
+	uint16_t version;		/* LOGRING_VERSION */
+	uint16_t hdrsize;		/* Offset of the first ring sector (LOGSEG_HDR_SIZE) */
+	uint32_t sectors;		/* Ring sectors after the header */
+	uint32_t created;		/* FAT timestamp when the file was created */
+	uint32_t nonce;			/* Tells the sectors of this file from stale ones */
+	uint32_t check;			/* ~(sum of the preceding 32-bit words) */
+} LOGRINGHDR;
+
+/* Ring sector header, stored little-endian at offset 0 of each ring sector. */
+typedef struct tagLOGRINGSEC
+{
+	uint16_t magic;			/* LOGRING_SEC_MAGIC */
+	uint16_t len;			/* Payload bytes (< LOGRING_PAYLOAD: flushed before it filled) */
+	uint32_t seq;			/* Stream sector number, from 1 */
+	uint16_t run;			/* Start up count of the writer */
+	uint16_t first;			/* Payload offset of the first record starting here, or LOGRING_NONE */
+	uint16_t nonce;			/* Low half of LOGRINGHDR.nonce */
+	uint16_t crc;			/* CRC-16 over the header (crc = 0) and the payload */
+} LOGRINGSEC;
+
+/* Stripe header, stored little-endian right after the LOGSEGHDR of a
+member file. */
+typedef struct tagLOGSTRIPEHDR
+{
+	uint8_t  member;		/* Member number, from 0, same as the volume */
+	uint8_t  members;		/* Member files of the segment */
+	uint16_t unit;			/* Most sectors written to a member in one run */
+	uint32_t check;			/* ~(first word + LOGSEGHDR.check) */
+} LOGSTRIPEHDR;
+
+/* Index entry, stored little-endian in an index page. */
+typedef struct tagLOGIDXENT
+{
+	uint32_t sec;			/* Timestamp of the first record starting in the span */
+	uint32_t nsec;
+	uint32_t sector;		/* Index of the data sector where it starts */
+	uint16_t offset;		/* Stream bytes before it in that sector */
+	uint16_t records;		/* Records starting in the span */
+	uint16_t chans;			/* Bit n: records of channel n in the span */
+	uint16_t reserved;
+} LOGIDXENT;
+
+/* Compressed block header, at the start of the sector payload. */
+typedef struct tagLOGLZHDR
+{
+	uint16_t rawlen;		/* Expanded bytes */
+	uint16_t zlen;			/* Compressed bytes following the header */
+} LOGLZHDR;
+
+/* Record header, stored little-endian in the log stream. */
+typedef struct tagLOGRECHDR
+{
+	uint8_t  chan;			/* Source channel, LOGREC_CH_xxx */
+	uint8_t  flags;			/* Channel specific */
+	uint16_t len;			/* Bytes following the header */
+	uint32_t sec;			/* Seconds since Jan 1st, 2000 (RTC local time) */
+	uint32_t nsec;			/* Nanoseconds within the second */
+} LOGRECHDR;
+
+/* Payload of the LOGREC_ADC_FL_CONFIG record. */
+typedef struct tagLOGADCCFG
+{
+	uint32_t rate;			/* Conversions per second, all channels together */
+	uint8_t  chmask;		/* Converted channels */
+	uint8_t  bits;			/* Result resolution */
+	uint16_t samples;		/* Samples per data record */
+} LOGADCCFG;
+
+/* Head of a packed ADC block. */
+typedef struct tagLOGADCPACK
+{
+	uint16_t samples;		/* Samples in the block */
+	uint8_t  chan;			/* Channel of the first sample */
+	uint8_t  nch;			/* Channels in the burst */
+} LOGADCPACK;
+
+/* Payload of the LOGREC_CAN_FL_CONFIG record. */
+typedef struct tagLOGCANCFG
+{
+	uint32_t baud[2];		/* Bit rate of CAN1 and CAN2, 0: not captured */
+	uint16_t filters;		/* Acceptance filter entries, 0: all frames */
+	uint8_t  listen;		/* Listen-only mode */
+	uint8_t  reserved;
+} LOGCANCFG;
+
+/* Payload of the LOGREC_UART_FL_CONFIG record. */
+typedef struct tagLOGUARTCFG
+{
+	uint32_t baud;			/* Line rate */
+	uint32_t format;		/* 0: 8N1 */
+} LOGUARTCFG;
+
+/* Payload of the LOGREC_I2C_FL_CONFIG record. */
+typedef struct tagLOGI2CCFG
+{
+	uint32_t rate;			/* Nominal bus rate */
+	uint8_t  stretch;		/* SCL held low until each event is read */
+	uint8_t  reserved[3];
+} LOGI2CCFG;
+
+/* Payload of the LOGREC_MOT_FL_CONFIG record. */
+typedef struct tagLOGMOTCFG
+{
+	uint32_t rate;			/* Position samples per second, 0: no sampling */
+	uint8_t  mcicap;		/* MCI edges captured */
+	uint8_t  reserved[3];
+} LOGMOTCFG;
+
+/* Head of a position block. */
+typedef struct tagLOGMOTPOS
+{
+	uint32_t pos;			/* QEI position of the first sample */
+	uint32_t index;			/* Index pulse count at the first sample */
+	uint16_t samples;		/* Samples in the block */
+	uint16_t reserved;
+} LOGMOTPOS;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+/* Checksum over the header words preceding 'check'. */
+static inline uint32_t LOGSEG_Check(const LOGSEGHDR *hdr)
+{
+	const uint32_t *w = (const uint32_t *)hdr;
+	uint32_t i, sum = 0;
+
+	for (i = 0; i < (sizeof(LOGSEGHDR) / 4) - 1; i++) sum += w[i];
+
+	return ~sum;
+}
+
+/* Checksum over the ring header words preceding 'check'. */
+static inline uint32_t LOGRING_Check(const LOGRINGHDR *hdr)
+{
+	const uint32_t *w = (const uint32_t *)hdr;
+	uint32_t i, sum = 0;
+
+	for (i = 0; i < (sizeof(LOGRINGHDR) / 4) - 1; i++) sum += w[i];
+
+	return ~sum;
+}
+
+/* Checksum of the stripe header, bound to the segment header before it. */
+static inline uint32_t LOGSTRIPE_Check(const LOGSTRIPEHDR *sh, const LOGSEGHDR *hdr)
+{
+	return ~(*(const uint32_t *)sh + hdr->check);
+}
+
+/* CRC of a data sector, computed with the crc field taken as zero. */
+static inline uint16_t LOGSEC_Crc(const uint8_t *sect)
+{
+	static const uint8_t zero[2] = { 0, 0 };
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+	uint16_t crc;
+
+	crc = CRC16_Update(CRC16_INIT, sect, (uint32_t)((const uint8_t *)&sh->crc - sect));
+	crc = CRC16_Update(crc, zero, 2);
+	return CRC16_Update(crc, sect + sizeof(LOGSECHDR), sh->len);
+}
+
+/* CRC of a ring sector, computed with the crc field taken as zero. */
+static inline uint16_t LOGRING_Crc(const uint8_t *sect)
+{
+	static const uint8_t zero[2] = { 0, 0 };
+	const LOGRINGSEC *sh = (const LOGRINGSEC *)sect;
+	uint16_t crc;
+
+	crc = CRC16_Update(CRC16_INIT, sect, (uint32_t)((const uint8_t *)&sh->crc - sect));
+	crc = CRC16_Update(crc, zero, 2);
+	return CRC16_Update(crc, sect + sizeof(LOGRINGSEC), sh->len);
+}
+
+/* Tells if a sector was written to the ring described by 'hdr'. */
+static inline int LOGRING_Valid(const uint8_t *sect, const LOGRINGHDR *hdr)
+{
+	const LOGRINGSEC *sh = (const LOGRINGSEC *)sect;
+
+	return sh->magic == LOGRING_SEC_MAGIC && sh->len <= LOGRING_PAYLOAD && sh->seq != 0
+		&& (sh->first == LOGRING_NONE || sh->first < sh->len)
+		&& sh->nonce == (uint16_t)hdr->nonce && sh->crc == LOGRING_Crc(sect);
+}
+
+/* Tells if a data sector is sector 'idx' of the segment described by 'hdr'. */
+static inline int LOGSEC_Valid(const uint8_t *sect, const LOGSEGHDR *hdr, uint32_t idx)
+{
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+
+	return (sh->magic == LOGSEC_MAGIC || (sh->magic == LOGSEC_RAW_MAGIC && (hdr->flags & LOGSEG_FL_LZ)))
+		&& sh->len <= LOGSEC_PAYLOAD
+		&& sh->segseq == hdr->seq && sh->seq == idx
+		&& sh->nonce == (uint16_t)hdr->nonce && sh->crc == LOGSEC_Crc(sect);
+}
+
+/* Tells if a valid data sector ends the stream of its segment: only the
+last sector of a plain segment is short. */
+static inline int LOGSEC_Last(const uint8_t *sect)
+{
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+
+	return sh->magic == LOGSEC_MAGIC && sh->len < LOGSEC_PAYLOAD;
+}
+
+/* Tells if a sector is index page 'page' of the segment described by 'hdr'. */
+static inline int LOGIDX_Valid(const uint8_t *sect, const LOGSEGHDR *hdr, uint32_t page)
+{
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+
+	return sh->magic == LOGIDX_MAGIC && sh->len <= LOGIDX_ENTRIES * sizeof(LOGIDXENT)
+		&& sh->segseq == hdr->seq && sh->seq == page
+		&& sh->nonce == (uint16_t)hdr->nonce && sh->crc == LOGSEC_Crc(sect);
+}
+
+/* Reads a length nibble and its extension bytes; -1 when the block ends. */
+static inline int32_t LOGLZ_Length(uint32_t n, const uint8_t **ip, const uint8_t *iend)
+{
+	uint8_t b;
+
+	if (n == 15)
+	{
+		do
+		{
+			if (*ip >= iend) return -1;
+			b = *(*ip)++;
+			n += b;
+		} while (b == 255);
+	}
+	return (int32_t)n;
+}
+
+/* Expands the LZ block of a valid sector of an LZ segment into 'dst', which
+must hold LOGLZ_MAX_RAW bytes, or copies the payload of a stored sector.
+Returns the stream length, or -1 if the block is damaged. */
+static inline int32_t LOGLZ_Unpack(const uint8_t *sect, uint8_t *dst)
+{
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+	const uint8_t *blk = sect + sizeof(LOGSECHDR);
+	const LOGLZHDR *bh = (const LOGLZHDR *)blk;
+	const uint8_t *ip = blk + sizeof(LOGLZHDR), *iend = ip + bh->zlen;
+	uint8_t *op = dst, *oend = dst + bh->rawlen;
+	uint32_t ofs;
+	int32_t n;
+	uint8_t tok;
+
+	if (sh->magic == LOGSEC_RAW_MAGIC)
+	{
+		if (sh->len > LOGSEC_PAYLOAD) return -1;
+		memcpy(dst, blk, sh->len);
+		return sh->len;
+	}
+	if (bh->zlen > LOGLZ_MAX_ZLEN || bh->rawlen > LOGLZ_MAX_RAW) return -1;
+
+	while (op < oend)
+	{
+		if (ip >= iend) return -1;
+		tok = *ip++;
+
+		n = LOGLZ_Length(tok >> 4, &ip, iend);
+		if (n < 0 || n > iend - ip || n > oend - op) return -1;
+		memcpy(op, ip, n);
+		ip += n;
+		op += n;
+		if (op == oend) break;
+
+		if (iend - ip < 2) return -1;
+		ofs = ip[0] | ((uint32_t)ip[1] << 8);
+		ip += 2;
+		n = LOGLZ_Length(tok & 15, &ip, iend);
+		if (n < 0 || ofs == 0 || ofs > (uint32_t)(op - dst)) return -1;
+		n += LOGLZ_MINMATCH;
+		if (n > oend - op) return -1;
+		for (; n; n--, op++) *op = op[-(int32_t)ofs];
+	}
+	return bh->rawlen;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
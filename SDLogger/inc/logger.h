@@ -0,0 +1,141 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file logger.h
+ * @headerfile logger.h
+ * @date Oct 18, 2026
+ *
+ * @brief SD card logging pipeline with segment rotation.
+ *
+ * Data handed to LOG_Write() is packed into a ring of sector sized staging
+ * buffers. LOG_Task(), called from the main loop, writes full sectors into
+ * the current segment file with sector aligned f_write() calls.
+ *
+ * Segments are rotated by size (LOG_SEGMENT_SIZE) or by age
+ * (LOG_SEGMENT_SECONDS). The next segment is created, preallocated and
+ * given its header in the background, and a cluster link map is kept for
+ * it, so switching over needs neither a directory scan nor a FAT access.
+ * The retired segment is truncated to its payload and closed later, also
+ * from LOG_Task().
+ *
+ * Every data sector carries a sequence numbered, CRC protected header (see
+ * logformat.h). Staged data is flushed to the card every LOG_FLUSH_SECONDS
+ * with a plain sector write; the segment header and the directory entry
+ * are only committed every LOG_COMMIT_SECONDS. At start up LOG_Init()
+ * checks the sectors written after the last commit and keeps the valid
+ * ones, so the recovery time depends on the uncommitted data only.
+ *
+ * Every LOG_INDEX_SECTORS data sectors the time and position of the first
+ * record starting in them are added to an index kept at the front of the
+ * segment (see logformat.h), so a reader can find a point in time with a
+ * binary search and seek straight to it. An index page is written once,
+ * when it is full, plus the last one when the segment is retired.
+ *
+ * With LOG_COMPRESS the stream is compressed before it is staged: each
+ * data sector holds one LZ block that can be expanded on its own (see
+ * logformat.h), so a damaged sector only loses its own data. The blocks
+ * have no history beyond their sector, which limits the gain. A sector
+ * whose block would not hold more of the stream than a plain one is
+ * stored as it is instead. Measured with tools/logcat.c (-z on plain
+ * segments, -v on compressed ones) on the logs of the tools/xxxsim.c runs,
+ * in stream bytes per card byte where plain sectors give 0.97: random ADC,
+ * UART and I2C data 0.97, nearly all sectors stored, and a few sectors a
+ * segment more than plain for the sectors LOG_Flush() seals part full; CAN
+ * frames with random data 1.14 and without data 1.42, an encoder at full
+ * speed 1.12 and mostly at rest 7.9; C source text gives 1.43. On a PC the
+ * compressor takes 1.4 to 6ns a byte and the expansion 0.1 to 1.5ns; the
+ * time on the LPC1768 was not measured. Compression costs 6KB of RAM and
+ * runs in LOG_Write(), in the main loop.
+ *
+ * With LOG_STRIPES set to 2 every segment is striped over the two cards:
+ * it becomes a pair of member files of the same name on volumes 0: and 1:
+ * (see logformat.h). The staged sectors go to the cards in runs of up to
+ * LOG_STRIPE_SECTORS, taking turns, but a card still programming the last
+ * run is passed over for one that is ready, and LOG_Task() leaves the
+ * sectors staged when both are busy. A slow card thus delays only its own
+ * runs, and the two cards program at the same time. tools/stripecat.c
+ * merges the members into a plain segment.
+ *
+ * With LOG_MIRRORS set to 2 instead, every segment is written in full to
+ * both cards, as two plain segment files of the same name. Each card has
+ * its own place in the staging ring and a sector leaves the ring once both
+ * have written it, so a slow card only holds more of the ring (LOG_Lag())
+ * and the other one goes on; LOG_Write() only waits for it when the ring
+ * is full. Size the ring for the longest write stall of the cards.
+ *
+ * With LOG_PREERASE the data area of the prepared segment is erased while
+ * the logger is idle, one whole allocation unit of the card (AU) per call
+ * of LOG_Task() and only when the card is not busy. The card then has
+ * erased AUs to write the segment into instead of garbage collecting
+ * under the data. The clusters freed by the truncation of a retired
+ * segment or by a deletion are erased by FatFs (_USE_TRIM).
+ *
+ * With LOG_RETAIN the cards are used as a ring: when a card has less than
+ * LOG_FREE_MIN bytes free after a segment is prepared, LOG_Task() deletes
+ * the oldest segments, one per call and only while the staging ring is
+ * empty, until it has again. A segment that cannot be prepared because
+ * the card is full makes room at once. The free space is checked when a
+ * segment is prepared only, so the files of the other modules are made
+ * room for a segment later.
+ *
+ * LOG_Record() frames data as a timestamped record of a channel. Sources
+ * running in interrupts take the timestamp with TS_Now() at the event and
+ * hand it over with the data; the record is written later by the main loop.
+ *
+ * @pre
+ *   The volume must be mounted with f_mount() before LOG_Init(), both
+ *   volumes with LOG_STRIPES or LOG_MIRRORS set to 2. The logger is not
+ *   reentrant: call it from the main loop only.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+#include "logformat.h"
+#include "timestamp.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define LOG_STAGE_SECTORS	8						/* Staging ring depth, in sectors */
+#define LOG_SEGMENT_SIZE	(4UL * 1024 * 1024)		/* Bytes preallocated per segment */
+#define LOG_SEGMENT_SECONDS	3600					/* Maximum segment age (0: size only) */
+#define LOG_FLUSH_SECONDS	1						/* Staged data is written at least this often */
+#define LOG_COMMIT_SECONDS	60						/* Commit interval of the segment header */
+#define LOG_CLMT_SIZE		32						/* Cluster link map items per segment */
+#define LOG_COMPRESS		0						/* 1: LZ compressed data sectors (lzpack.h) */
+#define LOG_LZ_RAW			4096					/* Data gathered for compression, bytes */
+#define LOG_INDEX_SECTORS	32						/* Data sectors per index entry (0: no index) */
+#define LOG_STRIPES			1						/* Cards the segments are striped over (1 or 2) */
+#define LOG_STRIPE_SECTORS	4						/* Sectors written to one card at a time */
+#define LOG_MIRRORS			1						/* Cards holding a full copy of each segment (1 or 2) */
+#define LOG_PREERASE		1						/* 1: the prepared segment is erased ahead, an AU at a time */
+#define LOG_RETAIN			1						/* 1: the oldest segments are deleted to keep LOG_FREE_MIN free */
+#define LOG_FREE_MIN		(4 * LOG_SEGMENT_SIZE)	/* Free space kept on each card by LOG_RETAIN, bytes */
+
+#define LOG_TICK_HZ			100						/* LOG_TimerProc() call rate */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT LOG_Init (void);
+FRESULT LOG_Write (const void *data, UINT len);
+FRESULT LOG_Puts (const char *str);
+FRESULT LOG_Record (BYTE chan, BYTE flags, const TSTAMP *ts, const void *data, UINT len);
+FRESULT LOG_Task (void);
+FRESULT LOG_Flush (void);
+FRESULT LOG_Sync (void);
+FRESULT LOG_Rotate (void);
+FRESULT LOG_Close (void);
+UINT LOG_Lag (BYTE card);
+UINT LOG_Staged (UINT *peak);
+void LOG_TimerProc (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
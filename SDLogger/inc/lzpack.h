@@ -0,0 +1,46 @@
+#ifndef LZPACK_H_
+#define LZPACK_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file lzpack.h
+ * @headerfile lzpack.h
+ * @date Oct 18, 2026
+ *
+ * @brief LZ compressor of the log sectors (LOGSEG_FL_LZ, see logformat.h).
+ *
+ * Greedy LZ77 with a single entry hash table of LZPACK_HASH_BITS, in the
+ * manner of LZ4: four bytes are hashed at each position and the previous
+ * position with the same hash is the only match candidate. Positions that
+ * find no match are skipped faster and faster, so incompressible data
+ * costs little time.
+ *
+ * The output size is bounded instead of the input: LZ_Pack() takes as much
+ * of the input as fits in the output buffer, so the logger can fill each
+ * sector with one block. Every call starts with an empty table; blocks
+ * are independent of each other. LZ_PackSector() fills a whole sector and
+ * stores the data as it is (LOGSEC_RAW_MAGIC) when the block would not
+ * carry more of it, so incompressible data takes no more card space than
+ * in a plain segment.
+ *
+ * Has no target dependency, so host tools can build it as is.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define LZPACK_HASH_BITS	10						/* 2KB of table */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+uint32_t LZ_Pack (const uint8_t *src, uint32_t srclen, uint8_t *dst, uint32_t dstcap, uint32_t *used);
+uint32_t LZ_PackSector (const uint8_t *src, uint32_t srclen, uint8_t *sect, uint32_t *used);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
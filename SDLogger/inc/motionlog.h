@@ -0,0 +1,86 @@
+#ifndef MOTIONLOG_H_
+#define MOTIONLOG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file motionlog.h
+ * @headerfile motionlog.h
+ * @date Oct 18, 2026
+ *
+ * @brief Quadrature encoder sampling and motor control input edges
+ *        (PHA/MCI0, PHB/MCI1 and IDX/MCI2 on P1.20, P1.23 and P1.24).
+ *
+ * The QEI velocity timer is loaded for the sample rate and its interrupt
+ * stores the position counter in blocks of MOTIONLOG_BLOCK samples; the
+ * first sample of a block is timestamped. MOTIONLOG_Task() delta-encodes
+ * each full block to one LOGREC_CH_MOTION record (see logformat.h). The
+ * difference between two samples is the velocity, in encoder edges per
+ * sample period, so it is not logged apart. With the encoder at rest a
+ * sample takes one byte.
+ *
+ * The MCPWM capture channels can also timestamp every edge of the three
+ * MCI inputs, for hall sensors or other slow signals sharing the pins. The
+ * edge time is corrected by the capture register for the interrupt
+ * latency.
+ *
+ * Samples or edges dropped while the rings are full are counted by
+ * MOTIONLOG_Lost(), and the record that follows the gap carries
+ * LOGREC_MOT_FL_LOST. Edges wait for a record until half the ring is full
+ * or the oldest has waited 100ms.
+ *
+ * Run by tools/motionsim.c against a simulated encoder and the card model
+ * of tools/host, a sample takes 1.09 bytes of log (header included) while
+ * the encoder moves less than 64 edges a sample, and an edge 6.4 bytes. At 10000 samples/s no sample
+ * is lost with card stalls up to 80ms, at 50000 samples/s up to 10ms. The
+ * edge ring keeps up to 50000 edges/s without stalls, but a stall of 20ms
+ * loses edges already at 2000 edges/s: the capture is for slow signals.
+ * The CPU time of the interrupts is not modelled, so there is no load
+ * figure.
+ *
+ * The settings are read from the configuration file (config.h):
+ *
+ * @code
+ *   qei = 10000                        # samples/s, 0 or absent: off
+ *   mcicap = 1                         # 1: log the MCI edges
+ * @endcode
+ *
+ * P1.23 is also the button that main() polls. While the QEI or the edge
+ * capture is on, the pin carries the PHB/MCI1 signal and the button is not
+ * read (see MOTIONLOG_UsesButton()).
+ *
+ * @pre
+ *   The volume must be mounted and the logger running.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+#include "stdbool.h"
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define MOTIONLOG_BLOCKS	4						/* Position blocks in the ring */
+#define MOTIONLOG_BLOCK		256						/* Samples per block */
+#define MOTIONLOG_EDGES		64						/* MCI edges buffered (power of 2) */
+#define MOTIONLOG_MAX_RATE	50000
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT MOTIONLOG_Init (void);
+FRESULT MOTIONLOG_Task (void);
+uint32_t MOTIONLOG_Lost (void);
+bool MOTIONLOG_UsesButton (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
@@ -0,0 +1,86 @@
+#ifndef RINGLOG_H_
+#define RINGLOG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file ringlog.h
+ * @headerfile ringlog.h
+ * @date Oct 18, 2026
+ *
+ * @brief Raw sector rings for the highest rate channels.
+ *
+ * RING_Init() opens LOGRING_NAME, or creates it with RINGLOG_SIZE bytes in
+ * one extent, and closes it again: the FAT and the directory are never
+ * written after that. The records handed to RING_Record() are packed into
+ * sectors (see logformat.h) and written straight to the LBAs of the file
+ * with disk_write(), RINGLOG_RUN sectors per write, wrapping around at
+ * the end and overwriting the oldest data. A record costs a copy, and at
+ * most one multiple block write of the card when a run fills, so the
+ * latency is bounded by the card alone: no FAT lookup, no cluster
+ * allocation, no directory update. RING_Task() writes the partial sector
+ * in place every RINGLOG_FLUSH_SECONDS.
+ *
+ * At start up the newest sector is found with a binary search over the
+ * sector numbers (about 20 sector reads), and the writer goes on after it.
+ * A file of another size is replaced. If the free clusters of the card do
+ * not give a single extent, RING_Init() fails with FR_DENIED: format the
+ * card (volfmt.h) or free space first.
+ *
+ * With RINGLOG_CHANNEL_FILES above 0 the first channels of
+ * RINGLOG_CHANNEL_LIST get a ring file of their own (RINGCHnn.DAT, see
+ * logformat.h) and the other channels share LOGRING_NAME. The files are
+ * open together, each with its run buffer (RINGLOG_RUN sectors of RAM per
+ * file) and its extent of RINGLOG_SIZE bytes. A fresh extent is placed on
+ * an allocation unit (AU) boundary of the card, so with RINGLOG_SIZE a
+ * multiple of the AU every AU belongs to one file and is written from its
+ * start to its end, in runs; only the flushes rewrite a sector. The card
+ * sees one sequential stream per file, and has to keep that many AUs open
+ * to write them at full speed.
+ *
+ * tools/chanbench.c counts the card commands on the host: with four
+ * channels, runs of 8 sectors and about 470KB/s, the channel files take
+ * 271 writes per MB against 266 for the merged ring, but the merged ring
+ * can use the RAM of the four buffers for runs of 32 sectors and takes 67.
+ * One FatFs file per channel with an f_write() per record would take
+ * about 10800 writes and 8750 reads per MB, through the one sector window
+ * of _FS_TINY.
+ *
+ * The files stay plain files for a PC; tools/ringcat.c puts the sectors
+ * of one back in order and writes the log stream, for adccat and logquery.
+ *
+ * @pre
+ *   The volume must be mounted. Call it from the main loop only, and do
+ *   not open the ring file with FatFs while it is in use.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+#include "logformat.h"
+#include "timestamp.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define RINGLOG_SIZE		(32UL * 1024 * 1024)	/* Ring file size, header sector included */
+#define RINGLOG_RUN			8						/* Sectors written per disk_write() */
+#define RINGLOG_FLUSH_SECONDS	1					/* The partial sector is written this often */
+#define RINGLOG_CHANNEL_FILES	0					/* Channels with a ring file of their own */
+#define RINGLOG_CHANNEL_LIST	{ LOGREC_CH_ADC, LOGREC_CH_CAN, LOGREC_CH_UART, LOGREC_CH_MOTION }
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT RING_Init (void);
+FRESULT RING_Record (BYTE chan, BYTE flags, const TSTAMP *ts, const void *data, UINT len);
+FRESULT RING_Task (void);
+FRESULT RING_Flush (void);
+FRESULT RING_Close (void);
+DWORD RING_Dropped (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
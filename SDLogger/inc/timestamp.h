@@ -0,0 +1,71 @@
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file timestamp.h
+ * @headerfile timestamp.h
+ * @date Oct 18, 2026
+ *
+ * @brief RTC based wall clock and high resolution timestamps.
+ *
+ * The RTC counter increment interrupt runs once per second. It reads the
+ * calendar registers, caches the FatFs timestamp returned by get_fattime()
+ * and latches the count of a free running timer (TS_TIMER, clocked at CCLK)
+ * at the start of the second. TS_Now() adds the timer ticks elapsed since
+ * that latch to the RTC seconds, so timestamps keep the RTC date and get the
+ * resolution of the timer (10ns at 100MHz).
+ *
+ * The cached state is double buffered and switched with a single word
+ * store, so TS_Now() never waits and can be called from any interrupt.
+ * It costs a few loads, one timer register read and one multiplication.
+ *
+ * @pre
+ *   TS_Init() must run before the volume is mounted. TS_TIMER is reserved
+ *   for this module. RTC_IRQn gets the highest priority, since its latency
+ *   is the error of the sub-second part.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "lpc17xx_rtc.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define TS_TIMER			LPC_TIM3				/* Free running sub-second counter */
+#define TS_EPOCH_YEAR		2000					/* TSTAMP.sec counts from Jan 1st of this year */
+
+/* Time set when the RTC was not running (no backup battery). */
+#define TS_DEFAULT_YEAR		2016
+#define TS_DEFAULT_MONTH	1
+#define TS_DEFAULT_DOM		1
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagTSTAMP
+{
+	uint32_t sec;			/* Seconds since TS_EPOCH_YEAR, RTC local time */
+	uint32_t nsec;			/* Nanoseconds, 0..999999999 */
+} TSTAMP;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+void TS_Init (void);
+void TS_SetTime (RTC_TIME_Type *time);
+void TS_Now (TSTAMP *ts);
+uint32_t TS_Seconds (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
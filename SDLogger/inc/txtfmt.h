@@ -0,0 +1,55 @@
+#ifndef TXTFMT_H_
+#define TXTFMT_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file txtfmt.h
+ * @headerfile txtfmt.h
+ * @date Oct 18, 2026
+ *
+ * @brief Integer only printf style formatter writing to memory.
+ *
+ * Made for the text log (txtlog.h), to take the place of f_printf(),
+ * which sends every character through a function call and a 64 byte
+ * buffer and converts numbers one division per digit. Here the literal
+ * text is copied in runs, numbers are converted two digits per division
+ * by 100 with a table of digit pairs, and the output goes straight to the
+ * caller's buffer, cut at its size.
+ *
+ * Conversions: %d %i %u %x %X %c %s %% and, with TXTFMT_FLOAT, %f. Flags
+ * '-' and '0', a width (or '*') and a precision are taken; 'l' and 'll'
+ * select long and long long arguments. A %f value is taken apart into
+ * the mantissa and exponent bits of the IEEE-754 double: the integer part
+ * is a shift of the mantissa and the decimals, scaled by a power of ten
+ * from a table, come from 64-bit multiplies and shifts, rounded to
+ * nearest (half up) exactly. No floating point routine is called, so the
+ * Cortex-M3 links no soft-float code for it. The precision (default 6, at
+ * most 9) is the number of decimals; values beyond the range of a 64-bit
+ * integer print as "inf".
+ *
+ * With TXTFMT_CRLF every '\n', in the format and in %s and %c, is written
+ * as "\r\n", as f_printf() does with _USE_STRFUNC 2.
+ *
+ * Has no target dependency, so host tools can build it as is.
+ *
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define TXTFMT_CRLF			1						/* '\n' is written as "\r\n" */
+#define TXTFMT_FLOAT		1						/* %f support, in integer arithmetic */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+uint32_t TXT_Format (char *dst, uint32_t cap, const char *fmt, ...);
+uint32_t TXT_VFormat (char *dst, uint32_t cap, const char *fmt, va_list ap);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
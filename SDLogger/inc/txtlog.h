@@ -0,0 +1,58 @@
+#ifndef TXTLOG_H_
+#define TXTLOG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file txtlog.h
+ * @headerfile txtlog.h
+ * @date Oct 18, 2026
+ *
+ * @brief Human readable text log (TXTLOG_FILE), for deployments that need
+ *        a log file that can be read without the host tools.
+ *
+ * TXTLOG_Printf() formats with txtfmt.h straight into a sector buffer
+ * held at the end of the file, each line prefixed with the date and time
+ * (TXTLOG_STAMP). Only whole sectors are handed to f_write(), sector
+ * aligned, so FatFs writes them from the buffer with no copy and no read
+ * back; the partial sector is written in place and synced every
+ * TXTLOG_FLUSH_SECONDS by TXTLOG_Task(), as the binary log does.
+ *
+ * The file is appended to across restarts: TXTLOG_Init() reloads its
+ * partial last sector.
+ *
+ * tools/txtbench.c compares it with f_printf() on the host, on a RAM disk:
+ * 1.1 to 1.6 times the lines per second and about 12% fewer disk writes.
+ * A host CPU divides and calls cheaply; on the Cortex-M3, where f_printf()
+ * pays a function call per character, the gain should be larger.
+ *
+ * @pre
+ *   The volume must be mounted. Call it from the main loop only.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define TXTLOG_FILE			"LOG.TXT"
+#define TXTLOG_LINE_MAX		256						/* Longest output of one call; the rest is cut */
+#define TXTLOG_FLUSH_SECONDS	1					/* The partial sector is written this often */
+#define TXTLOG_STAMP		1						/* 1: lines start with "YYYY-MM-DD hh:mm:ss.mmm " */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT TXTLOG_Init (void);
+FRESULT TXTLOG_Printf (const char *fmt, ...);
+FRESULT TXTLOG_Task (void);
+FRESULT TXTLOG_Flush (void);
+FRESULT TXTLOG_Close (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
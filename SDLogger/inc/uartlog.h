@@ -0,0 +1,70 @@
+#ifndef UARTLOG_H_
+#define UARTLOG_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file uartlog.h
+ * @headerfile uartlog.h
+ * @date Oct 18, 2026
+ *
+ * @brief Serial line sniffer on UART2 (RXD2 on P0.11).
+ *
+ * The GPDMA copies the received bytes into a circular buffer in AHB SRAM,
+ * made of UARTLOG_SEGS linked list items that point to each other in a
+ * ring. At the FIFO trigger level of 8 the DMA takes bursts of 4, so it
+ * never empties the FIFO. When the line goes idle the bytes left in it
+ * raise the character timeout interrupt: the handler halts the channel,
+ * moves them to the buffer itself and restarts the channel after them.
+ *
+ * Each idle period and each completed segment closes a chunk, which is
+ * timestamped and queued for UARTLOG_Task(). The task logs every chunk as
+ * LOGREC_CH_UART records of up to a segment, copied out of the buffer
+ * first, so the records follow the message boundaries of the sniffed
+ * protocol. With the queue full a chunk grows and boundaries merge. Bytes
+ * the DMA overwrote before they were logged are skipped, counted by
+ * UARTLOG_Lost() and flagged on the next record.
+ *
+ * The buffer lasts 44ms of a continuous stream at 921600 baud. Run by
+ * tools/uartsim.c against the card model of tools/host, a continuous
+ * stream is logged whole with card stalls up to 40ms. Messages with idle
+ * gaps are logged whole with stalls up to 50ms, each gap closing a record.
+ *
+ * The line rate is read from the configuration file (config.h), 8N1:
+ *
+ * @code
+ *   uart = 921600                      # 0 or absent: sniffer off
+ * @endcode
+ *
+ * @pre
+ *   The volume must be mounted and the logger running.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define UARTLOG_BUF			4096					/* Circular buffer (power of 2) */
+#define UARTLOG_SEGS		4						/* DMA linked list items in the ring */
+#define UARTLOG_CHUNKS		32						/* Chunks queued for the task (power of 2) */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT UARTLOG_Init (void);
+FRESULT UARTLOG_Task (void);
+uint32_t UARTLOG_Lost (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
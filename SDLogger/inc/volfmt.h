@@ -0,0 +1,61 @@
+#ifndef VOLFMT_H_
+#define VOLFMT_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file volfmt.h
+ * @headerfile volfmt.h
+ * @date Oct 18, 2026
+ *
+ * @brief Card formatting laid out on the allocation unit (AU) of the card.
+ *
+ * Cards formatted on a PC often have a FAT or a data area that does not
+ * start on an AU boundary, and then every cluster written straddles two
+ * AUs. VOL_Format() runs the f_mkfs() of the firmware, which takes the AU
+ * size from the SD status (ACMD13, read by SD_ReadConfiguration()), moves
+ * the partition so that the FAT starts on an AU boundary and expands the
+ * FAT so that the data area does too. The clusters are VOL_CLUSTER bytes,
+ * large for long sequential writes and fewer FAT updates; a volume too
+ * small to be laid out with them gets half the size, down to
+ * VOL_CLUSTER_MIN.
+ *
+ * VOL_Init() formats the cards when the configuration file asks for it
+ * with
+ *
+ * @code
+ *   format = 1
+ * @endcode
+ *
+ * The configuration file is kept in RAM (up to VOL_CFG_MAX bytes) and
+ * written back to the new volume with the "format" line commented out, so
+ * the cards are formatted once. tools/fmtcheck.c checks the layout of a
+ * card image on the host.
+ *
+ * @pre
+ *   The volumes must be mounted with f_mount(). Call it before any file
+ *   is opened (LOG_Init()).
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define VOL_CLUSTER			32768					/* Cluster size, bytes */
+#define VOL_CLUSTER_MIN		4096					/* Smallest cluster tried */
+#define VOL_CFG_MAX			2048					/* Largest configuration file kept */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT VOL_Init (BYTE volumes);
+FRESULT VOL_Format (const TCHAR *path);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
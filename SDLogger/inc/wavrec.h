@@ -0,0 +1,84 @@
+#ifndef WAVREC_H_
+#define WAVREC_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file wavrec.h
+ * @headerfile wavrec.h
+ * @date Oct 18, 2026
+ *
+ * @brief I2S stereo 16-bit recorder to WAV files (I2SRX_CLK, WS and SDA on
+ *        P0.4, P0.5 and P0.6, shared with CAN2).
+ *
+ * The I2S receiver runs as master at the configured sample rate. The GPDMA
+ * copies its FIFO, one stereo frame per word with the left sample in the
+ * lower half, into a ring of WAVREC_BUFS buffers in AHB SRAM: that is the
+ * WAV sample layout, so WAVREC_Task() writes each full buffer to the file
+ * as it is, in whole sectors.
+ *
+ * The files (WAVnnnnn.WAV) are preallocated to WAVREC_FILE_SIZE. A JUNK
+ * chunk pads the header to one sector, so the samples start sector
+ * aligned. The RIFF and data sizes in the header are patched every
+ * WAVREC_SYNC_SECONDS, together with f_sync(): after a power loss the file
+ * plays up to the last sync, and the preallocated tail is ignored. The next
+ * file is grown by WAVREC_GROW bytes per idle call of the task, so a file
+ * switch never has to walk the FAT for a whole file.
+ *
+ * At 48kHz the stream is 192KB/s. The ring holds WAVREC_BUFS x WAVREC_BUF
+ * bytes, 85ms with the defaults. Buffers overwritten by the DMA before
+ * being written are counted by WAVREC_Lost() and leave a gap in the file;
+ * a buffer the DMA reaches while f_write() sends it is taken back from the
+ * file and counted too, as part of it may be the newer samples. Run by
+ * tools/wavsim.c against the card model of tools/host, the recording
+ * loses nothing with card stalls up to 60ms at 48kHz and 25ms at 96kHz.
+ * When the volume has no room for the next file the recorder stops trying
+ * to preallocate it, and the recording ends when the current file is full.
+ *
+ * The sample rate is read from the configuration file (config.h):
+ *
+ * @code
+ *   wav = 48000                        # 0 or absent: recorder off
+ * @endcode
+ *
+ * @pre
+ *   The volume must be mounted.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "ff.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define WAVREC_BUFS			4						/* DMA buffers in the ring */
+#define WAVREC_BUF			4096					/* Bytes per buffer (sector multiple) */
+#define WAVREC_FILE_SIZE	(128UL * 1024 * 1024)	/* Bytes preallocated per file */
+#define WAVREC_GROW			(1024UL * 1024)			/* Preallocation step of the next file */
+#define WAVREC_SYNC_SECONDS	2						/* Header patch and sync interval */
+#define WAVREC_CLMT_SIZE	32						/* Cluster link map items per file */
+#define WAVREC_MAX_RATE		96000
+
+#define WAVREC_NAME_PREFIX	"WAV"					/* WAVnnnnn.WAV */
+#define WAVREC_NAME_EXT		".WAV"
+#define WAVREC_NAME_DIGITS	5
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+FRESULT WAVREC_Init (void);
+FRESULT WAVREC_Task (void);
+FRESULT WAVREC_Close (void);
+uint32_t WAVREC_Lost (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
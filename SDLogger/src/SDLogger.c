@@ -21,15 +21,31 @@
 
 // TODO: insert other include files here
 #include "ff.h"
+#include "diskio.h"
+#include "sdcard.h"
+#include "timestamp.h"
+#include "logger.h"
+#include "adclog.h"
+#include "canlog.h"
+#include "uartlog.h"
+#include "i2clog.h"
+#include "wavrec.h"
+#include "ethcap.h"
+#include "motionlog.h"
+#include "txtlog.h"
+#include "volfmt.h"
+#include "ringlog.h"
 // TODO: insert other definitions and declarations here
 #include "SDLogger.h"
 
 int main(void)
 {
 	FATFS FatFs;   			/* Work area (file system object) for logical drive */
-	FIL fil;       			/* File object */
+#if LOG_STRIPES > 1 || LOG_MIRRORS > 1
+	FATFS FatFs1;			/* Second card, for the striped or mirrored segments */
+#endif
 	bool stats = false;
-	char line; 				/* Line buffer */
+	bool button = true;					/* P1.23 is read as the button */
 
 	PINSEL_CFG_Type PinCfg;
 
@@ -45,12 +61,80 @@ int main(void)
 
 	SystemCoreClockUpdate();
 
-	if(f_mount(&FatFs, "", 1) == FR_OK)
+	TS_Init();							/* RTC and timestamps, before any file is written. */
+	SD_SetTickHook(LOG_TimerProc);		/* Logger time base on the 10ms SysTick of the SD driver */
+
+	if(f_mount(&FatFs, "", 1) == FR_OK
+#if LOG_STRIPES > 1 || LOG_MIRRORS > 1
+			&& f_mount(&FatFs1, "1:", 1) == FR_OK
+#endif
+			)
 	{
 		DEBUGP("\nMounted!");
-		if(f_open(&fil, "logger.txt", (FA_OPEN_ALWAYS | FA_READ | FA_WRITE)) == FR_OK)
+#if USE_VOLFMT
+		if (VOL_Init((LOG_STRIPES > 1 || LOG_MIRRORS > 1) ? 2 : 1) != FR_OK)
+		{
+			DEBUGP("\nFormat failed!");
+		}
+#endif
+		if(LOG_Init() == FR_OK)
 		{
 			DEBUGP("\nOpened!");
+#if USE_RINGLOG
+			if (RING_Init() == FR_OK)
+			{
+				DEBUGP("\nRing opened!");
+			}
+#endif
+#if USE_ADCLOG
+			if (ADCLOG_Init(ADCLOG_CHMASK, ADCLOG_RATE) && ADCLOG_Start() == FR_OK)
+			{
+				DEBUGP("\nADC running!");
+			}
+#endif
+#if USE_CANLOG
+			if (CANLOG_Init() == FR_OK)
+			{
+				DEBUGP("\nCAN configured!");
+			}
+#endif
+#if USE_UARTLOG
+			if (UARTLOG_Init() == FR_OK)
+			{
+				DEBUGP("\nUART configured!");
+			}
+#endif
+#if USE_I2CLOG
+			if (I2CLOG_Init() == FR_OK)
+			{
+				DEBUGP("\nI2C configured!");
+			}
+#endif
+#if USE_WAVREC
+			if (WAVREC_Init() == FR_OK)
+			{
+				DEBUGP("\nWAV recorder configured!");
+			}
+#endif
+#if USE_ETHCAP
+			if (ETHCAP_Init() == FR_OK)
+			{
+				DEBUGP("\nEthernet capture configured!");
+			}
+#endif
+#if USE_MOTIONLOG
+			if (MOTIONLOG_Init() == FR_OK)
+			{
+				DEBUGP("\nMotion capture configured!");
+			}
+			button = !MOTIONLOG_UsesButton();	/* PHB/MCI1 shares P1.23 */
+#endif
+#if USE_TXTLOG
+			if (TXTLOG_Init() == FR_OK)
+			{
+				DEBUGP("\nText log opened!");
+			}
+#endif
 		}
 	}
 	else
@@ -58,40 +142,57 @@ int main(void)
 		DEBUGP("\nError!");
 	}
 
-//  Byte Read Allocation.
-//	FRESULT fr;          					/* FatFs function common result code */
-//	UINT br, bw;         					/* File read/write count */
-//	for (;;)								/* For test from f_read only. */
-//	{
-//		fr = f_read(&fil, &line, 1, &br);  	/* Read a chunk of byte of source file */
-//		if (fr || br == 0) break; 			/* error or eof */
-//		printf("%c", line);
-//	}
-
-//  Character Read Allocation.
-//	f_gets(&line, sizeof(line), &fil);  	/* Read a chunk of character of source file */
-
     while(1)
     {
-    	if((GPIO_ReadValue(1) & (1 << 23)) && (stats == false))
+    	if(button && (GPIO_ReadValue(1) & (1 << 23)) && (stats == false))
     	{
     		stats = true;
-//    		if(f_write(&fil, "Button Enabled!", 17, &bw) == FR_OK)	// error
-    		if(f_puts("\nButton Enabled!", &fil) != 0)	// error
+    		if(LOG_Puts("\nButton Enabled!") == FR_OK)
     		{
-    			f_sync(&fil);
     			DEBUGP("\nWritted and Enabled!");
     		}
+#if USE_TXTLOG
+    		TXTLOG_Printf("Button enabled\n");
+#endif
     	}
-    	if(!(GPIO_ReadValue(1) & (1 << 23)) && (stats == true))
+    	if(button && !(GPIO_ReadValue(1) & (1 << 23)) && (stats == true))
     	{
     		stats = false;
-//    		if(f_write(&fil, "Button Disabled!\r\n", 18, &bw) == FR_OK)
-    		if(f_puts("\nButton Disabled!", &fil) != 0)
+    		if(LOG_Puts("\nButton Disabled!") == FR_OK)
 			{
-    			f_sync(&fil);
 				DEBUGP("\nWritted and Disabled!");
 			}
+#if USE_TXTLOG
+    		TXTLOG_Printf("Button disabled\n");
+#endif
     	}
+#if USE_ADCLOG
+    	ADCLOG_Task();						/* Hands the full ADC buffers to the logger. */
+#endif
+#if USE_CANLOG
+    	CANLOG_Task();						/* Packs the received CAN frames. */
+#endif
+#if USE_UARTLOG
+    	UARTLOG_Task();						/* Logs the received serial chunks. */
+#endif
+#if USE_I2CLOG
+    	I2CLOG_Task();						/* Packs the I2C bus events. */
+#endif
+#if USE_WAVREC
+    	WAVREC_Task();						/* Writes the I2S buffers to the WAV file. */
+#endif
+#if USE_ETHCAP
+    	ETHCAP_Task();						/* Packs the captured frames into pcapng blocks. */
+#endif
+#if USE_MOTIONLOG
+    	MOTIONLOG_Task();					/* Delta-encodes the encoder samples. */
+#endif
+#if USE_TXTLOG
+    	TXTLOG_Task();						/* Flushes the partial text sector. */
+#endif
+#if USE_RINGLOG
+    	RING_Task();						/* Flushes the partial ring sector. */
+#endif
+    	LOG_Task();							/* Writes staged sectors and rotates segments. */
     }
 }
@@ -0,0 +1,405 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file adclog.c
+ * @date Oct 18, 2026
+ *
+ * @brief Multi-channel ADC capture in burst mode.
+ *
+ * See adclog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <string.h>
+#include <cr_section_macros.h>
+
+#include "lpc17xx_adc.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_gpdma.h"
+#include "lpc17xx_pinsel.h"
+
+#include "dma.h"
+#include "timestamp.h"
+#include "logger.h"
+
+#include "adclog.h"
+#if ADCLOG_RING
+#include "ringlog.h"
+#endif
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define ADC_CHANNELS		8
+
+#if ADCLOG_RING
+#define ADC_RECORD			RING_Record
+#else
+#define ADC_RECORD			LOG_Record
+#endif
+
+#define ADC_LLI_CONTROL		(GPDMA_DMACCxControl_TransferSize(ADCLOG_BUF_SAMPLES) \
+							| GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_1) | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_1) \
+							| GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_WORD) | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_WORD) \
+							| GPDMA_DMACCxControl_DI | GPDMA_DMACCxControl_I)
+
+#define ADC_SAMPLE_TAG(s)	((s) & 0xF000)			/* Channel and overrun flag */
+
+#if ADCLOG_BUF_SAMPLES > 4095
+#error ADCLOG_BUF_SAMPLES exceeds the DMA transfer size.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* DMA buffer of ADGDR words. */
+typedef struct tagADCBUF
+{
+	uint32_t gdr[ADCLOG_BUF_SAMPLES];
+} ADCBUF;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+__BSS(RAM2) static ADCBUF Buf[ADCLOG_BUFS];
+static GPDMA_LLI_Type Lli[ADCLOG_BUFS];
+
+static volatile bool Full[ADCLOG_BUFS];					/* Set by the DMA interrupt */
+static TSTAMP Stamp[ADCLOG_BUFS];						/* Completion time of each buffer */
+static volatile uint8_t DmaIdx;							/* Buffer being filled */
+static volatile uint32_t Lost;							/* Buffers overwritten before logged */
+static uint32_t LostLogged;
+static uint16_t Out[ADCLOG_BUF_SAMPLES];				/* Record of the buffer being logged */
+
+static uint8_t ChMask;
+static uint8_t NextCh[ADC_CHANNELS];					/* Channel converted after each one */
+static uint8_t NumCh;
+static uint32_t Rate;									/* Effective conversion rate */
+static bool Running;
+
+/* AD0.0 to AD0.7 pins: port, pin, function. */
+static const uint8_t AdcPin[ADC_CHANNELS][3] =
+{
+	{ 0, 23, 1 }, { 0, 24, 1 }, { 0, 25, 1 }, { 0, 26, 1 },
+	{ 1, 30, 3 }, { 1, 31, 3 }, { 0,  3, 2 }, { 0,  2, 2 }
+};
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void DmaHandler (bool error);
+static void PackBuffer (const ADCBUF *buf, uint16_t *out);
+#if ADCLOG_PACK
+static uint32_t EncodeBuffer (uint16_t *s);
+#endif
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Configures the pins, the ADC and the DMA ring.
+  *
+  * @param  chmask: Channels to convert, bit n for AD0.n.
+  * @param  rate:   Samples per second of each channel.
+  * @retval true if the aggregate rate is within the ADC limit.
+  */
+bool ADCLOG_Init (uint8_t chmask, uint32_t rate)
+{
+	PINSEL_CFG_Type PinCfg;
+	uint32_t nch = 0, div;
+	int i, j;
+
+	for (i = 0; i < ADC_CHANNELS; i++) nch += (chmask >> i) & 1;
+	if (nch == 0 || rate == 0 || rate * nch > ADCLOG_MAX_RATE) return false;
+
+	ADCLOG_Stop();
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_TRISTATE;
+	for (i = 0; i < ADC_CHANNELS; i++)
+	{
+		if (!(chmask & (1 << i))) continue;
+		PinCfg.Portnum = AdcPin[i][0];
+		PinCfg.Pinnum = AdcPin[i][1];
+		PinCfg.Funcnum = AdcPin[i][2];
+		PINSEL_ConfigPin(&PinCfg);
+	}
+
+	/* In burst mode the channels share the conversion rate. */
+	ADC_Init(LPC_ADC, rate * nch);
+	div = ((LPC_ADC->ADCR >> 8) & 0xFF) + 1;
+	Rate = CLKPWR_GetPCLK(CLKPWR_PCLKSEL_ADC) / div / 65;
+	LPC_ADC->ADCR |= chmask;
+
+	/* A DMA request for each conversion; the ADC interrupt stays off. */
+	NVIC_DisableIRQ(ADC_IRQn);
+	LPC_ADC->ADINTEN = chmask;
+
+	for (i = 0; i < ADCLOG_BUFS; i++)
+	{
+		Lli[i].SrcAddr = (uint32_t)&LPC_ADC->ADGDR;
+		Lli[i].DstAddr = (uint32_t)Buf[i].gdr;
+		Lli[i].NextLLI = (uint32_t)&Lli[(i + 1) % ADCLOG_BUFS];
+		Lli[i].Control = ADC_LLI_CONTROL;
+	}
+
+	/* The burst goes up through the selected channels and wraps. */
+	for (i = 0; i < ADC_CHANNELS; i++)
+	{
+		for (j = 1; j <= ADC_CHANNELS && !(chmask & (1 << ((i + j) % ADC_CHANNELS))); j++);
+		NextCh[i] = (i + j) % ADC_CHANNELS;
+	}
+
+	DMA_Init();
+	DMA_Attach(DMA_CH_ADC, DmaHandler);
+	ChMask = chmask;
+	NumCh = nch;
+
+	return true;
+}
+
+/**
+  * @brief  Logs the configuration and starts the conversions.
+  *
+  * @param  None
+  * @retval Result of the configuration record.
+  */
+FRESULT ADCLOG_Start (void)
+{
+	GPDMA_Channel_CFG_Type cfg;
+	LOGADCCFG rec;
+	FRESULT res;
+	int i;
+
+	if (ChMask == 0) return FR_NOT_READY;
+
+	rec.rate = Rate;
+	rec.chmask = ChMask;
+	rec.bits = 12;
+	rec.samples = ADCLOG_BUF_SAMPLES;
+	res = ADC_RECORD(LOGREC_CH_ADC, LOGREC_ADC_FL_CONFIG, NULL, &rec, sizeof(rec));
+	if (res != FR_OK) return res;
+
+	for (i = 0; i < ADCLOG_BUFS; i++) Full[i] = false;
+	DmaIdx = 0;
+	Lost = LostLogged = 0;
+
+	cfg.ChannelNum = DMA_CH_ADC;
+	cfg.TransferSize = ADCLOG_BUF_SAMPLES;
+	cfg.TransferWidth = 0;
+	cfg.SrcMemAddr = 0;
+	cfg.DstMemAddr = (uint32_t)Buf[0].gdr;
+	cfg.TransferType = GPDMA_TRANSFERTYPE_P2M;
+	cfg.SrcConn = GPDMA_CONN_ADC;
+	cfg.DstConn = 0;
+	cfg.DMALLI = (uint32_t)&Lli[1 % ADCLOG_BUFS];
+	if (GPDMA_Setup(&cfg) != SUCCESS) return FR_INT_ERR;
+
+	Running = true;
+	GPDMA_ChannelCmd(DMA_CH_ADC, ENABLE);
+	ADC_BurstCmd(LPC_ADC, ENABLE);
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Stops the conversions. Buffers already full are still logged by
+  *         ADCLOG_Task(); the partial one is dropped.
+  *
+  * @param  None
+  * @retval None
+  */
+void ADCLOG_Stop (void)
+{
+	if (!Running) return;
+
+	ADC_BurstCmd(LPC_ADC, DISABLE);
+	GPDMA_ChannelCmd(DMA_CH_ADC, DISABLE);
+	Running = false;
+}
+
+/**
+  * @brief  Logs the buffers filled by the DMA. Call it from the main loop.
+  *
+  * The buffers are taken in the order the DMA filled them, the oldest first:
+  * after a loss that is not the next one in the ring. Each is packed out of
+  * the ring before it goes to the logger, which may wait for the card while
+  * it takes the record, so the DMA can go on into the buffer meanwhile. A
+  * buffer the DMA went into while it was being packed was counted as lost
+  * by the DMA interrupt and is passed over.
+  *
+  * @param  None
+  * @retval FR_OK or the logger error.
+  */
+FRESULT ADCLOG_Task (void)
+{
+	FRESULT res = FR_OK;
+	TSTAMP stamp;
+	BYTE flags;
+	UINT len;
+	uint8_t idx, k;
+
+	while (res == FR_OK)
+	{
+		/* The buffers after the one being filled are the oldest. */
+		idx = DmaIdx;
+		for (k = 1; k < ADCLOG_BUFS && !Full[(idx + k) % ADCLOG_BUFS]; k++);
+		if (k == ADCLOG_BUFS) break;
+		idx = (idx + k) % ADCLOG_BUFS;
+
+		PackBuffer(&Buf[idx], Out);
+		len = ADCLOG_BUF_SAMPLES * sizeof(uint16_t);
+		flags = 0;
+#if ADCLOG_PACK
+		if ((len = EncodeBuffer(Out)) != 0)
+		{
+			flags = LOGREC_ADC_FL_PACKED;
+		}
+		else
+		{
+			len = ADCLOG_BUF_SAMPLES * sizeof(uint16_t);
+		}
+#endif
+		stamp = Stamp[idx];
+		if (DmaIdx == idx) continue;		/* Went into while packed, and counted */
+		Full[idx] = false;
+
+		if (Lost != LostLogged)
+		{
+			LostLogged = Lost;
+			flags |= LOGREC_ADC_FL_LOST;
+		}
+		res = ADC_RECORD(LOGREC_CH_ADC, flags, &stamp, Out, len);
+	}
+	return res;
+}
+
+/**
+  * @brief  Number of buffers overwritten by the DMA before being logged.
+  *
+  * @param  None
+  * @retval Lost buffers since ADCLOG_Start().
+  */
+uint32_t ADCLOG_Lost (void)
+{
+	return Lost;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Terminal count of a buffer; the DMA is already filling the next one,
+which is lost if it was not logged yet. */
+static void DmaHandler (bool error)
+{
+	uint8_t idx = DmaIdx, next = (idx + 1) % ADCLOG_BUFS;
+
+	if (error)
+	{
+		ADCLOG_Stop();
+		return;
+	}
+
+	TS_Now(&Stamp[idx]);
+	Full[idx] = true;
+	if (Full[next])					/* The main loop did not keep up */
+	{
+		Full[next] = false;
+		Lost++;
+	}
+	DmaIdx = next;
+}
+
+/* Packs the ADGDR words to LOGADC samples. */
+static void PackBuffer (const ADCBUF *buf, uint16_t *out)
+{
+	uint32_t i, w;
+
+	for (i = 0; i < ADCLOG_BUF_SAMPLES; i++)
+	{
+		w = buf->gdr[i];
+		out[i] = ADC_GDR_RESULT(w) | (ADC_GDR_CH(w) << 12)
+				| ((w & ADC_GDR_OVERRUN_FLAG) ? LOGADC_OVERRUN : 0);
+	}
+}
+
+#if ADCLOG_PACK
+/* Delta codes the samples to a LOGREC_ADC_FL_PACKED block, in place, and
+returns its size; 0 if the buffer has to be logged as it is. Each group
+is read into 'z' before its bytes are written, and the output never gets
+ahead of the samples still to be read: a group takes at most 53 bytes
+for 64 bytes of samples, and the head only 4 bytes more than the first
+samples it replaces. */
+static uint32_t EncodeBuffer (uint16_t *s)
+{
+	uint8_t *out = (uint8_t *)s;
+	uint16_t prev[ADC_CHANNELS], first[ADC_CHANNELS], v;
+	uint32_t z[LOGADC_GROUP];
+	uint32_t i, k, n, ch, any, w, acc, bits;
+	LOGADCPACK *hdr = (LOGADCPACK *)out;
+
+	/* Every tag must be the expected channel with no overrun. */
+	ch = LOGADC_CHAN(s[0]);
+	if (!(ChMask & (1 << ch))) return 0;
+	for (i = 0; i < ADCLOG_BUF_SAMPLES; i++)
+	{
+		if (ADC_SAMPLE_TAG(s[i]) != (ch << 12)) return 0;
+		ch = NextCh[ch];
+	}
+
+	for (i = 0; i < NumCh; i++)
+	{
+		first[i] = s[i];
+		prev[LOGADC_CHAN(s[i])] = LOGADC_VALUE(s[i]);
+	}
+	ch = NextCh[LOGADC_CHAN(s[NumCh - 1])];
+
+	for (i = NumCh; i < ADCLOG_BUF_SAMPLES; i += LOGADC_GROUP)
+	{
+		n = ADCLOG_BUF_SAMPLES - i;
+		if (n > LOGADC_GROUP) n = LOGADC_GROUP;
+
+		any = 0;
+		for (k = 0; k < n; k++)
+		{
+			v = LOGADC_VALUE(s[i + k]);
+			z[k] = LOGADC_ZIGZAG((int32_t)v - prev[ch]);
+			any |= z[k];
+			prev[ch] = v;
+			ch = NextCh[ch];
+		}
+		for (; k < LOGADC_GROUP; k++) z[k] = 0;
+
+		if (i == NumCh)		/* The first group is read: the head can go over it */
+		{
+			hdr->samples = ADCLOG_BUF_SAMPLES;
+			hdr->chan = LOGADC_CHAN(first[0]);
+			hdr->nch = NumCh;
+			out += sizeof(LOGADCPACK);
+			memcpy(out, first, NumCh * sizeof(uint16_t));
+			out += NumCh * sizeof(uint16_t);
+		}
+
+		w = 32 - __CLZ(any);
+		*out++ = w;
+		acc = bits = 0;
+		for (k = 0; k < LOGADC_GROUP; k++)
+		{
+			acc |= z[k] << bits;
+			for (bits += w; bits >= 8; bits -= 8)
+			{
+				*out++ = (uint8_t)acc;
+				acc >>= 8;
+			}
+		}
+	}
+	return out - (uint8_t *)s;
+}
+#endif
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,395 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file canlog.c
+ * @date Oct 18, 2026
+ *
+ * @brief CAN bus traffic capture on CAN1 and CAN2.
+ *
+ * See canlog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <cr_section_macros.h>
+#include <string.h>
+#include "stdbool.h"
+
+#include "lpc17xx_can.h"
+#include "lpc17xx_pinsel.h"
+
+#include "config.h"
+#include "timestamp.h"
+#include "logger.h"
+
+#include "canlog.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define CAN_BUSES			2
+
+#define RFS_DLC(rfs)		(((rfs) >> 16) & 0x0F)
+#define RFS_FLAGS			(CAN_RFS_FF | CAN_RFS_RTR)	/* Same bits as LOGCAN_EXT and LOGCAN_RTR */
+#define RFS_GAP				(1UL << 15)				/* Reserved bit of RFS, in the ring: frames lost before this one */
+
+#define RING_MASK			(CANLOG_RING - 1)
+
+#if CANLOG_RING & RING_MASK
+#error CANLOG_RING must be a power of 2.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Received frame, as read from the controller. */
+typedef struct tagCANSLOT
+{
+	TSTAMP   ts;
+	uint32_t idf;			/* RID with the LOGCAN_xxx flags */
+	uint32_t rfs;			/* Frame status */
+	uint32_t data[2];		/* RDA, RDB */
+} CANSLOT;
+
+/* canfilter entry, an identifier or a range. */
+typedef struct tagCANFILTER
+{
+	uint32_t first;
+	uint32_t last;
+	uint8_t  bus;			/* CAN1_CTRL or CAN2_CTRL */
+	bool     ext;
+} CANFILTER;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+__BSS(RAM2) static CANSLOT Ring[CANLOG_RING];
+static volatile uint16_t RingHead;						/* Written by the interrupt */
+static uint16_t RingTail;								/* Written by CANLOG_Task() */
+static volatile uint32_t Lost;							/* Frames lost in the ring or the controller */
+static bool Gap[CAN_BUSES];								/* Next frame stored of the bus follows a loss */
+
+static BYTE Batch[CANLOG_BATCH];						/* Record being packed */
+static UINT BatchFill;
+static TSTAMP BatchTime;
+static bool BatchLost;									/* A frame of the batch follows a loss */
+
+static LOGCANCFG Config;
+static CANFILTER Filter[CANLOG_FILTERS];
+
+static LPC_CAN_TypeDef * const Can[CAN_BUSES] = { LPC_CAN1, LPC_CAN2 };
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static bool SetupFilters (void);
+static void ConfigPins (uint8_t bus);
+static void Receive (LPC_CAN_TypeDef *can, uint32_t bus);
+static FRESULT FlushBatch (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Reads the CAN settings and starts the capture.
+  *
+  * @param  None
+  * @retval FR_OK (also when no bus is configured), FR_NO_FILE without
+  *         configuration file, FR_INVALID_PARAMETER for a filter the
+  *         acceptance filter does not take, or the logger error.
+  */
+FRESULT CANLOG_Init (void)
+{
+	FRESULT res;
+	uint8_t i;
+
+	memset(&Config, 0, sizeof(Config));
+	Config.listen = 1;
+
+	res = CFG_Parse(ConfigHandler);
+	if (res != FR_OK) return res;
+	if (Config.baud[0] == 0 && Config.baud[1] == 0) return FR_OK;
+
+	for (i = 0; i < CAN_BUSES; i++)
+	{
+		if (Config.baud[i] == 0) continue;
+		ConfigPins(i);
+		CAN_Init(Can[i], Config.baud[i]);			/* Also clears the filter table */
+	}
+	if (!SetupFilters()) return FR_INVALID_PARAMETER;
+
+	RingHead = RingTail = 0;
+	Lost = 0;
+	Gap[0] = Gap[1] = BatchLost = false;
+	BatchFill = 0;
+
+	res = LOG_Record(LOGREC_CH_CAN, LOGREC_CAN_FL_CONFIG, NULL, &Config, sizeof(Config));
+	if (res != FR_OK) return res;
+
+	for (i = 0; i < CAN_BUSES; i++)
+	{
+		if (Config.baud[i] == 0) continue;
+		if (Config.listen)
+		{
+			Can[i]->MOD = CAN_MOD_RM;
+			Can[i]->MOD = CAN_MOD_RM | CAN_MOD_LOM;
+			Can[i]->MOD = CAN_MOD_LOM;
+		}
+		Can[i]->IER = CAN_IER_RIE | CAN_IER_DOIE;
+	}
+	NVIC_SetPriority(CAN_IRQn, 1);
+	NVIC_EnableIRQ(CAN_IRQn);
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Packs the received frames into records. Call it from the main
+  *         loop.
+  *
+  * @param  None
+  * @retval FR_OK or the logger error.
+  */
+FRESULT CANLOG_Task (void)
+{
+	FRESULT res = FR_OK;
+	CANSLOT *f;
+	BYTE *p;
+	uint32_t dt;
+	UINT n;
+
+	while (res == FR_OK && RingTail != RingHead)
+	{
+		f = &Ring[RingTail];
+		n = LOGCAN_DATALEN(f->idf, RFS_DLC(f->rfs));
+
+		/* dt must fit 32 bits of nanoseconds. */
+		if (BatchFill && (BatchFill + LOGCAN_HDR_SIZE + n > CANLOG_BATCH || f->ts.sec - BatchTime.sec > 3))
+		{
+			res = FlushBatch();
+			if (res != FR_OK) break;
+		}
+		if (BatchFill == 0) BatchTime = f->ts;
+
+		dt = (f->ts.sec - BatchTime.sec) * 1000000000UL + f->ts.nsec - BatchTime.nsec;
+		p = &Batch[BatchFill];
+		memcpy(p, &dt, 4);
+		memcpy(p + 4, &f->idf, 4);
+		p[8] = RFS_DLC(f->rfs);
+		memcpy(p + LOGCAN_HDR_SIZE, f->data, n);
+		BatchFill += LOGCAN_HDR_SIZE + n;
+		if (f->rfs & RFS_GAP) BatchLost = true;
+
+		RingTail = (RingTail + 1) & RING_MASK;
+	}
+
+	if (res == FR_OK && BatchFill) res = FlushBatch();
+
+	return res;
+}
+
+/**
+  * @brief  Number of frames lost since CANLOG_Init(), in the ring or in the
+  *         controllers (data overrun).
+  *
+  * @param  None
+  * @retval Lost frames.
+  */
+uint32_t CANLOG_Lost (void)
+{
+	return Lost;
+}
+
+/**
+  * @brief  CAN interrupt, shared by both controllers.
+  *
+  * @param  None
+  * @retval None
+  */
+void CAN_IRQHandler (void)
+{
+	if (Config.baud[0]) Receive(LPC_CAN1, 0);
+	if (Config.baud[1]) Receive(LPC_CAN2, LOGCAN_BUS2);
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	uint32_t bus, first, last;
+	bool ext;
+	CANFILTER *f;
+
+	if (strcmp(key, "can1") == 0 || strcmp(key, "can2") == 0)
+	{
+		CFG_GetUint(&value, &Config.baud[key[3] - '1']);
+	}
+	else if (strcmp(key, "canlisten") == 0)
+	{
+		if (CFG_GetUint(&value, &first)) Config.listen = (first != 0);
+	}
+	else if (strcmp(key, "canfilter") == 0 && Config.filters < CANLOG_FILTERS)
+	{
+		if (!CFG_GetUint(&value, &bus) || bus < 1 || bus > CAN_BUSES) return;
+		if (CFG_GetWord(&value, "std")) ext = false;
+		else if (CFG_GetWord(&value, "ext")) ext = true;
+		else return;
+		if (!CFG_GetUint(&value, &first)) return;
+		last = first;
+		if (*value == '-')
+		{
+			value++;
+			if (!CFG_GetUint(&value, &last) || last < first) return;
+		}
+		if (last > (ext ? 0x1FFFFFFFUL : 0x7FFUL)) return;
+
+		f = &Filter[Config.filters++];
+		f->bus = (bus == 1) ? CAN1_CTRL : CAN2_CTRL;
+		f->ext = ext;
+		f->first = first;
+		f->last = last;
+	}
+}
+
+/* Loads the acceptance filter, which wants each section sorted by
+controller and identifier. Without filters every frame is accepted. */
+static bool SetupFilters (void)
+{
+	static SFF_Entry sff[CANLOG_FILTERS];
+	static SFF_GPR_Entry sffg[CANLOG_FILTERS];
+	static EFF_Entry eff[CANLOG_FILTERS];
+	static EFF_GPR_Entry effg[CANLOG_FILTERS];
+	AF_SectionDef af;
+	CANFILTER t;
+	int i, j;
+
+	if (Config.filters == 0)
+	{
+		CAN_SetAFMode(LPC_CANAF, CAN_AccBP);
+		return true;
+	}
+
+	for (i = 1; i < Config.filters; i++)
+	{
+		t = Filter[i];
+		for (j = i; j > 0 && ((uint32_t)Filter[j - 1].bus << 29 | Filter[j - 1].first) > ((uint32_t)t.bus << 29 | t.first); j--)
+		{
+			Filter[j] = Filter[j - 1];
+		}
+		Filter[j] = t;
+	}
+
+	memset(&af, 0, sizeof(af));
+	af.SFF_Sec = sff;
+	af.SFF_GPR_Sec = sffg;
+	af.EFF_Sec = eff;
+	af.EFF_GPR_Sec = effg;
+	for (i = 0; i < Config.filters; i++)
+	{
+		if (!Filter[i].ext && Filter[i].first == Filter[i].last)
+		{
+			sff[af.SFF_NumEntry].controller = Filter[i].bus;
+			sff[af.SFF_NumEntry].disable = MSG_ENABLE;
+			sff[af.SFF_NumEntry++].id_11 = Filter[i].first;
+		}
+		else if (!Filter[i].ext)
+		{
+			sffg[af.SFF_GPR_NumEntry].controller1 = sffg[af.SFF_GPR_NumEntry].controller2 = Filter[i].bus;
+			sffg[af.SFF_GPR_NumEntry].disable1 = sffg[af.SFF_GPR_NumEntry].disable2 = MSG_ENABLE;
+			sffg[af.SFF_GPR_NumEntry].lowerID = Filter[i].first;
+			sffg[af.SFF_GPR_NumEntry++].upperID = Filter[i].last;
+		}
+		else if (Filter[i].first == Filter[i].last)
+		{
+			eff[af.EFF_NumEntry].controller = Filter[i].bus;
+			eff[af.EFF_NumEntry++].ID_29 = Filter[i].first;
+		}
+		else
+		{
+			effg[af.EFF_GPR_NumEntry].controller1 = effg[af.EFF_GPR_NumEntry].controller2 = Filter[i].bus;
+			effg[af.EFF_GPR_NumEntry].lowerEID = Filter[i].first;
+			effg[af.EFF_GPR_NumEntry++].upperEID = Filter[i].last;
+		}
+	}
+	if (af.SFF_NumEntry == 0) af.SFF_Sec = NULL;
+	if (af.SFF_GPR_NumEntry == 0) af.SFF_GPR_Sec = NULL;
+	if (af.EFF_NumEntry == 0) af.EFF_Sec = NULL;
+	if (af.EFF_GPR_NumEntry == 0) af.EFF_GPR_Sec = NULL;
+
+	return CAN_SetupAFLUT(LPC_CANAF, &af) == CAN_OK;
+}
+
+/* RD1/TD1 on P0.0/P0.1, RD2/TD2 on P0.4/P0.5. */
+static void ConfigPins (uint8_t bus)
+{
+	PINSEL_CFG_Type PinCfg;
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_PULLUP;
+	PinCfg.Portnum = 0;
+	PinCfg.Funcnum = (bus == 0) ? 1 : 2;
+	PinCfg.Pinnum = (bus == 0) ? 0 : 4;
+	PINSEL_ConfigPin(&PinCfg);
+	PinCfg.Pinnum++;
+	PINSEL_ConfigPin(&PinCfg);
+}
+
+/* Moves the received frame of a controller to the ring. */
+static void Receive (LPC_CAN_TypeDef *can, uint32_t bus)
+{
+	CANSLOT *f;
+	uint32_t rfs;
+	uint16_t head;
+	uint8_t gap = bus ? 1 : 0;
+
+	if (can->ICR & CAN_ICR_DOI)				/* Reading ICR clears it */
+	{
+		Lost++;
+		Gap[gap] = true;
+		can->CMR = CAN_CMR_CDO;
+	}
+
+	while (can->GSR & CAN_GSR_RBS)
+	{
+		head = RingHead;
+		if (((head + 1) & RING_MASK) == RingTail)
+		{
+			Lost++;
+			Gap[gap] = true;
+		}
+		else
+		{
+			f = &Ring[head];
+			TS_Now(&f->ts);
+			rfs = can->RFS;
+			f->rfs = Gap[gap] ? (rfs | RFS_GAP) : rfs;
+			Gap[gap] = false;
+			f->idf = can->RID | (rfs & RFS_FLAGS) | bus;
+			f->data[0] = can->RDA;
+			f->data[1] = can->RDB;
+			RingHead = (head + 1) & RING_MASK;
+		}
+		can->CMR = CAN_CMR_RRB;
+	}
+}
+
+/* The record holding the first frame of a bus after a loss on it carries
+LOGREC_CAN_FL_LOST, so a gap always ends in a flagged record. */
+static FRESULT FlushBatch (void)
+{
+	FRESULT res;
+
+	res = LOG_Record(LOGREC_CH_CAN, BatchLost ? LOGREC_CAN_FL_LOST : 0, &BatchTime, Batch, BatchFill);
+	BatchFill = 0;
+	BatchLost = false;
+
+	return res;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,137 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file config.c
+ * @date Oct 18, 2026
+ *
+ * @brief Configuration file on the card.
+ *
+ * See config.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "config.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define IS_SPACE(c)			((c) == ' ' || (c) == '\t' || (c) == '\n')
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static char *Trim (char *str);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Calls the handler for every setting of the configuration file.
+  *
+  * @param  handler: Setting handler.
+  * @retval FR_OK, FR_NO_FILE when there is no configuration file, or the
+  *         FatFs error.
+  */
+FRESULT CFG_Parse (CFG_HANDLER handler)
+{
+	FRESULT res;
+	FIL fil;
+	char line[CFG_LINE_MAX + 1];
+	char *key, *val;
+
+	res = f_open(&fil, CFG_FILENAME, FA_OPEN_EXISTING | FA_READ);
+	if (res != FR_OK) return res;
+
+	while (f_gets(line, sizeof(line), &fil) != NULL)
+	{
+		key = Trim(line);
+		if (*key == 0 || *key == '#') continue;
+
+		val = strchr(key, '=');
+		if (val == NULL) continue;
+		*val++ = 0;
+
+		handler(Trim(key), Trim(val));
+	}
+	res = f_error(&fil) ? FR_DISK_ERR : FR_OK;
+	f_close(&fil);
+
+	return res;
+}
+
+/**
+  * @brief  Reads an unsigned number, decimal or hexadecimal with "0x".
+  *
+  * @param  str: Pointer to the text, advanced past the number and the
+  *              blanks that follow it.
+  * @param  val: Receives the number.
+  * @retval true if a number was found.
+  */
+bool CFG_GetUint (const char **str, uint32_t *val)
+{
+	const char *s = *str;
+	uint32_t n = 0, base = 10, d;
+	bool any = false;
+
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+	{
+		base = 16;
+		s += 2;
+	}
+	for (;; s++)
+	{
+		if (*s >= '0' && *s <= '9') d = *s - '0';
+		else if (base == 16 && *s >= 'a' && *s <= 'f') d = *s - 'a' + 10;
+		else if (base == 16 && *s >= 'A' && *s <= 'F') d = *s - 'A' + 10;
+		else break;
+		n = n * base + d;
+		any = true;
+	}
+	if (!any) return false;
+
+	while (IS_SPACE(*s)) s++;
+	*str = s;
+	*val = n;
+	return true;
+}
+
+/**
+  * @brief  Matches a word followed by a blank or the end of the text.
+  *
+  * @param  str:  Pointer to the text, advanced past the word and the blanks
+  *               that follow it when it matches.
+  * @param  word: Word to match.
+  * @retval true if the word matched.
+  */
+bool CFG_GetWord (const char **str, const char *word)
+{
+	const char *s = *str;
+	size_t n = strlen(word);
+
+	if (strncmp(s, word, n) != 0 || (s[n] != 0 && !IS_SPACE(s[n]))) return false;
+
+	s += n;
+	while (IS_SPACE(*s)) s++;
+	*str = s;
+	return true;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static char *Trim (char *str)
+{
+	char *end;
+
+	while (IS_SPACE(*str)) str++;
+	end = str + strlen(str);
+	while (end > str && IS_SPACE(end[-1])) end--;
+	*end = 0;
+
+	return str;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,81 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file dma.c
+ * @date Oct 18, 2026
+ *
+ * @brief GPDMA channel allocation and shared interrupt dispatch.
+ *
+ * See dma.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include "lpc17xx_gpdma.h"
+
+#include "dma.h"
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static DMA_HANDLER Handler[DMA_CHANNELS];
+static bool DmaReady;
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Powers the GPDMA and enables its interrupt. Only the first call
+  *         has an effect.
+  *
+  * @param  None
+  * @retval None
+  */
+void DMA_Init (void)
+{
+	if (DmaReady) return;
+
+	GPDMA_Init();
+	NVIC_SetPriority(DMA_IRQn, 1);			/* Below the RTC, see timestamp.h */
+	NVIC_EnableIRQ(DMA_IRQn);
+	DmaReady = true;
+}
+
+/**
+  * @brief  Sets the interrupt handler of a channel.
+  *
+  * @param  ch:      DMA_CH_xxx.
+  * @param  handler: Handler, or NULL to ignore the channel interrupts.
+  * @retval None
+  */
+void DMA_Attach (uint8_t ch, DMA_HANDLER handler)
+{
+	if (ch < DMA_CHANNELS) Handler[ch] = handler;
+}
+
+/**
+  * @brief  GPDMA interrupt: clears and dispatches the pending channels.
+  *
+  * @param  None
+  * @retval None
+  */
+void DMA_IRQHandler (void)
+{
+	uint32_t stat = LPC_GPDMA->DMACIntStat;
+	uint32_t err = LPC_GPDMA->DMACIntErrStat;
+	uint8_t ch;
+
+	LPC_GPDMA->DMACIntTCClear = stat;
+	LPC_GPDMA->DMACIntErrClr = err;
+
+	for (ch = 0; stat; ch++, stat >>= 1)
+	{
+		if ((stat & 1) && Handler[ch]) Handler[ch]((err >> ch) & 1);
+	}
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
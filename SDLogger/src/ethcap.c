@@ -0,0 +1,509 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file ethcap.c
+ * @date Oct 18, 2026
+ *
+ * @brief Ethernet frame capture to pcapng files.
+ *
+ * See ethcap.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <cr_section_macros.h>
+#include <string.h>
+#include "stdbool.h"
+
+#include "lpc17xx_emac.h"
+#include "lpc17xx_pinsel.h"
+
+#include "config.h"
+#include "timestamp.h"
+
+#include "ethcap.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+/* pcapng block types and options */
+#define PCAPNG_SHB			0x0A0D0D0AUL			/* Section Header Block */
+#define PCAPNG_IDB			0x00000001UL			/* Interface Description Block */
+#define PCAPNG_ISB			0x00000005UL			/* Interface Statistics Block */
+#define PCAPNG_EPB			0x00000006UL			/* Enhanced Packet Block */
+#define PCAPNG_PAD			0x80000001UL			/* Local use, skipped by readers */
+#define PCAPNG_BOM			0x1A2B3C4DUL
+#define PCAPNG_LINKTYPE_ETH	1
+#define PCAPNG_OPT_TSRESOL	9						/* if_tsresol */
+#define PCAPNG_OPT_DROPS	4						/* epb_dropcount */
+#define PCAPNG_OPT_IFDROP	5						/* isb_ifdrop */
+
+#define SHB_SIZE			28
+#define IDB_SIZE			32						/* With if_tsresol and opt_endofopt */
+#define EPB_SIZE			32						/* Without data and options */
+#define EPB_DROPS_SIZE		16						/* epb_dropcount and opt_endofopt */
+#define EPB_MAX				(EPB_SIZE + EMAC_ETH_MAX_FLEN + EPB_DROPS_SIZE)
+#define ISB_SIZE			40						/* With isb_ifdrop and opt_endofopt */
+#define PAD_MIN				12
+
+#define UNIX_2000			946684800UL				/* Seconds from 1970 to TS_EPOCH_YEAR */
+
+#define FCS_SIZE			4
+#define RING_WORDS			(ETHCAP_RING / 4)
+#define RING_WRAP			0xFFFFFFFFUL			/* Slot header: continue at word 0 */
+#define SLOT_WORDS(len)		((sizeof(ETHSLOT) + (len) + 3) / 4)
+
+#if (ETHCAP_STAGE % _MAX_SS)
+#error ETHCAP_STAGE must be a sector multiple.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Frame in the ring, followed by its data padded to a word. */
+typedef struct tagETHSLOT
+{
+	uint16_t caplen;		/* Bytes kept */
+	uint16_t origlen;		/* Frame length without FCS */
+	uint32_t drops;			/* Frames lost just before this one */
+	TSTAMP   ts;
+} ETHSLOT;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+__BSS(RAM2) static uint32_t Ring[RING_WORDS];
+static volatile uint32_t RingHead;						/* Word index, written by the interrupt */
+static uint32_t RingTail;								/* Word index, written by ETHCAP_Task() */
+static volatile uint32_t Dropped;						/* Frames lost in the ring or the EMAC */
+static uint32_t DropSlotted;							/* Dropped up to the last frame in the ring */
+
+static uint32_t Stage[(ETHCAP_STAGE + EPB_MAX) / 4];	/* Blocks being packed, the last may run past the stage */
+static UINT StageFill;
+static uint32_t FlushTime;
+
+static FIL Fil;
+static bool Open;
+static uint32_t Enable;
+static uint32_t SnapLen;
+
+/* Locally administered, never transmitted */
+static uint8_t MacAddr[6] = { 0x02, 0x00, 0x00, 0x00, 0x17, 0x68 };
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static void ConfigPins (void);
+static void Receive (void);
+static ETHSLOT *Reserve (uint32_t words);
+static void PutFrame (const ETHSLOT *s);
+static void PutStats (void);
+static FRESULT FlushStage (bool pad);
+static FRESULT OpenFile (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Reads the capture settings, creates the file and starts the
+  *         EMAC in promiscuous mode.
+  *
+  * @param  None
+  * @retval FR_OK (also when the capture is off), FR_NO_FILE without
+  *         configuration file, FR_NOT_READY when the PHY does not answer,
+  *         or the file system error.
+  */
+FRESULT ETHCAP_Init (void)
+{
+	FRESULT res;
+	EMAC_CFG_Type EmacCfg;
+
+	Enable = 0;
+	SnapLen = EMAC_ETH_MAX_FLEN;
+	res = CFG_Parse(ConfigHandler);
+	if (res != FR_OK || Enable == 0) return res;
+	if (SnapLen == 0 || SnapLen > EMAC_ETH_MAX_FLEN) SnapLen = EMAC_ETH_MAX_FLEN;
+
+	RingHead = RingTail = 0;
+	Dropped = DropSlotted = 0;
+
+	res = OpenFile();
+	if (res != FR_OK) return res;
+
+	ConfigPins();
+	EmacCfg.Mode = EMAC_MODE_AUTO;
+	EmacCfg.pbEMAC_Addr = MacAddr;
+	if (EMAC_Init(&EmacCfg) != SUCCESS) return FR_NOT_READY;
+
+	EMAC_SetFilterMode(EMAC_RFC_UCAST_EN | EMAC_RFC_BCAST_EN | EMAC_RFC_MCAST_EN, ENABLE);
+	EMAC_IntCmd(EMAC_INT_TX_DONE, DISABLE);
+	EMAC_IntCmd(EMAC_INT_RX_OVERRUN, ENABLE);
+
+	NVIC_SetPriority(ENET_IRQn, 1);
+	NVIC_EnableIRQ(ENET_IRQn);
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Packs the received frames and writes the staging buffer when it
+  *         is full; every ETHCAP_FLUSH_SECONDS the frames staged are also
+  *         written, padded to a sector, and the file synced. Call it from
+  *         the main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT ETHCAP_Task (void)
+{
+	FRESULT res = FR_OK;
+	ETHSLOT *s;
+	uint32_t head = RingHead;					/* Frames coming in meanwhile wait for the next call */
+
+	if (!Open) return FR_OK;
+
+	while (res == FR_OK && RingTail != head)
+	{
+		if (Ring[RingTail] == RING_WRAP)
+		{
+			RingTail = 0;
+			continue;
+		}
+		s = (ETHSLOT *)&Ring[RingTail];
+		PutFrame(s);
+		RingTail += SLOT_WORDS(s->caplen);
+		if (RingTail == RING_WORDS) RingTail = 0;
+
+		if (StageFill >= ETHCAP_STAGE) res = FlushStage(false);
+	}
+
+	if (res == FR_OK && StageFill && TS_Seconds() - FlushTime >= ETHCAP_FLUSH_SECONDS)
+	{
+		res = FlushStage(true);
+		if (res == FR_OK) res = f_sync(&Fil);
+	}
+	return res;
+}
+
+/**
+  * @brief  Stops the EMAC, writes the staged frames and an Interface
+  *         Statistics Block with the frames dropped, and closes the file.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT ETHCAP_Close (void)
+{
+	FRESULT res;
+
+	if (!Open) return FR_OK;
+
+	NVIC_DisableIRQ(ENET_IRQn);
+	LPC_EMAC->Command &= ~EMAC_CR_RX_EN;
+
+	res = ETHCAP_Task();
+	if (res == FR_OK)
+	{
+		PutStats();
+		if (StageFill >= ETHCAP_STAGE) res = FlushStage(false);
+	}
+	if (res == FR_OK) res = FlushStage(true);
+	if (res == FR_OK) res = f_close(&Fil);
+	else f_close(&Fil);
+	Open = false;
+
+	return res;
+}
+
+/**
+  * @brief  Frames lost with a full ring or in EMAC overruns.
+  *
+  * @param  None
+  * @retval Dropped frames since ETHCAP_Init().
+  */
+uint32_t ETHCAP_Dropped (void)
+{
+	return Dropped;
+}
+
+/**
+  * @brief  Ethernet interrupt: receive done and overrun.
+  *
+  * @param  None
+  * @retval None
+  */
+void ENET_IRQHandler (void)
+{
+	uint32_t status;
+
+	status = LPC_EMAC->IntStatus & LPC_EMAC->IntEnable;
+	LPC_EMAC->IntClear = status;
+
+	/* The frames already in the descriptors are whole: taken first. */
+	if (status & (EMAC_INT_RX_DONE | EMAC_INT_RX_OVERRUN)) Receive();
+	if (status & EMAC_INT_RX_OVERRUN)
+	{
+		/* The receive datapath has to be reset; the frame in it is lost,
+		counted as one though the FIFO may have held more. */
+		Dropped++;
+		LPC_EMAC->Command |= EMAC_CR_RX_RES;
+		LPC_EMAC->RxConsumeIndex = LPC_EMAC->RxProduceIndex;
+		LPC_EMAC->Command |= EMAC_CR_RX_EN;
+	}
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	if (strcmp(key, "eth") == 0)
+	{
+		CFG_GetUint(&value, &Enable);
+	}
+	else if (strcmp(key, "ethsnap") == 0)
+	{
+		CFG_GetUint(&value, &SnapLen);
+	}
+}
+
+/* RMII: TXD0, TXD1, TX_EN, CRS, RXD0, RXD1, RX_ER, REF_CLK, MDC, MDIO. */
+static void ConfigPins (void)
+{
+	static const uint8_t pins[] = { 0, 1, 4, 8, 9, 10, 14, 15, 16, 17 };
+	PINSEL_CFG_Type PinCfg;
+	uint32_t i;
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_TRISTATE;
+	PinCfg.Portnum = 1;
+	PinCfg.Funcnum = 1;
+	for (i = 0; i < sizeof(pins); i++)
+	{
+		PinCfg.Pinnum = pins[i];
+		PINSEL_ConfigPin(&PinCfg);
+	}
+}
+
+/* Copies the received frames to the ring and releases their descriptors. */
+static void Receive (void)
+{
+	EMAC_PACKETBUF_Type pkt;
+	ETHSLOT *s;
+	uint32_t len, cap;
+	uint32_t head;
+
+	while (EMAC_CheckReceiveIndex())
+	{
+		if (EMAC_CheckReceiveDataStatus(EMAC_RINFO_ERR_MASK) == RESET
+			&& EMAC_CheckReceiveDataStatus(EMAC_RINFO_LAST_FLAG) == SET)
+		{
+			len = EMAC_GetReceiveDataSize() + 1;		/* The field holds size - 1 */
+			len = (len > FCS_SIZE) ? len - FCS_SIZE : 0;
+			cap = (len > SnapLen) ? SnapLen : len;
+
+			s = Reserve(SLOT_WORDS(cap));
+			if (s == NULL)
+			{
+				Dropped++;
+			}
+			else
+			{
+				TS_Now(&s->ts);
+				s->caplen = cap;
+				s->origlen = len;
+				s->drops = Dropped - DropSlotted;
+				DropSlotted = Dropped;
+				pkt.ulDataLen = cap;
+				pkt.pbDataBuf = (uint32_t *)(s + 1);
+				EMAC_ReadPacketBuffer(&pkt);
+
+				head = (uint32_t *)s - Ring + SLOT_WORDS(cap);
+				RingHead = (head == RING_WORDS) ? 0 : head;
+			}
+		}
+		EMAC_UpdateRxConsumeIndex();
+	}
+}
+
+/* Finds room for a slot, leaving a wrap mark when it does not fit before
+the end of the ring. The ring is never filled up to the tail, so that
+head == tail always means empty. */
+static ETHSLOT *Reserve (uint32_t words)
+{
+	uint32_t head = RingHead;
+	uint32_t tail = RingTail;
+
+	if (head < tail) return (words < tail - head) ? (ETHSLOT *)&Ring[head] : NULL;
+
+	if (words < RING_WORDS - head || (words == RING_WORDS - head && tail != 0))
+	{
+		return (ETHSLOT *)&Ring[head];
+	}
+	if (words >= tail) return NULL;
+
+	Ring[head] = RING_WRAP;
+	return (ETHSLOT *)&Ring[0];
+}
+
+/* Appends an EPB for the frame to the staging buffer, which holds less
+than ETHCAP_STAGE bytes: the EPB may run past the stage, into the next
+write. */
+static void PutFrame (const ETHSLOT *s)
+{
+	BYTE *p = (BYTE *)Stage + StageFill;
+	uint32_t drops = s->drops;
+	uint32_t data = (s->caplen + 3) & ~3UL;
+	uint32_t size = EPB_SIZE + data + (drops ? EPB_DROPS_SIZE : 0);
+	uint64_t ns;
+
+	ns = (uint64_t)(s->ts.sec + UNIX_2000) * 1000000000ULL + s->ts.nsec;
+
+	ST_DWORD(p, PCAPNG_EPB);
+	ST_DWORD(p + 4, size);
+	ST_DWORD(p + 8, 0);							/* Interface */
+	ST_DWORD(p + 12, (DWORD)(ns >> 32));
+	ST_DWORD(p + 16, (DWORD)ns);
+	ST_DWORD(p + 20, s->caplen);
+	ST_DWORD(p + 24, s->origlen);
+	memcpy(p + 28, s + 1, data);
+	p += 28 + data;
+	if (drops)
+	{
+		ST_WORD(p, PCAPNG_OPT_DROPS);
+		ST_WORD(p + 2, 8);
+		ST_DWORD(p + 4, drops);
+		ST_DWORD(p + 8, 0);
+		ST_DWORD(p + 12, 0);					/* opt_endofopt */
+		p += EPB_DROPS_SIZE;
+	}
+	ST_DWORD(p, size);
+
+	StageFill += size;
+}
+
+/* Appends the Interface Statistics Block that closes the file: the frames
+dropped in all, including those after the last EPB. */
+static void PutStats (void)
+{
+	BYTE *p = (BYTE *)Stage + StageFill;
+	TSTAMP ts;
+	uint64_t ns;
+
+	TS_Now(&ts);
+	ns = (uint64_t)(ts.sec + UNIX_2000) * 1000000000ULL + ts.nsec;
+
+	ST_DWORD(p, PCAPNG_ISB);
+	ST_DWORD(p + 4, ISB_SIZE);
+	ST_DWORD(p + 8, 0);							/* Interface */
+	ST_DWORD(p + 12, (DWORD)(ns >> 32));
+	ST_DWORD(p + 16, (DWORD)ns);
+	ST_WORD(p + 20, PCAPNG_OPT_IFDROP);
+	ST_WORD(p + 22, 8);
+	ST_DWORD(p + 24, Dropped);
+	ST_DWORD(p + 28, 0);
+	ST_DWORD(p + 32, 0);						/* opt_endofopt */
+	ST_DWORD(p + 36, ISB_SIZE);
+
+	StageFill += ISB_SIZE;
+}
+
+/* Writes the first ETHCAP_STAGE bytes of the staging buffer and moves the
+rest to its start; with pad, writes all of it instead, up to a sector
+boundary filled by a block readers skip. */
+static FRESULT FlushStage (bool pad)
+{
+	FRESULT res;
+	BYTE *p = (BYTE *)Stage + StageFill;
+	UINT n = ETHCAP_STAGE, rem, bw;
+
+	if (pad)
+	{
+		n = (StageFill + PAD_MIN + _MAX_SS - 1) & ~(_MAX_SS - 1UL);
+		rem = n - StageFill;
+		memset(p, 0, rem);
+		ST_DWORD(p, PCAPNG_PAD);
+		ST_DWORD(p + 4, rem);
+		ST_DWORD(p + rem - 4, rem);
+		StageFill = n;
+	}
+
+	res = f_write(&Fil, Stage, n, &bw);
+	if (res == FR_OK && bw != n) res = FR_DENIED;
+
+	StageFill -= n;
+	memmove(Stage, (BYTE *)Stage + n, StageFill);
+	if (pad) FlushTime = TS_Seconds();
+
+	return res;
+}
+
+/* Creates the next ETHnnnnn.PCN and stages its section header and
+interface description. */
+static FRESULT OpenFile (void)
+{
+	FRESULT res;
+	DIR dir;
+	FILINFO fno;
+	TCHAR name[13];
+	DWORD seq, next = 1;
+	const TCHAR *n;
+	BYTE *p = (BYTE *)Stage;
+	int i;
+
+	res = f_opendir(&dir, "");
+	while (res == FR_OK)
+	{
+		res = f_readdir(&dir, &fno);
+		if (res != FR_OK || fno.fname[0] == 0) break;
+		if (fno.fattrib & AM_DIR) continue;
+		if (strncmp(fno.fname, ETHCAP_NAME_PREFIX, sizeof(ETHCAP_NAME_PREFIX) - 1) != 0) continue;
+		n = fno.fname + sizeof(ETHCAP_NAME_PREFIX) - 1;
+		for (i = 0, seq = 0; i < ETHCAP_NAME_DIGITS && n[i] >= '0' && n[i] <= '9'; i++) seq = seq * 10 + (n[i] - '0');
+		if (i == ETHCAP_NAME_DIGITS && strcmp(n + i, ETHCAP_NAME_EXT) == 0 && seq >= next) next = seq + 1;
+	}
+	if (res != FR_OK) return res;
+
+	strcpy(name, ETHCAP_NAME_PREFIX);
+	for (i = ETHCAP_NAME_DIGITS - 1; i >= 0; i--)
+	{
+		name[sizeof(ETHCAP_NAME_PREFIX) - 1 + i] = '0' + (next % 10);
+		next /= 10;
+	}
+	strcpy(name + sizeof(ETHCAP_NAME_PREFIX) - 1 + ETHCAP_NAME_DIGITS, ETHCAP_NAME_EXT);
+
+	res = f_open(&Fil, name, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res != FR_OK) return res;
+	Open = true;
+
+	memset(Stage, 0, SHB_SIZE + IDB_SIZE);
+	ST_DWORD(p, PCAPNG_SHB);
+	ST_DWORD(p + 4, SHB_SIZE);
+	ST_DWORD(p + 8, PCAPNG_BOM);
+	ST_WORD(p + 12, 1);							/* Version 1.0 */
+	ST_WORD(p + 14, 0);
+	ST_DWORD(p + 16, 0xFFFFFFFFUL);				/* Section length not given */
+	ST_DWORD(p + 20, 0xFFFFFFFFUL);
+	ST_DWORD(p + 24, SHB_SIZE);
+	p += SHB_SIZE;
+	ST_DWORD(p, PCAPNG_IDB);
+	ST_DWORD(p + 4, IDB_SIZE);
+	ST_WORD(p + 8, PCAPNG_LINKTYPE_ETH);
+	ST_DWORD(p + 12, SnapLen);
+	ST_WORD(p + 16, PCAPNG_OPT_TSRESOL);
+	ST_WORD(p + 18, 1);
+	p[20] = 9;									/* Nanoseconds */
+	ST_DWORD(p + 28, IDB_SIZE);					/* After opt_endofopt */
+	StageFill = SHB_SIZE + IDB_SIZE;
+
+	res = FlushStage(true);
+	if (res == FR_OK) res = f_sync(&Fil);
+	return res;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
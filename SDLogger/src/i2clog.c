@@ -0,0 +1,313 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file i2clog.c
+ * @date Oct 18, 2026
+ *
+ * @brief I2C bus monitor on I2C0 (SDA0 on P0.27, SCL0 on P0.28).
+ *
+ * See i2clog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <string.h>
+#include "stdbool.h"
+
+#include "lpc17xx_i2c.h"
+#include "lpc17xx_pinsel.h"
+
+#include "config.h"
+#include "timestamp.h"
+#include "logger.h"
+
+#include "i2clog.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define MON_I2C				LPC_I2C0
+#define MON_IRQn			I2C0_IRQn
+
+#define EV_GAP				0x2000					/* Unused bit of the event, in the ring: events lost before this one */
+#define HOLD_NS				100000000UL				/* Age of a batch logged before it is full */
+
+#define RING_MASK			(I2CLOG_RING - 1)
+#define STAMP_MASK			(I2CLOG_STAMPS - 1)
+
+#if (I2CLOG_RING & RING_MASK) || (I2CLOG_STAMPS & STAMP_MASK)
+#error I2CLOG_RING and I2CLOG_STAMPS must be powers of 2.
+#endif
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint16_t Ring[I2CLOG_RING];
+static volatile uint16_t RingHead;						/* Written by the interrupt */
+static uint16_t RingTail;								/* Written by I2CLOG_Task() */
+static TSTAMP Stamp[I2CLOG_STAMPS];						/* Time of each LOGI2C_ADDR in Ring */
+static volatile uint16_t StampHead;
+static uint16_t StampTail;
+static volatile uint32_t Lost;							/* Events dropped with a full ring */
+static bool Gap;										/* Dropping up to the next address event */
+
+static BYTE Batch[I2CLOG_BATCH];						/* Record being packed */
+static UINT BatchFill;
+static TSTAMP BatchTime;
+static bool BatchLost;									/* An event of the batch follows a loss */
+static TSTAMP XferTime;									/* Time of the last address event */
+
+static LOGI2CCFG Config;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static void Event (uint16_t ev);
+static FRESULT FlushBatch (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Reads the I2C settings and starts the monitor.
+  *
+  * @param  None
+  * @retval FR_OK (also when the monitor is off), FR_NO_FILE without
+  *         configuration file, or the logger error.
+  */
+FRESULT I2CLOG_Init (void)
+{
+	FRESULT res;
+	PINSEL_CFG_Type PinCfg;
+
+	memset(&Config, 0, sizeof(Config));
+
+	res = CFG_Parse(ConfigHandler);
+	if (res != FR_OK || Config.rate == 0) return res;
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_TRISTATE;	/* The bus has its own pull-ups */
+	PinCfg.Portnum = 0;
+	PinCfg.Funcnum = 1;
+	PinCfg.Pinnum = 27;
+	PINSEL_ConfigPin(&PinCfg);
+	PinCfg.Pinnum = 28;
+	PINSEL_ConfigPin(&PinCfg);
+
+	RingHead = RingTail = 0;
+	StampHead = StampTail = 0;
+	Lost = 0;
+	Gap = BatchLost = false;
+	BatchFill = 0;
+	TS_Now(&XferTime);
+
+	res = LOG_Record(LOGREC_CH_I2C, LOGREC_I2C_FL_CONFIG, NULL, &Config, sizeof(Config));
+	if (res != FR_OK) return res;
+
+	I2C_Init(MON_I2C, Config.rate);
+	I2C_Cmd(MON_I2C, I2C_SLAVE_MODE, ENABLE);
+	I2C_MonitorModeConfig(MON_I2C, I2C_MONITOR_CFG_MATCHALL, ENABLE);
+	I2C_MonitorModeConfig(MON_I2C, I2C_MONITOR_CFG_SCL_OUTPUT, Config.stretch ? ENABLE : DISABLE);
+	I2C_MonitorModeCmd(MON_I2C, ENABLE);
+
+	/* Above the other capture interrupts: the data buffer register only
+	holds a byte for nine bit times. */
+	NVIC_SetPriority(MON_IRQn, 0);
+	NVIC_EnableIRQ(MON_IRQn);
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Packs the bus events into records. Call it from the main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the logger error.
+  */
+FRESULT I2CLOG_Task (void)
+{
+	FRESULT res = FR_OK;
+	uint16_t ev;
+	uint32_t dt;
+	TSTAMP ts;
+	UINT n;
+
+	while (res == FR_OK && RingTail != RingHead)
+	{
+		ev = Ring[RingTail];
+		n = 2;
+		if (LOGI2C_KIND(ev) == LOGI2C_ADDR)
+		{
+			ts = Stamp[StampTail];
+			n = LOGI2C_ADDR_SIZE;
+		}
+
+		/* dt must fit 32 bits of nanoseconds. */
+		if (BatchFill && (BatchFill + n > I2CLOG_BATCH || (n == LOGI2C_ADDR_SIZE && ts.sec - BatchTime.sec > 3)))
+		{
+			res = FlushBatch();
+			if (res != FR_OK) break;
+		}
+		if (n == LOGI2C_ADDR_SIZE) XferTime = ts;
+		if (BatchFill == 0) BatchTime = XferTime;
+
+		if (ev & EV_GAP)
+		{
+			BatchLost = true;
+			ev &= ~EV_GAP;
+		}
+		memcpy(&Batch[BatchFill], &ev, 2);
+		if (n == LOGI2C_ADDR_SIZE)
+		{
+			dt = (ts.sec - BatchTime.sec) * 1000000000UL + ts.nsec - BatchTime.nsec;
+			memcpy(&Batch[BatchFill + 2], &dt, 4);
+			StampTail = (StampTail + 1) & STAMP_MASK;
+		}
+		BatchFill += n;
+
+		RingTail = (RingTail + 1) & RING_MASK;
+	}
+
+	/* A record per pass of the main loop would hold a couple of events:
+	the batch is kept until it is full or old. */
+	if (res == FR_OK && BatchFill)
+	{
+		TS_Now(&ts);
+		if ((ts.sec - BatchTime.sec) * 1000000000ULL + ts.nsec - BatchTime.nsec >= HOLD_NS) res = FlushBatch();
+	}
+
+	return res;
+}
+
+/**
+  * @brief  Number of bus events lost since I2CLOG_Init().
+  *
+  * @param  None
+  * @retval Lost events.
+  */
+uint32_t I2CLOG_Lost (void)
+{
+	return Lost;
+}
+
+/**
+  * @brief  I2C0 interrupt: one address or data byte, STOP or bus error.
+  *
+  * @param  None
+  * @retval None
+  */
+void I2C0_IRQHandler (void)
+{
+	uint8_t byte;
+
+	byte = (uint8_t)MON_I2C->I2DATA_BUFFER;
+
+	switch (MON_I2C->I2STAT & I2C_STAT_CODE_BITMASK)
+	{
+	/* SLA+W, general call, SLA+R */
+	case I2C_I2STAT_S_RX_SLAW_ACK:
+	case I2C_I2STAT_S_RX_ARB_LOST_M_SLA:
+	case I2C_I2STAT_S_RX_GENCALL_ACK:
+	case I2C_I2STAT_S_RX_ARB_LOST_M_GENCALL:
+	case I2C_I2STAT_S_TX_SLAR_ACK:
+	case I2C_I2STAT_S_TX_ARB_LOST_M_SLA:
+		Event(LOGI2C_ADDR | byte);
+		break;
+
+	/* Written by the master. The monitor itself never drives SDA. */
+	case I2C_I2STAT_S_RX_PRE_SLA_DAT_ACK:
+	case I2C_I2STAT_S_RX_PRE_GENCALL_DAT_ACK:
+		Event(LOGI2C_DATA | byte);
+		break;
+	case I2C_I2STAT_S_RX_PRE_SLA_DAT_NACK:
+	case I2C_I2STAT_S_RX_PRE_GENCALL_DAT_NACK:
+		Event(LOGI2C_DATA | LOGI2C_NACK | byte);
+		break;
+
+	/* Read by the master from the addressed slave */
+	case I2C_I2STAT_S_TX_DAT_ACK:
+	case I2C_I2STAT_S_TX_LAST_DAT_ACK:
+		Event(LOGI2C_DATA | byte);
+		break;
+	case I2C_I2STAT_S_TX_DAT_NACK:
+		Event(LOGI2C_DATA | LOGI2C_NACK | byte);
+		break;
+
+	case I2C_I2STAT_S_RX_STA_STO_SLVREC_SLVTRX:
+		Event(LOGI2C_STOP);
+		break;
+
+	case I2C_I2STAT_BUS_ERROR:
+		Event(LOGI2C_ERROR);
+		MON_I2C->I2CONSET = I2C_I2CONSET_STO;		/* Releases the bus state machine */
+		break;
+
+	default:
+		break;
+	}
+
+	MON_I2C->I2CONSET = I2C_I2CONSET_AA;			/* Keeps following the bus */
+	MON_I2C->I2CONCLR = I2C_I2CONCLR_SIC;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	uint32_t val;
+
+	if (strcmp(key, "i2c") == 0)
+	{
+		CFG_GetUint(&value, &Config.rate);
+	}
+	else if (strcmp(key, "i2cstretch") == 0)
+	{
+		if (CFG_GetUint(&value, &val)) Config.stretch = (val != 0);
+	}
+}
+
+/* Queues an event, with the time of an address event. After a loss the
+events are dropped up to the next address event, so that the log goes on
+at the start of a transfer, which carries EV_GAP. */
+static void Event (uint16_t ev)
+{
+	uint16_t head = RingHead;
+	uint16_t stamp = StampHead;
+	bool addr = (LOGI2C_KIND(ev) == LOGI2C_ADDR);
+
+	if (((head + 1) & RING_MASK) == RingTail || (addr && ((stamp + 1) & STAMP_MASK) == StampTail)
+			|| (Gap && !addr))
+	{
+		Lost++;
+		Gap = true;
+		return;
+	}
+	if (addr)
+	{
+		TS_Now(&Stamp[stamp]);
+		StampHead = (stamp + 1) & STAMP_MASK;
+		if (Gap) ev |= EV_GAP;
+		Gap = false;
+	}
+	Ring[head] = ev;
+	RingHead = (head + 1) & RING_MASK;
+}
+
+static FRESULT FlushBatch (void)
+{
+	FRESULT res;
+
+	res = LOG_Record(LOGREC_CH_I2C, BatchLost ? LOGREC_I2C_FL_LOST : 0, &BatchTime, Batch, BatchFill);
+	BatchFill = 0;
+	BatchLost = false;
+
+	return res;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,1555 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file logger.c
+ * @date Oct 18, 2026
+ *
+ * @brief SD card logging pipeline with segment rotation.
+ *
+ * See logger.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <string.h>
+#include "stdbool.h"
+
+#include "ff.h"
+#include "diskio.h"
+
+#include "logger.h"
+#include "lzpack.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define LOG_SS				_MAX_SS
+
+/* Segment slot states */
+#define SEG_FREE			0
+#define SEG_READY			1		/* Created, preallocated and waiting to become current */
+#define SEG_ACTIVE			2		/* Receiving the staged sectors */
+#define SEG_RETIRED			3		/* Rotated out, waiting to be truncated and closed */
+
+#define LOG_SLOTS			3		/* Current, next and retired */
+#define LOG_NAME_SIZE		16		/* "n:LOGnnnnn.DAT" */
+#define LOG_RECLAIM_SCAN	8		/* Segment numbers tried per ReclaimSegment() */
+
+#define STAGE_HEAD			((StageTail + StageCount) % LOG_STAGE_SECTORS)
+#define SECT_INDEX(seg, ofs)	(((ofs) - (seg)->data) / LOG_SS)
+
+#if LOG_INDEX_SECTORS
+#define LOG_INDEX_PAGES		((LOG_STRIPES * (LOG_SEGMENT_SIZE / LOG_SS) / LOG_INDEX_SECTORS + LOGIDX_ENTRIES - 1) / LOGIDX_ENTRIES)
+#else
+#define LOG_INDEX_PAGES		0
+#endif
+#define LOG_DATA_START		(LOGSEG_HDR_SIZE + LOG_INDEX_PAGES * LOG_SS)	/* Header and index pages */
+
+#if LOG_STRIPES > 1
+#define LOG_RUN_SECTORS		LOG_STRIPE_SECTORS		/* Most sectors per write */
+#else
+#define LOG_RUN_SECTORS		LOG_STAGE_SECTORS
+#endif
+
+#if LOG_MIRRORS > 1
+#define LOG_MEMBERS			LOG_MIRRORS				/* Member files per segment */
+#else
+#define LOG_MEMBERS			LOG_STRIPES
+#endif
+
+#if LOG_COMPRESS
+#define LOG_PENDING()		(RawFill != 0)			/* Stream bytes not in a full sector yet */
+#else
+#define LOG_PENDING()		(StageFill != 0)
+#endif
+
+#if _FS_NORTC
+#define LOG_FATTIME()		((DWORD)(_NORTC_YEAR - 1980) << 25 | (DWORD)_NORTC_MON << 21 | (DWORD)_NORTC_MDAY << 16)
+#else
+#define LOG_FATTIME()		get_fattime()
+#endif
+
+#if (LOG_SEGMENT_SIZE % LOG_SS) || (LOG_SEGMENT_SIZE <= LOGSEG_HDR_SIZE)
+#error LOG_SEGMENT_SIZE must be a multiple of the sector size.
+#endif
+#if LOG_SS != LOGSEG_SECT_SIZE
+#error The journal format needs 512 byte sectors.
+#endif
+#if LOG_DATA_START > 0xFFFF
+#error The index does not fit before the data: raise LOG_INDEX_SECTORS.
+#endif
+#if LOG_STRIPES > 1 && LOG_MIRRORS > 1
+#error Segments are either striped or mirrored.
+#endif
+#if LOG_MEMBERS < 1 || LOG_MEMBERS > _VOLUMES
+#error Each member file needs a volume of its own.
+#endif
+#if LOG_COMPRESS && (LOG_LZ_RAW > LOGLZ_MAX_RAW)
+#error LOG_LZ_RAW is limited by the history of the block format.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Segment file on one card. */
+typedef struct tagLOGMEM
+{
+	FIL		fil;
+	DWORD	clmt[LOG_CLMT_SIZE];	/* Cluster link map, used by f_write() instead of the FAT */
+	DWORD	wptr;					/* File offset of the next full sector */
+	DWORD	committed;				/* Data sectors recorded in the header */
+#if LOG_PREERASE
+	DWORD	erased;					/* File sectors done by EraseAhead() */
+#endif
+} LOGMEM;
+
+typedef struct tagLOGSEG
+{
+	LOGMEM	mem[LOG_MEMBERS];		/* Member files, by volume */
+	DWORD	seq;					/* Segment sequence number */
+	DWORD	nonce;					/* Marks the sectors of this segment */
+	DWORD	data;					/* File offset of the first data sector */
+	DWORD	next;					/* Index of the next full sector, across the members */
+	DWORD	committed;				/* Data sectors of all the members at the last commit */
+	DWORD	created;				/* FAT timestamp of the creation */
+	DWORD	opened;					/* LogTicks when the segment became current */
+	WORD	flags;					/* LOGSEG_FL_xxx */
+	BYTE	state;					/* SEG_xxx */
+	BYTE	pm;						/* Member holding the partial sector */
+	bool	partial;				/* A partial sector is on the card at the wptr of pm */
+} LOGSEG;
+
+/* Records starting in a staged sector, for the index. */
+typedef struct tagSECTMETA
+{
+	DWORD	sec;					/* Timestamp of the first one */
+	DWORD	nsec;
+	WORD	first;					/* Stream bytes before it in the sector */
+	WORD	records;
+	WORD	chans;					/* Bit n: records of channel n */
+} SECTMETA;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static LOGSEG Seg[LOG_SLOTS];
+static LOGSEG *Cur;										/* Segment receiving data */
+static BYTE Turn;										/* Member to write next, cards permitting */
+#if LOG_MIRRORS > 1
+static BYTE Written[LOG_MIRRORS];						/* Full staged sectors already on each card */
+static BYTE Sealed;										/* Full staged sectors sealed and indexed */
+#endif
+
+static BYTE Stage[LOG_STAGE_SECTORS][LOG_SS];			/* Staging ring */
+static BYTE StageTail;									/* Oldest full sector */
+static BYTE StageCount;									/* Number of full sectors */
+static UINT StageFill;									/* Payload bytes in the sector at STAGE_HEAD */
+static UINT StagePeak;									/* Most full sectors staged */
+#if LOG_COMPRESS
+static BYTE Raw[LOG_LZ_RAW];							/* Stream bytes waiting to be compressed */
+static UINT RawFill;
+static UINT RawNext;									/* Offset of the next record header in Raw */
+#endif
+
+#if LOG_INDEX_SECTORS
+static SECTMETA Meta[LOG_STAGE_SECTORS];				/* Records starting in each staged sector */
+static BYTE IdxBuf[LOG_SS];								/* Index page being filled */
+static LOGIDXENT IdxEnt;								/* Entry of the span being written */
+static DWORD IdxSpan;									/* Span of IdxEnt */
+static UINT IdxCount;									/* Entries in IdxBuf */
+static UINT IdxPage;									/* Page number of IdxBuf */
+#endif
+
+static BYTE HdrBuf[LOG_SS];								/* Segment header sector */
+static DWORD NextSeq;									/* Sequence of the next segment to create */
+#if LOG_RETAIN
+static DWORD Oldest;									/* Lowest segment number that may still be on the cards */
+static bool LowSpace;									/* A card is below LOG_FREE_MIN */
+#endif
+static volatile DWORD LogTicks;							/* 100Hz time base */
+static DWORD LastFlush;									/* LogTicks at the last flush */
+static DWORD LastCommit;								/* LogTicks at the last header commit */
+static DWORD Dropped;									/* Sectors lost on write errors */
+static bool LogDirty;									/* Data staged since the last flush */
+static bool LogReady;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void MakeVolume (TCHAR *path, BYTE m);
+static void MakeName (TCHAR *name, BYTE m, DWORD seq);
+static bool ParseName (const TCHAR *name, DWORD *seq);
+static LOGSEG *FindSlot (BYTE state);
+static DWORD MemberSectors (const LOGSEG *seg, BYTE m);
+static void RetireSegment (LOGSEG *seg, WORD reason);
+static void SealSector (BYTE *sect, UINT len, const LOGSEG *seg, DWORD idx);
+static FRESULT WriteHeader (LOGSEG *seg, BYTE m);
+static FRESULT CreateMember (LOGSEG *seg, BYTE m);
+static FRESULT CreateSegment (LOGSEG *seg);
+static FRESULT DeleteMember (LOGSEG *seg, BYTE m);
+static FRESULT FinalizeMember (LOGSEG *seg, BYTE m);
+static FRESULT FinalizeSegment (LOGSEG *seg);
+static FRESULT RecoverMember (LOGSEG *seg, BYTE m, DWORD seq);
+static FRESULT RecoverSegment (DWORD seq);
+static FRESULT SwitchSegment (WORD reason);
+#if LOG_PREERASE
+static void EraseAhead (LOGSEG *seg);
+#endif
+#if LOG_RETAIN
+static FRESULT CheckSpace (void);
+static FRESULT ReclaimSegment (void);
+#endif
+static bool CardBusy (BYTE m);
+static int PickMember (bool wait);
+static FRESULT WriteSectors (bool wait);
+#if LOG_MIRRORS > 1
+static FRESULT WriteMirrors (bool wait);
+#endif
+static FRESULT WritePartial (void);
+static FRESULT PushSector (void);
+#if LOG_COMPRESS
+static FRESULT PackSector (void);
+#endif
+#if LOG_INDEX_SECTORS
+static void NoteRecord (SECTMETA *m, UINT ofs, const LOGRECHDR *rec);
+static void IndexSector (const SECTMETA *m, DWORD idx);
+static void AddEntry (void);
+static void WriteIndex (void);
+static void CloseIndex (void);
+static void ResetIndex (void);
+#endif
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Starts the logger on the mounted default volume.
+  *
+  * Recovers segments left open by a power loss, then creates and activates
+  * the first segment of this session. With LOG_STRIPES or LOG_MIRRORS the
+  * segments are looked for on all the volumes.
+  *
+  * @param  None
+  * @retval FR_OK or the FatFs error that stopped the start up.
+  */
+FRESULT LOG_Init (void)
+{
+	FRESULT res;
+	DIR dir;
+	FILINFO fno;
+	DWORD seq, first = 0, last = 0;
+	TCHAR path[3];
+	BYTE m;
+
+	memset(Seg, 0, sizeof(Seg));
+	Cur = NULL;
+	Turn = 0;
+	StageTail = StageCount = 0;
+	StageFill = StagePeak = 0;
+#if LOG_MIRRORS > 1
+	memset(Written, 0, sizeof(Written));
+	Sealed = 0;
+#endif
+#if LOG_COMPRESS
+	RawFill = RawNext = 0;
+#endif
+#if LOG_INDEX_SECTORS
+	memset(Meta, 0, sizeof(Meta));
+#endif
+	Dropped = 0;
+	LogDirty = false;
+	LogReady = false;
+
+	/* Find the highest segment number on the cards. */
+	for (m = 0; m < LOG_MEMBERS; m++)
+	{
+		MakeVolume(path, m);
+		res = f_opendir(&dir, path);
+		if (res != FR_OK) return res;
+		for (;;)
+		{
+			res = f_readdir(&dir, &fno);
+			if (res != FR_OK || fno.fname[0] == 0) break;
+			if (!(fno.fattrib & AM_DIR) && ParseName(fno.fname, &seq))
+			{
+				if (seq > last) last = seq;
+				if (seq < first || first == 0) first = seq;
+			}
+		}
+		f_closedir(&dir);
+		if (res != FR_OK) return res;
+	}
+
+	/* Only the current and the next segment can be left open by a reset. */
+	if (last > 1) RecoverSegment(last - 1);
+	if (last > 0) RecoverSegment(last);
+
+	NextSeq = last + 1;
+#if LOG_RETAIN
+	Oldest = (first > 0) ? first : NextSeq;
+#endif
+
+	res = CreateSegment(&Seg[0]);
+	if (res == FR_OK) res = SwitchSegment(0);
+#if LOG_RETAIN
+	if (res == FR_OK) res = CheckSpace();
+#endif
+	if (res == FR_OK)
+	{
+		LastFlush = LastCommit = LogTicks;
+		LogReady = true;
+	}
+	return res;
+}
+
+/**
+  * @brief  Appends data to the log stream.
+  *
+  * Data is copied into the staging ring. Disk writes only happen here when
+  * the ring is full; otherwise they are left to LOG_Task(). With
+  * LOG_COMPRESS the data is gathered in a buffer of LOG_LZ_RAW bytes
+  * instead and compressed into staging sectors when the buffer is full.
+  *
+  * @param  data: Pointer to the data.
+  * @param  len:  Number of bytes.
+  * @retval FR_OK or the error of the forced drain.
+  */
+FRESULT LOG_Write (const void *data, UINT len)
+{
+	FRESULT res = FR_OK;
+	const BYTE *p = data;
+	UINT n;
+
+	if (!LogReady) return FR_NOT_READY;
+
+	while (len)
+	{
+#if LOG_COMPRESS
+		n = LOG_LZ_RAW - RawFill;
+		if (n > len) n = len;
+		memcpy(&Raw[RawFill], p, n);
+		RawFill += n;
+		p += n;
+		len -= n;
+
+		if (RawFill == LOG_LZ_RAW) res = PackSector();
+#else
+		n = LOGSEC_PAYLOAD - StageFill;
+		if (n > len) n = len;
+		memcpy(&Stage[STAGE_HEAD][sizeof(LOGSECHDR) + StageFill], p, n);
+		StageFill += n;
+		p += n;
+		len -= n;
+
+		if (StageFill == LOGSEC_PAYLOAD)
+		{
+			StageFill = 0;
+			res = PushSector();
+		}
+#endif
+	}
+	LogDirty = true;
+
+	return res;
+}
+
+/**
+  * @brief  Logs a null terminated string as a text record.
+  *
+  * @param  str: String to log (without the terminator).
+  * @retval See LOG_Write().
+  */
+FRESULT LOG_Puts (const char *str)
+{
+	return LOG_Record(LOGREC_CH_TEXT, 0, NULL, str, strlen(str));
+}
+
+/**
+  * @brief  Appends a timestamped record to the log stream.
+  *
+  * @param  chan:  Source channel (LOGREC_CH_xxx).
+  * @param  flags: Channel specific flags.
+  * @param  ts:    Time of the event, or NULL to use the current time.
+  * @param  data:  Record payload.
+  * @param  len:   Payload bytes, up to 65535.
+  * @retval See LOG_Write().
+  */
+FRESULT LOG_Record (BYTE chan, BYTE flags, const TSTAMP *ts, const void *data, UINT len)
+{
+	FRESULT res;
+	LOGRECHDR rec;
+	TSTAMP now;
+
+	if (len > 0xFFFF) return FR_INVALID_PARAMETER;
+	if (ts == NULL)
+	{
+		TS_Now(&now);
+		ts = &now;
+	}
+
+	rec.chan = chan;
+	rec.flags = flags;
+	rec.len = len;
+	rec.sec = ts->sec;
+	rec.nsec = ts->nsec;
+
+#if LOG_INDEX_SECTORS
+#if LOG_COMPRESS
+	/* PackSector() finds the records by their headers, which must not be
+	split by a compression. */
+	if (RawFill + sizeof(rec) > LOG_LZ_RAW && LogReady) PackSector();
+#else
+	if (LogReady) NoteRecord(&Meta[STAGE_HEAD], StageFill, &rec);
+#endif
+#endif
+
+	res = LOG_Write(&rec, sizeof(rec));
+	if (res == FR_OK && len) res = LOG_Write(data, len);
+
+	return res;
+}
+
+/**
+  * @brief  Logger housekeeping, call it from the main loop.
+  *
+  * Writes the staged sectors, rotates, flushes and commits on time and then
+  * runs at most one background step: finalizing the retired segment or
+  * preparing the next one.
+  *
+  * @param  None
+  * @retval FR_OK or the first error found.
+  */
+FRESULT LOG_Task (void)
+{
+	FRESULT res, res2;
+	LOGSEG *seg;
+
+	if (!LogReady) return FR_NOT_READY;
+
+	res = WriteSectors(false);
+
+	if (res == FR_OK)
+	{
+		if (LOG_SEGMENT_SECONDS && (LogTicks - Cur->opened) >= (DWORD)LOG_SEGMENT_SECONDS * LOG_TICK_HZ
+				&& (Cur->next > 0 || LOG_PENDING()))
+		{
+			res = LOG_Rotate();
+		}
+		else if ((LogTicks - LastCommit) >= (DWORD)LOG_COMMIT_SECONDS * LOG_TICK_HZ
+				&& Cur->committed != Cur->next + (LOG_PENDING() ? 1 : 0))
+		{
+			res = LOG_Sync();
+		}
+		else if (LogDirty && (LogTicks - LastFlush) >= (DWORD)LOG_FLUSH_SECONDS * LOG_TICK_HZ)
+		{
+			res = LOG_Flush();
+		}
+	}
+
+	/* Background work, off the data path. */
+	res2 = FR_OK;
+	if ((seg = FindSlot(SEG_RETIRED)) != NULL)
+	{
+		res2 = FinalizeSegment(seg);
+	}
+	else if (FindSlot(SEG_READY) == NULL && (seg = FindSlot(SEG_FREE)) != NULL)
+	{
+		res2 = CreateSegment(seg);
+#if LOG_RETAIN
+		if (res2 == FR_OK) res2 = CheckSpace();
+#endif
+	}
+#if LOG_RETAIN
+	else if (LowSpace && StageCount == 0)
+	{
+		res2 = ReclaimSegment();
+		if (res2 == FR_OK) res2 = CheckSpace();
+		else if (res2 == FR_NO_FILE)
+		{
+			LowSpace = false;				/* Nothing older left to delete */
+			res2 = FR_OK;
+		}
+	}
+#endif
+#if LOG_PREERASE
+	else if (StageCount == 0 && (seg = FindSlot(SEG_READY)) != NULL)
+	{
+		EraseAhead(seg);
+	}
+#endif
+
+	return (res != FR_OK) ? res : res2;
+}
+
+/**
+  * @brief  Writes all staged data to the card.
+  *
+  * The partially filled staging sector is written in place (it is written
+  * again once it fills up). The sector headers make the data recoverable
+  * without touching the segment header or the FAT. With LOG_COMPRESS the
+  * gathered data is compressed and written as whole sectors instead: a
+  * compressed sector is never rewritten.
+  *
+  * @param  None
+  * @retval FR_OK or the FatFs error.
+  */
+FRESULT LOG_Flush (void)
+{
+	FRESULT res;
+
+	if (!LogReady) return FR_NOT_READY;
+
+	res = FR_OK;
+#if LOG_COMPRESS
+	while (res == FR_OK && RawFill) res = PackSector();
+#endif
+	if (res == FR_OK) res = WriteSectors(true);
+	if (res == FR_OK) res = WritePartial();
+	if (res == FR_OK)
+	{
+		LastFlush = LogTicks;
+		LogDirty = false;
+	}
+	return res;
+}
+
+/**
+  * @brief  Flushes and commits the current segment.
+  *
+  * Updates the committed sector count in the segment header, which bounds
+  * the recovery scan, and synchronizes the file. Each member file of a
+  * striped segment has its own count.
+  *
+  * @param  None
+  * @retval FR_OK or the FatFs error.
+  */
+FRESULT LOG_Sync (void)
+{
+	FRESULT res;
+	BYTE m;
+
+	res = LOG_Flush();
+	if (res == FR_OK) Cur->committed = Cur->next + (Cur->partial ? 1 : 0);
+	for (m = 0; m < LOG_MEMBERS && res == FR_OK; m++)
+	{
+		Cur->mem[m].committed = MemberSectors(Cur, m);
+		res = WriteHeader(Cur, m);
+		if (res == FR_OK) res = f_sync(&Cur->mem[m].fil);
+	}
+	if (res == FR_OK) LastCommit = LogTicks;
+
+	return res;
+}
+
+/**
+  * @brief  Closes the current segment and continues in the next one.
+  *
+  * @param  None
+  * @retval FR_OK or the FatFs error.
+  */
+FRESULT LOG_Rotate (void)
+{
+	FRESULT res;
+
+	res = LOG_Flush();
+	if (res == FR_OK)
+	{
+		res = SwitchSegment(LOGSEG_FL_BYTIME);
+	}
+	if (res == FR_OK)
+	{
+		StageFill = 0;				/* The partial sector now belongs to the old segment */
+#if LOG_INDEX_SECTORS
+		memset(&Meta[STAGE_HEAD], 0, sizeof(SECTMETA));
+#endif
+	}
+	if (res == FR_OK) LastCommit = LogTicks;
+
+	return res;
+}
+
+/**
+  * @brief  Flushes and closes all segments.
+  *
+  * The preallocated next segment is deleted. LOG_Init() must be called to
+  * log again.
+  *
+  * @param  None
+  * @retval FR_OK or the first FatFs error.
+  */
+FRESULT LOG_Close (void)
+{
+	FRESULT res, res2;
+	LOGSEG *seg;
+	BYTE m;
+
+	res = LOG_Flush();
+	if (res == FR_NOT_READY) return res;
+
+#if LOG_INDEX_SECTORS
+	CloseIndex();
+	memset(&Meta[STAGE_HEAD], 0, sizeof(SECTMETA));
+#endif
+	StageFill = 0;
+	RetireSegment(Cur, 0);
+	Cur = NULL;
+	LogReady = false;
+
+	while ((seg = FindSlot(SEG_RETIRED)) != NULL)
+	{
+		res2 = FinalizeSegment(seg);
+		if (res == FR_OK) res = res2;
+	}
+	if ((seg = FindSlot(SEG_READY)) != NULL)
+	{
+		for (m = 0; m < LOG_MEMBERS; m++) DeleteMember(seg, m);
+		seg->state = SEG_FREE;
+	}
+	return res;
+}
+
+/**
+  * @brief  Staged sectors not written to a card yet.
+  *
+  * With LOG_MIRRORS each card writes the staging ring at its own pace, and
+  * a card that falls behind only keeps its sectors in the ring: the lag
+  * tells how much of the ring it holds. Otherwise the cards share the ring
+  * and the lag is the count of LOG_Staged().
+  *
+  * @param  card: Member number, the volume of its files.
+  * @retval Number of sectors.
+  */
+UINT LOG_Lag (BYTE card)
+{
+#if LOG_MIRRORS > 1
+	if (card < LOG_MIRRORS) return StageCount - Written[card];
+	return 0;
+#else
+	(void)card;
+	return StageCount;
+#endif
+}
+
+/**
+  * @brief  Occupancy of the staging ring, in full sectors.
+  *
+  * When all the LOG_STAGE_SECTORS are full, LOG_Write() waits for the
+  * slowest card to write them.
+  *
+  * @param  peak: Receives the highest occupancy since LOG_Init(), or NULL.
+  * @retval Number of sectors.
+  */
+UINT LOG_Staged (UINT *peak)
+{
+	if (peak != NULL) *peak = StagePeak;
+	return StageCount;
+}
+
+/**
+  * @brief  Logger time base. Must be called at LOG_TICK_HZ.
+  *
+  * @param  None
+  * @retval None
+  */
+void LOG_TimerProc (void)
+{
+	LogTicks++;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Path of the volume of a member file: the default one unless striped. */
+static void MakeVolume (TCHAR *path, BYTE m)
+{
+#if LOG_MEMBERS > 1
+	*path++ = '0' + m;
+	*path++ = ':';
+#else
+	(void)m;
+#endif
+	*path = 0;
+}
+
+static void MakeName (TCHAR *name, BYTE m, DWORD seq)
+{
+	int i;
+
+	MakeVolume(name, m);
+	name += strlen(name);
+	strcpy(name, LOGSEG_NAME_PREFIX);
+	name += sizeof(LOGSEG_NAME_PREFIX) - 1;
+	for (i = LOGSEG_NAME_DIGITS - 1; i >= 0; i--)
+	{
+		name[i] = '0' + (seq % 10);
+		seq /= 10;
+	}
+	strcpy(name + LOGSEG_NAME_DIGITS, LOGSEG_NAME_EXT);
+}
+
+static bool ParseName (const TCHAR *name, DWORD *seq)
+{
+	int i;
+	DWORD n = 0;
+
+	if (strncmp(name, LOGSEG_NAME_PREFIX, sizeof(LOGSEG_NAME_PREFIX) - 1) != 0) return false;
+	name += sizeof(LOGSEG_NAME_PREFIX) - 1;
+	for (i = 0; i < LOGSEG_NAME_DIGITS; i++)
+	{
+		if (name[i] < '0' || name[i] > '9') return false;
+		n = n * 10 + (name[i] - '0');
+	}
+	if (strcmp(name + LOGSEG_NAME_DIGITS, LOGSEG_NAME_EXT) != 0) return false;
+
+	*seq = n;
+	return true;
+}
+
+static LOGSEG *FindSlot (BYTE state)
+{
+	int i;
+
+	for (i = 0; i < LOG_SLOTS; i++)
+	{
+		if (Seg[i].state == state) return &Seg[i];
+	}
+	return NULL;
+}
+
+/* Data sectors written to a member file, the partial one included. */
+static DWORD MemberSectors (const LOGSEG *seg, BYTE m)
+{
+	return SECT_INDEX(seg, seg->mem[m].wptr) + ((seg->partial && (LOG_MIRRORS > 1 || seg->pm == m)) ? 1 : 0);
+}
+
+/* Marks a segment for finalization with all its written sectors. */
+static void RetireSegment (LOGSEG *seg, WORD reason)
+{
+	BYTE m;
+
+	for (m = 0; m < LOG_MEMBERS; m++) seg->mem[m].committed = MemberSectors(seg, m);
+	seg->committed = seg->next + (seg->partial ? 1 : 0);
+	seg->flags |= reason;
+	seg->state = SEG_RETIRED;
+}
+
+/* Fills the journal header of a staged sector. */
+static void SealSector (BYTE *sect, UINT len, const LOGSEG *seg, DWORD idx)
+{
+	LOGSECHDR *sh = (LOGSECHDR *)sect;
+
+#if !LOG_COMPRESS
+	sh->magic = LOGSEC_MAGIC;			/* With LOG_COMPRESS LZ_PackSector() sets both */
+	sh->len = len;
+#endif
+	sh->segseq = seg->seq;
+	sh->seq = idx;
+	sh->nonce = (WORD)seg->nonce;
+	sh->crc = LOGSEC_Crc(sect);
+}
+
+/* Rewrites sector 0 of a member file and leaves the file pointer there. */
+static FRESULT WriteHeader (LOGSEG *seg, BYTE m)
+{
+	FRESULT res;
+	UINT bw;
+	LOGMEM *mem = &seg->mem[m];
+	LOGSEGHDR *hdr = (LOGSEGHDR *)HdrBuf;
+#if LOG_STRIPES > 1
+	LOGSTRIPEHDR *sh = (LOGSTRIPEHDR *)(HdrBuf + sizeof(LOGSEGHDR));
+#endif
+
+	memset(HdrBuf, 0, sizeof(HdrBuf));
+	hdr->magic = LOGSEG_MAGIC;
+	hdr->version = LOGSEG_VERSION;
+	hdr->hdrsize = seg->data;
+	hdr->seq = seg->seq;
+	hdr->created = seg->created;
+	hdr->prealloc = LOG_SEGMENT_SIZE;
+	hdr->committed = mem->committed;
+	hdr->flags = seg->flags;
+	hdr->nonce = seg->nonce;
+#if LOG_STRIPES > 1
+	if (m > 0) hdr->flags &= ~LOGSEG_FL_INDEX;		/* The index is in member 0 only */
+	hdr->check = LOGSEG_Check(hdr);
+	sh->member = m;
+	sh->members = LOG_STRIPES;
+	sh->unit = LOG_STRIPE_SECTORS;
+	sh->check = LOGSTRIPE_Check(sh, hdr);
+#else
+	hdr->check = LOGSEG_Check(hdr);
+#endif
+
+	res = f_lseek(&mem->fil, 0);
+	if (res == FR_OK) res = f_write(&mem->fil, HdrBuf, LOG_SS, &bw);
+	if (res == FR_OK && bw != LOG_SS) res = FR_DENIED;
+
+	return res;
+}
+
+/* Creates a member file of a new segment with all its clusters allocated. */
+static FRESULT CreateMember (LOGSEG *seg, BYTE m)
+{
+	FRESULT res;
+	LOGMEM *mem = &seg->mem[m];
+	TCHAR name[LOG_NAME_SIZE];
+
+	MakeName(name, m, seg->seq);
+	res = f_open(&mem->fil, name, FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
+	if (res != FR_OK) return res;
+
+	/* Seeking past the end in write mode stretches the cluster chain. */
+	res = f_lseek(&mem->fil, LOG_SEGMENT_SIZE);
+	if (res == FR_OK && f_size(&mem->fil) != LOG_SEGMENT_SIZE) res = FR_DENIED;	/* Volume full */
+
+	if (res == FR_OK)
+	{
+		/* With the link map f_write() never reads the FAT. Fall back to the
+		chain when the segment is too fragmented to fit in the map. */
+		mem->clmt[0] = LOG_CLMT_SIZE;
+		mem->fil.cltbl = mem->clmt;
+		res = f_lseek(&mem->fil, CREATE_LINKMAP);
+		if (res == FR_NOT_ENOUGH_CORE)
+		{
+			mem->fil.cltbl = NULL;
+			res = FR_OK;
+		}
+	}
+
+	if (res == FR_OK)
+	{
+		mem->wptr = seg->data;
+		mem->committed = 0;
+#if LOG_PREERASE
+		mem->erased = seg->data / LOG_SS;
+#endif
+		res = WriteHeader(seg, m);
+	}
+	if (res == FR_OK) res = f_sync(&mem->fil);		/* Make the allocation durable */
+
+	if (res != FR_OK)
+	{
+		f_close(&mem->fil);
+		f_unlink(name);
+	}
+	return res;
+}
+
+/* Creates the next segment, one member file per card. */
+static FRESULT CreateSegment (LOGSEG *seg)
+{
+	FRESULT res;
+	BYTE m;
+
+	seg->seq = NextSeq;
+	seg->data = LOG_DATA_START;
+	seg->next = seg->committed = 0;
+	seg->created = LOG_FATTIME();
+	seg->nonce = seg->created ^ (NextSeq << 16) ^ LogTicks ^ SysTick->VAL;
+	seg->flags = (LOG_COMPRESS ? LOGSEG_FL_LZ : 0) | (LOG_INDEX_PAGES ? LOGSEG_FL_INDEX : 0)
+			| (LOG_STRIPES > 1 ? LOGSEG_FL_STRIPE : 0) | (LOG_MIRRORS > 1 ? LOGSEG_FL_MIRROR : 0);
+	seg->partial = false;
+
+	for (m = 0; m < LOG_MEMBERS; m++)
+	{
+		res = CreateMember(seg, m);
+#if LOG_RETAIN
+		/* The card is full: make room now, whatever the time. */
+		while (res == FR_DENIED && ReclaimSegment() == FR_OK) res = CreateMember(seg, m);
+#endif
+		if (res != FR_OK)
+		{
+			while (m--) DeleteMember(seg, m);	/* Members created before */
+			return res;
+		}
+	}
+
+	NextSeq++;
+	seg->state = SEG_READY;
+
+	return FR_OK;
+}
+
+static FRESULT DeleteMember (LOGSEG *seg, BYTE m)
+{
+	TCHAR name[LOG_NAME_SIZE];
+
+	MakeName(name, m, seg->seq);
+	f_close(&seg->mem[m].fil);
+	return f_unlink(name);
+}
+
+/* Writes the final header of a member file, releases the unused clusters
+and closes it. A member without data is deleted, except member 0 of a
+segment with data, which holds the index. */
+static FRESULT FinalizeMember (LOGSEG *seg, BYTE m)
+{
+	FRESULT res;
+	LOGMEM *mem = &seg->mem[m];
+
+	if (mem->committed == 0 && (m > 0 || seg->committed == 0)) return DeleteMember(seg, m);
+
+	res = WriteHeader(seg, m);
+	if (res == FR_OK) res = f_lseek(&mem->fil, seg->data + mem->committed * LOG_SS);
+	if (res == FR_OK) res = f_truncate(&mem->fil);
+	if (res == FR_OK) res = f_close(&mem->fil);
+	else f_close(&mem->fil);
+
+	return res;
+}
+
+/* Finalizes all the member files. A segment without data is deleted. */
+static FRESULT FinalizeSegment (LOGSEG *seg)
+{
+	FRESULT res = FR_OK, res2;
+	BYTE m;
+
+	seg->state = SEG_FREE;
+	seg->flags |= LOGSEG_FL_CLOSED;
+	for (m = 0; m < LOG_MEMBERS; m++)
+	{
+		res2 = FinalizeMember(seg, m);
+		if (res == FR_OK) res = res2;
+	}
+	return res;
+}
+
+/* Finds the valid sectors of a member file that was not closed, starting
+at the last commit, and truncates the file after them. The sectors found
+are added to seg->committed. */
+static FRESULT RecoverMember (LOGSEG *seg, BYTE m, DWORD seq)
+{
+	FRESULT res;
+	TCHAR name[LOG_NAME_SIZE];
+	UINT br, i, n;
+	DWORD idx, next, total;
+	bool end = false;
+	LOGMEM *mem = &seg->mem[m];
+	LOGSEGHDR *hdr = (LOGSEGHDR *)HdrBuf;
+#if LOG_STRIPES > 1
+	LOGSECHDR *sh;
+#endif
+
+	MakeName(name, m, seq);
+	res = f_open(&mem->fil, name, FA_OPEN_EXISTING | FA_READ | FA_WRITE);
+	if (res != FR_OK) return res;
+
+	res = f_read(&mem->fil, HdrBuf, LOG_SS, &br);
+	if (res == FR_OK && (br != LOG_SS || hdr->magic != LOGSEG_MAGIC || hdr->check != LOGSEG_Check(hdr)
+			|| hdr->version != LOGSEG_VERSION || hdr->hdrsize < LOGSEG_HDR_SIZE || (hdr->hdrsize % LOG_SS)))
+	{
+		res = FR_NO_FILESYSTEM;		/* Not a segment header, leave the file alone */
+	}
+	if (res != FR_OK || (hdr->flags & LOGSEG_FL_CLOSED))
+	{
+		if (res == FR_OK) seg->committed += hdr->committed;
+		f_close(&mem->fil);
+		return res;
+	}
+
+	seg->seq = hdr->seq;
+	seg->nonce = hdr->nonce;
+	seg->created = hdr->created;
+	seg->flags = hdr->flags;
+	seg->data = hdr->hdrsize;
+	seg->partial = false;
+	total = (f_size(&mem->fil) > seg->data) ? SECT_INDEX(seg, f_size(&mem->fil)) : 0;
+
+	/* The last committed sector may have been partial: check it again. */
+	idx = (hdr->committed > 0) ? hdr->committed - 1 : 0;
+	if (idx > total) idx = total;
+	next = idx;
+
+	/* The staging ring is not in use yet; read through it in runs. */
+	while (!end && idx < total)
+	{
+		n = total - idx;
+		if (n > LOG_STAGE_SECTORS) n = LOG_STAGE_SECTORS;
+		res = f_lseek(&mem->fil, seg->data + idx * LOG_SS);
+		if (res == FR_OK) res = f_read(&mem->fil, Stage, n * LOG_SS, &br);
+		if (res != FR_OK || br < LOG_SS) break;
+		n = br / LOG_SS;
+
+		for (i = 0; i < n && !end; i++)
+		{
+#if LOG_STRIPES > 1
+			/* Numbered across the stripe: the number only has to grow. */
+			sh = (LOGSECHDR *)Stage[i];
+			if (sh->seq > next) next = sh->seq;
+#endif
+			if (!LOGSEC_Valid(Stage[i], hdr, next))
+			{
+				end = true;
+			}
+			else
+			{
+				idx++;
+				next++;
+				end = LOGSEC_Last(Stage[i]);
+			}
+		}
+	}
+
+	mem->committed = idx;
+	seg->committed += idx;
+	seg->flags |= LOGSEG_FL_CLOSED;
+
+	return FinalizeMember(seg, m);		/* Prepared but never used members are deleted */
+}
+
+/* Recovers the member files of a segment. Member 0 goes last, when the
+data of the others is known. */
+static FRESULT RecoverSegment (DWORD seq)
+{
+	FRESULT res = FR_OK, res2;
+	LOGSEG *seg = &Seg[0];
+	int m;
+
+	seg->committed = 0;
+	for (m = LOG_MEMBERS - 1; m >= 0; m--)
+	{
+		res2 = RecoverMember(seg, m, seq);
+		if (res == FR_OK) res = res2;
+	}
+	return res;
+}
+
+/* Retires the current segment and makes the prepared one current. */
+static FRESULT SwitchSegment (WORD reason)
+{
+	FRESULT res;
+	LOGSEG *seg;
+
+	if ((seg = FindSlot(SEG_READY)) == NULL)
+	{
+		/* The background preparation did not keep up. */
+		if ((seg = FindSlot(SEG_RETIRED)) != NULL && (res = FinalizeSegment(seg)) != FR_OK) return res;
+		if ((seg = FindSlot(SEG_FREE)) == NULL) return FR_INT_ERR;
+		if ((res = CreateSegment(seg)) != FR_OK) return res;
+	}
+	else if (Cur && FindSlot(SEG_RETIRED) != NULL)
+	{
+		/* Only one retired slot is available. */
+		if ((res = FinalizeSegment(FindSlot(SEG_RETIRED))) != FR_OK) return res;
+	}
+
+	if (Cur)
+	{
+#if LOG_INDEX_SECTORS
+		CloseIndex();
+#endif
+		RetireSegment(Cur, reason);
+	}
+	Cur = seg;
+	Cur->state = SEG_ACTIVE;
+	Cur->opened = LogTicks;
+#if LOG_INDEX_SECTORS
+	ResetIndex();
+#endif
+
+	return FR_OK;
+}
+
+#if LOG_PREERASE
+/* Erases the next whole AU of the data area of a prepared segment, on a
+card that is not busy. The sectors are found with the link map; the part
+of an extent that does not fill an AU is skipped. */
+static void EraseAhead (LOGSEG *seg)
+{
+	LOGMEM *mem;
+	FATFS *fs;
+	DWORD au, idx, n, lba, start, rt[2], *tbl;
+	BYTE m, busy;
+
+	for (m = 0; m < LOG_MEMBERS; m++)
+	{
+		mem = &seg->mem[m];
+		if (mem->erased >= LOG_SEGMENT_SIZE / LOG_SS) continue;
+		fs = mem->fil.fs;
+		if (mem->fil.cltbl == NULL || disk_ioctl(fs->drv, GET_BLOCK_SIZE, &au) != RES_OK || au == 0)
+		{
+			mem->erased = LOG_SEGMENT_SIZE / LOG_SS;	/* Fragmented beyond the map, or no AU */
+			continue;
+		}
+		if (disk_ioctl(fs->drv, MMC_GET_BUSY, &busy) == RES_OK && busy) continue;
+
+		/* Extent holding the sector 'erased', at file sector 'idx' */
+		idx = 0;
+		for (tbl = mem->clmt + 1; tbl[0] != 0; tbl += 2)
+		{
+			n = tbl[0] * fs->csize;
+			if (mem->erased < idx + n) break;
+			idx += n;
+		}
+		if (tbl[0] == 0)
+		{
+			mem->erased = LOG_SEGMENT_SIZE / LOG_SS;
+			continue;
+		}
+		start = fs->database + (tbl[1] - 2) * fs->csize;
+		lba = (start + mem->erased - idx + au - 1) / au * au;
+		if (lba + au > start + n)
+		{
+			mem->erased = idx + n;			/* No whole AU left in the extent */
+			continue;
+		}
+
+		rt[0] = lba;
+		rt[1] = lba + au - 1;
+		disk_ioctl(fs->drv, CTRL_TRIM, rt);
+		mem->erased = idx + lba + au - start;
+		return;								/* One AU per call */
+	}
+}
+#endif
+
+#if LOG_RETAIN
+/* Sets LowSpace when a card has less than LOG_FREE_MIN bytes free. FatFs
+keeps the free cluster count once it is known, so only the first call
+scans the FAT. */
+static FRESULT CheckSpace (void)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD nclst;
+	TCHAR path[3];
+	BYTE m;
+
+	LowSpace = false;
+	for (m = 0; m < LOG_MEMBERS; m++)
+	{
+		MakeVolume(path, m);
+		res = f_getfree(path, &nclst, &fs);
+		if (res != FR_OK) return res;
+		if (nclst < LOG_FREE_MIN / LOG_SS / fs->csize) LowSpace = true;
+	}
+	return FR_OK;
+}
+
+/* Deletes the member files of the oldest segment on the cards. The
+segments in the slots are never touched. Numbers of segments already gone
+are passed over, LOG_RECLAIM_SCAN per call, so FR_OK may come back with
+nothing deleted; FR_NO_FILE when there is no older segment left. */
+static FRESULT ReclaimSegment (void)
+{
+	FRESULT res, res2;
+	TCHAR name[LOG_NAME_SIZE];
+	DWORD limit = NextSeq;
+	UINT n;
+	BYTE m;
+
+	for (n = 0; n < LOG_SLOTS; n++)
+	{
+		if (Seg[n].state != SEG_FREE && Seg[n].seq < limit) limit = Seg[n].seq;
+	}
+	if (Oldest >= limit) return FR_NO_FILE;
+
+	for (n = 0; n < LOG_RECLAIM_SCAN && Oldest < limit; n++)
+	{
+		res = FR_NO_FILE;
+		for (m = 0; m < LOG_MEMBERS; m++)
+		{
+			MakeName(name, m, Oldest);
+			res2 = f_unlink(name);
+			if (res2 != FR_NO_FILE && (res == FR_NO_FILE || res2 != FR_OK)) res = res2;
+		}
+		Oldest++;							/* Also past a file that cannot be deleted */
+		if (res != FR_NO_FILE) return res;
+	}
+	return FR_OK;
+}
+#endif
+
+/* Tells if the card of a member is still programming its last write. */
+static bool CardBusy (BYTE m)
+{
+#if LOG_MEMBERS > 1 || LOG_PREERASE
+	BYTE busy;
+
+	return disk_ioctl(Cur->mem[m].fil.fs->drv, MMC_GET_BUSY, &busy) == RES_OK && busy;
+#else
+	(void)m;
+	return false;
+#endif
+}
+
+/* Chooses the member file of the next write: the one whose turn it is,
+unless its card is still busy with the last write and another one is
+ready. The member holding the partial sector is always chosen, to rewrite
+it in place. Returns -1 when the card to write is busy and 'wait' is not
+set. */
+static int PickMember (bool wait)
+{
+#if LOG_STRIPES > 1
+	BYTE m;
+	int i;
+
+	for (i = 0; i < LOG_STRIPES; i++)
+	{
+		m = Cur->partial ? Cur->pm : (Turn + i) % LOG_STRIPES;
+		if (!CardBusy(m)) return m;
+		if (Cur->partial) break;
+	}
+	if (!wait) return -1;
+	return Cur->partial ? Cur->pm : Turn;
+#elif LOG_PREERASE
+	/* The card may be erasing ahead: the sectors stay staged meanwhile. */
+	return (!wait && CardBusy(0)) ? -1 : 0;
+#else
+	(void)wait;
+	return 0;
+#endif
+}
+
+/* Seals and writes the full staged sectors to the current segment. With
+'wait' clear the sectors stay staged while the cards are busy. */
+static FRESULT WriteSectors (bool wait)
+{
+#if LOG_MIRRORS > 1
+	return WriteMirrors(wait);
+#else
+	FRESULT res;
+	UINT i, n, room, bw;
+	LOGMEM *mem;
+	int m;
+
+	while (StageCount)
+	{
+		if ((m = PickMember(wait)) < 0) break;
+		mem = &Cur->mem[m];
+		if (mem->wptr + LOG_SS > LOG_SEGMENT_SIZE)
+		{
+			res = SwitchSegment(LOGSEG_FL_BYSIZE);
+			if (res != FR_OK) return res;
+			continue;
+		}
+
+		/* Largest run that is contiguous in the ring and fits the segment. */
+		n = LOG_STAGE_SECTORS - StageTail;
+		if (n > StageCount) n = StageCount;
+		if (n > LOG_RUN_SECTORS) n = LOG_RUN_SECTORS;
+		room = (LOG_SEGMENT_SIZE - mem->wptr) / LOG_SS;
+		if (n > room) n = room;
+
+		for (i = 0; i < n; i++)
+		{
+			SealSector(Stage[StageTail + i], LOGSEC_PAYLOAD, Cur, Cur->next + i);
+		}
+
+		if (f_tell(&mem->fil) != mem->wptr)
+		{
+			res = f_lseek(&mem->fil, mem->wptr);
+			if (res != FR_OK) return res;
+		}
+		res = f_write(&mem->fil, Stage[StageTail], n * LOG_SS, &bw);
+		if (res == FR_OK && bw != n * LOG_SS) res = FR_DENIED;
+		if (res != FR_OK) return res;
+
+#if LOG_INDEX_SECTORS
+		for (i = 0; i < n; i++)
+		{
+			IndexSector(&Meta[StageTail + i], Cur->next + i);
+		}
+		if (IdxCount == LOGIDX_ENTRIES) WriteIndex();
+#endif
+		mem->wptr += n * LOG_SS;
+		Cur->next += n;
+		Cur->partial = false;
+		Turn = (m + 1) % LOG_STRIPES;
+		StageTail = (StageTail + n) % LOG_STAGE_SECTORS;
+		StageCount -= n;
+	}
+	return FR_OK;
+#endif
+}
+
+#if LOG_MIRRORS > 1
+/* Writes the staged sectors to every mirror, each card from its own place
+in the ring. A sector is sealed and indexed by the first card to take it,
+and leaves the ring once all the cards have it. With 'wait' clear a busy
+card is passed over and falls behind by the sectors staged meanwhile. A
+card that reaches the end of the segment waits there for the others. */
+static FRESULT WriteMirrors (bool wait)
+{
+	FRESULT res;
+	UINT i, k, n, room, bw, done;
+	LOGMEM *mem;
+	BYTE m;
+	bool full;
+
+	for (;;)
+	{
+		full = true;
+		for (m = 0; m < LOG_MIRRORS; m++)
+		{
+			mem = &Cur->mem[m];
+			room = (LOG_SEGMENT_SIZE - mem->wptr) / LOG_SS;
+
+			while (Written[m] < StageCount && room && (wait || !CardBusy(m)))
+			{
+				/* Largest run that is contiguous in the ring and fits the segment. */
+				k = (StageTail + Written[m]) % LOG_STAGE_SECTORS;
+				n = LOG_STAGE_SECTORS - k;
+				if (n > StageCount - Written[m]) n = StageCount - Written[m];
+				if (n > room) n = room;
+
+				for (i = Written[m]; i < Written[m] + n; i++)
+				{
+					if (i < Sealed) continue;
+					SealSector(Stage[(StageTail + i) % LOG_STAGE_SECTORS], LOGSEC_PAYLOAD, Cur, Cur->next);
+#if LOG_INDEX_SECTORS
+					IndexSector(&Meta[(StageTail + i) % LOG_STAGE_SECTORS], Cur->next);
+					if (IdxCount == LOGIDX_ENTRIES) WriteIndex();
+#endif
+					Cur->next++;
+					Sealed++;
+				}
+
+				if (f_tell(&mem->fil) != mem->wptr)
+				{
+					res = f_lseek(&mem->fil, mem->wptr);
+					if (res != FR_OK) return res;
+				}
+				res = f_write(&mem->fil, Stage[k], n * LOG_SS, &bw);
+				if (res == FR_OK && bw != n * LOG_SS) res = FR_DENIED;
+				if (res != FR_OK) return res;
+
+				mem->wptr += n * LOG_SS;
+				Written[m] += n;
+				room -= n;
+				Cur->partial = false;		/* The others rewrite it before the next commit */
+			}
+			if (room) full = false;
+		}
+
+		/* The sectors on all the cards leave the ring. */
+		done = StageCount;
+		for (m = 0; m < LOG_MIRRORS; m++)
+		{
+			if (Written[m] < done) done = Written[m];
+		}
+		for (m = 0; m < LOG_MIRRORS; m++) Written[m] -= done;
+		Sealed -= done;
+		StageTail = (StageTail + done) % LOG_STAGE_SECTORS;
+		StageCount -= done;
+
+		/* All the cards at the end of the segment: go on in the next one. */
+		if (!full || StageCount == 0) return FR_OK;
+		res = SwitchSegment(LOGSEG_FL_BYSIZE);
+		if (res != FR_OK) return res;
+	}
+}
+#endif
+
+/* Seals and writes the partially filled head sector in place, to every
+mirror. The file offset of the sector is not advanced. */
+static FRESULT WritePartial (void)
+{
+	FRESULT res;
+	UINT bw, i;
+	BYTE *sect;
+	LOGMEM *mem;
+	int m;
+
+	if (StageFill == 0) return FR_OK;
+
+	m = PickMember(true);
+	if (Cur->mem[m].wptr + LOG_SS > LOG_SEGMENT_SIZE)
+	{
+		res = SwitchSegment(LOGSEG_FL_BYSIZE);
+		if (res != FR_OK) return res;
+		m = PickMember(true);
+	}
+
+	sect = Stage[STAGE_HEAD];
+	memset(sect + sizeof(LOGSECHDR) + StageFill, 0, LOGSEC_PAYLOAD - StageFill);
+	SealSector(sect, StageFill, Cur, Cur->next);
+
+	/* Mirrors are level after WriteSectors(true), and m is 0. */
+	res = FR_OK;
+	for (i = 0; i < LOG_MIRRORS && res == FR_OK; i++)
+	{
+		mem = &Cur->mem[m + i];
+		res = f_lseek(&mem->fil, mem->wptr);
+		if (res == FR_OK) res = f_write(&mem->fil, sect, LOG_SS, &bw);
+		if (res == FR_OK && bw != LOG_SS) res = FR_DENIED;
+	}
+	if (res == FR_OK)
+	{
+		Cur->partial = true;
+		Cur->pm = m;
+	}
+
+	return res;
+}
+
+/* Adds the sector at STAGE_HEAD to the full ones. */
+static FRESULT PushSector (void)
+{
+	FRESULT res = FR_OK;
+#if LOG_MIRRORS > 1
+	BYTE m;
+#endif
+
+	if (++StageCount > StagePeak) StagePeak = StageCount;
+	if (StageCount == LOG_STAGE_SECTORS)	/* No room for a new head sector */
+	{
+		res = WriteSectors(true);
+		if (res != FR_OK)
+		{
+			/* Keep the ring consistent by dropping the oldest sector. */
+			StageTail = (StageTail + 1) % LOG_STAGE_SECTORS;
+			StageCount--;
+			Dropped++;
+#if LOG_MIRRORS > 1
+			for (m = 0; m < LOG_MIRRORS; m++)
+			{
+				if (Written[m]) Written[m]--;
+			}
+			if (Sealed) Sealed--;
+#endif
+		}
+	}
+#if LOG_INDEX_SECTORS
+	memset(&Meta[STAGE_HEAD], 0, sizeof(SECTMETA));
+#endif
+	return res;
+}
+
+#if LOG_COMPRESS
+/* Compresses as much of the gathered data as fits in the sector at
+STAGE_HEAD, as one block padded to the full payload, or stores it as it is
+when LZ does not beat that, and stages the sector. The rest of the data
+moves to the start of the buffer. */
+static FRESULT PackSector (void)
+{
+	uint32_t used;
+#if LOG_INDEX_SECTORS
+	LOGRECHDR rec;
+#endif
+
+	LZ_PackSector(Raw, RawFill, Stage[STAGE_HEAD], &used);
+
+#if LOG_INDEX_SECTORS
+	/* Walk the records starting in the block, from header to header. */
+	for (; RawNext < used; RawNext += sizeof(rec) + rec.len)
+	{
+		memcpy(&rec, &Raw[RawNext], sizeof(rec));
+		NoteRecord(&Meta[STAGE_HEAD], RawNext, &rec);
+	}
+#endif
+	RawNext -= used;
+
+	RawFill -= used;
+	memmove(Raw, &Raw[used], RawFill);
+
+	return PushSector();
+}
+#endif
+
+#if LOG_INDEX_SECTORS
+/* Counts a record starting 'ofs' stream bytes into a staged sector. */
+static void NoteRecord (SECTMETA *m, UINT ofs, const LOGRECHDR *rec)
+{
+	if (m->records == 0)
+	{
+		m->sec = rec->sec;
+		m->nsec = rec->nsec;
+		m->first = ofs;
+	}
+	m->records++;
+	m->chans |= 1 << (rec->chan & 15);
+}
+
+/* Adds a written data sector to the entry of its span. */
+static void IndexSector (const SECTMETA *m, DWORD idx)
+{
+	if (idx / LOG_INDEX_SECTORS != IdxSpan)
+	{
+		AddEntry();
+		IdxSpan = idx / LOG_INDEX_SECTORS;
+	}
+	if (m->records == 0) return;
+
+	if (IdxEnt.records == 0)
+	{
+		IdxEnt.sec = m->sec;
+		IdxEnt.nsec = m->nsec;
+		IdxEnt.sector = idx;
+		IdxEnt.offset = m->first;
+	}
+	IdxEnt.records += m->records;
+	IdxEnt.chans |= m->chans;
+}
+
+/* Moves the entry of a finished span to the page. A span where no record
+starts gets no entry. */
+static void AddEntry (void)
+{
+	if (IdxEnt.records && IdxCount < LOGIDX_ENTRIES)
+	{
+		memcpy(&IdxBuf[sizeof(LOGSECHDR) + IdxCount * sizeof(LOGIDXENT)], &IdxEnt, sizeof(LOGIDXENT));
+		IdxCount++;
+	}
+	memset(&IdxEnt, 0, sizeof(IdxEnt));
+}
+
+/* Seals and writes the index page to its place after the segment header,
+in member 0 when striped and in every mirror, and starts the next page if
+this one is full.
+The index is only an aid to the readers: a failed write does not stop the
+logging, the data writes will fail anyway. */
+static void WriteIndex (void)
+{
+	LOGSECHDR *sh = (LOGSECHDR *)IdxBuf;
+	UINT bw;
+	BYTE m;
+
+	if (IdxCount == 0 || IdxPage >= LOG_INDEX_PAGES) return;
+
+	sh->magic = LOGIDX_MAGIC;
+	sh->len = IdxCount * sizeof(LOGIDXENT);
+	sh->segseq = Cur->seq;
+	sh->seq = IdxPage;
+	sh->nonce = (WORD)Cur->nonce;
+	sh->crc = LOGSEC_Crc(IdxBuf);
+
+	for (m = 0; m < LOG_MIRRORS; m++)
+	{
+		if (f_lseek(&Cur->mem[m].fil, LOGSEG_HDR_SIZE + IdxPage * LOG_SS) == FR_OK)
+		{
+			f_write(&Cur->mem[m].fil, IdxBuf, LOG_SS, &bw);
+		}
+	}
+
+	if (IdxCount == LOGIDX_ENTRIES)
+	{
+		IdxPage++;
+		IdxCount = 0;
+		memset(IdxBuf, 0, sizeof(IdxBuf));
+	}
+}
+
+/* Ends the index of the current segment before it is retired, with the
+records of a flushed partial sector. */
+static void CloseIndex (void)
+{
+	if (Cur->partial) IndexSector(&Meta[STAGE_HEAD], Cur->next);
+	AddEntry();
+	WriteIndex();
+}
+
+/* Starts the index of a new current segment. */
+static void ResetIndex (void)
+{
+	memset(&IdxEnt, 0, sizeof(IdxEnt));
+	memset(IdxBuf, 0, sizeof(IdxBuf));
+	IdxSpan = IdxCount = IdxPage = 0;
+}
+#endif
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,179 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file lzpack.c
+ * @date Oct 18, 2026
+ *
+ * @brief LZ compressor of the log sectors.
+ *
+ * See lzpack.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "logformat.h"
+#include "lzpack.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define LZ_HASH(v)			((uint32_t)((v) * 2654435761U) >> (32 - LZPACK_HASH_BITS))
+#define LZ_EMPTY			0xFFFF
+#define LZ_SKIP_SHIFT		5				/* Step grows by one every 32 misses */
+
+/* Extension bytes of a literal count or of a match length - 4. */
+#define LZ_EXT_SIZE(n)		(((n) >= 15) ? ((n) - 15) / 255 + 1 : 0)
+
+#if LOGLZ_MAX_RAW > LZ_EMPTY
+#error The hash table holds 16-bit positions.
+#endif
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint16_t Table[1 << LZPACK_HASH_BITS];			/* Last position of each hash */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint32_t Read32 (const uint8_t *p);
+static uint8_t *PutExt (uint8_t *op, uint32_t n);
+static uint8_t *PutLiterals (uint8_t *op, const uint8_t *lit, uint32_t n, uint32_t mlen);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Compresses the head of a buffer into one LZ block.
+  *
+  * Only the sequences are written; the caller stores the LOGLZHDR.
+  *
+  * @param  src:    Data to compress, up to LOGLZ_MAX_RAW bytes.
+  * @param  srclen: Bytes in src.
+  * @param  dst:    Output buffer.
+  * @param  dstcap: Size of the output buffer.
+  * @param  used:   Receives the bytes of src taken into the block.
+  * @retval Compressed bytes written to dst.
+  */
+uint32_t LZ_Pack (const uint8_t *src, uint32_t srclen, uint8_t *dst, uint32_t dstcap, uint32_t *used)
+{
+	const uint8_t *ip = src, *anchor = src, *ref;
+	const uint8_t *iend = src + srclen;
+	uint8_t *op = dst, *oend = dst + dstcap;
+	uint32_t v, h, lit, mlen, room;
+
+	if (srclen > LOGLZ_MAX_RAW) iend = src + LOGLZ_MAX_RAW;
+	memset(Table, 0xFF, sizeof(Table));		/* LZ_EMPTY points past the end: no candidate */
+
+	while (iend - ip >= LOGLZ_MINMATCH)
+	{
+		v = Read32(ip);
+		h = LZ_HASH(v);
+		ref = src + Table[h];
+		Table[h] = (uint16_t)(ip - src);
+
+		if (ref >= ip || Read32(ref) != v)
+		{
+			ip += 1 + ((uint32_t)(ip - anchor) >> LZ_SKIP_SHIFT);
+			continue;
+		}
+
+		for (mlen = LOGLZ_MINMATCH; ip + mlen < iend && ref[mlen] == ip[mlen]; mlen++);
+
+		lit = ip - anchor;
+		if (1 + LZ_EXT_SIZE(lit) + lit + 2 + LZ_EXT_SIZE(mlen - LOGLZ_MINMATCH) > (uint32_t)(oend - op)) break;
+
+		op = PutLiterals(op, anchor, lit, mlen - LOGLZ_MINMATCH);
+		*op++ = (uint8_t)(ip - ref);
+		*op++ = (uint8_t)((ip - ref) >> 8);
+		if (mlen - LOGLZ_MINMATCH >= 15) op = PutExt(op, mlen - LOGLZ_MINMATCH);
+
+		ip += mlen;
+		anchor = ip;
+	}
+
+	/* The rest goes as literals, as much of it as fits. */
+	lit = iend - anchor;
+	room = oend - op;
+	if (1 + LZ_EXT_SIZE(lit) + lit > room)
+	{
+		lit = (room > 1) ? room - 1 - LZ_EXT_SIZE(room - 1) : 0;
+	}
+
+	if (lit) op = PutLiterals(op, anchor, lit, 0);
+
+	*used = (anchor - src) + lit;
+	return op - dst;
+}
+
+/**
+  * @brief  Fills a sector of an LZ segment with the head of a buffer.
+  *
+  * The data is compressed into an LZ block. When the block does not take
+  * more of src than the payload holds as it is, the data is stored
+  * instead, as in a plain sector. The magic and the length of the sector
+  * header are set; the rest of the header is left to the caller. The
+  * payload is padded with zeros to its end.
+  *
+  * @param  src:    Data, up to LOGLZ_MAX_RAW bytes.
+  * @param  srclen: Bytes in src.
+  * @param  sect:   Sector, LOGSEG_SECT_SIZE bytes.
+  * @param  used:   Receives the bytes of src taken into the sector.
+  * @retval LOGLZHDR.zlen, or 0 if the data is stored.
+  */
+uint32_t LZ_PackSector (const uint8_t *src, uint32_t srclen, uint8_t *sect, uint32_t *used)
+{
+	LOGSECHDR *sh = (LOGSECHDR *)sect;
+	uint8_t *blk = sect + sizeof(LOGSECHDR);
+	LOGLZHDR *bh = (LOGLZHDR *)blk;
+	uint32_t zlen, plain = (srclen < LOGSEC_PAYLOAD) ? srclen : LOGSEC_PAYLOAD;
+
+	zlen = LZ_Pack(src, srclen, blk + sizeof(LOGLZHDR), LOGLZ_MAX_ZLEN, used);
+	if (*used <= plain)
+	{
+		memcpy(blk, src, plain);
+		memset(blk + plain, 0, LOGSEC_PAYLOAD - plain);
+		sh->magic = LOGSEC_RAW_MAGIC;
+		sh->len = plain;
+		*used = plain;
+		return 0;
+	}
+	bh->rawlen = *used;
+	bh->zlen = zlen;
+	memset(blk + sizeof(LOGLZHDR) + zlen, 0, LOGLZ_MAX_ZLEN - zlen);
+	sh->magic = LOGSEC_MAGIC;
+	sh->len = LOGSEC_PAYLOAD;
+	return zlen;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static uint32_t Read32 (const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* Writes the extension bytes of a count of 15 or more. */
+static uint8_t *PutExt (uint8_t *op, uint32_t n)
+{
+	for (n -= 15; n >= 255; n -= 255) *op++ = 255;
+	*op++ = (uint8_t)n;
+	return op;
+}
+
+/* Writes the token, the literal count extension and the literals. */
+static uint8_t *PutLiterals (uint8_t *op, const uint8_t *lit, uint32_t n, uint32_t mlen)
+{
+	*op++ = (uint8_t)(((n < 15) ? n : 15) << 4 | ((mlen < 15) ? mlen : 15));
+	if (n >= 15) op = PutExt(op, n);
+	memcpy(op, lit, n);
+	return op + n;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
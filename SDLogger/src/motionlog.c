@@ -0,0 +1,458 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file motionlog.c
+ * @date Oct 18, 2026
+ *
+ * @brief Quadrature encoder sampling and motor control input edges.
+ *
+ * See motionlog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <string.h>
+#include "stdbool.h"
+
+#include "lpc17xx_qei.h"
+#include "lpc17xx_mcpwm.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_pinsel.h"
+
+#include "config.h"
+#include "timestamp.h"
+#include "logger.h"
+
+#include "motionlog.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define MCI_INPUTS			3
+#define EDGE_MASK			(MOTIONLOG_EDGES - 1)
+#define VARINT_MAX			5						/* Bytes of a 32-bit LEB128 varint */
+#define EDGE_HOLD_NS		100000000UL				/* Longest wait for more edges to a record */
+
+#define MCTIM(i)			((&LPC_MCPWM->MCTIM0)[i])
+#define MCCR(i)				((&LPC_MCPWM->MCCR0)[i])
+
+#if MOTIONLOG_EDGES & EDGE_MASK
+#error MOTIONLOG_EDGES must be a power of 2.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagMOTEDGE
+{
+	TSTAMP  ts;
+	uint8_t mci;
+	uint8_t level;
+	bool    lost;			/* Edges were dropped before this one */
+} MOTEDGE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t Pos[MOTIONLOG_BLOCKS][MOTIONLOG_BLOCK];
+static TSTAMP Stamp[MOTIONLOG_BLOCKS];					/* Time of the first sample */
+static uint32_t Index[MOTIONLOG_BLOCKS];				/* Index count at the first sample */
+static bool Gap[MOTIONLOG_BLOCKS];						/* Samples were dropped before the block */
+static volatile bool Full[MOTIONLOG_BLOCKS];			/* Set by the QEI interrupt */
+static volatile uint8_t FillIdx;						/* Block being filled */
+static uint16_t Fill;
+static uint8_t TaskIdx;									/* Next block to log */
+
+static MOTEDGE Edge[MOTIONLOG_EDGES];
+static volatile uint16_t EdgeHead;						/* Written by the MCPWM interrupt */
+static uint16_t EdgeTail;								/* Written by MOTIONLOG_Task() */
+
+static volatile uint32_t Lost;							/* Samples and edges dropped */
+static bool SampleGap, EdgeGap;							/* Set by the interrupts while dropping */
+
+static BYTE Batch[sizeof(LOGMOTPOS) + VARINT_MAX * MOTIONLOG_BLOCK];
+
+static LOGMOTCFG Config;
+static bool PinsTaken;									/* P1.20, P1.23, P1.24 on the MCI function */
+static uint32_t NsPerTick;								/* MCPWM timer period */
+
+/* PHA/MCI0, PHB/MCI1 and IDX/MCI2 on port 1 */
+static const uint8_t MciPin[MCI_INPUTS] = { 20, 23, 24 };
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static void StartQei (void);
+static void StartCapture (void);
+static FRESULT LogBlock (uint8_t idx);
+static FRESULT LogEdges (void);
+static bool HoldEdges (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Reads the settings and starts the encoder sampling and the edge
+  *         capture.
+  *
+  * @param  None
+  * @retval FR_OK (also when both are off), FR_NO_FILE without
+  *         configuration file, FR_INVALID_PARAMETER for a rate above
+  *         MOTIONLOG_MAX_RATE, or the logger error.
+  */
+FRESULT MOTIONLOG_Init (void)
+{
+	FRESULT res;
+	PINSEL_CFG_Type PinCfg;
+	int i;
+
+	memset(&Config, 0, sizeof(Config));
+	PinsTaken = false;
+	res = CFG_Parse(ConfigHandler);
+	if (res != FR_OK) return res;
+	if (Config.rate == 0 && !Config.mcicap) return FR_OK;
+	if (Config.rate > MOTIONLOG_MAX_RATE) return FR_INVALID_PARAMETER;
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_PULLUP;
+	PinCfg.Portnum = 1;
+	PinCfg.Funcnum = 1;
+	for (i = 0; i < MCI_INPUTS; i++)
+	{
+		PinCfg.Pinnum = MciPin[i];
+		PINSEL_ConfigPin(&PinCfg);
+	}
+	PinsTaken = true;
+
+	for (i = 0; i < MOTIONLOG_BLOCKS; i++) Full[i] = false;
+	FillIdx = TaskIdx = 0;
+	Fill = 0;
+	EdgeHead = EdgeTail = 0;
+	Lost = 0;
+	SampleGap = EdgeGap = false;
+
+	/* The effective rate goes in the configuration record. */
+	if (Config.rate) StartQei();
+
+	res = LOG_Record(LOGREC_CH_MOTION, LOGREC_MOT_FL_CONFIG, NULL, &Config, sizeof(Config));
+	if (res != FR_OK) return res;
+
+	if (Config.rate)
+	{
+		NVIC_SetPriority(QEI_IRQn, 1);
+		NVIC_EnableIRQ(QEI_IRQn);
+	}
+	if (Config.mcicap) StartCapture();
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Logs the full position blocks and the captured edges. Call it
+  *         from the main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the logger error.
+  */
+FRESULT MOTIONLOG_Task (void)
+{
+	FRESULT res = FR_OK;
+
+	while (res == FR_OK && Full[TaskIdx])
+	{
+		res = LogBlock(TaskIdx);
+		Full[TaskIdx] = false;
+		TaskIdx = (TaskIdx + 1) % MOTIONLOG_BLOCKS;
+	}
+
+	if (res == FR_OK && EdgeTail != EdgeHead && !HoldEdges()) res = LogEdges();
+
+	return res;
+}
+
+/**
+  * @brief  Position samples and edges dropped because the main loop did not
+  *         keep up.
+  *
+  * @param  None
+  * @retval Lost samples and edges since MOTIONLOG_Init().
+  */
+uint32_t MOTIONLOG_Lost (void)
+{
+	return Lost;
+}
+
+/**
+  * @brief  Whether P1.23, the button pin, was given to PHB/MCI1. Its level
+  *         then follows the encoder and is not a button press.
+  *
+  * @param  None
+  * @retval true while the QEI or the edge capture owns the pin.
+  */
+bool MOTIONLOG_UsesButton (void)
+{
+	return PinsTaken;
+}
+
+/**
+  * @brief  QEI interrupt: velocity timer reload, one position sample.
+  *
+  * @param  None
+  * @retval None
+  */
+void QEI_IRQHandler (void)
+{
+	uint8_t idx = FillIdx;
+
+	LPC_QEI->QEICLR = QEI_INTFLAG_TIM_Int;
+
+	if (Fill == 0)
+	{
+		if (Full[idx])
+		{
+			Lost++;						/* Waits for the block to be logged */
+			SampleGap = true;
+			return;
+		}
+		TS_Now(&Stamp[idx]);
+		Index[idx] = LPC_QEI->INXCNT;
+		Gap[idx] = SampleGap;
+		SampleGap = false;
+	}
+
+	Pos[idx][Fill] = LPC_QEI->QEIPOS;
+	if (++Fill == MOTIONLOG_BLOCK)
+	{
+		Full[idx] = true;
+		FillIdx = (idx + 1) % MOTIONLOG_BLOCKS;
+		Fill = 0;
+	}
+}
+
+/**
+  * @brief  MCPWM interrupt: capture of an MCI edge.
+  *
+  * @param  None
+  * @retval None
+  */
+void MCPWM_IRQHandler (void)
+{
+	uint32_t flags, ns, age[MCI_INPUTS];
+	uint8_t order[MCI_INPUTS];
+	uint16_t head;
+	MOTEDGE *e;
+	int i, j, n = 0;
+
+	flags = LPC_MCPWM->MCINTFLAG & LPC_MCPWM->MCINTEN;
+	LPC_MCPWM->MCINTFLAG_CLR = flags;
+
+	/* The edges go in the ring oldest first: the records hold times after
+	their first edge. */
+	for (i = 0; i < MCI_INPUTS; i++)
+	{
+		if (!(flags & MCPWM_INT_ICAP(i))) continue;
+
+		age[i] = MCTIM(i) - MCCR(i);
+		for (j = n++; j > 0 && age[order[j - 1]] < age[i]; j--) order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	for (j = 0; j < n; j++)
+	{
+		i = order[j];
+		head = EdgeHead;
+		if (((head + 1) & EDGE_MASK) == EdgeTail)
+		{
+			Lost++;
+			EdgeGap = true;
+			continue;
+		}
+		e = &Edge[head];
+		TS_Now(&e->ts);
+
+		/* Back to the captured edge. */
+		ns = age[i] * NsPerTick;
+		if (ns > e->ts.nsec)
+		{
+			e->ts.sec--;
+			e->ts.nsec += 1000000000UL;
+		}
+		e->ts.nsec -= ns;
+
+		e->mci = i;
+		e->level = (LPC_GPIO1->FIOPIN >> MciPin[i]) & 1;
+		e->lost = EdgeGap;
+		EdgeGap = false;
+		EdgeHead = (head + 1) & EDGE_MASK;
+	}
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	uint32_t val;
+
+	if (strcmp(key, "qei") == 0)
+	{
+		CFG_GetUint(&value, &Config.rate);
+	}
+	else if (strcmp(key, "mcicap") == 0)
+	{
+		if (CFG_GetUint(&value, &val)) Config.mcicap = (val != 0);
+	}
+}
+
+/* Quadrature mode counting all edges; the position counter wraps at 2^32
+so the sample differences are plain subtractions. */
+static void StartQei (void)
+{
+	QEI_CFG_Type QeiCfg;
+	QEI_RELOADCFG_Type ReloadCfg;
+	uint32_t pclk, ticks;
+
+	QeiCfg.DirectionInvert = QEI_DIRINV_NONE;
+	QeiCfg.SignalMode = QEI_SIGNALMODE_QUAD;
+	QeiCfg.CaptureMode = QEI_CAPMODE_4X;
+	QeiCfg.InvertIndex = QEI_INVINX_NONE;
+	QEI_Init(LPC_QEI, &QeiCfg);
+	QEI_SetMaxPosition(LPC_QEI, 0xFFFFFFFFUL);
+
+	pclk = CLKPWR_GetPCLK(CLKPWR_PCLKSEL_QEI);
+	ticks = (pclk + Config.rate / 2) / Config.rate;
+	ReloadCfg.ReloadOption = QEI_TIMERRELOAD_TICKVAL;
+	ReloadCfg.ReloadValue = ticks;
+	QEI_SetTimerReload(LPC_QEI, &ReloadCfg);
+	Config.rate = pclk / ticks;
+
+	QEI_IntCmd(LPC_QEI, QEI_INTFLAG_TIM_Int, ENABLE);
+}
+
+/* Capture channel i captures timer i on both edges of MCIi. The timers run
+free over the full 32 bits. */
+static void StartCapture (void)
+{
+	MCPWM_CHANNEL_CFG_Type ChCfg;
+	MCPWM_CAPTURE_CFG_Type CapCfg;
+	int i;
+
+	MCPWM_Init(LPC_MCPWM);
+	NsPerTick = 1000000000UL / CLKPWR_GetPCLK(CLKPWR_PCLKSEL_MC);
+
+	memset(&ChCfg, 0, sizeof(ChCfg));
+	ChCfg.channelType = MCPWM_CHANNEL_EDGE_MODE;
+	ChCfg.channelPolarity = MCPWM_CHANNEL_PASSIVE_LO;
+	ChCfg.channelDeadtimeEnable = DISABLE;
+	ChCfg.channelUpdateEnable = ENABLE;
+	ChCfg.channelPeriodValue = 0xFFFFFFFFUL;
+
+	CapCfg.captureRising = ENABLE;
+	CapCfg.captureFalling = ENABLE;
+	CapCfg.timerReset = DISABLE;
+	CapCfg.hnfEnable = DISABLE;
+
+	for (i = 0; i < MCI_INPUTS; i++)
+	{
+		MCPWM_ConfigChannel(LPC_MCPWM, i, &ChCfg);
+		CapCfg.captureChannel = i;
+		MCPWM_ConfigCapture(LPC_MCPWM, i, &CapCfg);
+		MCPWM_IntConfig(LPC_MCPWM, MCPWM_INT_ICAP(i), ENABLE);
+	}
+
+	NVIC_SetPriority(MCPWM_IRQn, 1);
+	NVIC_EnableIRQ(MCPWM_IRQn);
+	MCPWM_Start(LPC_MCPWM, ENABLE, ENABLE, ENABLE);
+}
+
+/* Delta-encodes a full block into one record. */
+static FRESULT LogBlock (uint8_t idx)
+{
+	LOGMOTPOS *hdr = (LOGMOTPOS *)Batch;
+	BYTE *p = Batch + sizeof(LOGMOTPOS);
+	uint32_t z;
+	int i;
+
+	hdr->pos = Pos[idx][0];
+	hdr->index = Index[idx];
+	hdr->samples = MOTIONLOG_BLOCK;
+	hdr->reserved = 0;
+
+	for (i = 1; i < MOTIONLOG_BLOCK; i++)
+	{
+		z = LOGMOT_ZIGZAG(Pos[idx][i] - Pos[idx][i - 1]);
+		while (z >= 0x80)
+		{
+			*p++ = (BYTE)(z | 0x80);
+			z >>= 7;
+		}
+		*p++ = (BYTE)z;
+	}
+
+	return LOG_Record(LOGREC_CH_MOTION, Gap[idx] ? LOGREC_MOT_FL_LOST : 0, &Stamp[idx], Batch, p - Batch);
+}
+
+/* Packs the queued edges into records; dt must fit 32 bits of
+nanoseconds. A record starts at each edge that follows a loss, so its
+flag marks where the edges are missing. */
+static FRESULT LogEdges (void)
+{
+	FRESULT res = FR_OK;
+	MOTEDGE *e;
+	TSTAMP first;
+	uint32_t dt;
+	UINT fill = 0;
+	BYTE flags = 0;
+
+	while (res == FR_OK && EdgeTail != EdgeHead)
+	{
+		e = &Edge[EdgeTail];
+		if (fill && (fill + LOGMOT_EDGE_SIZE > sizeof(Batch) || e->ts.sec - first.sec > 3 || e->lost))
+		{
+			res = LOG_Record(LOGREC_CH_MOTION, flags, &first, Batch, fill);
+			fill = 0;
+			continue;
+		}
+		if (fill == 0)
+		{
+			first = e->ts;
+			flags = LOGREC_MOT_FL_EDGES | (e->lost ? LOGREC_MOT_FL_LOST : 0);
+		}
+
+		dt = (e->ts.sec - first.sec) * 1000000000UL + e->ts.nsec - first.nsec;
+		memcpy(&Batch[fill], &dt, 4);
+		Batch[fill + 4] = e->mci;
+		Batch[fill + 5] = e->level;
+		fill += LOGMOT_EDGE_SIZE;
+
+		EdgeTail = (EdgeTail + 1) & EDGE_MASK;
+	}
+
+	if (res == FR_OK && fill) res = LOG_Record(LOGREC_CH_MOTION, flags, &first, Batch, fill);
+
+	return res;
+}
+
+/* Whether to wait for more edges: the record header costs as much as two
+edges, so they are logged once the ring is half full or the oldest one
+has waited EDGE_HOLD_NS. */
+static bool HoldEdges (void)
+{
+	TSTAMP now;
+	const TSTAMP *ts = &Edge[EdgeTail].ts;
+	uint32_t ns;
+
+	if (((EdgeHead - EdgeTail) & EDGE_MASK) >= MOTIONLOG_EDGES / 2) return false;
+
+	TS_Now(&now);
+	if (now.sec - ts->sec > 1) return false;
+	ns = (now.sec - ts->sec) * 1000000000UL + now.nsec - ts->nsec;
+	return ns < EDGE_HOLD_NS;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,456 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file ringlog.c
+ * @date Oct 18, 2026
+ *
+ * @brief Raw sector rings for the highest rate channels.
+ *
+ * See ringlog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "stdbool.h"
+
+#include "diskio.h"
+
+#include "ringlog.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define RING_SS				_MAX_SS
+#define RING_SECTORS		((RINGLOG_SIZE - LOGSEG_HDR_SIZE) / RING_SS)
+#define RING_CLMT_SIZE		4						/* Link map of a single extent */
+#define RING_FILES			(1 + RINGLOG_CHANNEL_FILES)
+#define RING_NAME_SIZE		13						/* "RINGCHnn.DAT" */
+
+#if RING_SS != LOGSEG_SECT_SIZE
+#error The ring sectors must be LOGSEG_SECT_SIZE bytes.
+#endif
+#if (RINGLOG_SIZE % RING_SS) || (RING_SECTORS < 2 * RINGLOG_RUN)
+#error RINGLOG_SIZE must be whole sectors, two runs at least.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* A ring file and the run being gathered for it */
+typedef struct tagRINGFILE
+{
+	BYTE buf[RINGLOG_RUN][RING_SS];			/* Full sectors of the run, then the partial one */
+	LOGRINGHDR hdr;
+	BYTE drv;								/* Physical drive of the ring */
+	DWORD base;								/* LBA of ring sector 0 */
+	DWORD head;								/* Ring sector of buf[0] */
+	DWORD seq;								/* LOGRINGSEC.seq of buf[0] */
+	WORD run;
+	UINT count;								/* Full sectors in buf */
+	UINT fill;								/* Payload bytes in buf[count] */
+	WORD first;								/* LOGRINGSEC.first of buf[count] */
+	bool dirty;								/* Data added since the last flush */
+} RINGFILE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static RINGFILE Ring[RING_FILES];				/* Ring[0]: LOGRING_NAME, for the other channels */
+static const BYTE Chan[] = RINGLOG_CHANNEL_LIST;	/* Channel of Ring[i + 1] */
+static DWORD Dropped;							/* Sectors lost on write errors */
+static uint32_t FlushTime;						/* TS_Seconds() at the last flush */
+static bool Open;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void MakeName (TCHAR *name, UINT i);
+static RINGFILE *FileOf (BYTE chan);
+static void AlignAlloc (FATFS *fs);
+static FRESULT OpenRing (RINGFILE *r, const TCHAR *name);
+static FRESULT ReadKey (RINGFILE *r, DWORD pos, DWORD *seq, WORD *run);
+static FRESULT FindHead (RINGFILE *r);
+static void SealSector (RINGFILE *r, UINT len);
+static FRESULT WriteRun (RINGFILE *r, UINT n);
+static FRESULT AddBytes (RINGFILE *r, const BYTE *p, UINT len);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Opens or creates the ring files and finds where to go on in
+  *         each one.
+  *
+  * @param  None
+  * @retval FR_OK, FR_DENIED when a ring cannot be one extent, or the
+  *         file system error.
+  */
+FRESULT RING_Init (void)
+{
+	FRESULT res = FR_OK;
+	TCHAR name[RING_NAME_SIZE];
+	RINGFILE *r;
+	UINT i;
+
+	Open = false;
+	for (i = 0; i < RING_FILES && res == FR_OK; i++)
+	{
+		r = &Ring[i];
+		MakeName(name, i);
+		res = OpenRing(r, name);
+		if (res == FR_OK) res = FindHead(r);
+
+		r->count = r->fill = 0;
+		r->first = LOGRING_NONE;
+		r->dirty = false;
+	}
+	if (res != FR_OK) return res;
+
+	Dropped = 0;
+	FlushTime = TS_Seconds();
+	Open = true;
+	return FR_OK;
+}
+
+/**
+  * @brief  Appends a timestamped record to the ring of its channel.
+  *
+  * @param  chan:  Source channel (LOGREC_CH_xxx).
+  * @param  flags: Channel specific flags.
+  * @param  ts:    Time of the event, or NULL to use the current time.
+  * @param  data:  Record payload.
+  * @param  len:   Payload bytes, up to 65535.
+  * @retval FR_OK, FR_NOT_READY before RING_Init() or the error of a run
+  *         write (the run is dropped).
+  */
+FRESULT RING_Record (BYTE chan, BYTE flags, const TSTAMP *ts, const void *data, UINT len)
+{
+	FRESULT res, res2;
+	RINGFILE *r;
+	LOGRECHDR rec;
+	TSTAMP now;
+
+	if (!Open) return FR_NOT_READY;
+	if (len > 0xFFFF) return FR_INVALID_PARAMETER;
+	if (ts == NULL)
+	{
+		TS_Now(&now);
+		ts = &now;
+	}
+
+	rec.chan = chan;
+	rec.flags = flags;
+	rec.len = len;
+	rec.sec = ts->sec;
+	rec.nsec = ts->nsec;
+
+	/* A full sector is written at once, so fill is below the payload. */
+	r = FileOf(chan);
+	if (r->first == LOGRING_NONE) r->first = r->fill;
+	res = AddBytes(r, (const BYTE *)&rec, sizeof(rec));
+	res2 = AddBytes(r, data, len);
+	return (res != FR_OK) ? res : res2;
+}
+
+/**
+  * @brief  Flushes the rings every RINGLOG_FLUSH_SECONDS. Call it from the
+  *         main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the disk error.
+  */
+FRESULT RING_Task (void)
+{
+	if (!Open || TS_Seconds() - FlushTime < RINGLOG_FLUSH_SECONDS) return FR_OK;
+
+	return RING_Flush();
+}
+
+/**
+  * @brief  Writes the full sectors and the partial one of each ring, in
+  *         place. The partial sector is written again as it fills.
+  *
+  * @param  None
+  * @retval FR_OK or the first disk error.
+  */
+FRESULT RING_Flush (void)
+{
+	FRESULT res = FR_OK, res2;
+	RINGFILE *r;
+
+	FlushTime = TS_Seconds();
+	if (!Open) return FR_OK;
+
+	for (r = Ring; r < &Ring[RING_FILES]; r++)
+	{
+		if (!r->dirty) continue;
+
+		r->dirty = false;
+		if (r->fill) SealSector(r, r->fill);
+		res2 = WriteRun(r, r->count + (r->fill ? 1 : 0));
+		if (res == FR_OK) res = res2;
+	}
+	return res;
+}
+
+/**
+  * @brief  Flushes the rings and waits for the card to program them.
+  *
+  * @param  None
+  * @retval FR_OK or the disk error.
+  */
+FRESULT RING_Close (void)
+{
+	FRESULT res;
+
+	if (!Open) return FR_OK;
+
+	res = RING_Flush();
+	if (disk_ioctl(Ring[0].drv, CTRL_SYNC, NULL) != RES_OK && res == FR_OK) res = FR_DISK_ERR;
+	Open = false;
+	return res;
+}
+
+/**
+  * @brief  Sectors lost on write errors since RING_Init().
+  *
+  * @param  None
+  * @retval Sector count.
+  */
+DWORD RING_Dropped (void)
+{
+	return Dropped;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* LOGRING_NAME for ring 0; LOGRING_CH_PREFIX and the channel number for
+the others. */
+static void MakeName (TCHAR *name, UINT i)
+{
+	BYTE chan;
+
+	if (i == 0)
+	{
+		strcpy(name, LOGRING_NAME);
+		return;
+	}
+	chan = Chan[i - 1];
+	strcpy(name, LOGRING_CH_PREFIX);
+	name += sizeof(LOGRING_CH_PREFIX) - 1;
+	*name++ = '0' + (chan / 10) % 10;
+	*name++ = '0' + chan % 10;
+	strcpy(name, LOGSEG_NAME_EXT);
+}
+
+static RINGFILE *FileOf (BYTE chan)
+{
+	UINT i;
+
+	for (i = 1; i < RING_FILES; i++)
+	{
+		if (Chan[i - 1] == chan) return &Ring[i];
+	}
+	return &Ring[0];
+}
+
+/* Makes the next cluster allocation start on an AU boundary of the card,
+so that a ring of whole AUs shares none with another file: each AU is then
+written by one stream, from its start to its end. */
+static void AlignAlloc (FATFS *fs)
+{
+	DWORD au, clst, off;
+
+	if (disk_ioctl(fs->drv, GET_BLOCK_SIZE, &au) != RES_OK || au <= fs->csize) return;
+
+	clst = (fs->last_clust >= 2 && fs->last_clust < fs->n_fatent) ? fs->last_clust + 1 : 2;
+	off = (fs->database + (clst - 2) * fs->csize) % au;
+	if (off == 0 || (au - off) % fs->csize) return;
+
+	clst += (au - off) / fs->csize;
+	if (clst < fs->n_fatent) fs->last_clust = clst - 1;
+}
+
+/* Opens a ring file, creating it if it is missing or of another size, and
+takes the LBA of its first sector. The file is closed again: from here on
+it is written by LBA only. */
+static FRESULT OpenRing (RINGFILE *r, const TCHAR *name)
+{
+	FRESULT res, res2;
+	FIL fil;
+	UINT n;
+	DWORD clmt[RING_CLMT_SIZE];
+	TSTAMP now;
+	bool fresh;
+
+	res = f_open(&fil, name, FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
+	if (res != FR_OK) return res;
+
+	res = f_read(&fil, &r->hdr, sizeof(r->hdr), &n);
+	fresh = n != sizeof(r->hdr) || f_size(&fil) != RINGLOG_SIZE
+			|| r->hdr.magic != LOGRING_MAGIC || r->hdr.check != LOGRING_Check(&r->hdr)
+			|| r->hdr.version != LOGRING_VERSION || r->hdr.hdrsize != LOGSEG_HDR_SIZE
+			|| r->hdr.sectors != RING_SECTORS;
+
+	if (res == FR_OK && fresh)
+	{
+		/* Seeking past the end in write mode allocates the clusters. */
+		res = f_lseek(&fil, 0);
+		if (res == FR_OK) res = f_truncate(&fil);
+		if (res == FR_OK) AlignAlloc(fil.fs);
+		if (res == FR_OK) res = f_lseek(&fil, RINGLOG_SIZE);
+		if (res == FR_OK && f_size(&fil) != RINGLOG_SIZE) res = FR_DENIED;	/* Volume full */
+
+		if (res == FR_OK)
+		{
+			/* Rings created together differ in the nonce even so. */
+			TS_Now(&now);
+			memset(r->buf[0], 0, RING_SS);
+			r->hdr.magic = LOGRING_MAGIC;
+			r->hdr.version = LOGRING_VERSION;
+			r->hdr.hdrsize = LOGSEG_HDR_SIZE;
+			r->hdr.sectors = RING_SECTORS;
+			r->hdr.created = get_fattime();
+			r->hdr.nonce = r->hdr.created ^ (now.sec << 16) ^ now.nsec ^ (DWORD)(r - Ring);
+			r->hdr.check = LOGRING_Check(&r->hdr);
+			memcpy(r->buf[0], &r->hdr, sizeof(r->hdr));
+			res = f_lseek(&fil, 0);
+			if (res == FR_OK) res = f_write(&fil, r->buf[0], RING_SS, &n);
+			if (res == FR_OK && n != RING_SS) res = FR_DENIED;
+		}
+	}
+
+	/* The ring sectors are addressed as one extent. */
+	if (res == FR_OK)
+	{
+		clmt[0] = RING_CLMT_SIZE;
+		fil.cltbl = clmt;
+		res = f_lseek(&fil, CREATE_LINKMAP);
+		fil.cltbl = NULL;
+		if (res == FR_NOT_ENOUGH_CORE) res = FR_DENIED;		/* Fragmented */
+	}
+	if (res == FR_OK)
+	{
+		r->drv = fil.fs->drv;
+		r->base = fil.fs->database + (clmt[2] - 2) * fil.fs->csize + LOGSEG_HDR_SIZE / RING_SS;
+	}
+
+	res2 = f_close(&fil);
+	if (res == FR_OK) res = res2;
+	if (res != FR_OK && fresh) f_unlink(name);
+
+	return res;
+}
+
+/* Number and run of a ring sector; a sector that is not valid has number
+0. */
+static FRESULT ReadKey (RINGFILE *r, DWORD pos, DWORD *seq, WORD *run)
+{
+	const LOGRINGSEC *sh = (const LOGRINGSEC *)r->buf[0];
+
+	if (disk_read(r->drv, r->buf[0], r->base + pos, 1) != RES_OK) return FR_DISK_ERR;
+
+	*seq = LOGRING_Valid(r->buf[0], &r->hdr) ? sh->seq : 0;
+	*run = sh->run;
+	return FR_OK;
+}
+
+/* Finds the sector after the newest one. The sectors from there to the end
+of the ring are the older lap and hold numbers up to the one of the last
+sector; those before it are newer. A sector that is not valid counts as
+0: never written, or torn by a power loss at the head. So the head is the
+first sector numbered at most as the last one, found with a binary search,
+and the writer goes on after the newest sector in a new run. */
+static FRESULT FindHead (RINGFILE *r)
+{
+	FRESULT res;
+	DWORD lo = 0, hi = RING_SECTORS - 1, mid, last, seq;
+	WORD run;
+
+	res = ReadKey(r, RING_SECTORS - 1, &last, &run);
+	while (res == FR_OK && lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		res = ReadKey(r, mid, &seq, &run);
+		if (seq <= last) hi = mid;
+		else lo = mid + 1;
+	}
+	r->head = lo;
+	if (res == FR_OK) res = ReadKey(r, (r->head > 0) ? r->head - 1 : RING_SECTORS - 1, &seq, &run);
+	if (res != FR_OK) return res;
+
+	r->seq = seq + 1;
+	r->run = (seq != 0) ? run + 1 : 0;
+	return FR_OK;
+}
+
+/* Fills the header of the sector being filled, buf[count]. */
+static void SealSector (RINGFILE *r, UINT len)
+{
+	LOGRINGSEC *sh = (LOGRINGSEC *)r->buf[r->count];
+
+	sh->magic = LOGRING_SEC_MAGIC;
+	sh->len = len;
+	sh->seq = r->seq + r->count;
+	sh->run = r->run;
+	sh->first = r->first;
+	sh->nonce = (WORD)r->hdr.nonce;
+	sh->crc = LOGRING_Crc(r->buf[r->count]);
+}
+
+/* Writes the first n sectors of buf at the head, the full ones and maybe
+the partial one after them, and moves the head past the full ones. The
+runs end at the end of the ring, so they never wrap. */
+static FRESULT WriteRun (RINGFILE *r, UINT n)
+{
+	FRESULT res = FR_OK;
+
+	if (n && disk_write(r->drv, r->buf[0], r->base + r->head, n) != RES_OK)
+	{
+		res = FR_DISK_ERR;
+		Dropped += r->count;
+	}
+
+	r->head = (r->head + r->count) % RING_SECTORS;
+	r->seq += r->count;
+	if (r->count && r->fill) memcpy(r->buf[0], r->buf[r->count], RING_SS);
+	r->count = 0;
+	return res;
+}
+
+/* Copies bytes into the sectors of the run, sealing each one as it fills
+and writing the run when it is complete or reaches the end of the ring. */
+static FRESULT AddBytes (RINGFILE *r, const BYTE *p, UINT len)
+{
+	FRESULT res = FR_OK, res2;
+	UINT n;
+
+	while (len)
+	{
+		n = LOGRING_PAYLOAD - r->fill;
+		if (n > len) n = len;
+		memcpy(&r->buf[r->count][sizeof(LOGRINGSEC) + r->fill], p, n);
+		r->fill += n;
+		p += n;
+		len -= n;
+
+		if (r->fill == LOGRING_PAYLOAD)
+		{
+			SealSector(r, r->fill);
+			r->count++;
+			r->fill = 0;
+			r->first = LOGRING_NONE;
+			if (r->count == RINGLOG_RUN || r->head + r->count == RING_SECTORS)
+			{
+				res2 = WriteRun(r, r->count);
+				if (res == FR_OK) res = res2;
+			}
+		}
+	}
+	r->dirty = true;
+	return res;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,238 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file timestamp.c
+ * @date Oct 18, 2026
+ *
+ * @brief RTC based wall clock and high resolution timestamps.
+ *
+ * See timestamp.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include "stdbool.h"
+
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_timer.h"
+#include "lpc17xx_rtc.h"
+
+#include "ff.h"
+
+#include "timestamp.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define TS_TIMER_PCLK		CLKPWR_PCLKSEL_TIMER3	/* Must match TS_TIMER */
+
+#define TS_NS_SHIFT			24						/* Fraction bits of NsScale */
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagTSBASE
+{
+	uint32_t sec;			/* RTC time of the last second tick */
+	uint32_t ticks;			/* TS_TIMER count at that tick */
+} TSBASE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static volatile TSBASE Base[2];							/* Written alternately by the RTC interrupt */
+static volatile uint8_t BaseIdx;						/* Entry of Base[] in use */
+static volatile DWORD FatTime;							/* get_fattime() value of the current second */
+static uint32_t TickHz;									/* TS_TIMER clock */
+static uint32_t NsScale;								/* Nanoseconds per tick << TS_NS_SHIFT */
+
+/* Days before the first day of each month, in a common year. */
+static const uint16_t MonthDays[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static bool TimeValid (const RTC_TIME_Type *t);
+static uint32_t ToSeconds (const RTC_TIME_Type *t);
+static void Latch (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Starts the RTC, the sub-second timer and the second interrupt.
+  *
+  * The RTC keeps running from the backup battery across resets; it is only
+  * initialized (to TS_DEFAULT_xxx) when it is stopped or holds garbage.
+  * The sub-second part is exact from the first RTC tick after this call.
+  *
+  * @param  None
+  * @retval None
+  */
+void TS_Init (void)
+{
+	TIM_TIMERCFG_Type cfg;
+	RTC_TIME_Type t;
+
+	NVIC_DisableIRQ(RTC_IRQn);
+
+	CLKPWR_ConfigPPWR(CLKPWR_PCONP_PCRTC, ENABLE);
+	RTC_GetFullTime(LPC_RTC, &t);
+	if (!(LPC_RTC->CCR & RTC_CCR_CLKEN) || !TimeValid(&t))
+	{
+		RTC_Init(LPC_RTC);
+		t.YEAR = TS_DEFAULT_YEAR;
+		t.MONTH = TS_DEFAULT_MONTH;
+		t.DOM = TS_DEFAULT_DOM;
+		t.DOW = t.DOY = 0;
+		t.HOUR = t.MIN = t.SEC = 0;
+		RTC_SetFullTime(LPC_RTC, &t);
+		RTC_Cmd(LPC_RTC, ENABLE);
+	}
+
+	/* Free running at CCLK, no prescaler and no match. */
+	cfg.PrescaleOption = TIM_PRESCALE_TICKVAL;
+	cfg.PrescaleValue = 1;
+	TIM_Init(TS_TIMER, TIM_TIMER_MODE, &cfg);
+	CLKPWR_SetPCLKDiv(TS_TIMER_PCLK, CLKPWR_PCLKSEL_CCLK_DIV_1);	/* TIM_Init() sets CCLK/4 */
+	TickHz = CLKPWR_GetPCLK(TS_TIMER_PCLK);
+	NsScale = (uint32_t)((1000000000ULL << TS_NS_SHIFT) / TickHz);
+	TIM_Cmd(TS_TIMER, ENABLE);
+
+	Latch();
+
+	RTC_CntIncrIntConfig(LPC_RTC, RTC_TIMETYPE_SECOND, ENABLE);
+	RTC_ClearIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE);
+	NVIC_SetPriority(RTC_IRQn, 0);
+	NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/**
+  * @brief  Sets the RTC and restarts the second at this instant.
+  *
+  * @param  time: New time. YEAR, MONTH, DOM, HOUR, MIN and SEC are used.
+  * @retval None
+  */
+void TS_SetTime (RTC_TIME_Type *time)
+{
+	NVIC_DisableIRQ(RTC_IRQn);
+
+	LPC_RTC->CCR |= RTC_CCR_CTCRST;			/* Hold the sub-second divider in reset */
+	RTC_SetFullTime(LPC_RTC, time);
+	Latch();
+	LPC_RTC->CCR &= ~RTC_CCR_CTCRST & RTC_CCR_BITMASK;
+
+	RTC_ClearIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE);
+	NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/**
+  * @brief  Reads the current time with the resolution of TS_TIMER.
+  *
+  * Lock free; safe in any interrupt and at any priority.
+  *
+  * @param  ts: Receives the timestamp.
+  * @retval None
+  */
+void TS_Now (TSTAMP *ts)
+{
+	const volatile TSBASE *b = &Base[BaseIdx];
+	uint32_t sec = b->sec;
+	uint32_t ticks = TS_TIMER->TC - b->ticks;
+
+	/* The second tick is pending, or the caller preempted the RTC
+	interrupt after the read of BaseIdx. */
+	if (ticks >= TickHz)
+	{
+		sec += ticks / TickHz;
+		ticks %= TickHz;
+	}
+
+	ts->sec = sec;
+	ts->nsec = (uint32_t)(((uint64_t)ticks * NsScale) >> TS_NS_SHIFT);
+}
+
+/**
+  * @brief  Current time with a resolution of one second.
+  *
+  * @param  None
+  * @retval Seconds since TS_EPOCH_YEAR.
+  */
+uint32_t TS_Seconds (void)
+{
+	return Base[BaseIdx].sec;
+}
+
+#if !_FS_NORTC
+/**
+  * @brief  FatFs timestamp callback, cached by the RTC interrupt.
+  *
+  * @param  None
+  * @retval Packed FAT date and time.
+  */
+DWORD get_fattime (void)
+{
+	return FatTime;
+}
+#endif
+
+/**
+  * @brief  RTC interrupt: one per second.
+  *
+  * @param  None
+  * @retval None
+  */
+void RTC_IRQHandler (void)
+{
+	if (RTC_GetIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE))
+	{
+		Latch();
+		RTC_ClearIntPending(LPC_RTC, RTC_INT_COUNTER_INCREASE);
+	}
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static bool TimeValid (const RTC_TIME_Type *t)
+{
+	return t->YEAR >= TS_EPOCH_YEAR && t->YEAR < 2100 && t->MONTH >= 1 && t->MONTH <= 12
+		&& t->DOM >= 1 && t->DOM <= 31 && t->HOUR < 24 && t->MIN < 60 && t->SEC < 60;
+}
+
+/* Seconds since TS_EPOCH_YEAR; every fourth year is a leap year until 2100. */
+static uint32_t ToSeconds (const RTC_TIME_Type *t)
+{
+	uint32_t y = t->YEAR - TS_EPOCH_YEAR;
+	uint32_t days;
+
+	days = y * 365 + (y + 3) / 4 + MonthDays[t->MONTH - 1] + t->DOM - 1;
+	if ((y % 4) == 0 && t->MONTH > 2) days++;
+
+	return ((days * 24 + t->HOUR) * 60 + t->MIN) * 60 + t->SEC;
+}
+
+/* Captures the timer at the second tick, then the calendar, and publishes
+both in the Base[] entry not in use. */
+static void Latch (void)
+{
+	uint32_t ticks = TS_TIMER->TC;
+	uint8_t idx = BaseIdx ^ 1;
+	RTC_TIME_Type t;
+
+	RTC_GetFullTime(LPC_RTC, &t);
+	if (!TimeValid(&t)) return;
+
+	Base[idx].sec = ToSeconds(&t);
+	Base[idx].ticks = ticks;
+	BaseIdx = idx;
+
+	FatTime = (DWORD)(t.YEAR - 1980) << 25 | (DWORD)t.MONTH << 21 | (DWORD)t.DOM << 16
+		| (DWORD)t.HOUR << 11 | (DWORD)t.MIN << 5 | (DWORD)t.SEC >> 1;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
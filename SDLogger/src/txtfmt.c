@@ -0,0 +1,415 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file txtfmt.c
+ * @date Oct 18, 2026
+ *
+ * @brief Integer only printf style formatter writing to memory.
+ *
+ * See txtfmt.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "txtfmt.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define FL_LEFT				0x01			/* '-': pad on the right */
+#define FL_ZERO				0x02			/* '0': pad with zeros after the sign */
+
+#define NO_PREC				0xFFFFFFFFUL
+#define FLOAT_PREC			6				/* Decimals of %f without a precision */
+#define FLOAT_MAX_PREC		9				/* The decimals fit in 32 bits */
+#define TMP_SIZE			32				/* 20 integer digits, '.' and 9 decimals */
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static const char Pairs[200] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+#if TXTFMT_FLOAT
+static const uint32_t Pow10[FLOAT_MAX_PREC + 1] =
+{
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/* 10^n = 5^n * 2^n: the scale of the decimals is a multiply and a shift. */
+static const uint32_t Pow5[FLOAT_MAX_PREC + 1] =
+{
+	1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125
+};
+#endif
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static char *PutDec (char *end, unsigned long v);
+static char *PutDec64 (char *end, unsigned long long v);
+static char *PutHex (char *end, unsigned long long v, const char *digits);
+#if TXTFMT_FLOAT
+static char *PutFloat (char *end, double x, uint32_t prec, char *sign);
+#endif
+static char *Copy (char *d, const char *end, const char *src, uint32_t n);
+static char *CopyText (char *d, const char *end, const char *src, uint32_t n);
+static char *Fill (char *d, const char *end, char c, uint32_t n);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Formats into a buffer, as snprintf() with the conversions of
+  *         txtfmt.h. No terminator is written.
+  *
+  * @param  dst: Output buffer.
+  * @param  cap: Size of the output buffer; the output is cut there.
+  * @param  fmt: Format string.
+  * @retval Bytes written.
+  */
+uint32_t TXT_Format (char *dst, uint32_t cap, const char *fmt, ...)
+{
+	va_list ap;
+	uint32_t n;
+
+	va_start(ap, fmt);
+	n = TXT_VFormat(dst, cap, fmt, ap);
+	va_end(ap);
+	return n;
+}
+
+/**
+  * @brief  TXT_Format() with a variable argument list.
+  *
+  * @param  dst: Output buffer.
+  * @param  cap: Size of the output buffer.
+  * @param  fmt: Format string.
+  * @param  ap:  Arguments.
+  * @retval Bytes written.
+  */
+uint32_t TXT_VFormat (char *dst, uint32_t cap, const char *fmt, va_list ap)
+{
+	char *d = dst, *end = dst + cap;
+	char tmp[TMP_SIZE], *s;
+	const char *p;
+	char sign, conv;
+	uint32_t flags, width, prec, size, n, pad;
+	long sl;
+	long long sll;
+	unsigned long ul;
+	unsigned long long ull;
+
+	for (;;)
+	{
+		/* Literal text up to the next conversion or line end. */
+		for (p = fmt; *p != 0 && *p != '%' && !(TXTFMT_CRLF && *p == '\n'); p++);
+		d = Copy(d, end, fmt, p - fmt);
+		fmt = p;
+		if (*fmt == 0) break;
+		fmt++;
+		if (fmt[-1] == '\n')
+		{
+			d = Copy(d, end, "\r\n", 2);
+			continue;
+		}
+
+		flags = 0;
+		for (;; fmt++)
+		{
+			if (*fmt == '-') flags |= FL_LEFT;
+			else if (*fmt == '0') flags |= FL_ZERO;
+			else break;
+		}
+
+		width = 0;
+		if (*fmt == '*')
+		{
+			sl = va_arg(ap, int);
+			if (sl < 0)
+			{
+				flags |= FL_LEFT;
+				sl = -sl;
+			}
+			width = sl;
+			fmt++;
+		}
+		for (; *fmt >= '0' && *fmt <= '9'; fmt++) width = width * 10 + (*fmt - '0');
+
+		prec = NO_PREC;
+		if (*fmt == '.')
+		{
+			fmt++;
+			prec = 0;
+			if (*fmt == '*')
+			{
+				sl = va_arg(ap, int);
+				prec = (sl < 0) ? NO_PREC : (uint32_t)sl;
+				fmt++;
+			}
+			for (; *fmt >= '0' && *fmt <= '9'; fmt++) prec = prec * 10 + (*fmt - '0');
+		}
+
+		for (size = 0; *fmt == 'l'; fmt++) size++;
+
+		conv = *fmt;
+		if (conv == 0) break;
+		fmt++;
+
+		s = tmp + TMP_SIZE;
+		sign = 0;
+		switch (conv)
+		{
+		case 'd':
+		case 'i':
+			if (size >= 2)
+			{
+				sll = va_arg(ap, long long);
+				if (sll < 0) sign = '-';
+				s = PutDec64(s, (sll < 0) ? 0ULL - (unsigned long long)sll : (unsigned long long)sll);
+			}
+			else
+			{
+				sl = size ? va_arg(ap, long) : va_arg(ap, int);
+				if (sl < 0) sign = '-';
+				s = PutDec(s, (sl < 0) ? 0UL - (unsigned long)sl : (unsigned long)sl);
+			}
+			break;
+
+		case 'u':
+			if (size >= 2) s = PutDec64(s, va_arg(ap, unsigned long long));
+			else s = PutDec(s, size ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int));
+			break;
+
+		case 'x':
+		case 'X':
+			if (size >= 2) ull = va_arg(ap, unsigned long long);
+			else ull = size ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+			s = PutHex(s, ull, (conv == 'x') ? "0123456789abcdef" : "0123456789ABCDEF");
+			break;
+
+#if TXTFMT_FLOAT
+		case 'f':
+			if (prec == NO_PREC) prec = FLOAT_PREC;
+			if (prec > FLOAT_MAX_PREC) prec = FLOAT_MAX_PREC;
+			s = PutFloat(s, va_arg(ap, double), prec, &sign);
+			break;
+#endif
+
+		case 'c':
+			*--s = (char)va_arg(ap, int);
+			break;
+
+		case 's':
+			s = va_arg(ap, char *);
+			if (s == NULL) s = "(null)";
+			break;
+
+		default:							/* '%' and unknown conversions are written as is */
+			*--s = conv;
+			break;
+		}
+
+		if (conv == 's')
+		{
+			for (n = 0; n < prec && s[n] != 0; n++);
+		}
+		else
+		{
+			n = tmp + TMP_SIZE - s;
+		}
+		ul = n + (sign != 0);
+		pad = (width > ul) ? width - ul : 0;
+
+		if (!(flags & (FL_LEFT | FL_ZERO))) d = Fill(d, end, ' ', pad);
+		if (sign) d = Copy(d, end, &sign, 1);
+		if (!(flags & FL_LEFT) && (flags & FL_ZERO)) d = Fill(d, end, '0', pad);
+		d = (conv == 's' || conv == 'c') ? CopyText(d, end, s, n) : Copy(d, end, s, n);
+		if (flags & FL_LEFT) d = Fill(d, end, ' ', pad);
+	}
+	return d - dst;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Writes the decimal digits of v backwards from end, two per division;
+the division by a constant is a multiplication on the Cortex-M3. */
+static char *PutDec (char *end, unsigned long v)
+{
+	unsigned long q;
+
+	while (v >= 100)
+	{
+		q = v / 100;
+		end -= 2;
+		memcpy(end, &Pairs[(v - q * 100) * 2], 2);
+		v = q;
+	}
+	if (v >= 10)
+	{
+		end -= 2;
+		memcpy(end, &Pairs[v * 2], 2);
+	}
+	else
+	{
+		*--end = '0' + v;
+	}
+	return end;
+}
+
+/* Same for 64 bits: groups of 9 digits are taken off with one 64-bit
+division each until the rest fits in a long. */
+static char *PutDec64 (char *end, unsigned long long v)
+{
+	char *s;
+
+	while (v > (unsigned long)-1)
+	{
+		s = PutDec(end, (unsigned long)(v % 1000000000));
+		while (s > end - 9) *--s = '0';
+		end = s;
+		v /= 1000000000;
+	}
+	return PutDec(end, (unsigned long)v);
+}
+
+static char *PutHex (char *end, unsigned long long v, const char *digits)
+{
+	do
+	{
+		*--end = digits[v & 15];
+		v >>= 4;
+	} while (v);
+	return end;
+}
+
+#if TXTFMT_FLOAT
+/* Writes x with prec decimals. The IEEE-754 double is taken apart as
+mant * 2^exp, so the integer part is a shift of the mantissa and the
+decimals are f * 10^prec / 2^sh, rounded to nearest, computed exactly in
+two 32-bit halves: no floating point arithmetic at all. */
+static char *PutFloat (char *end, double x, uint32_t prec, char *sign)
+{
+	uint64_t bits, mant, f, hi, lo;
+	unsigned long long ip;
+	uint32_t frac, sh, k;
+	int32_t exp;
+	char *s;
+
+	memcpy(&bits, &x, sizeof(bits));
+	exp = (int32_t)(bits >> 52) & 0x7FF;
+	mant = bits & 0xFFFFFFFFFFFFFULL;
+	if (exp == 0x7FF)
+	{
+		end -= 3;
+		memcpy(end, mant ? "nan" : "inf", 3);
+		if (!mant && (bits >> 63)) *sign = '-';
+		return end;
+	}
+	if ((bits >> 63) && (exp || mant)) *sign = '-';
+	if (exp) mant |= 1ULL << 52;				/* Normal: the hidden bit */
+	else exp = 1;								/* Subnormal */
+	exp -= 1075;								/* x = mant * 2^exp */
+
+	if (exp > 11)
+	{
+		end -= 3;								/* 2^64 and beyond */
+		memcpy(end, "inf", 3);
+		return end;
+	}
+	if (exp >= 0)
+	{
+		ip = mant << exp;
+		f = 0;
+		sh = 0;
+	}
+	else if ((sh = (uint32_t)-exp) <= 52)
+	{
+		ip = mant >> sh;
+		f = mant & ((1ULL << sh) - 1);
+	}
+	else
+	{
+		ip = 0;
+		f = (sh <= 84) ? mant : 0;				/* Under 2^-32 the decimals round to 0 */
+	}
+
+	/* frac = round(f * 5^prec / 2^k), k = sh - prec; f * 5^prec < 2^75 is
+	held as hi * 2^32 + lo. The result is under 10^prec, so it fits. */
+	frac = 0;
+	if (f)
+	{
+		hi = (f >> 32) * Pow5[prec];
+		lo = (f & 0xFFFFFFFFUL) * Pow5[prec];
+		hi += lo >> 32;
+		lo &= 0xFFFFFFFFUL;
+		if (sh <= prec) frac = (uint32_t)((hi << 32 | lo) << (prec - sh));
+		else
+		{
+			k = sh - prec;
+			if (k <= 32) lo += 1ULL << (k - 1);
+			else hi += 1ULL << (k - 33);
+			hi += lo >> 32;
+			lo &= 0xFFFFFFFFUL;
+			if (k < 32) frac = (uint32_t)(hi << (32 - k) | lo >> k);
+			else frac = (uint32_t)(hi >> (k - 32));
+		}
+	}
+	if (frac >= Pow10[prec])
+	{
+		frac -= Pow10[prec];
+		ip++;
+	}
+	if (prec)
+	{
+		s = PutDec(end, frac);
+		while (s > end - prec) *--s = '0';
+		end = s;
+		*--end = '.';
+	}
+	return PutDec64(end, ip);
+}
+#endif
+
+/* Copies as much as fits. */
+static char *Copy (char *d, const char *end, const char *src, uint32_t n)
+{
+	if (n > (uint32_t)(end - d)) n = end - d;
+	memcpy(d, src, n);
+	return d + n;
+}
+
+/* Copies text, with the line ends converted. */
+static char *CopyText (char *d, const char *end, const char *src, uint32_t n)
+{
+#if TXTFMT_CRLF
+	const char *nl;
+	uint32_t k;
+
+	while (n && (nl = memchr(src, '\n', n)) != NULL)
+	{
+		k = nl - src;
+		d = Copy(d, end, src, k);
+		d = Copy(d, end, "\r\n", 2);
+		src += k + 1;
+		n -= k + 1;
+	}
+#endif
+	return Copy(d, end, src, n);
+}
+
+static char *Fill (char *d, const char *end, char c, uint32_t n)
+{
+	if (n > (uint32_t)(end - d)) n = end - d;
+	memset(d, c, n);
+	return d + n;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,245 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file txtlog.c
+ * @date Oct 18, 2026
+ *
+ * @brief Human readable text log.
+ *
+ * See txtlog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "stdbool.h"
+
+#include "timestamp.h"
+#include "txtfmt.h"
+
+#include "txtlog.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define TXT_SS				_MAX_SS
+#define STAMP_DATE			20				/* "YYYY-MM-DD hh:mm:ss." */
+#define STAMP_LEN			24				/* Date, milliseconds and a space */
+
+#if TXTLOG_LINE_MAX <= STAMP_LEN
+#error TXTLOG_LINE_MAX must leave room after the time stamp.
+#endif
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static FIL Fil;
+static BYTE Buf[TXT_SS + TXTLOG_LINE_MAX];		/* Last sector of the file and room for a line */
+static UINT Fill;								/* Bytes in Buf */
+static FSIZE_t Pos;								/* File offset of Buf, sector aligned */
+static uint32_t FlushTime;						/* TS_Seconds() at the last flush */
+static bool Dirty;								/* Text added since the last flush */
+static bool Open;
+
+#if TXTLOG_STAMP
+static char Stamp[STAMP_DATE];					/* Date and time of StampSec */
+static uint32_t StampSec = 0xFFFFFFFF;
+
+/* Days of each month, in a common year. */
+static const uint8_t MonthLen[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+#endif
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static FRESULT WriteSector (void);
+static FRESULT WritePartial (void);
+#if TXTLOG_STAMP
+static void PutStamp (char *d);
+#endif
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Opens the text log for appending.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT TXTLOG_Init (void)
+{
+	FRESULT res;
+	UINT br;
+
+	res = f_open(&Fil, TXTLOG_FILE, FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
+	if (res != FR_OK) return res;
+
+	/* The partial last sector is taken back into the buffer, so the file
+	is only ever written in whole, aligned sectors. */
+	Pos = f_size(&Fil) & ~(FSIZE_t)(TXT_SS - 1);
+	Fill = f_size(&Fil) - Pos;
+	res = f_lseek(&Fil, Pos);
+	if (res == FR_OK && Fill)
+	{
+		res = f_read(&Fil, Buf, Fill, &br);
+		if (res == FR_OK && br != Fill) res = FR_INT_ERR;
+		if (res == FR_OK) res = f_lseek(&Fil, Pos);
+	}
+	if (res != FR_OK)
+	{
+		f_close(&Fil);
+		return res;
+	}
+
+	FlushTime = TS_Seconds();
+	Dirty = false;
+	Open = true;
+	return FR_OK;
+}
+
+/**
+  * @brief  Appends formatted text (see txtfmt.h), after the time stamp.
+  *
+  * @param  fmt: Format string; the output is cut at TXTLOG_LINE_MAX bytes.
+  * @retval FR_OK, FR_NOT_READY before TXTLOG_Init() or the error of a
+  *         sector write (the sector is dropped).
+  */
+FRESULT TXTLOG_Printf (const char *fmt, ...)
+{
+	va_list ap;
+	char *d = (char *)&Buf[Fill];
+	UINT n = 0;
+
+	if (!Open) return FR_NOT_READY;
+
+#if TXTLOG_STAMP
+	PutStamp(d);
+	n = STAMP_LEN;
+#endif
+	va_start(ap, fmt);
+	n += TXT_VFormat(d + n, TXTLOG_LINE_MAX - n, fmt, ap);
+	va_end(ap);
+
+	Fill += n;
+	Dirty = true;
+
+	return (Fill >= TXT_SS) ? WriteSector() : FR_OK;
+}
+
+/**
+  * @brief  Flushes the text every TXTLOG_FLUSH_SECONDS. Call it from the
+  *         main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT TXTLOG_Task (void)
+{
+	if (!Open || !Dirty || TS_Seconds() - FlushTime < TXTLOG_FLUSH_SECONDS) return FR_OK;
+
+	return TXTLOG_Flush();
+}
+
+/**
+  * @brief  Writes the partial sector in place and syncs the file.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT TXTLOG_Flush (void)
+{
+	FlushTime = TS_Seconds();
+	if (!Open || !Dirty) return FR_OK;
+
+	Dirty = false;
+	return WritePartial();
+}
+
+/**
+  * @brief  Flushes and closes the text log.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT TXTLOG_Close (void)
+{
+	FRESULT res;
+
+	if (!Open) return FR_OK;
+
+	res = TXTLOG_Flush();
+	if (res == FR_OK) res = f_close(&Fil);
+	else f_close(&Fil);
+	Open = false;
+	return res;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Writes the full sector at the front of Buf and moves the rest down. The
+file pointer is at Pos and stays sector aligned, also when the write fails
+and the sector is lost. */
+static FRESULT WriteSector (void)
+{
+	FRESULT res;
+	UINT bw;
+
+	res = f_write(&Fil, Buf, TXT_SS, &bw);
+	if (res == FR_OK && bw != TXT_SS) res = FR_DENIED;	/* Volume full */
+
+	if (res == FR_OK) Pos += TXT_SS;
+	else f_lseek(&Fil, Pos);
+
+	Fill -= TXT_SS;
+	memmove(Buf, &Buf[TXT_SS], Fill);
+	return res;
+}
+
+/* Writes the partial sector and syncs, then goes back to its start, where
+the next full sector is written over it. */
+static FRESULT WritePartial (void)
+{
+	FRESULT res = FR_OK;
+	UINT bw;
+
+	if (Fill)
+	{
+		res = f_write(&Fil, Buf, Fill, &bw);
+		if (res == FR_OK && bw != Fill) res = FR_DENIED;
+	}
+	if (res == FR_OK) res = f_sync(&Fil);
+	if (Fill) f_lseek(&Fil, Pos);
+	return res;
+}
+
+#if TXTLOG_STAMP
+/* Writes "YYYY-MM-DD hh:mm:ss.mmm ". The date is only worked out again
+when the second changes. */
+static void PutStamp (char *d)
+{
+	TSTAMP ts;
+	uint32_t days, y, m, n, ms;
+
+	TS_Now(&ts);
+	if (ts.sec != StampSec)
+	{
+		StampSec = ts.sec;
+		days = ts.sec / 86400;
+		for (y = TS_EPOCH_YEAR; days >= (n = (y % 4) ? 365 : 366); y++) days -= n;
+		for (m = 0; days >= (n = MonthLen[m] + (m == 1 && !(y % 4))); m++) days -= n;
+		TXT_Format(Stamp, STAMP_DATE, "%04u-%02u-%02u %02u:%02u:%02u.", y, m + 1, days + 1,
+				ts.sec / 3600 % 24, ts.sec / 60 % 60, ts.sec % 60);
+	}
+
+	ms = ts.nsec / 1000000;
+	memcpy(d, Stamp, STAMP_DATE);
+	d[STAMP_DATE] = '0' + ms / 100;
+	d[STAMP_DATE + 1] = '0' + ms / 10 % 10;
+	d[STAMP_DATE + 2] = '0' + ms % 10;
+	d[STAMP_DATE + 3] = ' ';
+}
+#endif
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,359 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file uartlog.c
+ * @date Oct 18, 2026
+ *
+ * @brief Serial line sniffer on UART2 (RXD2 on P0.11).
+ *
+ * See uartlog.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <cr_section_macros.h>
+#include <string.h>
+#include "stdbool.h"
+
+#include "lpc17xx_uart.h"
+#include "lpc17xx_gpdma.h"
+#include "lpc17xx_pinsel.h"
+
+#include "config.h"
+#include "dma.h"
+#include "timestamp.h"
+#include "logger.h"
+
+#include "uartlog.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SNIFF_UART			LPC_UART2
+#define SNIFF_IRQn			UART2_IRQn
+#define SNIFF_DMA			((LPC_GPDMACH_TypeDef *)(LPC_GPDMACH0_BASE + 0x20 * DMA_CH_UART))
+
+#define SEG_SIZE			(UARTLOG_BUF / UARTLOG_SEGS)
+#define BUF_MASK			(UARTLOG_BUF - 1)
+#define CHUNK_MASK			(UARTLOG_CHUNKS - 1)
+
+/* Bursts of 4 bytes at a trigger level of 8: the DMA leaves 4 to 7 bytes
+in the FIFO, so the end of every message raises the character timeout. A
+burst of the whole trigger level empties the FIFO after one message in
+eight, and an empty FIFO never times out. */
+#define SEG_CONTROL			(GPDMA_DMACCxControl_TransferSize(SEG_SIZE) \
+							| GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_4) | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_4) \
+							| GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_BYTE) | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_BYTE) \
+							| GPDMA_DMACCxControl_DI | GPDMA_DMACCxControl_I)
+
+#if (UARTLOG_BUF & BUF_MASK) || (UARTLOG_CHUNKS & CHUNK_MASK)
+#error UARTLOG_BUF and UARTLOG_CHUNKS must be powers of 2.
+#endif
+#if SEG_SIZE > 4095 || (UARTLOG_BUF % UARTLOG_SEGS)
+#error Bad UARTLOG_SEGS for UARTLOG_BUF.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagUARTCHUNK
+{
+	uint32_t end;			/* Stream position after the last byte */
+	TSTAMP   ts;			/* Time the chunk was closed */
+	uint8_t  flags;			/* LOGREC_UART_FL_xxx */
+} UARTCHUNK;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+__BSS(RAM2) static uint8_t Buf[UARTLOG_BUF];
+static GPDMA_LLI_Type Lli[UARTLOG_SEGS];
+
+static UARTCHUNK Chunk[UARTLOG_CHUNKS];
+static volatile uint8_t ChunkHead;						/* Written by the interrupts */
+static uint8_t ChunkTail;								/* Written by UARTLOG_Task() */
+static volatile uint32_t Head;							/* Stream position of the last chunk end */
+static uint32_t Tail;									/* Stream position logged so far */
+static uint8_t Out[SEG_SIZE];							/* Piece being logged */
+static volatile uint8_t LineErr;						/* LOGREC_UART_FL_ERROR for the next chunk */
+static volatile uint32_t Lost;							/* Receive overruns and overwritten chunks */
+static uint32_t LostLogged;
+
+static uint32_t Baud;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static void DmaHandler (bool error);
+static void Drain (void);
+static void CloseChunk (uint8_t flags);
+static bool Overwritten (uint32_t end);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Reads the line rate and starts the sniffer.
+  *
+  * @param  None
+  * @retval FR_OK (also when the sniffer is off), FR_NO_FILE without
+  *         configuration file, or the logger error.
+  */
+FRESULT UARTLOG_Init (void)
+{
+	FRESULT res;
+	PINSEL_CFG_Type PinCfg;
+	UART_CFG_Type UartCfg;
+	UART_FIFO_CFG_Type FifoCfg;
+	GPDMA_Channel_CFG_Type DmaCfg;
+	LOGUARTCFG rec;
+	int i;
+
+	Baud = 0;
+	res = CFG_Parse(ConfigHandler);
+	if (res != FR_OK || Baud == 0) return res;
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_PULLUP;
+	PinCfg.Portnum = 0;
+	PinCfg.Pinnum = 11;
+	PinCfg.Funcnum = 1;
+	PINSEL_ConfigPin(&PinCfg);
+
+	UART_ConfigStructInit(&UartCfg);
+	UartCfg.Baud_rate = Baud;
+	UART_Init(SNIFF_UART, &UartCfg);
+
+	FifoCfg.FIFO_ResetRxBuf = ENABLE;
+	FifoCfg.FIFO_ResetTxBuf = ENABLE;
+	FifoCfg.FIFO_DMAMode = ENABLE;
+	FifoCfg.FIFO_Level = UART_FIFO_TRGLEV2;		/* 8 characters, see SEG_CONTROL */
+	UART_FIFOConfig(SNIFF_UART, &FifoCfg);
+
+	for (i = 0; i < UARTLOG_SEGS; i++)
+	{
+		Lli[i].SrcAddr = (uint32_t)&SNIFF_UART->RBR;
+		Lli[i].DstAddr = (uint32_t)&Buf[i * SEG_SIZE];
+		Lli[i].NextLLI = (uint32_t)&Lli[(i + 1) % UARTLOG_SEGS];
+		Lli[i].Control = SEG_CONTROL;
+	}
+
+	ChunkHead = ChunkTail = 0;
+	Head = Tail = 0;
+	LineErr = 0;
+	Lost = LostLogged = 0;
+
+	rec.baud = Baud;
+	rec.format = 0;
+	res = LOG_Record(LOGREC_CH_UART, LOGREC_UART_FL_CONFIG, NULL, &rec, sizeof(rec));
+	if (res != FR_OK) return res;
+
+	DMA_Init();
+	DMA_Attach(DMA_CH_UART, DmaHandler);
+	DmaCfg.ChannelNum = DMA_CH_UART;
+	DmaCfg.TransferSize = SEG_SIZE;
+	DmaCfg.TransferWidth = 0;
+	DmaCfg.SrcMemAddr = 0;
+	DmaCfg.DstMemAddr = (uint32_t)Buf;
+	DmaCfg.TransferType = GPDMA_TRANSFERTYPE_P2M;
+	DmaCfg.SrcConn = GPDMA_CONN_UART2_Rx;
+	DmaCfg.DstConn = 0;
+	DmaCfg.DMALLI = (uint32_t)&Lli[1 % UARTLOG_SEGS];
+	if (GPDMA_Setup(&DmaCfg) != SUCCESS) return FR_INT_ERR;
+	SNIFF_DMA->DMACCControl = SEG_CONTROL;		/* GPDMA_Setup() uses single transfers */
+	GPDMA_ChannelCmd(DMA_CH_UART, ENABLE);
+
+	UART_IntConfig(SNIFF_UART, UART_INTCFG_RBR, ENABLE);	/* Character timeout */
+	UART_IntConfig(SNIFF_UART, UART_INTCFG_RLS, ENABLE);
+	NVIC_SetPriority(SNIFF_IRQn, 1);			/* Same as DMA_IRQn: they never preempt each other */
+	NVIC_EnableIRQ(SNIFF_IRQn);
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Logs the closed chunks. Call it from the main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the logger error.
+  */
+FRESULT UARTLOG_Task (void)
+{
+	FRESULT res = FR_OK;
+	UARTCHUNK *c;
+	uint32_t end, ofs, len;
+	BYTE flags;
+
+	while (res == FR_OK && ChunkTail != ChunkHead)
+	{
+		c = &Chunk[ChunkTail];
+		end = c->end;
+
+		/* In pieces of up to a segment, copied out of the ring first: the
+		DMA goes on while LOG_Record() waits for the card. */
+		while (res == FR_OK && Tail != end)
+		{
+			if (Overwritten(end)) continue;
+
+			ofs = Tail & BUF_MASK;
+			len = end - Tail;
+			if (len > SEG_SIZE) len = SEG_SIZE;
+			if (ofs + len > UARTLOG_BUF) len = UARTLOG_BUF - ofs;
+			memcpy(Out, &Buf[ofs], len);
+			if (Overwritten(end)) continue;			/* During the copy */
+
+			/* Only the last piece ends the message. */
+			flags = c->flags;
+			if (Tail + len != end) flags &= ~LOGREC_UART_FL_IDLE;
+			if (Lost != LostLogged)
+			{
+				LostLogged = Lost;
+				flags |= LOGREC_UART_FL_LOST;
+			}
+			res = LOG_Record(LOGREC_CH_UART, flags, &c->ts, Out, len);
+			Tail += len;
+		}
+		if (Tail == end) ChunkTail = (ChunkTail + 1) & CHUNK_MASK;
+	}
+	return res;
+}
+
+/**
+  * @brief  Receive overruns plus chunks overwritten before being logged.
+  *
+  * @param  None
+  * @retval Loss events since UARTLOG_Init().
+  */
+uint32_t UARTLOG_Lost (void)
+{
+	return Lost;
+}
+
+/**
+  * @brief  UART2 interrupt: character timeout and line errors.
+  *
+  * @param  None
+  * @retval None
+  */
+void UART2_IRQHandler (void)
+{
+	uint32_t id = UART_GetIntId(SNIFF_UART) & UART_IIR_INTID_MASK;
+	uint8_t lsr;
+
+	if (id == UART_IIR_INTID_RLS)
+	{
+		lsr = UART_GetLineStatus(SNIFF_UART);
+		if (lsr & UART_LSR_OE) Lost++;
+		if (lsr & (UART_LSR_PE | UART_LSR_FE | UART_LSR_BI)) LineErr = LOGREC_UART_FL_ERROR;
+	}
+	else if (id == UART_IIR_INTID_CTI)
+	{
+		Drain();
+		CloseChunk(LOGREC_UART_FL_IDLE);
+	}
+	/* UART_IIR_INTID_RDA: the DMA is taking care of it. */
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	if (strcmp(key, "uart") == 0) CFG_GetUint(&value, &Baud);
+}
+
+/* End of a segment. */
+static void DmaHandler (bool error)
+{
+	if (error) Lost++;
+	CloseChunk(0);
+}
+
+/* Moves the bytes under the trigger level from the FIFO to the buffer and
+resumes the DMA after them. */
+static void Drain (void)
+{
+	LPC_GPDMACH_TypeDef *dma = SNIFF_DMA;
+	GPDMA_LLI_Type *next;
+	uint8_t *dst;
+	uint32_t left;
+
+	dma->DMACCConfig |= GPDMA_DMACCxConfig_H;
+	while (dma->DMACCConfig & GPDMA_DMACCxConfig_A);
+	dma->DMACCConfig &= ~(GPDMA_DMACCxConfig_H | GPDMA_DMACCxConfig_E);
+
+	dst = (uint8_t *)dma->DMACCDestAddr;
+	left = dma->DMACCControl & 0xFFF;
+	next = (GPDMA_LLI_Type *)dma->DMACCLLI;
+
+	for (;;)
+	{
+		if (left == 0)
+		{
+			/* Continue in the next segment, as the DMA would. */
+			dst = (uint8_t *)next->DstAddr;
+			left = SEG_SIZE;
+			next = (GPDMA_LLI_Type *)next->NextLLI;
+		}
+		if (!(SNIFF_UART->LSR & UART_LSR_RDR)) break;
+		*dst++ = SNIFF_UART->RBR;
+		left--;
+	}
+
+	dma->DMACCSrcAddr = (uint32_t)&SNIFF_UART->RBR;
+	dma->DMACCDestAddr = (uint32_t)dst;
+	dma->DMACCLLI = (uint32_t)next;
+	dma->DMACCControl = (SEG_CONTROL & ~0xFFFUL) | left;
+	dma->DMACCConfig |= GPDMA_DMACCxConfig_E;
+}
+
+/* Queues a chunk that ends at the current DMA position. */
+static void CloseChunk (uint8_t flags)
+{
+	uint32_t ofs = SNIFF_DMA->DMACCDestAddr - (uint32_t)Buf;
+	uint32_t n = (ofs - Head) & BUF_MASK;
+	uint8_t head = ChunkHead;
+	UARTCHUNK *c;
+
+	if (n == 0) return;
+	Head += n;
+
+	if (((head + 1) & CHUNK_MASK) == ChunkTail)
+	{
+		/* Queue full: extend the newest chunk, which now ends here. */
+		c = &Chunk[(head - 1) & CHUNK_MASK];
+		c->end = Head;
+		c->flags = (c->flags & ~LOGREC_UART_FL_IDLE) | flags | LineErr;
+		TS_Now(&c->ts);
+	}
+	else
+	{
+		c = &Chunk[head];
+		c->end = Head;
+		c->flags = flags | LineErr;
+		TS_Now(&c->ts);
+		ChunkHead = (head + 1) & CHUNK_MASK;
+	}
+	LineErr = 0;
+}
+
+/* The DMA is never more than a segment past Head, the end of a segment
+closing a chunk: the bytes more than the ring less a segment behind Head
+may be overwritten already. Skips them, up to the end of the chunk, and
+counts the loss. */
+static bool Overwritten (uint32_t end)
+{
+	uint32_t safe = Head + SEG_SIZE - UARTLOG_BUF;
+
+	if ((int32_t)(safe - Tail) <= 0) return false;
+	Tail = ((int32_t)(end - safe) > 0) ? safe : end;
+	Lost++;
+	return true;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,161 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file volfmt.c
+ * @date Oct 18, 2026
+ *
+ * @brief Card formatting laid out on the allocation unit (AU) of the card.
+ *
+ * See volfmt.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "stdbool.h"
+
+#include "config.h"
+#include "volfmt.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define FORMAT_KEY			"format"
+#define IS_SPACE(c)			((c) == ' ' || (c) == '\t')
+
+#if !_USE_MKFS
+#error volfmt needs f_mkfs(): set _USE_MKFS in ffconf.h.
+#endif
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static char CfgBuf[VOL_CFG_MAX];				/* Configuration file across the format */
+static UINT CfgLen;
+static bool Format;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static FRESULT LoadConfig (void);
+static FRESULT StoreConfig (void);
+static bool IsFormatLine (const char *line, UINT len);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Formats the cards if the configuration file says "format = 1".
+  *
+  * @param  volumes: Number of volumes to format, from 0:.
+  * @retval FR_OK (also with nothing to do), FR_NOT_ENOUGH_CORE for a
+  *         configuration file larger than VOL_CFG_MAX (nothing formatted)
+  *         or the FatFs error.
+  */
+FRESULT VOL_Init (BYTE volumes)
+{
+	FRESULT res;
+	TCHAR path[3] = "0:";
+	BYTE v;
+
+	Format = false;
+	res = CFG_Parse(ConfigHandler);
+	if (res == FR_NO_FILE) return FR_OK;
+	if (res != FR_OK || !Format) return res;
+
+	res = LoadConfig();
+	if (res != FR_OK) return res;
+
+	/* The configuration file lives on volume 0. */
+	res = VOL_Format(path);
+	if (res == FR_OK) res = StoreConfig();
+
+	for (v = 1; v < volumes && res == FR_OK; v++)
+	{
+		path[0] = '0' + v;
+		res = VOL_Format(path);
+	}
+	return res;
+}
+
+/**
+  * @brief  Formats a volume, laid out on the AU of its card.
+  *
+  * @param  path: Logical drive ("0:", "1:").
+  * @retval FR_OK or the FatFs error.
+  */
+FRESULT VOL_Format (const TCHAR *path)
+{
+	FRESULT res;
+	UINT cluster;
+
+	for (cluster = VOL_CLUSTER;; cluster /= 2)
+	{
+		res = f_mkfs(path, 0, cluster);
+		if (res != FR_MKFS_ABORTED || cluster <= VOL_CLUSTER_MIN) break;
+	}
+	return res;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	uint32_t n;
+
+	if (strcmp(key, FORMAT_KEY) == 0 && CFG_GetUint(&value, &n)) Format = (n != 0);
+}
+
+static FRESULT LoadConfig (void)
+{
+	FRESULT res;
+	FIL fil;
+
+	res = f_open(&fil, CFG_FILENAME, FA_OPEN_EXISTING | FA_READ);
+	if (res != FR_OK) return res;
+
+	if (f_size(&fil) > sizeof(CfgBuf)) res = FR_NOT_ENOUGH_CORE;
+	else res = f_read(&fil, CfgBuf, sizeof(CfgBuf), &CfgLen);
+	f_close(&fil);
+
+	return res;
+}
+
+/* Writes the configuration file back, with the format request commented
+out. */
+static FRESULT StoreConfig (void)
+{
+	FRESULT res, res2;
+	FIL fil;
+	UINT start, i, bw;
+
+	res = f_open(&fil, CFG_FILENAME, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res != FR_OK) return res;
+
+	for (start = 0; start < CfgLen && res == FR_OK; start = i)
+	{
+		for (i = start; i < CfgLen && CfgBuf[i++] != '\n';) ;
+		if (IsFormatLine(&CfgBuf[start], i - start)) res = f_write(&fil, "# ", 2, &bw);
+		if (res == FR_OK) res = f_write(&fil, &CfgBuf[start], i - start, &bw);
+	}
+	res2 = f_close(&fil);
+
+	return (res != FR_OK) ? res : res2;
+}
+
+static bool IsFormatLine (const char *line, UINT len)
+{
+	UINT n = sizeof(FORMAT_KEY) - 1;
+
+	while (len && IS_SPACE(*line))
+	{
+		line++;
+		len--;
+	}
+	if (len <= n || memcmp(line, FORMAT_KEY, n) != 0) return false;
+	return IS_SPACE(line[n]) || line[n] == '=';
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,525 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file wavrec.c
+ * @date Oct 18, 2026
+ *
+ * @brief I2S stereo 16-bit recorder to WAV files.
+ *
+ * See wavrec.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#ifdef __USE_CMSIS
+#include "LPC17xx.h"
+#endif
+
+#include <cr_section_macros.h>
+#include <string.h>
+#include "stdbool.h"
+
+#include "lpc17xx_i2s.h"
+#include "lpc17xx_gpdma.h"
+#include "lpc17xx_pinsel.h"
+
+#include "config.h"
+#include "dma.h"
+#include "timestamp.h"
+
+#include "wavrec.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define WAV_HDR_SIZE		_MAX_SS					/* Samples start at the second sector */
+#define WAV_DATA_MAX		(WAVREC_FILE_SIZE - WAV_HDR_SIZE)
+#define WAV_CHANNELS		2
+#define WAV_BITS			16
+#define WAV_FRAME			(WAV_CHANNELS * WAV_BITS / 8)
+
+#define REC_DMA				((LPC_GPDMACH_TypeDef *)(LPC_GPDMACH0_BASE + 0x20 * DMA_CH_I2S))
+#define REC_FIFO_LEVEL		4						/* Words in the RX FIFO per DMA request */
+
+/* Bursts of 4 words, matching the FIFO request level. */
+#define BUF_CONTROL			(GPDMA_DMACCxControl_TransferSize(WAVREC_BUF / 4) \
+							| GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_4) | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_4) \
+							| GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_WORD) | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_WORD) \
+							| GPDMA_DMACCxControl_DI | GPDMA_DMACCxControl_I)
+
+#if (WAVREC_BUF % _MAX_SS) || (WAVREC_BUF / 4 > 4095)
+#error WAVREC_BUF must be a sector multiple within the DMA transfer size.
+#endif
+#if (WAVREC_FILE_SIZE % WAVREC_GROW) || (WAVREC_GROW % _MAX_SS)
+#error WAVREC_FILE_SIZE must be a multiple of WAVREC_GROW, and that of the sector.
+#endif
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef enum
+{
+	WAV_FREE = 0,
+	WAV_GROWING,			/* Open, preallocation in progress */
+	WAV_READY,				/* Preallocated, header written */
+	WAV_ACTIVE				/* Being recorded */
+} WAVSTATE;
+
+typedef struct tagWAVFILE
+{
+	FIL		fil;
+	DWORD	clmt[WAVREC_CLMT_SIZE];	/* Cluster link map, used by f_write() instead of the FAT */
+	DWORD	seq;
+	DWORD	size;			/* Bytes allocated */
+	DWORD	data;			/* Sample bytes written */
+	BYTE	state;			/* WAVSTATE */
+} WAVFILE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+__BSS(RAM2) static uint32_t Buf[WAVREC_BUFS][WAVREC_BUF / 4];
+static GPDMA_LLI_Type Lli[WAVREC_BUFS];
+
+static volatile uint32_t Done;							/* Buffers filled, counted by the DMA interrupt */
+static uint32_t Written;								/* Buffers written or lost: Buf[Written % WAVREC_BUFS] is next */
+static uint32_t Lost;									/* Buffers overwritten before written */
+
+static WAVFILE File[2];
+static WAVFILE *Cur, *Next;
+static DWORD NextSeq;
+static bool NoRoom;										/* The next file did not fit: not tried again */
+static uint32_t SyncTime;
+static BYTE HdrBuf[WAV_HDR_SIZE];
+
+static uint32_t Rate;
+static bool Running;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value);
+static void DmaHandler (bool error);
+static void Stop (void);
+static FRESULT WriteBuffers (void);
+static FRESULT OpenFile (WAVFILE *f);
+static FRESULT GrowFile (WAVFILE *f);
+static FRESULT PatchHeader (WAVFILE *f);
+static FRESULT FinalizeFile (WAVFILE *f);
+static FRESULT SwitchFile (void);
+static void MakeName (TCHAR *name, DWORD seq);
+static bool ParseName (const TCHAR *name, DWORD *seq);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Reads the sample rate, creates the first file and starts the
+  *         recording.
+  *
+  * @param  None
+  * @retval FR_OK (also when the recorder is off), FR_NO_FILE without
+  *         configuration file, FR_INVALID_PARAMETER for a rate the I2S
+  *         cannot make, or the file system error.
+  */
+FRESULT WAVREC_Init (void)
+{
+	FRESULT res;
+	DIR dir;
+	FILINFO fno;
+	DWORD seq;
+	PINSEL_CFG_Type PinCfg;
+	I2S_CFG_Type I2sCfg;
+	I2S_MODEConf_Type ModeCfg;
+	I2S_DMAConf_Type I2sDma;
+	GPDMA_Channel_CFG_Type DmaCfg;
+	int i;
+
+	Rate = 0;
+	res = CFG_Parse(ConfigHandler);
+	if (res != FR_OK || Rate == 0) return res;
+	if (Rate > WAVREC_MAX_RATE) return FR_INVALID_PARAMETER;
+
+	/* Numbering goes on after the last file on the card. */
+	NextSeq = 1;
+	res = f_opendir(&dir, "");
+	while (res == FR_OK)
+	{
+		res = f_readdir(&dir, &fno);
+		if (res != FR_OK || fno.fname[0] == 0) break;
+		if (!(fno.fattrib & AM_DIR) && ParseName(fno.fname, &seq) && seq >= NextSeq) NextSeq = seq + 1;
+	}
+	if (res != FR_OK) return res;
+
+	memset(File, 0, sizeof(File));
+	NoRoom = false;
+	Cur = &File[0];
+	Next = &File[1];
+	res = OpenFile(Cur);
+	while (res == FR_OK && Cur->state == WAV_GROWING) res = GrowFile(Cur);
+	if (res != FR_OK) return res;
+	Cur->state = WAV_ACTIVE;
+	SyncTime = TS_Seconds();
+
+	PinCfg.OpenDrain = PINSEL_PINMODE_NORMAL;
+	PinCfg.Pinmode = PINSEL_PINMODE_TRISTATE;
+	PinCfg.Portnum = 0;
+	PinCfg.Funcnum = 1;
+	for (i = 4; i <= 6; i++)					/* I2SRX_CLK, I2SRX_WS, I2SRX_SDA */
+	{
+		PinCfg.Pinnum = i;
+		PINSEL_ConfigPin(&PinCfg);
+	}
+
+	I2S_Init(LPC_I2S);
+	I2sCfg.wordwidth = I2S_WORDWIDTH_16;
+	I2sCfg.mono = I2S_STEREO;
+	I2sCfg.stop = I2S_STOP_ENABLE;
+	I2sCfg.reset = I2S_RESET_ENABLE;
+	I2sCfg.ws_sel = I2S_MASTER_MODE;
+	I2sCfg.mute = I2S_MUTE_DISABLE;
+	I2S_Config(LPC_I2S, I2S_RX_MODE, &I2sCfg);
+	ModeCfg.clksel = I2S_CLKSEL_FRDCLK;
+	ModeCfg.fpin = I2S_4PIN_DISABLE;
+	ModeCfg.mcena = I2S_MCLK_DISABLE;
+	I2S_ModeConfig(LPC_I2S, &ModeCfg, I2S_RX_MODE);
+	if (I2S_FreqConfig(LPC_I2S, Rate, I2S_RX_MODE) != SUCCESS) return FR_INVALID_PARAMETER;
+
+	/* DMA2 of the I2S is request line GPDMA_CONN_I2S_Channel_1, which the
+	GPDMA driver maps to the RX FIFO. */
+	I2sDma.DMAIndex = I2S_DMA_2;
+	I2sDma.depth = REC_FIFO_LEVEL;
+	I2S_DMAConfig(LPC_I2S, &I2sDma, I2S_RX_MODE);
+	I2S_DMACmd(LPC_I2S, I2S_DMA_2, I2S_RX_MODE, ENABLE);
+
+	for (i = 0; i < WAVREC_BUFS; i++)
+	{
+		Lli[i].SrcAddr = (uint32_t)&LPC_I2S->I2SRXFIFO;
+		Lli[i].DstAddr = (uint32_t)Buf[i];
+		Lli[i].NextLLI = (uint32_t)&Lli[(i + 1) % WAVREC_BUFS];
+		Lli[i].Control = BUF_CONTROL;
+	}
+	Done = Written = Lost = 0;
+
+	DMA_Init();
+	DMA_Attach(DMA_CH_I2S, DmaHandler);
+	DmaCfg.ChannelNum = DMA_CH_I2S;
+	DmaCfg.TransferSize = WAVREC_BUF / 4;
+	DmaCfg.TransferWidth = 0;
+	DmaCfg.SrcMemAddr = 0;
+	DmaCfg.DstMemAddr = (uint32_t)Buf[0];
+	DmaCfg.TransferType = GPDMA_TRANSFERTYPE_P2M;
+	DmaCfg.SrcConn = GPDMA_CONN_I2S_Channel_1;
+	DmaCfg.DstConn = 0;
+	DmaCfg.DMALLI = (uint32_t)&Lli[1 % WAVREC_BUFS];
+	if (GPDMA_Setup(&DmaCfg) != SUCCESS) return FR_INT_ERR;
+	REC_DMA->DMACCControl = BUF_CONTROL;		/* GPDMA_Setup() uses 32-word bursts */
+
+	Running = true;
+	GPDMA_ChannelCmd(DMA_CH_I2S, ENABLE);
+	I2S_Start(LPC_I2S);
+
+	return FR_OK;
+}
+
+/**
+  * @brief  Writes the full buffers, patches the header every
+  *         WAVREC_SYNC_SECONDS and, when idle, preallocates the next file.
+  *         Call it from the main loop.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT WAVREC_Task (void)
+{
+	FRESULT res;
+
+	if (Cur == NULL || Cur->state != WAV_ACTIVE) return FR_OK;
+
+	res = WriteBuffers();
+	if (res != FR_OK) return res;
+
+	if (TS_Seconds() - SyncTime >= WAVREC_SYNC_SECONDS)
+	{
+		SyncTime = TS_Seconds();
+		res = PatchHeader(Cur);
+		if (res == FR_OK) res = f_sync(&Cur->fil);
+	}
+	else if (Next->state == WAV_FREE && !NoRoom)
+	{
+		res = OpenFile(Next);
+	}
+	else if (Next->state == WAV_GROWING)
+	{
+		res = GrowFile(Next);
+	}
+	return res;
+}
+
+/**
+  * @brief  Stops the recording, writes the full buffers and closes the
+  *         file. The partial buffer is dropped and the next file, if any,
+  *         is deleted.
+  *
+  * @param  None
+  * @retval FR_OK or the file system error.
+  */
+FRESULT WAVREC_Close (void)
+{
+	FRESULT res;
+	TCHAR name[13];
+
+	if (Cur == NULL || Cur->state != WAV_ACTIVE) return FR_OK;
+
+	Stop();
+	res = WriteBuffers();
+	if (res == FR_OK) res = FinalizeFile(Cur);
+	else f_close(&Cur->fil);
+	Cur->state = WAV_FREE;
+
+	if (Next->state != WAV_FREE)
+	{
+		MakeName(name, Next->seq);
+		f_close(&Next->fil);
+		f_unlink(name);
+		Next->state = WAV_FREE;
+	}
+	return res;
+}
+
+/**
+  * @brief  Number of buffers overwritten by the DMA before being written.
+  *
+  * @param  None
+  * @retval Lost buffers since WAVREC_Init().
+  */
+uint32_t WAVREC_Lost (void)
+{
+	return Lost;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static void ConfigHandler (const char *key, const char *value)
+{
+	if (strcmp(key, "wav") == 0) CFG_GetUint(&value, &Rate);
+}
+
+/* Terminal count of a buffer; the DMA is already filling the next one. */
+static void DmaHandler (bool error)
+{
+	if (error)
+	{
+		Stop();
+		return;
+	}
+	Done++;
+}
+
+static void Stop (void)
+{
+	if (!Running) return;
+
+	I2S_Stop(LPC_I2S, I2S_RX_MODE);
+	GPDMA_ChannelCmd(DMA_CH_I2S, DISABLE);
+	Running = false;
+}
+
+/* Appends the full buffers to the current file, switching files when it
+is full. Each buffer is a whole number of sectors, so f_write() sends it
+straight to the card.
+
+Buffer n is overwritten once the DMA starts on buffer n + WAVREC_BUFS,
+that is when Done - n reaches WAVREC_BUFS. Such buffers are skipped, and
+one overwritten while f_write() sent it is taken back from the file. */
+static FRESULT WriteBuffers (void)
+{
+	FRESULT res;
+	UINT bw;
+
+	while (Done != Written)
+	{
+		if (Done - Written >= WAVREC_BUFS)
+		{
+			Lost += Done - Written - (WAVREC_BUFS - 1);
+			Written = Done - (WAVREC_BUFS - 1);
+		}
+
+		if (Cur->data + WAVREC_BUF > WAV_DATA_MAX)
+		{
+			res = SwitchFile();
+			if (res != FR_OK) return res;
+		}
+
+		res = f_write(&Cur->fil, Buf[Written % WAVREC_BUFS], WAVREC_BUF, &bw);
+		if (res == FR_OK && bw != WAVREC_BUF) res = FR_DENIED;
+		if (res == FR_OK && Done - Written >= WAVREC_BUFS) res = f_lseek(&Cur->fil, WAV_HDR_SIZE + Cur->data);
+		if (res != FR_OK) return res;
+		if (Done - Written >= WAVREC_BUFS) continue;
+
+		Cur->data += WAVREC_BUF;
+		Written++;
+	}
+	return FR_OK;
+}
+
+static FRESULT OpenFile (WAVFILE *f)
+{
+	FRESULT res;
+	TCHAR name[13];
+
+	MakeName(name, NextSeq);
+	res = f_open(&f->fil, name, FA_CREATE_ALWAYS | FA_READ | FA_WRITE);
+	if (res != FR_OK) return res;
+
+	f->seq = NextSeq++;
+	f->size = 0;
+	f->data = 0;
+	f->state = WAV_GROWING;
+
+	return FR_OK;
+}
+
+/* Extends the file by one WAVREC_GROW step. Seeking past the end in write
+mode stretches the cluster chain. The last step builds the link map and
+writes the header. */
+static FRESULT GrowFile (WAVFILE *f)
+{
+	FRESULT res;
+	TCHAR name[13];
+
+	res = f_lseek(&f->fil, f->size + WAVREC_GROW);
+	if (res == FR_OK && f_size(&f->fil) != f->size + WAVREC_GROW)
+	{
+		NoRoom = true;							/* Volume full */
+		res = FR_DENIED;
+	}
+	if (res == FR_OK) f->size += WAVREC_GROW;
+
+	if (res == FR_OK && f->size == WAVREC_FILE_SIZE)
+	{
+		f->clmt[0] = WAVREC_CLMT_SIZE;
+		f->fil.cltbl = f->clmt;
+		res = f_lseek(&f->fil, CREATE_LINKMAP);
+		if (res == FR_NOT_ENOUGH_CORE)
+		{
+			f->fil.cltbl = NULL;
+			res = FR_OK;
+		}
+		if (res == FR_OK) res = PatchHeader(f);
+		if (res == FR_OK) res = f_sync(&f->fil);	/* Make the allocation durable */
+		if (res == FR_OK) f->state = WAV_READY;
+	}
+
+	if (res != FR_OK)
+	{
+		MakeName(name, f->seq);
+		f_close(&f->fil);
+		f_unlink(name);
+		f->state = WAV_FREE;
+		NextSeq = f->seq;						/* The number goes to the next try */
+	}
+	return res;
+}
+
+/* Writes the header sector for the samples written so far and returns to
+the end of the samples. */
+static FRESULT PatchHeader (WAVFILE *f)
+{
+	FRESULT res;
+	UINT bw;
+
+	memset(HdrBuf, 0, sizeof(HdrBuf));
+	memcpy(&HdrBuf[0], "RIFF", 4);
+	ST_DWORD(&HdrBuf[4], WAV_HDR_SIZE - 8 + f->data);
+	memcpy(&HdrBuf[8], "WAVE", 4);
+	memcpy(&HdrBuf[12], "fmt ", 4);
+	ST_DWORD(&HdrBuf[16], 16);
+	ST_WORD(&HdrBuf[20], 1);					/* PCM */
+	ST_WORD(&HdrBuf[22], WAV_CHANNELS);
+	ST_DWORD(&HdrBuf[24], Rate);
+	ST_DWORD(&HdrBuf[28], Rate * WAV_FRAME);
+	ST_WORD(&HdrBuf[32], WAV_FRAME);
+	ST_WORD(&HdrBuf[34], WAV_BITS);
+	memcpy(&HdrBuf[36], "JUNK", 4);				/* Pads the header to a sector */
+	ST_DWORD(&HdrBuf[40], WAV_HDR_SIZE - 36 - 8 - 8);
+	memcpy(&HdrBuf[WAV_HDR_SIZE - 8], "data", 4);
+	ST_DWORD(&HdrBuf[WAV_HDR_SIZE - 4], f->data);
+
+	res = f_lseek(&f->fil, 0);
+	if (res == FR_OK) res = f_write(&f->fil, HdrBuf, WAV_HDR_SIZE, &bw);
+	if (res == FR_OK && bw != WAV_HDR_SIZE) res = FR_DENIED;
+	if (res == FR_OK) res = f_lseek(&f->fil, WAV_HDR_SIZE + f->data);
+
+	return res;
+}
+
+/* Writes the final header, releases the unused clusters and closes. */
+static FRESULT FinalizeFile (WAVFILE *f)
+{
+	FRESULT res;
+
+	res = PatchHeader(f);
+	if (res == FR_OK) res = f_truncate(&f->fil);
+	if (res == FR_OK) res = f_close(&f->fil);
+	else f_close(&f->fil);
+	f->state = WAV_FREE;
+
+	return res;
+}
+
+/* Moves the recording to the next file, completing its preallocation if
+the task had no idle time for it. */
+static FRESULT SwitchFile (void)
+{
+	FRESULT res = FR_OK;
+	WAVFILE *f;
+
+	if (Next->state == WAV_FREE) res = NoRoom ? FR_DENIED : OpenFile(Next);
+	while (res == FR_OK && Next->state == WAV_GROWING) res = GrowFile(Next);
+	if (res != FR_OK) return res;
+
+	res = FinalizeFile(Cur);
+
+	f = Cur;
+	Cur = Next;
+	Next = f;
+	Cur->state = WAV_ACTIVE;
+
+	return res;
+}
+
+static void MakeName (TCHAR *name, DWORD seq)
+{
+	int i;
+
+	strcpy(name, WAVREC_NAME_PREFIX);
+	name += sizeof(WAVREC_NAME_PREFIX) - 1;
+	for (i = WAVREC_NAME_DIGITS - 1; i >= 0; i--)
+	{
+		name[i] = '0' + (seq % 10);
+		seq /= 10;
+	}
+	strcpy(name + WAVREC_NAME_DIGITS, WAVREC_NAME_EXT);
+}
+
+static bool ParseName (const TCHAR *name, DWORD *seq)
+{
+	int i;
+	DWORD n = 0;
+
+	if (strncmp(name, WAVREC_NAME_PREFIX, sizeof(WAVREC_NAME_PREFIX) - 1) != 0) return false;
+	name += sizeof(WAVREC_NAME_PREFIX) - 1;
+	for (i = 0; i < WAVREC_NAME_DIGITS; i++)
+	{
+		if (name[i] < '0' || name[i] > '9') return false;
+		n = n * 10 + (name[i] - '0');
+	}
+	if (strcmp(name + WAVREC_NAME_DIGITS, WAVREC_NAME_EXT) != 0) return false;
+
+	*seq = n;
+	return true;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,206 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file adccat.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: decodes the ADC records of a log stream.
+ *
+ * Reads a log stream (see logcat.c) from the standard input and writes the
+ * samples of the LOGREC_CH_ADC records as CSV, one line per sample:
+ *
+ * @code
+ *   seconds.nanoseconds,channel,value
+ *   logcat LOG*.DAT | adccat > adc.csv
+ *   logcat LOG*.DAT | adccat -q             # decode only, report speed
+ * @endcode
+ *
+ * The time of each sample is derived from the record timestamp, which is
+ * the time of the last sample, and the conversion rate of the last
+ * LOGREC_ADC_FL_CONFIG record. -q skips the output and prints the
+ * decoding time per sample.
+ *
+ * Packed blocks (LOGREC_ADC_FL_PACKED) are unpacked 8 values at a time
+ * with AVX2 gathers and variable shifts when the compiler targets it, else
+ * by a plain loop. Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -march=native -I../inc -o adccat adccat.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "logformat.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define ADC_CHANNELS		8
+#define MAX_SAMPLES			65536			/* More than a record can hold */
+#define SLACK				8				/* The unpacking reads a little past a group */
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint8_t Payload[0x10000 + SLACK];
+static uint16_t Samples[MAX_SAMPLES];
+static LOGADCCFG Cfg;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void UnpackGroup (const uint8_t *p, uint32_t w, uint32_t *z);
+static int32_t Decode (const uint8_t *p, uint32_t len, uint16_t *out);
+static void Print (const LOGRECHDR *rec, const uint16_t *s, uint32_t n);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	LOGRECHDR rec;
+	struct timespec t0, t1;
+	double secs = 0;
+	unsigned long total = 0;
+	int quiet = (argc > 1 && strcmp(argv[1], "-q") == 0);
+	int32_t n;
+
+	while (fread(&rec, sizeof(rec), 1, stdin) == 1)
+	{
+		if (fread(Payload, 1, rec.len, stdin) != rec.len) break;
+		if (rec.chan != LOGREC_CH_ADC) continue;
+
+		if (rec.flags & LOGREC_ADC_FL_CONFIG)
+		{
+			memcpy(&Cfg, Payload, sizeof(Cfg));
+			continue;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if (rec.flags & LOGREC_ADC_FL_PACKED)
+		{
+			n = Decode(Payload, rec.len, Samples);
+		}
+		else
+		{
+			n = rec.len / sizeof(uint16_t);
+			memcpy(Samples, Payload, n * sizeof(uint16_t));
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		secs += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+		if (n < 0)
+		{
+			fprintf(stderr, "bad packed block at %lu.%09lu\n", (unsigned long)rec.sec, (unsigned long)rec.nsec);
+			continue;
+		}
+		total += n;
+		if (!quiet) Print(&rec, Samples, n);
+	}
+
+	if (quiet && total)
+	{
+		fprintf(stderr, "%lu samples, %.2f ns/sample\n", total, secs * 1e9 / total);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Unpacks the LOGADC_GROUP values of w bits that follow a width byte. */
+static void UnpackGroup (const uint8_t *p, uint32_t w, uint32_t *z)
+{
+	uint32_t k;
+#ifdef __AVX2__
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i mask = _mm256_set1_epi32((1 << w) - 1);
+	const __m256i seven = _mm256_set1_epi32(7);
+	__m256i bit, v;
+
+	for (k = 0; k < LOGADC_GROUP; k += 8)
+	{
+		bit = _mm256_mullo_epi32(_mm256_add_epi32(lane, _mm256_set1_epi32(k)), _mm256_set1_epi32(w));
+		v = _mm256_i32gather_epi32((const int *)p, _mm256_srli_epi32(bit, 3), 1);
+		v = _mm256_and_si256(_mm256_srlv_epi32(v, _mm256_and_si256(bit, seven)), mask);
+		_mm256_storeu_si256((__m256i *)&z[k], v);
+	}
+#else
+	uint32_t bit, v;
+
+	for (k = 0, bit = 0; k < LOGADC_GROUP; k++, bit += w)
+	{
+		memcpy(&v, p + (bit >> 3), sizeof(v));
+		z[k] = (v >> (bit & 7)) & ((1u << w) - 1);
+	}
+#endif
+}
+
+/* Expands a packed block to samples in the LOGADC format. */
+static int32_t Decode (const uint8_t *p, uint32_t len, uint16_t *out)
+{
+	LOGADCPACK hdr;
+	const uint8_t *end = p + len;
+	uint8_t order[ADC_CHANNELS];
+	uint16_t prev[ADC_CHANNELS];
+	uint32_t z[LOGADC_GROUP];
+	uint32_t i, k, n, c, w, ch;
+
+	memcpy(&hdr, p, sizeof(hdr));
+	p += sizeof(hdr);
+	if (hdr.nch == 0 || hdr.nch > ADC_CHANNELS || hdr.nch > hdr.samples
+			|| (uint32_t)(end - p) < hdr.nch * sizeof(uint16_t)) return -1;
+
+	/* Burst order from the first channel, as in the capture. */
+	for (c = 0, ch = hdr.chan; c < hdr.nch; c++)
+	{
+		order[c] = ch;
+		do ch = (ch + 1) % ADC_CHANNELS; while (!(Cfg.chmask & (1 << ch)) && ch != hdr.chan);
+	}
+
+	memcpy(out, p, hdr.nch * sizeof(uint16_t));
+	p += hdr.nch * sizeof(uint16_t);
+	for (c = 0; c < hdr.nch; c++) prev[c] = LOGADC_VALUE(out[c]);
+
+	for (i = hdr.nch, c = 0; i < hdr.samples; i += LOGADC_GROUP)
+	{
+		if (p >= end || (w = *p++) > 16 || (uint32_t)(end - p) < 4 * w) return -1;
+		UnpackGroup(p, w, z);
+		p += 4 * w;
+
+		n = hdr.samples - i;
+		if (n > LOGADC_GROUP) n = LOGADC_GROUP;
+		for (k = 0; k < n; k++)
+		{
+			prev[c] = (uint16_t)(prev[c] + LOGADC_UNZIGZAG(z[k]));
+			out[i + k] = (prev[c] & 0x0FFF) | (order[c] << 12);
+			if (++c == hdr.nch) c = 0;
+		}
+	}
+	return hdr.samples;
+}
+
+/* Prints one CSV line per sample; the last sample is at the record time. */
+static void Print (const LOGRECHDR *rec, const uint16_t *s, uint32_t n)
+{
+	int64_t t, last = (int64_t)rec->sec * 1000000000 + rec->nsec;
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		t = Cfg.rate ? last - (int64_t)(n - 1 - i) * 1000000000 / Cfg.rate : last;
+		printf("%lld.%09lld,%u,%u\n", (long long)(t / 1000000000), (long long)(t % 1000000000),
+				LOGADC_CHAN(s[i]), LOGADC_VALUE(s[i]));
+	}
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,299 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file adcsim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs adclog.c and the logger against a simulated ADC
+ *        and card, and checks the log against the samples converted.
+ *
+ * The ADC in burst mode is a source of the simulation (hostsim.h): at the
+ * conversion rate that adclog.c programmed it sets ADGDR for the next
+ * selected channel, with a sine of its own on each channel plus a little
+ * noise, and raises the DMA request of the ADC. The GPDMA of the
+ * simulation fills the ADCBUF ring of adclog.c by its linked list and
+ * raises the interrupt that timestamps each buffer. The main loop runs
+ * ADCLOG_Task() and LOG_Task(), which write to the card model of
+ * hostsim.c while the conversions go on.
+ *
+ * At the end the log is read back from the RAM disk and every record is
+ * compared with the samples made: the packed blocks are expanded, each
+ * buffer must match the conversions it holds, a missing buffer must be
+ * announced by LOGREC_ADC_FL_LOST and counted by ADCLOG_Lost(), and the
+ * timestamp must be the time of the last sample. It prints the buffers
+ * converted, logged and missing, and the card counts. The exit status is 1
+ * when a buffer is missing or differs.
+ *
+ * @code
+ *   adcsim [options] [SECONDS [RATE [CHMASK]]]    # default 60s, 10000/s, 0xFF
+ *   adcsim -s 100 -k 1024 60                      # 100ms stall every MB
+ * @endcode
+ *
+ * The options of the card model are listed by hostsim.c (HOST_Usage()).
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o adcsim adcsim.c host/hostsim.c ../src/adclog.c ../src/dma.c \
+ *       ../src/logger.c ../src/lzpack.c ../src/crc16.c ../src/config.c \
+ *       ../src/volfmt.c ../fatfs/src/ff.c ../library/src/lpc17xx_adc.c \
+ *       ../library/src/lpc17xx_gpdma.c ../library/src/lpc17xx_clkpwr.c \
+ *       ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_adc.h"
+#include "lpc17xx_clkpwr.h"
+#include "lpc17xx_gpdma.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "adclog.h"
+#include "SDLogger.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define ADC_CHANNELS		8
+#define VOLUME_MB			512
+#define TS_TOLERANCE		1000					/* Timestamp error allowed, ns */
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t ConvRate;							/* Conversions/s, all channels */
+static uint64_t Start;								/* Time of the burst start */
+static uint16_t *Gen;								/* Conversions made, as LOGADC samples */
+static uint32_t GenMax, Conv;
+static uint32_t Count[ADC_CHANNELS];				/* Conversions made per channel */
+static uint8_t Ch = ADC_CHANNELS - 1;
+static bool Unread;									/* ADGDR not taken by the DMA */
+
+static LOGADCCFG Cfg;
+static uint32_t NextBuf, Logged, Missing, Unflagged, Bad, Configs;
+static int64_t TsError;
+static uint16_t Samples[0x10000];
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t ConvTime (uint32_t k);
+static uint64_t Convert (uint64_t now);
+static uint16_t Signal (uint8_t ch, uint32_t n);
+static void Check (const LOGRECHDR *rec, const uint8_t *data);
+static int32_t Decode (const uint8_t *p, uint32_t len, uint16_t *out);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	uint32_t seconds, rate, chmask, div, peak;
+	uint64_t end;
+	int i = HOST_Options(argc, argv);
+
+	if (i < 0)
+	{
+		fprintf(stderr, "usage: adcsim [options] [SECONDS [RATE [CHMASK]]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	seconds = (i < argc) ? strtoul(argv[i], NULL, 0) : 60;
+	rate = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 0) : ADCLOG_RATE;
+	chmask = (i + 2 < argc) ? strtoul(argv[i + 2], NULL, 0) : ADCLOG_CHMASK;
+
+	if (HOST_Init(VOLUME_MB, NULL) != 0) return 1;
+	SD_SetTickHook(LOG_TimerProc);
+	if (LOG_Init() != FR_OK || !ADCLOG_Init(chmask, rate))
+	{
+		fprintf(stderr, "no logger or no ADC at %lu/s\n", (unsigned long)rate);
+		return 1;
+	}
+	div = ((LPC_ADC->ADCR >> 8) & 0xFF) + 1;
+	ConvRate = CLKPWR_GetPCLK(CLKPWR_PCLKSEL_ADC) / div / 65;
+	GenMax = (uint32_t)((uint64_t)(seconds + 1) * ConvRate);
+	if ((Gen = malloc(GenMax * sizeof(uint16_t))) == NULL) return 1;
+
+	if (ADCLOG_Start() != FR_OK)
+	{
+		fprintf(stderr, "ADCLOG_Start() failed\n");
+		return 1;
+	}
+	Start = HOST_Ns;
+	HOST_Source(Convert, ConvTime(0));
+
+	end = HOST_Ns + seconds * 1000000000ULL;
+	while (HOST_Ns < end)
+	{
+		ADCLOG_Task();
+		LOG_Task();
+		HOST_Loop();
+	}
+	ADCLOG_Stop();
+	ADCLOG_Task();
+	LOG_Close();
+	LOG_Staged(&peak);
+
+	printf("%lus of %u channels at %lu conversions/s (%lu/s per channel asked)\n", (unsigned long)seconds,
+			__builtin_popcount(chmask), (unsigned long)ConvRate, (unsigned long)rate);
+	HOST_Report();
+	if (HOST_ReadLog(Check) < 0) return 1;
+
+	printf("%lu buffers converted, %lu logged, %lu missing (ADCLOG_Lost() %lu, %lu gaps not flagged), %lu damaged\n",
+			(unsigned long)(Conv / ADCLOG_BUF_SAMPLES), (unsigned long)Logged, (unsigned long)Missing,
+			(unsigned long)ADCLOG_Lost(), (unsigned long)Unflagged, (unsigned long)Bad);
+	printf("staging ring peak %u of %u sectors, timestamps within %lldns\n", peak, LOG_STAGE_SECTORS, (long long)TsError);
+	if (Configs != 1 || Cfg.rate != ConvRate) printf("configuration record wrong or missing\n");
+
+	HOST_Save();
+	return (Missing || ADCLOG_Lost() || Unflagged || Bad || Configs != 1 || Cfg.rate != ConvRate) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Time of the end of conversion k, from 0. */
+static uint64_t ConvTime (uint32_t k)
+{
+	return Start + (uint64_t)(k + 1) * 1000000000ULL / ConvRate;
+}
+
+/* End of a conversion in burst mode: the result of the next selected
+channel goes to ADGDR and asks for the DMA. */
+static uint64_t Convert (uint64_t now)
+{
+	uint32_t adcr = LPC_ADC->ADCR, gdr;
+	uint16_t v;
+
+	if (!(adcr & ADC_CR_BURST) || !(adcr & ADC_CR_PDN) || !(adcr & 0xFF) || Conv >= GenMax) return HOST_NEVER;
+
+	do Ch = (Ch + 1) % ADC_CHANNELS; while (!(adcr & (1 << Ch)));
+	v = Signal(Ch, Count[Ch]++);
+	gdr = ((uint32_t)v << 4) | ((uint32_t)Ch << 24) | ADC_GDR_DONE_FLAG;
+	if (Unread) gdr |= ADC_GDR_OVERRUN_FLAG;
+	HOST_SET(LPC_ADC->ADGDR, gdr);
+	Unread = HOST_DmaRequest(GPDMA_CONN_ADC, &gdr, 1) == 0;
+
+	Gen[Conv++] = v | (Ch << 12) | ((gdr & ADC_GDR_OVERRUN_FLAG) ? LOGADC_OVERRUN : 0);
+	(void)now;
+	return ConvTime(Conv);
+}
+
+/* Sample n of a channel: a sine of 10Hz times the channel number plus
+one, with a few LSB of noise. */
+static uint16_t Signal (uint8_t ch, uint32_t n)
+{
+	static uint32_t seed = 1;
+	double t = (double)n * __builtin_popcount(LPC_ADC->ADCR & 0xFF) / ConvRate;
+	int32_t v;
+
+	seed = seed * 1103515245 + 12345;
+	v = 2048 + (int32_t)(1500.0 * sin(2 * M_PI * 10 * (ch + 1) * t)) + (int32_t)((seed >> 16) % 7) - 3;
+	return (uint16_t)v & 0x0FFF;
+}
+
+/* Compares an ADC record with the conversions made. */
+static void Check (const LOGRECHDR *rec, const uint8_t *data)
+{
+	int64_t err;
+	int32_t n;
+	uint32_t b;
+
+	if (rec->chan != LOGREC_CH_ADC) return;
+	if (rec->flags & LOGREC_ADC_FL_CONFIG)
+	{
+		memcpy(&Cfg, data, sizeof(Cfg));
+		Configs++;
+		return;
+	}
+
+	if (rec->flags & LOGREC_ADC_FL_PACKED)
+	{
+		n = Decode(data, rec->len, Samples);
+	}
+	else
+	{
+		n = rec->len / sizeof(uint16_t);
+		memcpy(Samples, data, rec->len);
+	}
+	if (n != ADCLOG_BUF_SAMPLES)
+	{
+		Bad++;
+		return;
+	}
+
+	/* The buffer is looked for from the one expected on: a gap is only
+	right after a LOGREC_ADC_FL_LOST record. */
+	for (b = NextBuf; (b + 1) * ADCLOG_BUF_SAMPLES <= Conv; b++)
+	{
+		if (memcmp(Samples, &Gen[b * ADCLOG_BUF_SAMPLES], sizeof(uint16_t) * ADCLOG_BUF_SAMPLES) == 0) break;
+	}
+	if ((b + 1) * ADCLOG_BUF_SAMPLES > Conv)
+	{
+		Bad++;
+		return;
+	}
+	Missing += b - NextBuf;
+	if (b != NextBuf && !(rec->flags & LOGREC_ADC_FL_LOST)) Unflagged++;
+	NextBuf = b + 1;
+	Logged++;
+
+	err = ((int64_t)rec->sec - HOST_EPOCH) * 1000000000LL + rec->nsec - (int64_t)ConvTime((b + 1) * ADCLOG_BUF_SAMPLES - 1);
+	if (err < 0) err = -err;
+	if (err > TsError) TsError = err;
+	if (err > TS_TOLERANCE) Bad++;
+}
+
+/* Expands a packed block to samples in the LOGADC format, as adccat.c. */
+static int32_t Decode (const uint8_t *p, uint32_t len, uint16_t *out)
+{
+	LOGADCPACK hdr;
+	const uint8_t *end = p + len;
+	uint8_t order[ADC_CHANNELS];
+	uint16_t prev[ADC_CHANNELS];
+	uint32_t i, k, n, c, w, ch, bit, v;
+
+	memcpy(&hdr, p, sizeof(hdr));
+	p += sizeof(hdr);
+	if (hdr.nch == 0 || hdr.nch > ADC_CHANNELS || hdr.nch > hdr.samples
+			|| (uint32_t)(end - p) < hdr.nch * sizeof(uint16_t)) return -1;
+
+	for (c = 0, ch = hdr.chan; c < hdr.nch; c++)
+	{
+		order[c] = ch;
+		do ch = (ch + 1) % ADC_CHANNELS; while (!(Cfg.chmask & (1 << ch)) && ch != hdr.chan);
+	}
+
+	memcpy(out, p, hdr.nch * sizeof(uint16_t));
+	p += hdr.nch * sizeof(uint16_t);
+	for (c = 0; c < hdr.nch; c++) prev[c] = LOGADC_VALUE(out[c]);
+
+	for (i = hdr.nch, c = 0; i < hdr.samples; i += LOGADC_GROUP)
+	{
+		if (p >= end || (w = *p++) > 16 || (uint32_t)(end - p) < 4 * w) return -1;
+		n = hdr.samples - i;
+		if (n > LOGADC_GROUP) n = LOGADC_GROUP;
+		for (k = 0, bit = 0; k < n; k++, bit += w)
+		{
+			v = 0;
+			memcpy(&v, p + (bit >> 3), (w == 0) ? 0 : ((bit & 7) + w + 7) / 8);
+			prev[c] = (uint16_t)(prev[c] + LOGADC_UNZIGZAG((v >> (bit & 7)) & ((1u << w) - 1)));
+			out[i + k] = (prev[c] & 0x0FFF) | (order[c] << 12);
+			if (++c == hdr.nch) c = 0;
+		}
+		p += 4 * w;
+	}
+	return hdr.samples;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,481 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file cansim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs canlog.c and the logger against two simulated CAN
+ *        buses at full load and a simulated card, and checks the log
+ *        against the frames sent.
+ *
+ * Each bus is a source of the simulation (hostsim.h) that sends frames
+ * back to back, with only the intermission between them: 100% load. The
+ * time of a frame is its length on the wire, stuff bits included, worked
+ * out from its identifier, data and CRC. At the end of each frame the
+ * controller model takes it in its double receive buffer, sets RFS, RID,
+ * RDA, RDB and GSR.RBS as the CAN controller does, and raises
+ * CAN_IRQHandler(). The registers of the controllers are watched with
+ * HOST_Trap(): a write of CMR.RRB releases the buffer and brings the next
+ * frame, CMR.CDO clears the overrun, and reading ICR clears it. A frame
+ * that finds both receive buffers full is lost with a data overrun.
+ *
+ * The main loop runs CANLOG_Task() and LOG_Task(), which write to the card
+ * model of hostsim.c while the frames go on. At the end the log is read
+ * back from the RAM disk and every frame logged is compared with the
+ * frames sent on its bus: identifier, flags, DLC, data and timestamp (the
+ * end of the frame). A missing frame must be announced by a
+ * LOGREC_CAN_FL_LOST record and counted by CANLOG_Lost(). It prints the
+ * frames sent and logged, the bus load, and how long the ring of canlog.c
+ * lasts at that frame rate. The exit status is 1 when a frame is missing
+ * or differs.
+ *
+ * The time the firmware spends in the interrupt is not modelled: the
+ * handler empties the receive buffer at once, so the losses measured are
+ * those of the ring and of the card, not of the interrupt latency.
+ *
+ * @code
+ *   cansim [options] [SECONDS [BAUD [DLC]]]    # default 60s, 1000000, DLC mixed
+ *   cansim -s 50 60 1000000 0                  # shortest frames, 50ms stalls
+ * @endcode
+ *
+ * DLC 0 to 8 sends only frames of that length (0 is the highest frame
+ * rate); any other value mixes lengths, extended identifiers and remote
+ * frames. The options of the card model are listed by hostsim.c
+ * (HOST_Usage()). Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o cansim cansim.c host/hostsim.c ../src/canlog.c ../src/logger.c \
+ *       ../src/lzpack.c ../src/crc16.c ../src/config.c ../src/volfmt.c \
+ *       ../fatfs/src/ff.c ../library/src/lpc17xx_can.c \
+ *       ../library/src/lpc17xx_clkpwr.c ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_can.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "canlog.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define CAN_BUSES			2
+#define VOLUME_MB			512
+#define TS_TOLERANCE		1000					/* Timestamp error allowed, ns */
+
+#define MIN_FRAME_BITS		47						/* Standard data frame without data, no stuffing */
+#define FRAME_TAIL_BITS		10						/* CRC delimiter, ACK slot and delimiter, EOF */
+#define IFS_BITS			3						/* Intermission */
+#define CRC15_POLY			0x4599
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Frame sent on a bus. */
+typedef struct tagFRAME
+{
+	uint64_t end;			/* End of the EOF: the controller takes it */
+	uint32_t idf;			/* Identifier and LOGCAN_xxx flags, as logged */
+	uint8_t  dlc;
+	uint8_t  data[8];
+} FRAME;
+
+/* Receive side of a controller. */
+typedef struct tagRXBUF
+{
+	uint32_t frame[2];		/* Double receive buffer: frames held */
+	uint8_t  head, count;
+} RXBUF;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t Baud;
+static int Dlc;
+static uint64_t End;								/* No frame starts after it */
+static uint32_t Seed = 1;
+
+static FRAME *Gen[CAN_BUSES];						/* Frames sent */
+static uint32_t GenCount[CAN_BUSES], GenMax;
+static uint64_t GenBits[CAN_BUSES];
+static uint64_t NextStart[CAN_BUSES];
+static RXBUF Rx[CAN_BUSES];
+static uint32_t Overruns;
+
+static LOGCANCFG Cfg;
+static uint32_t Next[CAN_BUSES], Logged, Missing, Unflagged, Bad, Configs;
+static int64_t TsError;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t Bus1 (uint64_t now);
+static uint64_t Bus2 (uint64_t now);
+static uint64_t Send (uint8_t bus);
+static void MakeFrame (uint8_t bus, FRAME *f);
+static uint32_t FrameBits (const FRAME *f);
+static void Deliver (uint8_t bus, uint32_t k);
+static void Load (uint8_t bus);
+static void Release (uint8_t bus);
+static void Access (uint32_t offset, bool write);
+static void Check (const LOGRECHDR *rec, const uint8_t *data);
+static uint32_t Random (void);
+
+/* Handler of canlog.c, declared by the startup code on the board */
+void CAN_IRQHandler (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	char cfg[64];
+	uint32_t seconds, peak, sent, b;
+	uint64_t start, bits;
+	int i = HOST_Options(argc, argv);
+
+	if (i < 0)
+	{
+		fprintf(stderr, "usage: cansim [options] [SECONDS [BAUD [DLC]]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	seconds = (i < argc) ? strtoul(argv[i], NULL, 0) : 60;
+	Baud = (i + 1 < argc) ? strtoul(argv[i + 1], NULL, 0) : 1000000;
+	Dlc = (i + 2 < argc) ? atoi(argv[i + 2]) : -1;
+	if (Baud == 0 || Baud > 1000000)
+	{
+		fprintf(stderr, "BAUD from 1 to 1000000\n");
+		return 2;
+	}
+
+	GenMax = (uint32_t)((uint64_t)seconds * Baud / MIN_FRAME_BITS + 2);
+	for (b = 0; b < CAN_BUSES; b++)
+	{
+		if ((Gen[b] = malloc(GenMax * sizeof(FRAME))) == NULL) return 1;
+	}
+
+	snprintf(cfg, sizeof(cfg), "can1 = %lu\ncan2 = %lu\n", (unsigned long)Baud, (unsigned long)Baud);
+	if (HOST_Init(VOLUME_MB, cfg) != 0 || HOST_Trap(&HostCan, Access) != 0) return 1;
+	SD_SetTickHook(LOG_TimerProc);
+	if (LOG_Init() != FR_OK || CANLOG_Init() != FR_OK)
+	{
+		fprintf(stderr, "no logger or no CAN at %lu bit/s\n", (unsigned long)Baud);
+		return 1;
+	}
+
+	start = HOST_Ns;
+	End = start + seconds * 1000000000ULL;
+	for (b = 0; b < CAN_BUSES; b++) NextStart[b] = start + b * 7919;		/* Buses out of step */
+	HOST_Source(Bus1, Send(0));
+	HOST_Source(Bus2, Send(1));
+
+	while (HOST_Ns < End)
+	{
+		CANLOG_Task();
+		LOG_Task();
+		HOST_Loop();
+	}
+	HOST_RunTo(End + 1000000);
+	CANLOG_Task();
+	LOG_Close();
+	LOG_Staged(&peak);
+
+	sent = GenCount[0] + GenCount[1];
+	bits = GenBits[0] + GenBits[1];
+	printf("%lus of 2 buses at %lu bit/s, %s: %lu frames, %.0f frames/s, %.1f%% load\n", (unsigned long)seconds,
+			(unsigned long)Baud, (Dlc >= 0 && Dlc <= 8) ? "fixed DLC" : "mixed frames", (unsigned long)sent,
+			(double)sent / seconds, 100.0 * bits / ((double)seconds * Baud * CAN_BUSES));
+	printf("ring of %u frames lasts %.1fms at this rate\n", CANLOG_RING, 1000.0 * CANLOG_RING * seconds / sent);
+	HOST_Report();
+	if (HOST_ReadLog(Check) < 0) return 1;
+
+	for (b = 0; b < CAN_BUSES; b++) Missing += GenCount[b] - Next[b];
+	printf("%lu frames logged, %lu missing (CANLOG_Lost() %lu, %lu overruns, %lu gaps not flagged), %lu damaged\n",
+			(unsigned long)Logged, (unsigned long)Missing, (unsigned long)CANLOG_Lost(),
+			(unsigned long)Overruns, (unsigned long)Unflagged, (unsigned long)Bad);
+	printf("staging ring peak %u of %u sectors, timestamps within %lldns\n", peak, LOG_STAGE_SECTORS, (long long)TsError);
+	if (Configs != 1 || Cfg.baud[0] != Baud || Cfg.baud[1] != Baud) printf("configuration record wrong or missing\n");
+
+	HOST_Save();
+	return (Missing || CANLOG_Lost() || Unflagged || Bad || Configs != 1 || Cfg.baud[0] != Baud) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static uint64_t Bus1 (uint64_t now)
+{
+	(void)now;
+	Deliver(0, GenCount[0] - 1);
+	return Send(0);
+}
+
+static uint64_t Bus2 (uint64_t now)
+{
+	(void)now;
+	Deliver(1, GenCount[1] - 1);
+	return Send(1);
+}
+
+/* Starts the next frame of a bus; returns the time of its end. */
+static uint64_t Send (uint8_t bus)
+{
+	FRAME *f;
+	uint32_t bits;
+
+	if (NextStart[bus] >= End || GenCount[bus] == GenMax) return HOST_NEVER;
+
+	f = &Gen[bus][GenCount[bus]++];
+	MakeFrame(bus, f);
+	bits = FrameBits(f);
+	GenBits[bus] += bits;
+	f->end = NextStart[bus] + (uint64_t)(bits - IFS_BITS) * 1000000000ULL / Baud;
+	NextStart[bus] += (uint64_t)bits * 1000000000ULL / Baud;
+	return f->end;
+}
+
+/* Mostly standard frames, a quarter extended, a few remote. */
+static void MakeFrame (uint8_t bus, FRAME *f)
+{
+	uint32_t r = Random(), i;
+
+	f->idf = (bus == 1) ? LOGCAN_BUS2 : 0;
+	if ((r & 3) == 0) f->idf |= LOGCAN_EXT | (Random() & 0x1FFFFFFF);
+	else f->idf |= Random() & 0x7FF;
+	if (Dlc >= 0 && Dlc <= 8)
+	{
+		f->dlc = Dlc;
+	}
+	else
+	{
+		f->dlc = (r >> 2) % 9;
+		if (((r >> 8) & 31) == 0) f->idf |= LOGCAN_RTR;
+	}
+	memset(f->data, 0, sizeof(f->data));
+	for (i = 0; i < LOGCAN_DATALEN(f->idf, f->dlc); i++) f->data[i] = Random() >> 24;
+}
+
+/* Length of a frame on the wire: arbitration, control, data and CRC with
+their stuff bits, then the fixed tail and the intermission. */
+static uint32_t FrameBits (const FRAME *f)
+{
+	uint8_t bit[160];
+	uint32_t n = 0, i, id = LOGCAN_ID(f->idf), run, stuff;
+	uint16_t crc = 0;
+	uint8_t rtr = (f->idf & LOGCAN_RTR) ? 1 : 0, prev, x;
+
+	bit[n++] = 0;												/* SOF */
+	if (f->idf & LOGCAN_EXT)
+	{
+		for (i = 0; i < 11; i++) bit[n++] = (id >> (28 - i)) & 1;
+		bit[n++] = 1;											/* SRR */
+		bit[n++] = 1;											/* IDE */
+		for (i = 0; i < 18; i++) bit[n++] = (id >> (17 - i)) & 1;
+		bit[n++] = rtr;
+		bit[n++] = 0;											/* r1 */
+	}
+	else
+	{
+		for (i = 0; i < 11; i++) bit[n++] = (id >> (10 - i)) & 1;
+		bit[n++] = rtr;
+		bit[n++] = 0;											/* IDE */
+	}
+	bit[n++] = 0;												/* r0 */
+	for (i = 0; i < 4; i++) bit[n++] = (f->dlc >> (3 - i)) & 1;
+	for (i = 0; i < 8 * LOGCAN_DATALEN(f->idf, f->dlc); i++) bit[n++] = (f->data[i / 8] >> (7 - i % 8)) & 1;
+
+	for (i = 0; i < n; i++)
+	{
+		x = bit[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7FFF;
+		if (x) crc ^= CRC15_POLY;
+	}
+	for (i = 0; i < 15; i++) bit[n++] = (crc >> (14 - i)) & 1;
+
+	/* A bit of the opposite level after five equal ones, the stuff bit
+	counting in the next run. */
+	for (i = 1, run = 1, stuff = 0, prev = bit[0]; i < n; i++)
+	{
+		if (bit[i] == prev)
+		{
+			run++;
+		}
+		else
+		{
+			run = 1;
+			prev = bit[i];
+		}
+		if (run == 5)
+		{
+			stuff++;
+			prev = !prev;
+			run = 1;
+		}
+	}
+	return n + stuff + FRAME_TAIL_BITS + IFS_BITS;
+}
+
+/* End of frame k on a bus: the controller takes it if a receive buffer is
+free, and interrupts. */
+static void Deliver (uint8_t bus, uint32_t k)
+{
+	LPC_CAN_TypeDef *can = &HostCan.reg[bus];
+	RXBUF *rx = &Rx[bus];
+
+	if (can->MOD & CAN_MOD_RM) return;
+	if (rx->count == 2)
+	{
+		Overruns++;
+		HOST_SET(can->GSR, can->GSR | CAN_GSR_DOS);
+		if (can->IER & CAN_IER_DOIE) HOST_SET(can->ICR, can->ICR | CAN_ICR_DOI);
+	}
+	else
+	{
+		rx->frame[(rx->head + rx->count) & 1] = k;
+		if (++rx->count == 1) Load(bus);
+	}
+	if (can->ICR) HOST_Irq(CAN_IRQn, CAN_IRQHandler);
+}
+
+/* Puts the frame at the head of the receive buffer in the registers. */
+static void Load (uint8_t bus)
+{
+	LPC_CAN_TypeDef *can = &HostCan.reg[bus];
+	const FRAME *f = &Gen[bus][Rx[bus].frame[Rx[bus].head]];
+	uint32_t d[2];
+
+	memcpy(d, f->data, sizeof(d));
+	HOST_SET(can->RFS, (uint32_t)f->dlc << 16 | (f->idf & (LOGCAN_EXT | LOGCAN_RTR)));
+	HOST_SET(can->RID, LOGCAN_ID(f->idf));
+	HOST_SET(can->RDA, d[0]);
+	HOST_SET(can->RDB, d[1]);
+	HOST_SET(can->GSR, can->GSR | CAN_GSR_RBS);
+	if (can->IER & CAN_IER_RIE) HOST_SET(can->ICR, can->ICR | CAN_ICR_RI);
+}
+
+/* CMR.RRB: the next frame, if any, takes the registers. */
+static void Release (uint8_t bus)
+{
+	LPC_CAN_TypeDef *can = &HostCan.reg[bus];
+	RXBUF *rx = &Rx[bus];
+
+	if (rx->count == 0) return;
+	rx->head ^= 1;
+	if (--rx->count != 0)
+	{
+		Load(bus);
+	}
+	else
+	{
+		HOST_SET(can->GSR, can->GSR & ~CAN_GSR_RBS);
+		HOST_SET(can->ICR, can->ICR & ~CAN_ICR_RI);
+	}
+}
+
+/* Access of the firmware to the registers of the controllers. */
+static void Access (uint32_t offset, bool write)
+{
+	uint32_t bus = offset / sizeof(LPC_CAN_TypeDef), reg = offset % sizeof(LPC_CAN_TypeDef);
+	LPC_CAN_TypeDef *can = &HostCan.reg[bus];
+
+	if (bus >= CAN_BUSES) return;
+	if (reg == offsetof(LPC_CAN_TypeDef, CMR) && write)
+	{
+		if (can->CMR & CAN_CMR_RRB) Release(bus);
+		if (can->CMR & CAN_CMR_CDO) HOST_SET(can->GSR, can->GSR & ~CAN_GSR_DOS);
+		can->CMR = 0;
+	}
+	else if (reg == offsetof(LPC_CAN_TypeDef, ICR) && !write)
+	{
+		HOST_SET(can->ICR, can->ICR & CAN_ICR_RI);			/* RI goes with the buffer */
+	}
+}
+
+/* Compares a CAN record with the frames sent. */
+static void Check (const LOGRECHDR *rec, const uint8_t *data)
+{
+	const uint8_t *p = data, *end = data + rec->len;
+	const FRAME *f;
+	uint64_t t0, t;
+	int64_t err;
+	uint32_t dt, idf, n, k, bus;
+	uint8_t dlc;
+
+	if (rec->chan != LOGREC_CH_CAN) return;
+	if (rec->flags & LOGREC_CAN_FL_CONFIG)
+	{
+		memcpy(&Cfg, data, sizeof(Cfg));
+		Configs++;
+		return;
+	}
+
+	t0 = ((uint64_t)rec->sec - HOST_EPOCH) * 1000000000ULL + rec->nsec;
+	while (p < end)
+	{
+		if (end - p < LOGCAN_HDR_SIZE)
+		{
+			Bad++;
+			return;
+		}
+		memcpy(&dt, p, 4);
+		memcpy(&idf, p + 4, 4);
+		dlc = p[8];
+		n = LOGCAN_DATALEN(idf, dlc);
+		if ((uint32_t)(end - p) < LOGCAN_HDR_SIZE + n)
+		{
+			Bad++;
+			return;
+		}
+		t = t0 + dt;
+		bus = (idf & LOGCAN_BUS2) ? 1 : 0;
+
+		/* The frame is looked for from the one expected on: a gap is only
+		allowed in a LOGREC_CAN_FL_LOST record. */
+		for (k = Next[bus]; k < GenCount[bus] && Gen[bus][k].end <= t + TS_TOLERANCE; k++)
+		{
+			f = &Gen[bus][k];
+			if (f->idf == idf && f->dlc == dlc && memcmp(f->data, p + LOGCAN_HDR_SIZE, n) == 0
+					&& f->end + TS_TOLERANCE >= t) break;
+		}
+		if (k == GenCount[bus] || Gen[bus][k].end > t + TS_TOLERANCE)
+		{
+			Bad++;
+		}
+		else
+		{
+			Missing += k - Next[bus];
+			if (k != Next[bus] && !(rec->flags & LOGREC_CAN_FL_LOST)) Unflagged++;
+			Next[bus] = k + 1;
+			Logged++;
+
+			err = (int64_t)(t - Gen[bus][k].end);
+			if (err < 0) err = -err;
+			if (err > TsError) TsError = err;
+		}
+		p += LOGCAN_HDR_SIZE + n;
+	}
+}
+
+/* xorshift32 */
+static uint32_t Random (void)
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Seed;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,362 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file chanbench.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: card write commands per MB for one file per channel
+ *        against a single merged file.
+ *
+ * Runs the FatFs of the firmware on a RAM disk formatted with VOL_Format()
+ * (volfmt.h) and logs the same mix of four channels (ADC blocks, CAN
+ * frames, serial bursts and encoder events, about 470KB/s) in four ways:
+ *
+ *   - merged:   one ring file for all channels, as ringlog.c writes it
+ *               with RINGLOG_CHANNEL_FILES at 0, with runs of RUN sectors
+ *               and with runs of 4 * RUN sectors (the same RAM as below)
+ *   - channels: a ring file per channel, each with its own run buffer of
+ *               RUN sectors, as ringlog.c writes them with
+ *               RINGLOG_CHANNEL_FILES at 4
+ *   - f_write:  a plain file per channel and an f_write() per record, the
+ *               files sharing the sector window of the _FS_TINY FatFs
+ *
+ * Every second of the stream the partial sectors are written in place, as
+ * RING_Task() does, and the plain files are synced. For each way it prints
+ * the disk writes and reads per MB of records, the mean write size, and
+ * the writes that land in another allocation unit (AU) than the write
+ * before them, which is what costs a card that keeps few AUs open.
+ *
+ * @code
+ *   chanbench [MB [RUN]]               # default 64MB of records, RUN 8
+ * @endcode
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -I../fatfs/src -o chanbench chanbench.c ../src/volfmt.c \
+ *       ../src/config.c ../src/crc16.c ../fatfs/src/ff.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "logformat.h"
+#include "volfmt.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+#define DISK_SECTORS		524288			/* 256MB */
+#define AU_SECTORS			8192			/* 4MB */
+#define RING_SIZE			(32UL * 1024 * 1024)
+#define RING_SECTORS		((RING_SIZE - LOGSEG_HDR_SIZE) / SS)
+#define RUN_MAX				64
+#define CHANNELS			4
+#define TICKS				1000			/* Ticks of the record mix per second */
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* A ring file written by LBA, as in ringlog.c */
+typedef struct tagRING
+{
+	BYTE buf[RUN_MAX][SS];
+	DWORD base, head;
+	UINT count, fill;
+} RING;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static BYTE *Disk;
+static unsigned long Writes, Sectors, Reads, AuChanges, Unordered;
+static DWORD LastAu = 0xFFFFFFFF;
+static DWORD *AuNext;					/* Per AU: sector after the last write into it */
+
+static const BYTE Chan[CHANNELS] = { LOGREC_CH_ADC, LOGREC_CH_CAN, LOGREC_CH_UART, LOGREC_CH_MOTION };
+static RING Ring[CHANNELS];
+static FIL File[CHANNELS];
+static UINT Run;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static int Bench (const char *what, int mode, unsigned long mb);
+static void MakeName (char *name, int mode, UINT i);
+static int Open (int mode, UINT i);
+static int Close (int mode, UINT i);
+static void Record (int mode, UINT i, const BYTE *rec, UINT len);
+static void Flush (int mode);
+static void RingAdd (RING *r, const BYTE *p, UINT len);
+static void RingWrite (RING *r, UINT n);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	static FATFS fs;
+	unsigned long mb = (argc > 1) ? strtoul(argv[1], NULL, 0) : 64;
+	UINT run = (argc > 2) ? strtoul(argv[2], NULL, 0) : 8;
+	int ret;
+
+	if (mb == 0 || run == 0 || 4 * run > RUN_MAX)
+	{
+		fprintf(stderr, "usage: chanbench [MB [RUN]]    (RUN up to %u)\n", RUN_MAX / 4);
+		return 2;
+	}
+	Disk = calloc(DISK_SECTORS, SS);
+	AuNext = calloc(DISK_SECTORS / AU_SECTORS, sizeof(DWORD));
+	if (Disk == NULL || AuNext == NULL || f_mount(&fs, "", 0) != FR_OK || VOL_Format("") != FR_OK || f_mount(&fs, "", 1) != FR_OK)
+	{
+		fprintf(stderr, "no volume\n");
+		return 1;
+	}
+
+	printf("%luMB of records, %u channels, AU %uKB\n", mb, CHANNELS, AU_SECTORS * SS / 1024);
+	printf("                      writes/MB  reads/MB  KB/write  AU changes/MB  unordered/MB\n");
+	Run = run;
+	ret = Bench("merged, run", 0, mb);
+	Run = 4 * run;
+	ret |= Bench("merged, run", 0, mb);
+	Run = run;
+	ret |= Bench("channels, run", 1, mb);
+	ret |= Bench("f_write", 2, mb);
+	return ret;
+}
+
+/* RAM disk */
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DISK_SECTORS) return RES_PARERR;
+	memcpy(buff, Disk + (size_t)sector * SS, (size_t)count * SS);
+	Reads++;
+	return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DISK_SECTORS) return RES_PARERR;
+	memcpy(Disk + (size_t)sector * SS, buff, (size_t)count * SS);
+	Writes++;
+	Sectors += count;
+	if (sector / AU_SECTORS != LastAu) AuChanges++;
+	if (AuNext[sector / AU_SECTORS] != 0 && AuNext[sector / AU_SECTORS] != sector) Unordered++;
+	LastAu = (sector + count - 1) / AU_SECTORS;
+	AuNext[sector / AU_SECTORS] = AuNext[LastAu] = sector + count;
+	return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	if (pdrv) return RES_PARERR;
+	switch (cmd)
+	{
+		case CTRL_SYNC:
+		case CTRL_TRIM:
+			return RES_OK;
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = DISK_SECTORS;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = AU_SECTORS;
+			return RES_OK;
+		default:
+			return RES_PARERR;
+	}
+}
+
+DWORD get_fattime (void)
+{
+	return (DWORD)(2026 - 1980) << 25 | 10UL << 21 | 18UL << 16;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Logs mb megabytes of the record mix in one of the ways (0: merged ring,
+1: ring per channel, 2: f_write per record) and prints the counts. */
+static int Bench (const char *what, int mode, unsigned long mb)
+{
+	static BYTE rec[sizeof(LOGRECHDR) + 256];
+	LOGRECHDR *hdr = (LOGRECHDR *)rec;
+	unsigned long long bytes = 0, total = (unsigned long long)mb << 20;
+	unsigned long tick, k;
+	UINT i, n, files = (mode == 0) ? 1 : CHANNELS;
+	char label[32];
+	double m;
+
+	for (i = 0; i < files; i++)
+	{
+		if (Open(mode, i)) return 1;
+	}
+	Writes = Sectors = Reads = AuChanges = Unordered = 0;
+	LastAu = 0xFFFFFFFF;
+	memset(AuNext, 0, DISK_SECTORS / AU_SECTORS * sizeof(DWORD));
+
+	for (tick = 0; bytes < total; tick++)
+	{
+		hdr->sec = tick / TICKS;
+		hdr->nsec = tick % TICKS * (1000000000 / TICKS);
+
+		/* Per tick: an ADC block, four CAN frames, a serial burst and two
+		encoder events. */
+		for (k = 0; k < 8; k++)
+		{
+			if (k == 0) i = 0, n = 256;
+			else if (k < 5) i = 1, n = 16;
+			else if (k == 5) i = 2, n = 1 + ((uint32_t)(tick * 2654435761UL) >> 26);
+			else i = 3, n = 12;
+
+			hdr->chan = Chan[i];
+			hdr->flags = 0;
+			hdr->len = n;
+			memset(rec + sizeof(LOGRECHDR), (BYTE)tick, n);
+			Record(mode, (mode == 0) ? 0 : i, rec, sizeof(LOGRECHDR) + n);
+			bytes += sizeof(LOGRECHDR) + n;
+		}
+		if (tick % TICKS == TICKS - 1) Flush(mode);
+	}
+	Flush(mode);
+
+	for (i = 0; i < files; i++)
+	{
+		if (Close(mode, i)) return 1;
+	}
+
+	m = bytes / 1048576.0;
+	if (mode == 2) snprintf(label, sizeof(label), "%s", what);
+	else snprintf(label, sizeof(label), "%s %u", what, Run);
+	printf("%-20s %10.1f %9.1f %9.2f %14.1f %13.1f\n", label, Writes / m, Reads / m,
+			Sectors * (SS / 1024.0) / Writes, AuChanges / m, Unordered / m);
+	return 0;
+}
+
+static void MakeName (char *name, int mode, UINT i)
+{
+	if (mode == 0) strcpy(name, LOGRING_NAME);
+	else if (mode == 1) sprintf(name, "%s%02u%s", LOGRING_CH_PREFIX, Chan[i], LOGSEG_NAME_EXT);
+	else sprintf(name, "CH%02u%s", Chan[i], LOGSEG_NAME_EXT);
+}
+
+/* Creates the file of channel i (or of the merged ring) and, for a ring,
+takes the LBA of its single extent. */
+static int Open (int mode, UINT i)
+{
+	DWORD clmt[4], au, clst, off;
+	char name[16];
+	FIL *fil = &File[i];
+	FATFS *fs;
+	RING *r = &Ring[i];
+
+	MakeName(name, mode, i);
+	if (f_open(fil, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return 1;
+	if (mode == 2) return 0;
+
+	fs = fil->fs;
+
+	/* The AlignAlloc() of ringlog.c */
+	if (disk_ioctl(0, GET_BLOCK_SIZE, &au) == RES_OK && au > fs->csize)
+	{
+		clst = (fs->last_clust >= 2 && fs->last_clust < fs->n_fatent) ? fs->last_clust + 1 : 2;
+		off = (fs->database + (clst - 2) * fs->csize) % au;
+		if (off != 0 && (au - off) % fs->csize == 0 && clst + (au - off) / fs->csize < fs->n_fatent)
+		{
+			fs->last_clust = clst + (au - off) / fs->csize - 1;
+		}
+	}
+
+	clmt[0] = 4;
+	if (f_lseek(fil, RING_SIZE) != FR_OK || f_size(fil) != RING_SIZE
+			|| (fil->cltbl = clmt, f_lseek(fil, CREATE_LINKMAP)) != FR_OK)
+	{
+		fprintf(stderr, "%s: no single extent\n", name);
+		return 1;
+	}
+	fil->cltbl = NULL;
+	r->base = fil->fs->database + (clmt[2] - 2) * fil->fs->csize + LOGSEG_HDR_SIZE / SS;
+	r->head = r->count = r->fill = 0;
+	return 0;
+}
+
+/* Closes and deletes the file, so the next way starts on the same free
+space. */
+static int Close (int mode, UINT i)
+{
+	char name[16];
+
+	MakeName(name, mode, i);
+	return f_close(&File[i]) != FR_OK || f_unlink(name) != FR_OK;
+}
+
+static void Record (int mode, UINT i, const BYTE *rec, UINT len)
+{
+	UINT bw;
+
+	if (mode == 2) f_write(&File[i], rec, len, &bw);
+	else RingAdd(&Ring[i], rec, len);
+}
+
+/* The partial sectors written in place, or the plain files synced */
+static void Flush (int mode)
+{
+	UINT i;
+	RING *r;
+
+	for (i = 0; i < ((mode == 0) ? 1 : CHANNELS); i++)
+	{
+		r = &Ring[i];
+		if (mode == 2) f_sync(&File[i]);
+		else if (r->count || r->fill) RingWrite(r, r->count + (r->fill ? 1 : 0));
+	}
+}
+
+/* The packing of AddBytes() in ringlog.c, without the sector headers */
+static void RingAdd (RING *r, const BYTE *p, UINT len)
+{
+	UINT n;
+
+	while (len)
+	{
+		n = LOGRING_PAYLOAD - r->fill;
+		if (n > len) n = len;
+		memcpy(&r->buf[r->count][sizeof(LOGRINGSEC) + r->fill], p, n);
+		r->fill += n;
+		p += n;
+		len -= n;
+
+		if (r->fill == LOGRING_PAYLOAD)
+		{
+			r->count++;
+			r->fill = 0;
+			if (r->count == Run || r->head + r->count == RING_SECTORS) RingWrite(r, r->count);
+		}
+	}
+}
+
+static void RingWrite (RING *r, UINT n)
+{
+	disk_write(0, r->buf[0], r->base + r->head, n);
+	r->head = (r->head + r->count) % RING_SECTORS;
+	if (r->count && r->fill) memcpy(r->buf[0], r->buf[r->count], SS);
+	r->count = 0;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
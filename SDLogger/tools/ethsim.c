@@ -0,0 +1,587 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file ethsim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs ethcap.c against a simulated EMAC and card, and
+ *        checks the pcapng file frame for frame against the frames sent.
+ *
+ * The line is a source of the simulation (hostsim.h) that ends one frame
+ * at a time at 100Mbit/s, preamble and inter-frame gap included. The
+ * frames are read from a classic pcap file (Ethernet link type), sent at
+ * their recorded spacing or back to back at the load given, or made up:
+ * random bytes, of the length given or of mixed lengths, one in 100 with
+ * a CRC error.
+ *
+ * The model of the EMAC keeps the receive descriptors of the driver
+ * (lpc17xx_emac.c): at the end of a frame the frame and its FCS go in the
+ * buffer of the descriptor at RxProduceIndex, its status word gets the
+ * size, the last fragment flag and the CRC error, RxProduceIndex moves on
+ * and RX_DONE raises ENET_IRQHandler(). With no free descriptor the frame
+ * is lost and RX_OVERRUN is raised instead. The registers are watched
+ * with HOST_Trap(): IntClear clears IntStatus, the reset bits of Command
+ * clear themselves, and a read on the MII management interface answers as
+ * the DP83848C of the board does, link up at 100Mbit/s full duplex.
+ *
+ * The main loop runs ETHCAP_Task(), which writes to the card model of
+ * hostsim.c; at the end ETHCAP_Close() closes the file. Then the file is
+ * read back from the RAM disk, block by block. The section header and
+ * the interface description must be those of ethcap.c, every block must
+ * have its length at both ends, and the file must be whole sectors.
+ * Each EPB must hold the frame received at its timestamp, to the
+ * nanosecond, cut to the snap length, with its original length. Frames
+ * with a CRC error must not be there. Every other frame missing before an
+ * EPB must be counted by the epb_dropcount of that EPB, and the frames
+ * missing after the last one by the isb_ifdrop of the closing statistics
+ * block, which must equal ETHCAP_Dropped(). The exit status is 1 when a
+ * frame is damaged or out of place, or a loss is miscounted.
+ *
+ * @code
+ *   ethsim [options] [SECONDS [LOAD [SNAP [LEN]]]]  # default 10s, 100%, 128, mixed
+ *   ethsim [options] FILE.pcap [LOAD [SNAP]]        # LOAD 0: recorded spacing
+ *   ethsim -s 20 10 5 1536 1514                     # whole frames, card stalls
+ * @endcode
+ *
+ * LOAD is the share of the line taken by the frames, in percent. The
+ * options of the card model are listed by hostsim.c (HOST_Usage()). Build
+ * it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o ethsim ethsim.c host/hostsim.c ../src/ethcap.c ../src/logger.c \
+ *       ../src/lzpack.c ../src/crc16.c ../src/config.c ../src/volfmt.c \
+ *       ../fatfs/src/ff.c ../library/src/lpc17xx_emac.c \
+ *       ../library/src/lpc17xx_clkpwr.c ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_emac.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "ethcap.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define VOLUME_MB			256
+#define BYTE_NS				80						/* 100Mbit/s */
+#define WIRE_EXTRA			20						/* Preamble, SFD and inter-frame gap */
+#define HEAD_EXTRA			8						/* Preamble and SFD */
+#define FCS_SIZE			4
+#define MIN_LEN				60						/* Without FCS */
+#define MAX_LEN				1514
+#define CRC_ERR_ONE_IN		100
+
+#define UNIX_2000			946684800ULL			/* Seconds from 1970 to TS_EPOCH_YEAR */
+#define PCAP_MAGIC_US		0xA1B2C3D4UL
+#define PCAP_MAGIC_NS		0xA1B23C4DUL
+
+#define PCAPNG_SHB			0x0A0D0D0AUL
+#define PCAPNG_IDB			0x00000001UL
+#define PCAPNG_ISB			0x00000005UL
+#define PCAPNG_EPB			0x00000006UL
+#define PCAPNG_PAD			0x80000001UL
+
+#define EMAC				(&HostEmac.reg[0])
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* What became of a frame on the line */
+typedef enum
+{
+	FATE_NONE = 0,			/* Not sent, or the receiver was off */
+	FATE_RECEIVED,			/* In a descriptor */
+	FATE_OVERRUN,			/* No free descriptor */
+	FATE_CRC				/* Received with a CRC error */
+} FATE;
+
+typedef struct tagFRAME
+{
+	uint64_t end;			/* End of the FCS, HOST_Ns */
+	uint8_t *data;			/* From the pcap file, or NULL: made up */
+	uint16_t len;			/* Without FCS */
+	uint8_t crcerr;
+	uint8_t fate;
+} FRAME;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static FRAME *Frames;
+static uint32_t Count, Sent;
+static uint32_t Snap;
+static uint32_t Seed = 1;
+static uint16_t Bmcr;
+static uint32_t Overruns, CrcErrors, Skipped;
+
+static uint32_t Pos, Epbs, Pads, Missing, Miscounted, Bad, BadBlock, Isbs;
+static uint64_t Drops, IsbDrops;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static int ReadPcap (const char *name, uint32_t load);
+static void MakeFrames (uint32_t seconds, uint32_t load, uint32_t len);
+static void Place (uint32_t load);
+static uint64_t Line (uint64_t now);
+static void Raise (uint32_t status);
+static void Access (uint32_t offset, bool write);
+static uint16_t Phy (uint32_t reg);
+static void Data (uint32_t i, uint8_t *buf);
+static int CheckFile (const TCHAR *name);
+static void CheckEpb (const BYTE *p, DWORD len);
+static uint32_t Random (void);
+
+/* Handler of ethcap.c, declared by the startup code on the board */
+void ENET_IRQHandler (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	char cfg[48], *e;
+	FILINFO fno;
+	DIR dir;
+	TCHAR name[13];
+	uint64_t end, bytes = 0;
+	uint32_t seconds = 10, load = 100, len = 0, i, files = 0, received = 0;
+	int a = HOST_Options(argc, argv);
+
+	if (a < 0)
+	{
+		fprintf(stderr, "usage: ethsim [options] [SECONDS [LOAD [SNAP [LEN]]]]\n"
+				"       ethsim [options] FILE.pcap [LOAD [SNAP]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	Snap = 128;
+	if (a < argc && (strtoul(argv[a], &e, 0), *e != 0))
+	{
+		load = (a + 1 < argc) ? strtoul(argv[a + 1], NULL, 0) : 0;
+		if (a + 2 < argc) Snap = strtoul(argv[a + 2], NULL, 0);
+		if (ReadPcap(argv[a], load) != 0) return 1;
+	}
+	else
+	{
+		if (a < argc) seconds = strtoul(argv[a], NULL, 0);
+		if (a + 1 < argc) load = strtoul(argv[a + 1], NULL, 0);
+		if (a + 2 < argc) Snap = strtoul(argv[a + 2], NULL, 0);
+		if (a + 3 < argc) len = strtoul(argv[a + 3], NULL, 0);
+		if (load == 0 || load > 100 || (len && (len < MIN_LEN || len > MAX_LEN)))
+		{
+			fprintf(stderr, "LOAD from 1 to 100, LEN from %u to %u\n", MIN_LEN, MAX_LEN);
+			return 2;
+		}
+		MakeFrames(seconds, load, len);
+	}
+	if (Frames == NULL) return 1;
+	if (Snap == 0 || Snap > EMAC_ETH_MAX_FLEN) Snap = EMAC_ETH_MAX_FLEN;
+
+	snprintf(cfg, sizeof(cfg), "eth = 1\nethsnap = %lu\n", (unsigned long)Snap);
+	if (HOST_Init(VOLUME_MB, cfg) != 0 || HOST_Trap(&HostEmac, Access) != 0) return 1;
+	if (ETHCAP_Init() != FR_OK)
+	{
+		fprintf(stderr, "no capture\n");
+		return 1;
+	}
+
+	/* The frames start with the capture */
+	for (i = 0; i < Count; i++) Frames[i].end += HOST_Ns;
+	end = (Count ? Frames[Count - 1].end : HOST_Ns) + HOST_MS;
+	if (Count) HOST_Source(Line, Frames[0].end);
+	while (HOST_Ns < end)
+	{
+		ETHCAP_Task();
+		HOST_Loop();
+	}
+	if (ETHCAP_Close() != FR_OK)
+	{
+		fprintf(stderr, "ETHCAP_Close() failed\n");
+		return 1;
+	}
+
+	for (i = 0; i < Count; i++)
+	{
+		bytes += Frames[i].len;
+		if (Frames[i].fate == FATE_RECEIVED) received++;
+	}
+	printf("%.1fs: %lu frames of %.0f bytes on average, %.0f frames/s, %lu with CRC errors, %lu EMAC overruns",
+			(end - Frames[0].end) / 1e9, (unsigned long)Count, Count ? (double)bytes / Count : 0.0,
+			Count * 1e9 / (end - Frames[0].end), (unsigned long)CrcErrors, (unsigned long)Overruns);
+	if (Skipped) printf(", %lu longer than %u bytes left out", (unsigned long)Skipped, MAX_LEN);
+	printf("\n");
+	HOST_Report();
+	HOST_Timed(false);
+
+	if (f_opendir(&dir, "") != FR_OK) return 1;
+	while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0)
+	{
+		if (strncmp(fno.fname, ETHCAP_NAME_PREFIX, sizeof(ETHCAP_NAME_PREFIX) - 1) != 0) continue;
+		strcpy(name, fno.fname);
+		files++;
+	}
+	f_closedir(&dir);
+	if (files != 1 || CheckFile(name) != 0)
+	{
+		fprintf(stderr, "%lu capture files\n", (unsigned long)files);
+		return 1;
+	}
+
+	/* The frames lost after the last EPB */
+	for (; Pos < Count; Pos++)
+	{
+		if (Frames[Pos].fate == FATE_RECEIVED || Frames[Pos].fate == FATE_OVERRUN) Missing++;
+	}
+	printf("%lu EPBs, %lu padding blocks; %lu frames missing (epb_dropcount %llu, isb_ifdrop %llu, ETHCAP_Dropped() %lu), "
+			"%lu miscounted, %lu damaged or out of place, %lu bad blocks\n",
+			(unsigned long)Epbs, (unsigned long)Pads, (unsigned long)Missing, (unsigned long long)Drops,
+			(unsigned long long)IsbDrops, (unsigned long)ETHCAP_Dropped(), (unsigned long)Miscounted,
+			(unsigned long)Bad, (unsigned long)BadBlock);
+
+	HOST_Save();
+	return (Miscounted || Bad || BadBlock || Isbs != 1 || Missing != ETHCAP_Dropped() || IsbDrops != Missing
+			|| Epbs + Missing != received + Overruns) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Frames of a classic pcap file. */
+static int ReadPcap (const char *name, uint32_t load)
+{
+	FILE *f = fopen(name, "rb");
+	uint8_t hdr[24], rec[16];
+	uint64_t first = 0, t;
+	uint32_t magic, incl, orig, max = 0;
+	bool swap, ns;
+
+#define PCAP_U32(b)		(swap ? ((uint32_t)(b)[0] << 24 | (uint32_t)(b)[1] << 16 | (uint32_t)(b)[2] << 8 | (b)[3]) \
+						: ((uint32_t)(b)[3] << 24 | (uint32_t)(b)[2] << 16 | (uint32_t)(b)[1] << 8 | (b)[0]))
+
+	if (f == NULL || fread(hdr, sizeof(hdr), 1, f) != 1)
+	{
+		fprintf(stderr, "cannot read %s\n", name);
+		return -1;
+	}
+	swap = false;
+	magic = PCAP_U32(hdr);
+	if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS)
+	{
+		swap = true;
+		magic = PCAP_U32(hdr);
+	}
+	ns = (magic == PCAP_MAGIC_NS);
+	if ((magic != PCAP_MAGIC_US && !ns) || PCAP_U32(hdr + 20) != 1)
+	{
+		fprintf(stderr, "%s is not a classic pcap file of Ethernet frames\n", name);
+		return -1;
+	}
+
+	while (fread(rec, sizeof(rec), 1, f) == 1)
+	{
+		t = PCAP_U32(rec) * 1000000000ULL + PCAP_U32(rec + 4) * (ns ? 1 : 1000);
+		incl = PCAP_U32(rec + 8);
+		orig = PCAP_U32(rec + 12);
+		if (incl > orig || orig > MAX_LEN)
+		{
+			if (incl > 0x40000 || fseek(f, incl, SEEK_CUR) != 0) break;
+			Skipped++;
+			continue;
+		}
+		if (Count == max)
+		{
+			max = max ? 2 * max : 4096;
+			Frames = realloc(Frames, max * sizeof(FRAME));
+			if (Frames == NULL) return -1;
+		}
+		if (Count == 0) first = t;
+
+		/* Cut in the file or sent unpadded: zeros, as on the line */
+		Frames[Count].len = (orig < MIN_LEN) ? MIN_LEN : orig;
+		Frames[Count].data = calloc(Frames[Count].len, 1);
+		if (Frames[Count].data == NULL || fread(Frames[Count].data, 1, incl, f) != incl) break;
+		Frames[Count].end = t - first;
+		Frames[Count].crcerr = 0;
+		Frames[Count].fate = FATE_NONE;
+		Count++;
+	}
+#undef PCAP_U32
+	fclose(f);
+	if (Count == 0)
+	{
+		fprintf(stderr, "no frame in %s\n", name);
+		return -1;
+	}
+	Place(load);
+	return 0;
+}
+
+/* Random frames for the time given. */
+static void MakeFrames (uint32_t seconds, uint32_t load, uint32_t len)
+{
+	uint64_t t = 0, wire;
+	uint32_t max = 0, r;
+
+	while (t < seconds * 1000000000ULL)
+	{
+		if (Count == max)
+		{
+			max = max ? 2 * max : 65536;
+			Frames = realloc(Frames, max * sizeof(FRAME));
+			if (Frames == NULL) return;
+		}
+		r = Random();
+		if (len) Frames[Count].len = len;
+		else if (r % 3 == 0) Frames[Count].len = MIN_LEN;
+		else if (r % 3 == 1) Frames[Count].len = MAX_LEN;
+		else Frames[Count].len = MIN_LEN + (r >> 8) % (MAX_LEN - MIN_LEN + 1);
+		Frames[Count].data = NULL;
+		Frames[Count].crcerr = (Random() % CRC_ERR_ONE_IN == 0);
+		Frames[Count].fate = FATE_NONE;
+
+		wire = (uint64_t)(Frames[Count].len + FCS_SIZE + WIRE_EXTRA) * BYTE_NS;
+		Frames[Count].end = t;
+		t += wire * 100 / load;
+		Count++;
+	}
+	Place(load);
+}
+
+/* Turns the start of each frame into the end of its FCS, keeping them
+apart by their time on the line. With a load, back to back at it. */
+static void Place (uint32_t load)
+{
+	uint64_t start = HOST_MS, min = 0, wire;
+	uint32_t i;
+
+	for (i = 0; i < Count; i++)
+	{
+		wire = (uint64_t)(Frames[i].len + FCS_SIZE + WIRE_EXTRA) * BYTE_NS;
+		if (load == 0 || Frames[i].data == NULL) start = HOST_MS + Frames[i].end;
+		if (start < min) start = min;
+		Frames[i].end = start + (uint64_t)(HEAD_EXTRA + Frames[i].len + FCS_SIZE) * BYTE_NS;
+		min = start + wire;
+		if (load) start += wire * 100 / load;
+	}
+}
+
+/* End of a frame: into the next free descriptor. */
+static uint64_t Line (uint64_t now)
+{
+	static uint8_t buf[MAX_LEN + FCS_SIZE];
+	FRAME *f = &Frames[Sent];
+	RX_Desc *desc = (RX_Desc *)(uintptr_t)EMAC->RxDescriptor;
+	RX_Stat *stat = (RX_Stat *)(uintptr_t)EMAC->RxStatus;
+	uint32_t n = EMAC->RxDescriptorNumber + 1;
+	uint32_t p = EMAC->RxProduceIndex;
+
+	(void)now;
+	if (EMAC->Command & EMAC_CR_RX_EN)
+	{
+		if ((p + 1) % n == EMAC->RxConsumeIndex)
+		{
+			f->fate = FATE_OVERRUN;
+			Overruns++;
+			Raise(EMAC_INT_RX_OVERRUN);
+		}
+		else
+		{
+			f->fate = f->crcerr ? FATE_CRC : FATE_RECEIVED;
+			if (f->crcerr) CrcErrors++;
+			Data(Sent, buf);
+			memset(buf + f->len, 0xA5, FCS_SIZE);
+			memcpy((void *)(uintptr_t)desc[p].Packet, buf, f->len + FCS_SIZE);
+			stat[p].Info = (f->len + FCS_SIZE - 1) | EMAC_RINFO_LAST_FLAG | (f->crcerr ? EMAC_RINFO_CRC_ERR : 0);
+			HOST_SET(EMAC->RxProduceIndex, (p + 1) % n);
+			Raise(EMAC_INT_RX_DONE);
+		}
+	}
+	return (++Sent < Count) ? Frames[Sent].end : HOST_NEVER;
+}
+
+/* Interrupt of the EMAC. */
+static void Raise (uint32_t status)
+{
+	HOST_SET(EMAC->IntStatus, EMAC->IntStatus | status);
+	if (EMAC->IntStatus & EMAC->IntEnable) HOST_Irq(ENET_IRQn, ENET_IRQHandler);
+}
+
+/* Access of the firmware to the registers of the EMAC. */
+static void Access (uint32_t offset, bool write)
+{
+	if (!write) return;
+
+	if (offset == offsetof(LPC_EMAC_TypeDef, IntClear))
+	{
+		HOST_SET(EMAC->IntStatus, EMAC->IntStatus & ~EMAC->IntClear);
+	}
+	else if (offset == offsetof(LPC_EMAC_TypeDef, Command))
+	{
+		EMAC->Command &= ~(EMAC_CR_REG_RES | EMAC_CR_TX_RES | EMAC_CR_RX_RES);
+	}
+	else if (offset == offsetof(LPC_EMAC_TypeDef, MCMD) && (EMAC->MCMD & EMAC_MCMD_READ))
+	{
+		HOST_SET(EMAC->MRDD, Phy(EMAC->MADR & 0x1F));
+	}
+	else if (offset == offsetof(LPC_EMAC_TypeDef, MWTD) && (EMAC->MADR & 0x1F) == EMAC_PHY_REG_BMCR)
+	{
+		Bmcr = EMAC->MWTD & ~EMAC_PHY_BMCR_RESET;			/* Reset done at once */
+	}
+}
+
+/* Registers of the DP83848C, link up at 100Mbit/s full duplex. */
+static uint16_t Phy (uint32_t reg)
+{
+	switch (reg)
+	{
+		case EMAC_PHY_REG_BMCR: return Bmcr;
+		case EMAC_PHY_REG_IDR1: return EMAC_DP83848C_ID >> 16;
+		case EMAC_PHY_REG_IDR2: return EMAC_DP83848C_ID & 0xFFFF;
+		case EMAC_PHY_REG_STS: return EMAC_PHY_SR_LINK | EMAC_PHY_SR_DUP | EMAC_PHY_SR_AUTO_DONE;
+		default: return 0;
+	}
+}
+
+/* Bytes of frame i, without FCS. */
+static void Data (uint32_t i, uint8_t *buf)
+{
+	uint32_t s = i * 2654435761UL + 1, k;
+
+	if (Frames[i].data != NULL)
+	{
+		memcpy(buf, Frames[i].data, Frames[i].len);
+		return;
+	}
+	for (k = 0; k < Frames[i].len; k++)
+	{
+		s ^= s << 13;
+		s ^= s >> 17;
+		s ^= s << 5;
+		buf[k] = s >> 24;
+	}
+}
+
+/* Walks the blocks of the capture file. */
+static int CheckFile (const TCHAR *name)
+{
+	FIL fil;
+	BYTE *buf, *p;
+	DWORD size, off, len, type;
+	UINT br;
+
+	if (f_open(&fil, name, FA_READ) != FR_OK) return -1;
+	size = f_size(&fil);
+	buf = malloc(size + 1);
+	if (buf == NULL || f_read(&fil, buf, size, &br) != FR_OK || br != size) return -1;
+	f_close(&fil);
+	printf("%s: %lu bytes\n", name, (unsigned long)size);
+
+	/* Section header and interface description of ethcap.c */
+	p = buf + 28;
+	if (size % _MAX_SS != 0 || size < 60 || LD_DWORD(buf) != PCAPNG_SHB || LD_DWORD(buf + 4) != 28
+		|| LD_DWORD(buf + 8) != 0x1A2B3C4DUL || LD_WORD(buf + 12) != 1 || LD_WORD(buf + 14) != 0
+		|| LD_DWORD(p) != PCAPNG_IDB || LD_DWORD(p + 4) != 32 || LD_WORD(p + 8) != 1 || LD_DWORD(p + 12) != Snap
+		|| LD_WORD(p + 16) != 9 || LD_WORD(p + 18) != 1 || p[20] != 9 || LD_DWORD(p + 24) != 0)
+	{
+		BadBlock++;
+	}
+
+	for (off = 0; off + 12 <= size; off += len)
+	{
+		p = buf + off;
+		type = LD_DWORD(p);
+		len = LD_DWORD(p + 4);
+		if (len < 12 || len % 4 || len > size - off || LD_DWORD(p + len - 4) != len)
+		{
+			BadBlock++;
+			break;
+		}
+		if (type == PCAPNG_EPB)
+		{
+			CheckEpb(p, len);
+		}
+		else if (type == PCAPNG_PAD)
+		{
+			Pads++;
+		}
+		else if (type == PCAPNG_ISB && len == 40 && LD_WORD(p + 20) == 5 && LD_WORD(p + 22) == 8)
+		{
+			Isbs++;
+			IsbDrops = LD_DWORD(p + 24) | (uint64_t)LD_DWORD(p + 28) << 32;
+		}
+		else if (off != 0 && off != 28)
+		{
+			BadBlock++;
+		}
+	}
+	if (off != size) BadBlock++;
+	free(buf);
+	return 0;
+}
+
+/* An EPB holds the frame received at its timestamp, and counts the frames
+missing before it. */
+static void CheckEpb (const BYTE *p, DWORD len)
+{
+	static uint8_t frame[MAX_LEN];
+	const BYTE *o, *end = p + len - 4;
+	uint64_t ns, drops = 0;
+	uint32_t cap, orig, data, missing = 0, k;
+
+	Epbs++;
+	ns = ((uint64_t)LD_DWORD(p + 12) << 32 | LD_DWORD(p + 16)) - (UNIX_2000 + HOST_EPOCH) * 1000000000ULL;
+	cap = LD_DWORD(p + 20);
+	orig = LD_DWORD(p + 24);
+	data = (cap + 3) & ~3UL;
+	if (LD_DWORD(p + 8) != 0 || 28 + data + 4 > len)
+	{
+		Bad++;
+		return;
+	}
+	for (o = p + 28 + data; o + 4 <= end && LD_WORD(o) != 0; o += 4 + ((LD_WORD(o + 2) + 3) & ~3))
+	{
+		if (LD_WORD(o) == 4 && LD_WORD(o + 2) == 8) drops = LD_DWORD(o + 4) | (uint64_t)LD_DWORD(o + 8) << 32;
+	}
+	Drops += drops;
+
+	for (k = Pos; k < Count && Frames[k].end < ns; k++)
+	{
+		if (Frames[k].fate == FATE_RECEIVED || Frames[k].fate == FATE_OVERRUN) missing++;
+	}
+	if (k == Count || Frames[k].end != ns || Frames[k].fate != FATE_RECEIVED)
+	{
+		Bad++;
+		return;
+	}
+	if (missing != drops) Miscounted++;
+	Missing += missing;
+	Pos = k + 1;
+
+	Data(k, frame);
+	if (orig != Frames[k].len || cap != ((orig < Snap) ? orig : Snap) || memcmp(p + 28, frame, cap) != 0) Bad++;
+}
+
+/* xorshift32 */
+static uint32_t Random (void)
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Seed;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
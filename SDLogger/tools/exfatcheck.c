@@ -0,0 +1,1416 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file exfatcheck.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: checks the exFAT support of FatFs (ff.c) against
+ *        volumes it did not make, and the volumes it leaves behind.
+ *
+ * The image is a sparse file on the PC, so a volume of several GB takes
+ * only the space of the data written. Without -i the tool formats it
+ * itself, following the exFAT specification and sharing no code with
+ * ff.c: boot region and its backup with the checksum sector, FAT, the
+ * allocation bitmap, a compressed up-case table and a root directory with
+ * a label. Two layouts are made: "sd", an MBR and the volume at 4MB with
+ * its FAT 1MB further and its cluster heap on a 4MB boundary as on SDXC
+ * cards, and "packed", a bare volume with the FAT right after the boot
+ * region. It places a few files: a contiguous one (NoFatChain), one on a
+ * FAT chain out of order with free clusters between its own, one with a
+ * lower case name, a directory holding a file and a file with a long name
+ * (invisible to the 8.3 build of ff.c), and a deleted entry set.
+ *
+ * With -i an existing image is used, e.g. one made by mkfs.exfat or by
+ * Windows (a whole card with an MBR, or a bare volume); the tests then
+ * write into it, so give a copy.
+ *
+ * Through ff.c, on the RAM of the PC with the image as disk:
+ *   - read: every file the checker below finds with an 8.3 name is read
+ *     back and compared with the bytes the checker reads on its own
+ *   - large file: BIG.DAT is written at its start, extended by f_lseek()
+ *     past 4GB, written across the 4GB boundary and read back at 64-bit
+ *     offsets (skipped when the volume has less than 4.1GB free)
+ *   - fragmentation: four files in FRAG grow by turns, so they cannot stay
+ *     contiguous and go over to FAT chains
+ *   - directory growth: 600 files in MANY, over several clusters
+ *   - truncation and deletion: files cut to a half and to 0, BIG.DAT cut
+ *     back under 4GB, half of MANY deleted, then FRAG emptied and removed
+ * The files are written in a directory EXFCHK made for the run. After each
+ * step the volume is unmounted and checked, and every file written is read
+ * back both through ff.c and by the checker.
+ *
+ * The checker is a read-only exFAT parser of its own. It checks the boot
+ * region (fields, checksum, backup), the up-case table checksum, every
+ * entry set (checksum, name hash, stream and name entries, lengths), that
+ * every object has the clusters of its length, contiguous or on an ended
+ * FAT chain, with no cluster in two objects, and that the allocation
+ * bitmap marks exactly the clusters in use; f_getfree() must agree. When
+ * fsck.exfat is on the PATH it is also run on the image (-n). The exit
+ * status is 1 on any error.
+ *
+ * @code
+ *   exfatcheck [-s GB] [-c KB] [-l sd|packed] IMAGE   # default 6GB, 32KB clusters, sd
+ *   exfatcheck -i IMAGE                               # existing image, written to
+ * @endcode
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../fatfs/src -o exfatcheck exfatcheck.c ../fatfs/src/ff.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#define _FILE_OFFSET_BITS	64
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "ff.h"
+#include "diskio.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+#define GB					(1024ULL * 1024 * 1024)
+#define PATH_LEN			300
+#define MAX_MODEL			1024
+#define MAX_ERRORS			20						/* Errors printed by a check */
+#define EOC					0xFFFFFFFFUL
+#define CHUNK				(64 * 1024)
+#define WORK_DIR			"EXFCHK"				/* Directory of the tests */
+#define WORK				WORK_DIR "/"
+
+#define LD16(p)				((uint32_t)(p)[0] | (uint32_t)(p)[1] << 8)
+#define LD32(p)				(LD16(p) | LD16((p) + 2) << 16)
+#define LD64(p)				((uint64_t)LD32(p) | (uint64_t)LD32((p) + 4) << 32)
+#define ST16(p, v)			((p)[0] = (uint8_t)(v), (p)[1] = (uint8_t)((v) >> 8))
+#define ST32(p, v)			(ST16(p, v), ST16((p) + 2, (v) >> 16))
+#define ST64(p, v)			(ST32(p, (uint32_t)(v)), ST32((p) + 4, (uint32_t)((uint64_t)(v) >> 32)))
+
+/* Entry types */
+#define ET_END				0x00
+#define ET_BITMAP			0x81
+#define ET_UPCASE			0x82
+#define ET_LABEL			0x83
+#define ET_FILE				0x85
+#define ET_STREAM			0xC0
+#define ET_NAME				0xC1
+#define ET_INUSE			0x80
+
+#define FL_ALLOC			0x01					/* AllocationPossible */
+#define FL_NOFAT			0x02					/* NoFatChain */
+#define AT_DIR				0x10
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Volume as read by the checker. */
+typedef struct tagXVOL
+{
+	uint64_t base;			/* Boot sector */
+	uint64_t sectors;		/* VolumeLength */
+	uint32_t fatofs, fatlen, heap, count, root;
+	uint32_t spc, clbytes;
+	uint32_t *fat;
+	uint8_t *bitmap;		/* As on the volume */
+	uint8_t *used;			/* Clusters found in use */
+	uint16_t *upcase;		/* 65536 entries */
+	uint32_t bmclus;
+	uint64_t bmlen;
+	unsigned long errors, files, dirs, hidden;
+} XVOL;
+
+/* Object found by the checker. */
+typedef struct tagXFILE
+{
+	char path[PATH_LEN];
+	uint64_t size, valid;
+	uint32_t first;
+	uint8_t flags, attr;
+	int fits;				/* Name fits 8.3: visible to ff.c */
+} XFILE;
+
+/* File the tests wrote: its pattern in [from, to) of each range. */
+typedef struct tagMFILE
+{
+	char path[PATH_LEN];
+	uint32_t id;
+	uint64_t size;
+	uint64_t from[2], to[2];
+	int ranges;
+	int gone;
+} MFILE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static int Fd = -1;
+static uint64_t ImageSectors;
+static FATFS Fs;
+static XVOL V;
+static XFILE *Files;
+static uint32_t NumFiles, MaxFiles;
+static MFILE Model[MAX_MODEL];
+static uint32_t NumModel;
+static unsigned long Failures;
+static uint8_t Buf[CHUNK], Buf2[CHUNK];
+
+/* Up-case table of the formatter: a to z, then the rest as is. */
+static uint16_t UpTable[130];
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static int ReadSectors (uint64_t sect, void *buf, uint32_t n);
+static int WriteSectors (uint64_t sect, const void *buf, uint32_t n);
+static uint8_t Pattern (uint32_t id, uint64_t ofs);
+static void Fail (const char *fmt, ...);
+
+static int Format (uint64_t sectors, uint32_t clkb, int packed);
+static uint32_t BootSum (const uint8_t *region);
+static uint32_t TableSum (const uint8_t *p, uint32_t n, uint32_t sum);
+static uint16_t SetSum (const uint8_t *set, uint32_t entries);
+static uint16_t NameHash (const char *name, const uint16_t *upcase);
+static uint32_t PutSet (uint8_t *dir, uint32_t idx, const char *name, uint8_t attr, uint8_t flags, uint32_t first, uint64_t size);
+static void PlaceFiles (uint32_t *next, uint8_t *root, uint32_t *ridx);
+
+static int CheckVolume (const char *when);
+static void Error (const char *fmt, ...);
+static int Mark (uint32_t first, int nofat, uint64_t size, const char *what, uint32_t *clusters);
+static uint8_t *LoadObject (uint32_t first, int nofat, uint64_t size);
+static int ReadObject (const XFILE *f, uint64_t ofs, uint8_t *buf, uint32_t n);
+static void WalkDir (const uint8_t *dir, uint64_t len, const char *path, int root);
+static void LoadUpcase (uint32_t first, uint64_t len, uint32_t sum);
+static const XFILE *FindFile (const char *path);
+
+static int TestRead (void);
+static void TestBig (void);
+static void TestFragment (void);
+static void TestMany (void);
+static void TestTruncate (void);
+static int Remount (const char *when);
+static MFILE *AddModel (const char *path, uint32_t id);
+static FRESULT WriteFile (FIL *fp, MFILE *m, uint64_t ofs, uint64_t n);
+static void VerifyModel (void);
+static int VerifyRange (const MFILE *m, FIL *fp, const XFILE *xf, uint64_t from, uint64_t to);
+static void RunFsck (const char *image);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	uint64_t gb = 6;
+	uint32_t clkb = 32;
+	int i, packed = 0, existing = 0;
+	DWORD nfree;
+	FATFS *fs;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i], "-i") == 0) existing = 1;
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) gb = strtoull(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) clkb = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) packed = strcmp(argv[++i], "packed") == 0;
+		else break;
+	}
+	if (i + 1 != argc || gb == 0 || gb > 1024 || clkb < 1 || clkb > 16384 || (clkb & (clkb - 1)))
+	{
+		fprintf(stderr, "usage: exfatcheck [-s GB] [-c KB] [-l sd|packed] IMAGE\n"
+				"       exfatcheck -i IMAGE\n");
+		return 2;
+	}
+
+	Fd = open(argv[i], existing ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (Fd < 0)
+	{
+		perror(argv[i]);
+		return 1;
+	}
+	if (!existing)
+	{
+		if (ftruncate(Fd, (off_t)(gb * GB)) != 0 || Format(gb * GB / SS, clkb, packed) != 0)
+		{
+			perror(argv[i]);
+			return 1;
+		}
+		printf("formatted %lluGB, %uKB clusters, %s layout\n", (unsigned long long)gb, clkb, packed ? "packed" : "sd");
+	}
+	ImageSectors = (uint64_t)lseek(Fd, 0, SEEK_END) / SS;
+
+	if (CheckVolume(existing ? "image as given" : "image as formatted") != 0) return 1;
+	printf("%lu files and %lu directories, %lu names not in 8.3 (invisible to ff.c), %u clusters of %uKB\n",
+			V.files, V.dirs, V.hidden, V.count, V.clbytes / 1024);
+
+	if (f_mount(&Fs, "", 1) != FR_OK || Fs.fs_type != FS_EXFAT)
+	{
+		fprintf(stderr, "ff.c does not mount the volume as exFAT\n");
+		return 1;
+	}
+	if (TestRead() != 0) return 1;
+	if (f_mkdir(WORK_DIR) != FR_OK)
+	{
+		fprintf(stderr, WORK_DIR " cannot be made (left by an earlier run?): give a fresh copy of the image\n");
+		return 1;
+	}
+
+	TestBig();
+	if (Remount("after the large file") == 0) VerifyModel();
+	TestFragment();
+	if (Remount("after fragmentation") == 0) VerifyModel();
+	TestMany();
+	if (Remount("after directory growth") == 0) VerifyModel();
+	TestTruncate();
+	if (Remount("after truncation and deletion") == 0) VerifyModel();
+
+	/* Free clusters, unless the last check could not read the volume */
+	if (V.used != NULL && f_getfree("", &nfree, &fs) != FR_OK) Fail("f_getfree() failed");
+	else if (V.used != NULL)
+	{
+		uint32_t c, used = 0;
+
+		for (c = 0; c < V.count; c++) if (V.used[c / 8] & (1 << (c % 8))) used++;
+		if (nfree != V.count - used) Fail("f_getfree() gives %lu free clusters, the checker %lu", (unsigned long)nfree, (unsigned long)(V.count - used));
+		else printf("f_getfree(): %lu free clusters, as counted by the checker\n", (unsigned long)nfree);
+	}
+	f_mount(NULL, "", 0);
+	fsync(Fd);
+	RunFsck(argv[i]);
+	close(Fd);
+
+	printf("%s: %lu failures\n", argv[i], Failures);
+	return Failures ? 1 : 0;
+}
+
+/* The image as disk 0 of ff.c */
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return (pdrv || Fd < 0) ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status (BYTE pdrv)
+{
+	return (pdrv || Fd < 0) ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + (uint64_t)count > ImageSectors) return RES_PARERR;
+	return ReadSectors(sector, buff, count) == 0 ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + (uint64_t)count > ImageSectors) return RES_PARERR;
+	return WriteSectors(sector, buff, count) == 0 ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	if (pdrv) return RES_PARERR;
+	switch (cmd)
+	{
+		case CTRL_SYNC:
+		case CTRL_TRIM:
+			return RES_OK;
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = (ImageSectors > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (DWORD)ImageSectors;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = 8192;
+			return RES_OK;
+		default:
+			return RES_PARERR;
+	}
+}
+
+DWORD get_fattime (void)
+{
+	return (DWORD)(2026 - 1980) << 25 | 10UL << 21 | 18UL << 16;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static int ReadSectors (uint64_t sect, void *buf, uint32_t n)
+{
+	return pread(Fd, buf, (size_t)n * SS, (off_t)(sect * SS)) == (ssize_t)n * SS ? 0 : -1;
+}
+
+static int WriteSectors (uint64_t sect, const void *buf, uint32_t n)
+{
+	return pwrite(Fd, buf, (size_t)n * SS, (off_t)(sect * SS)) == (ssize_t)n * SS ? 0 : -1;
+}
+
+/* Contents of the test files: a function of the file and the offset. */
+static uint8_t Pattern (uint32_t id, uint64_t ofs)
+{
+	uint32_t x = (uint32_t)(ofs >> 2) * 2654435761UL ^ id * 0x9E3779B9UL ^ (uint32_t)(ofs >> 32);
+
+	return (uint8_t)(x >> ((ofs & 3) * 8));
+}
+
+/* A failure of a test through ff.c. */
+static void Fail (const char *fmt, ...)
+{
+	va_list ap;
+
+	if (Failures++ < MAX_ERRORS)
+	{
+		va_start(ap, fmt);
+		fputs("FAIL: ", stdout);
+		vprintf(fmt, ap);
+		putchar('\n');
+		va_end(ap);
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Formatter                                                                  */
+/*----------------------------------------------------------------------------*/
+/* Lays out an exFAT volume as the specification describes it. sd makes a
+card: an MBR with the volume at 4MB, its FAT 1MB further and its heap on a
+4MB boundary. packed makes a bare volume over the whole image. The bitmap,
+the up-case table and the root directory take the first clusters, in that
+order, each on a FAT chain. */
+static int Format (uint64_t sectors, uint32_t clkb, int packed)
+{
+	static uint8_t region[12 * SS];
+	uint64_t base = packed ? 0 : 8192;
+	uint32_t spc = clkb * 1024 / SS, shift, fatofs, fatlen, heap, count, clbytes = clkb * 1024;
+	uint32_t bmclus, bmn, ucclus, ucn, rootclus, next, i, c, sum, ridx = 0;
+	uint64_t bmlen;
+	uint8_t *fat, *bm, *root, *uc;
+	int ret = 0;
+
+	sectors -= base;
+	if (sectors > 0xFFFFFFFFULL) return -1;
+	for (shift = 0; (1UL << shift) < spc; shift++) ;
+
+	fatofs = packed ? 24 : 2048;
+	count = (uint32_t)((sectors - fatofs) / spc);
+	fatlen = ((count + 2) * 4 + SS - 1) / SS;
+	heap = fatofs + fatlen;
+	heap = packed ? (heap + spc - 1) / spc * spc : (heap + 8191) / 8192 * 8192;
+	count = (uint32_t)((sectors - heap) / spc);
+
+	fat = calloc(fatlen, SS);
+	bmlen = (count + 7) / 8;
+	bm = calloc((bmlen + clbytes - 1) / clbytes, clbytes);
+	root = calloc(1, clbytes);
+	if (fat == NULL || bm == NULL || root == NULL) return -1;
+
+	/* Up-case table: a-z, then 0xFFFF and the length of the identity run. */
+	for (i = 0; i < 128; i++) UpTable[i] = (i >= 'a' && i <= 'z') ? i - 0x20 : i;
+	UpTable[128] = 0xFFFF;
+	UpTable[129] = 0x10000 - 128;
+	uc = calloc(1, clbytes);
+	for (i = 0; i < 130; i++) ST16(uc + i * 2, UpTable[i]);
+
+	/* Clusters of the system objects, then the free ones. */
+	ST32(fat, 0xFFFFFFF8UL);
+	ST32(fat + 4, EOC);
+	next = 2;
+	bmclus = next;
+	bmn = (uint32_t)((bmlen + clbytes - 1) / clbytes);
+	ucclus = bmclus + bmn;
+	ucn = 1;
+	rootclus = ucclus + ucn;
+	next = rootclus + 1;
+	for (c = 2; c < next; c++)
+	{
+		ST32(fat + c * 4, (c + 1 == ucclus || c + 1 == rootclus || c + 1 == next) ? EOC : c + 1);
+		bm[(c - 2) / 8] |= 1 << ((c - 2) % 8);
+	}
+
+	/* Root directory: label, bitmap, up-case table, then the files. */
+	root[ridx * 32] = ET_LABEL;
+	root[ridx * 32 + 1] = 8;
+	for (i = 0; i < 8; i++) ST16(root + ridx * 32 + 2 + i * 2, "SDLOGGER"[i]);
+	ridx++;
+	root[ridx * 32] = ET_BITMAP;
+	ST32(root + ridx * 32 + 20, bmclus);
+	ST64(root + ridx * 32 + 24, bmlen);
+	ridx++;
+	root[ridx * 32] = ET_UPCASE;
+	ST32(root + ridx * 32 + 4, TableSum(uc, 130 * 2, 0));
+	ST32(root + ridx * 32 + 20, ucclus);
+	ST64(root + ridx * 32 + 24, 130 * 2);
+	ridx++;
+
+	/* The files take clusters from 'next' on, marked as they go. */
+	V.fat = (uint32_t *)fat;
+	V.bitmap = bm;
+	V.heap = heap;
+	V.spc = spc;
+	V.clbytes = clbytes;
+	V.count = count;
+	V.base = base;
+	PlaceFiles(&next, root, &ridx);
+
+	/* Boot region and its backup. */
+	memset(region, 0, sizeof(region));
+	region[0] = 0xEB;
+	region[1] = 0x76;
+	region[2] = 0x90;
+	memcpy(region + 3, "EXFAT   ", 8);
+	ST64(region + 72, sectors);
+	ST32(region + 80, fatofs);
+	ST32(region + 84, fatlen);
+	ST32(region + 88, heap);
+	ST32(region + 92, count);
+	ST32(region + 96, rootclus);
+	ST32(region + 100, 0x5D1066E2UL);
+	ST16(region + 104, 0x100);
+	region[108] = 9;
+	region[109] = (uint8_t)shift;
+	region[110] = 1;
+	region[111] = 0x80;
+	region[510] = 0x55;
+	region[511] = 0xAA;
+	for (i = 1; i <= 8; i++)
+	{
+		region[i * SS + 510] = 0x55;
+		region[i * SS + 511] = 0xAA;
+	}
+	sum = BootSum(region);
+	for (i = 0; i < SS; i += 4) ST32(region + 11 * SS + i, sum);
+
+	if (WriteSectors(base, region, 12) || WriteSectors(base + 12, region, 12)
+			|| WriteSectors(base + fatofs, fat, fatlen)
+			|| WriteSectors(base + heap + (uint64_t)(bmclus - 2) * spc, bm, bmn * spc)
+			|| WriteSectors(base + heap + (uint64_t)(ucclus - 2) * spc, uc, spc)
+			|| WriteSectors(base + heap + (uint64_t)(rootclus - 2) * spc, root, spc)) ret = -1;
+
+	/* MBR: one partition of type 07 (exFAT/NTFS), in LBA only */
+	if (base)
+	{
+		memset(region, 0, SS);
+		region[446 + 1] = region[446 + 5] = 0xFE;
+		region[446 + 2] = region[446 + 6] = 0xFF;
+		region[446 + 3] = region[446 + 7] = 0xFF;
+		region[446 + 4] = 0x07;
+		ST32(region + 446 + 8, (uint32_t)base);
+		ST32(region + 446 + 12, (uint32_t)sectors);
+		region[510] = 0x55;
+		region[511] = 0xAA;
+		if (WriteSectors(0, region, 1)) ret = -1;
+	}
+
+	free(fat);
+	free(bm);
+	free(root);
+	free(uc);
+	memset(&V, 0, sizeof(V));
+	return ret;
+}
+
+/* Checksum of the boot region: sectors 0 to 10 but VolumeFlags and
+PercentInUse. */
+static uint32_t BootSum (const uint8_t *region)
+{
+	uint32_t i, sum = 0;
+
+	for (i = 0; i < 11 * SS; i++)
+	{
+		if (i == 106 || i == 107 || i == 112) continue;
+		sum = ((sum & 1) ? 0x80000000UL : 0) + (sum >> 1) + region[i];
+	}
+	return sum;
+}
+
+static uint32_t TableSum (const uint8_t *p, uint32_t n, uint32_t sum)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) sum = ((sum & 1) ? 0x80000000UL : 0) + (sum >> 1) + p[i];
+	return sum;
+}
+
+static uint16_t SetSum (const uint8_t *set, uint32_t entries)
+{
+	uint32_t i;
+	uint16_t sum = 0;
+
+	for (i = 0; i < entries * 32; i++)
+	{
+		if (i == 2 || i == 3) continue;
+		sum = (uint16_t)(((sum & 1) ? 0x8000 : 0) + (sum >> 1) + set[i]);
+	}
+	return sum;
+}
+
+static uint16_t NameHash (const char *name, const uint16_t *upcase)
+{
+	uint16_t hash = 0, c;
+
+	for (; *name; name++)
+	{
+		c = upcase ? upcase[(uint8_t)*name] : (uint16_t)((*name >= 'a' && *name <= 'z') ? *name - 0x20 : *name);
+		hash = (uint16_t)(((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (c & 0xFF));
+		hash = (uint16_t)(((hash & 1) ? 0x8000 : 0) + (hash >> 1) + (c >> 8));
+	}
+	return hash;
+}
+
+/* Writes an entry set at entry idx of a directory; returns the entries. */
+static uint32_t PutSet (uint8_t *dir, uint32_t idx, const char *name, uint8_t attr, uint8_t flags, uint32_t first, uint64_t size)
+{
+	uint8_t *e = dir + idx * 32;
+	uint32_t len = (uint32_t)strlen(name), names = (len + 14) / 15, i;
+
+	memset(e, 0, (2 + names) * 32);
+	e[0] = ET_FILE;
+	e[1] = (uint8_t)(1 + names);
+	ST16(e + 4, attr);
+	ST32(e + 8, get_fattime());
+	ST32(e + 12, get_fattime());
+	ST32(e + 16, get_fattime());
+	e[32] = ET_STREAM;
+	e[33] = flags;
+	e[35] = (uint8_t)len;
+	ST16(e + 36, NameHash(name, NULL));
+	ST64(e + 40, size);
+	ST32(e + 52, first);
+	ST64(e + 56, size);
+	for (i = 0; i < len; i++)
+	{
+		e[64 + (i / 15) * 32] = ET_NAME;
+		ST16(e + 64 + (i / 15) * 32 + 2 + (i % 15) * 2, (uint8_t)name[i]);
+	}
+	ST16(e + 2, SetSum(e, 2 + names));
+	return 2 + names;
+}
+
+/* The files of a new volume, written with the formatter's own view of the
+FAT and the bitmap. */
+static void PlaceFiles (uint32_t *next, uint8_t *root, uint32_t *ridx)
+{
+	static const struct
+	{
+		const char *path;
+		uint32_t id;
+		uint64_t size;
+	} file[] =
+	{
+		{ "PLAIN.TXT", 1, 100000 },
+		{ "CHAIN.BIN", 2, 0 },
+		{ "lower.txt", 3, 777 },
+		{ "DIR1/INNER.DAT", 4, 70000 },
+		{ "DIR1/A file with a long name.txt", 5, 5000 }
+	};
+	uint8_t *dir1 = calloc(1, V.clbytes), *data = malloc(V.clbytes);
+	uint32_t chain[6], c, i, k, n, d1, didx = 0;
+	uint64_t size, o;
+	MFILE *m;
+
+#define TAKE(c)		(V.bitmap[((c) - 2) / 8] |= 1 << (((c) - 2) % 8))
+#define CLSECT(c)	(V.base + V.heap + (uint64_t)((c) - 2) * V.spc)
+
+	/* CHAIN.BIN: six clusters from the top of a run of eleven, down every
+	other one, on a FAT chain; the five between stay free. */
+	for (i = 0; i < 6; i++)
+	{
+		chain[i] = *next + 10 - 2 * i;
+		TAKE(chain[i]);
+		ST32((uint8_t *)V.fat + chain[i] * 4, (i == 5) ? EOC : *next + 10 - 2 * (i + 1));
+	}
+	*next += 11;
+
+	/* DIR1, one cluster on a FAT chain */
+	d1 = (*next)++;
+	TAKE(d1);
+	ST32((uint8_t *)V.fat + d1 * 4, EOC);
+	*ridx += PutSet(root, *ridx, "DIR1", AT_DIR, FL_ALLOC, d1, V.clbytes);
+
+	for (k = 0; k < sizeof(file) / sizeof(file[0]); k++)
+	{
+		size = file[k].size ? file[k].size : 6ULL * V.clbytes - 1000;
+		n = (uint32_t)((size + V.clbytes - 1) / V.clbytes);
+		if (file[k].id == 2) c = chain[0];
+		else
+		{
+			c = *next;
+			*next += n;
+			for (i = 0; i < n; i++) TAKE(c + i);
+		}
+		for (i = 0, o = 0; i < n; i++)
+		{
+			memset(data, 0, V.clbytes);
+			for (; o < size && o < (uint64_t)(i + 1) * V.clbytes; o++) data[o % V.clbytes] = Pattern(file[k].id, o);
+			WriteSectors(CLSECT(file[k].id == 2 ? chain[i] : c + i), data, V.spc);
+		}
+		if (strncmp(file[k].path, "DIR1/", 5) == 0) didx += PutSet(dir1, didx, file[k].path + 5, 0x20, file[k].id == 2 ? FL_ALLOC : FL_ALLOC | FL_NOFAT, c, size);
+		else *ridx += PutSet(root, *ridx, file[k].path, 0x20, file[k].id == 2 ? FL_ALLOC : FL_ALLOC | FL_NOFAT, c, size);
+
+		m = AddModel(file[k].path, file[k].id);
+		m->size = m->to[0] = size;
+		m->ranges = 1;
+	}
+
+	/* A deleted entry set, its clusters free */
+	i = *ridx;
+	*ridx += PutSet(root, *ridx, "GONE.TXT", 0x20, FL_ALLOC | FL_NOFAT, *next, 1000);
+	for (; i < *ridx; i++) root[i * 32] &= ~ET_INUSE;
+
+	WriteSectors(CLSECT(d1), dir1, V.spc);
+	free(dir1);
+	free(data);
+#undef TAKE
+#undef CLSECT
+}
+
+/*----------------------------------------------------------------------------*/
+/* Checker                                                                    */
+/*----------------------------------------------------------------------------*/
+/* Reads the volume on its own and checks it; returns -1 when it is not an
+exFAT volume or its boot region is bad, else 0 (the errors are counted). */
+static int CheckVolume (const char *when)
+{
+	static uint8_t region[24 * SS];
+	uint8_t *root;
+	uint32_t i, c, bad, leaked, sum, clusters;
+	uint64_t rootlen;
+	unsigned long before = Failures;
+
+	free(V.fat);
+	free(V.bitmap);
+	free(V.used);
+	free(V.upcase);
+	memset(&V, 0, sizeof(V));
+	NumFiles = 0;
+
+	if (ReadSectors(0, region, 1) != 0) return -1;
+	if (memcmp(region + 3, "EXFAT   ", 8) != 0 && LD16(region + 510) == 0xAA55 && region[446 + 4] != 0) V.base = LD32(region + 446 + 8);
+	if (ReadSectors(V.base, region, 24) != 0 || memcmp(region + 3, "EXFAT   ", 8) != 0)
+	{
+		fprintf(stderr, "%s: no exFAT volume\n", when);
+		return -1;
+	}
+
+	/* Boot region */
+	if (region[0] != 0xEB || region[1] != 0x76 || region[2] != 0x90) Error("JumpBoot is not EB 76 90");
+	for (i = 11; i < 64; i++) if (region[i]) break;
+	if (i < 64) Error("MustBeZero field not zero at byte %u", i);
+	V.sectors = LD64(region + 72);
+	V.fatofs = LD32(region + 80);
+	V.fatlen = LD32(region + 84);
+	V.heap = LD32(region + 88);
+	V.count = LD32(region + 92);
+	V.root = LD32(region + 96);
+	V.spc = 1U << region[109];
+	V.clbytes = V.spc * SS;
+	if (region[108] != 9) Error("BytesPerSectorShift %u, only 512 byte sectors are checked", region[108]);
+	if (LD16(region + 104) != 0x100) Error("FileSystemRevision %04X", LD16(region + 104));
+	if (region[110] != 1) Error("NumberOfFats %u: ff.c takes 1", region[110]);
+	if (LD16(region + 510) != 0xAA55) Error("no boot signature");
+	if (V.base + V.sectors > ImageSectors) Error("VolumeLength beyond the image");
+	if (V.fatofs < 24 || V.fatofs + (uint64_t)V.fatlen > V.heap) Error("FAT at %u+%u overlaps the boot region or the heap at %u", V.fatofs, V.fatlen, V.heap);
+	if ((uint64_t)V.fatlen * SS < ((uint64_t)V.count + 2) * 4) Error("FatLength too short for %u clusters", V.count);
+	if (V.heap + (uint64_t)V.count * V.spc > V.sectors) Error("cluster heap beyond VolumeLength");
+	if (V.root < 2 || V.root >= V.count + 2) Error("FirstClusterOfRootDirectory %u out of range", V.root);
+	for (i = 1; i <= 8; i++) if (LD32(region + i * SS + 508) != 0xAA550000UL) Error("extended boot sector %u without signature", i);
+	sum = BootSum(region);
+	for (i = 0; i < SS; i += 4) if (LD32(region + 11 * SS + i) != sum) break;
+	if (i < SS) Error("boot checksum sector wrong");
+	if (memcmp(region, region + 12 * SS, 12 * SS) != 0) Error("backup boot region differs from the main one");
+	if (V.errors)
+	{
+		Failures = before + V.errors;
+		printf("check %s: %lu errors in the boot region\n", when, V.errors);
+		return -1;
+	}
+
+	V.fat = malloc((size_t)V.fatlen * SS);
+	V.used = calloc((V.count + 7) / 8 + 1, 1);
+	V.upcase = malloc(65536 * sizeof(uint16_t));
+	if (V.fat == NULL || V.used == NULL || V.upcase == NULL || ReadSectors(V.base + V.fatofs, V.fat, V.fatlen) != 0) return -1;
+	for (i = 0; i < 65536; i++) V.upcase[i] = (uint16_t)i;
+	if (LD32((uint8_t *)V.fat) != 0xFFFFFFF8UL || LD32((uint8_t *)V.fat + 4) != EOC) Error("FAT entries 0 and 1 are %08X %08X", LD32((uint8_t *)V.fat), LD32((uint8_t *)V.fat + 4));
+
+	/* Root directory: a FAT chain without a length of its own */
+	for (c = V.root, clusters = 0; c >= 2 && c < V.count + 2 && clusters <= V.count; c = LD32((uint8_t *)V.fat + c * 4)) clusters++;
+	rootlen = (uint64_t)clusters * V.clbytes;
+	if (Mark(V.root, 0, rootlen, "root directory", NULL) != 0 || (root = LoadObject(V.root, 0, rootlen)) == NULL) return 0;
+
+	/* The bitmap and the up-case table first: names and allocation need them. */
+	for (i = 0; i < rootlen && root[i] != ET_END; i += 32)
+	{
+		if (root[i] == ET_BITMAP && (root[i + 1] & 1) == 0)
+		{
+			V.bmclus = LD32(root + i + 20);
+			V.bmlen = LD64(root + i + 24);
+		}
+		if (root[i] == ET_UPCASE) LoadUpcase(LD32(root + i + 20), LD64(root + i + 24), LD32(root + i + 4));
+	}
+	if (V.bmclus == 0 || V.bmlen < (V.count + 7) / 8) Error("no allocation bitmap, or too short");
+	else V.bitmap = LoadObject(V.bmclus, 0, V.bmlen);
+	WalkDir(root, rootlen, "", 1);
+	free(root);
+
+	if (V.bitmap != NULL)
+	{
+		for (c = 0, bad = leaked = 0; c < V.count; c++)
+		{
+			int b = (V.bitmap[c / 8] >> (c % 8)) & 1, u = (V.used[c / 8] >> (c % 8)) & 1;
+
+			if (u && !b && bad++ < 3) Error("cluster %u in use but free in the bitmap", c + 2);
+			if (b && !u && leaked++ < 3) Error("cluster %u allocated in the bitmap but in no object", c + 2);
+		}
+		if (bad + leaked > 6) Error("%u clusters in use but free, %u allocated but in no object", bad, leaked);
+	}
+
+	/* ff.c does not keep PercentInUse: told, not counted */
+	for (c = 0, clusters = 0; c < V.count; c++) clusters += (V.used[c / 8] >> (c % 8)) & 1;
+	if (region[112] != 0xFF && region[112] != (uint8_t)((uint64_t)clusters * 100 / V.count))
+	{
+		printf("  note: PercentInUse %u, %u%% of the clusters in use\n", region[112], (unsigned)((uint64_t)clusters * 100 / V.count));
+	}
+
+	Failures = before + V.errors;
+	printf("check %s: %lu errors\n", when, V.errors);
+	return 0;
+}
+
+/* An error of the volume. */
+static void Error (const char *fmt, ...)
+{
+	va_list ap;
+
+	if (V.errors++ < MAX_ERRORS)
+	{
+		va_start(ap, fmt);
+		fputs("  volume: ", stdout);
+		vprintf(fmt, ap);
+		putchar('\n');
+		va_end(ap);
+	}
+}
+
+/* Marks the clusters of an object in use: contiguous, or a FAT chain that
+must end right after the clusters of its length. */
+static int Mark (uint32_t first, int nofat, uint64_t size, const char *what, uint32_t *clusters)
+{
+	uint64_t n = (size + V.clbytes - 1) / V.clbytes, i;
+	uint32_t c = first, next;
+
+	if (clusters) *clusters = (uint32_t)n;
+	if (n == 0)
+	{
+		if (first != 0) Error("%s: no data but FirstCluster %u", what, first);
+		return 0;
+	}
+	if (first < 2 || first + (nofat ? n : 1) > (uint64_t)V.count + 2)
+	{
+		Error("%s: clusters %u+%llu out of the heap", what, first, (unsigned long long)n);
+		return -1;
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (V.used[(c - 2) / 8] & (1 << ((c - 2) % 8)))
+		{
+			Error("%s: cluster %u already in use by another object", what, c);
+			return -1;
+		}
+		V.used[(c - 2) / 8] |= 1 << ((c - 2) % 8);
+		if (nofat)
+		{
+			c++;
+			continue;
+		}
+		next = LD32((uint8_t *)V.fat + c * 4);
+		if (i + 1 == n)
+		{
+			if (next != EOC) Error("%s: FAT entry of cluster %u, the last of %llu, is %08X, not end of chain", what, c, (unsigned long long)n, next);
+		}
+		else if (next < 2 || next >= V.count + 2)
+		{
+			Error("%s: FAT chain ends at %llu of %llu clusters (%08X)", what, (unsigned long long)i + 1, (unsigned long long)n, next);
+			return -1;
+		}
+		c = next;
+	}
+	return 0;
+}
+
+/* Reads a whole object. */
+static uint8_t *LoadObject (uint32_t first, int nofat, uint64_t size)
+{
+	XFILE f;
+	uint8_t *p;
+	uint64_t o;
+
+	if (size > 256 * 1024 * 1024 || (p = malloc(size + V.clbytes)) == NULL) return NULL;
+	memset(&f, 0, sizeof(f));
+	f.first = first;
+	f.flags = nofat ? FL_NOFAT : 0;
+	f.size = size;
+	for (o = 0; o < size; o += V.clbytes)
+	{
+		if (ReadObject(&f, o, p + o, V.clbytes) != 0)
+		{
+			free(p);
+			return NULL;
+		}
+	}
+	return p;
+}
+
+/* Reads n bytes at a cluster aligned offset or within a cluster. */
+static int ReadObject (const XFILE *f, uint64_t ofs, uint8_t *buf, uint32_t n)
+{
+	static uint8_t cl[1 << 25];
+	uint64_t k = ofs / V.clbytes, i;
+	uint32_t c = f->first, in;
+
+	if (f->flags & FL_NOFAT) c = (uint32_t)(f->first + k);
+	else
+	{
+		for (i = 0; i < k && c >= 2 && c < V.count + 2; i++) c = LD32((uint8_t *)V.fat + c * 4);
+	}
+	while (n)
+	{
+		if (c < 2 || c >= V.count + 2 || ReadSectors(V.base + V.heap + (uint64_t)(c - 2) * V.spc, cl, V.spc) != 0) return -1;
+		in = V.clbytes - (uint32_t)(ofs % V.clbytes);
+		if (in > n) in = n;
+		memcpy(buf, cl + ofs % V.clbytes, in);
+		buf += in;
+		ofs += in;
+		n -= in;
+		c = (f->flags & FL_NOFAT) ? c + 1 : LD32((uint8_t *)V.fat + c * 4);
+	}
+	return 0;
+}
+
+/* Checks the entry sets of a directory and goes into the sub-directories. */
+static void WalkDir (const uint8_t *dir, uint64_t len, const char *path, int root)
+{
+	const uint8_t *e, *s;
+	uint64_t i, j, end = 0;
+	uint32_t n, k, nlen, ch, clusters;
+	char name[256], sub[PATH_LEN];
+	uint8_t *child;
+	XFILE *f;
+
+	for (i = 0; i < len; i += 32)
+	{
+		e = dir + i;
+		if (end)
+		{
+			if (e[0] != ET_END)
+			{
+				Error("%s/: entry %02X after the end of the directory", path, e[0]);
+				return;
+			}
+			continue;
+		}
+		if (e[0] == ET_END)
+		{
+			end = 1;
+			continue;
+		}
+		if (!(e[0] & ET_INUSE) || e[0] == ET_BITMAP || e[0] == ET_UPCASE || e[0] == ET_LABEL)
+		{
+			if (!root && e[0] & ET_INUSE) Error("%s/: system entry %02X out of the root", path, e[0]);
+			if (root && e[0] == ET_BITMAP) Mark(LD32(e + 20), 0, LD64(e + 24), "allocation bitmap", NULL);
+			if (root && e[0] == ET_UPCASE) Mark(LD32(e + 20), 0, LD64(e + 24), "up-case table", NULL);
+			continue;
+		}
+		if (e[0] >= 0xC0)
+		{
+			Error("%s/: secondary entry %02X without its file entry", path, e[0]);
+			continue;
+		}
+		if (e[0] != ET_FILE)
+		{
+			i += 32 * (uint64_t)e[1];			/* Benign primary entry and its secondaries */
+			continue;
+		}
+
+		n = e[1];
+		s = e + 32;
+		if (n < 2 || i + 32 * (uint64_t)(n + 1) > len || s[0] != ET_STREAM)
+		{
+			Error("%s/: broken entry set at %llu", path, (unsigned long long)i / 32);
+			i += 32 * (uint64_t)n;
+			continue;
+		}
+		nlen = s[3];
+		for (k = 0, ch = 0; k + 2 <= n && ch < nlen; k++)
+		{
+			const uint8_t *ne = e + 64 + 32 * k;
+
+			if (ne[0] != ET_NAME) break;
+			for (j = 0; j < 15 && ch < nlen; j++, ch++)
+			{
+				uint32_t w = LD16(ne + 2 + j * 2);
+
+				name[ch] = (w < 0x80 && w >= 0x20) ? (char)w : '?';
+			}
+		}
+		name[ch] = 0;
+		snprintf(sub, sizeof(sub), "%s%s%s", path, *path ? "/" : "", name);
+		if (ch < nlen || nlen == 0) Error("%s: name entries hold %u of %u characters", sub, ch, nlen);
+		if (LD16(e + 2) != SetSum(e, n + 1)) Error("%s: entry set checksum %04X, should be %04X", sub, LD16(e + 2), SetSum(e, n + 1));
+		for (ch = 0, k = 0; k < nlen && k < 255; k++)
+		{
+			uint32_t w = LD16(e + 64 + 32 * (k / 15) + 2 + (k % 15) * 2), c = V.upcase[w];
+
+			ch = (((ch & 1) ? 0x8000 : 0) + (ch >> 1) + (c & 0xFF)) & 0xFFFF;
+			ch = (((ch & 1) ? 0x8000 : 0) + (ch >> 1) + (c >> 8)) & 0xFFFF;
+		}
+		if (LD16(s + 4) != ch) Error("%s: name hash %04X, should be %04X", sub, LD16(s + 4), ch);
+
+		if (NumFiles == MaxFiles)
+		{
+			MaxFiles = MaxFiles ? 2 * MaxFiles : 1024;
+			Files = realloc(Files, MaxFiles * sizeof(XFILE));
+		}
+		f = &Files[NumFiles++];
+		strcpy(f->path, sub);
+		f->attr = (uint8_t)LD16(e + 4);
+		f->flags = s[1];
+		f->valid = LD64(s + 8);
+		f->first = LD32(s + 20);
+		f->size = LD64(s + 24);
+		f->fits = (nlen <= 12);
+		for (k = 0, j = 0; k < nlen && f->fits; k++)
+		{
+			if (name[k] == '.') f->fits = (j++ == 0 && k > 0 && k <= 8 && nlen - k - 1 <= 3 && nlen - k - 1 > 0);
+			else if (name[k] == ' ' || name[k] == '?' || strchr("\"*+,:;<=>[]|", name[k]) || (j == 0 && k >= 8)) f->fits = 0;
+		}
+		if (!f->fits) V.hidden++;
+
+		if (f->valid > f->size) Error("%s: ValidDataLength %llu over DataLength %llu", sub, (unsigned long long)f->valid, (unsigned long long)f->size);
+		if (!(f->flags & FL_ALLOC) && (f->first || f->size)) Error("%s: allocation not possible but clusters given", sub);
+		if (f->attr & AT_DIR)
+		{
+			V.dirs++;
+			if (f->size == 0 || f->size % V.clbytes || f->valid != f->size) Error("%s: directory length %llu", sub, (unsigned long long)f->size);
+		}
+		else V.files++;
+
+		if (Mark(f->first, f->flags & FL_NOFAT, f->size, sub, &clusters) == 0 && (f->attr & AT_DIR) && f->size)
+		{
+			if ((child = LoadObject(f->first, f->flags & FL_NOFAT, f->size)) != NULL)
+			{
+				XFILE copy = *f;
+
+				WalkDir(child, copy.size, copy.path, 0);
+				free(child);
+			}
+		}
+		i += 32 * (uint64_t)n;
+	}
+}
+
+/* Loads the up-case table, compressed (0xFFFF and the length of an
+identity run) or not, and checks its checksum. */
+static void LoadUpcase (uint32_t first, uint64_t len, uint32_t sum)
+{
+	uint8_t *t;
+	uint64_t i;
+	uint32_t ch = 0, w;
+
+	if (len < 2 || len > 2 * 65536 + 4 || (t = LoadObject(first, 0, len)) == NULL)
+	{
+		Error("up-case table of %llu bytes not read", (unsigned long long)len);
+		return;
+	}
+	if (TableSum(t, (uint32_t)len, 0) != sum) Error("up-case table checksum %08X, should be %08X", sum, TableSum(t, (uint32_t)len, 0));
+	for (i = 0; i + 1 < len && ch < 65536; i += 2)
+	{
+		w = LD16(t + i);
+		if (w == 0xFFFF && i + 3 < len)
+		{
+			ch += LD16(t + i + 2);
+			i += 2;
+		}
+		else V.upcase[ch++] = (uint16_t)w;
+	}
+	free(t);
+}
+
+static const XFILE *FindFile (const char *path)
+{
+	uint32_t i;
+
+	for (i = 0; i < NumFiles; i++) if (strcasecmp(Files[i].path, path) == 0) return &Files[i];
+	return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Tests through ff.c                                                         */
+/*----------------------------------------------------------------------------*/
+/* Every file with an 8.3 name, read through ff.c and by the checker. */
+static int TestRead (void)
+{
+	FIL fil;
+	FILINFO fno;
+	DIR dir;
+	uint32_t i, listed = 0, read = 0, visible = 0;
+	uint64_t o;
+	UINT br;
+	const XFILE *f;
+	char path[PATH_LEN];
+
+	/* The root as ff.c lists it */
+	if (f_opendir(&dir, "") != FR_OK) Fail("f_opendir() of the root failed");
+	while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0])
+	{
+		listed++;
+		if ((f = FindFile(fno.fname)) == NULL) Fail("ff.c lists %s, the checker has no such object", fno.fname);
+		else if (f->size != fno.fsize && !(f->attr & AT_DIR)) Fail("%s: ff.c gives %llu bytes, the entry %llu", fno.fname, (unsigned long long)fno.fsize, (unsigned long long)f->size);
+	}
+	for (i = 0; i < NumFiles; i++) if (!strchr(Files[i].path, '/') && Files[i].fits) visible++;
+	if (listed != visible) Fail("ff.c lists %u objects in the root, the checker %u with 8.3 names", listed, visible);
+
+	for (i = 0; i < NumFiles; i++)
+	{
+		f = &Files[i];
+		if (!f->fits || (f->attr & AT_DIR)) continue;
+		snprintf(path, sizeof(path), "%s", f->path);
+		if (strchr(path, '/'))
+		{
+			/* Only visible when every directory on the way is */
+			char *p, up[PATH_LEN];
+			const XFILE *d;
+			int ok = 1;
+
+			for (p = strchr(path, '/'); p && ok; p = strchr(p + 1, '/'))
+			{
+				snprintf(up, sizeof(up), "%.*s", (int)(p - path), path);
+				ok = (d = FindFile(up)) != NULL && d->fits;
+			}
+			if (!ok) continue;
+		}
+		if (f_open(&fil, path, FA_READ) != FR_OK)
+		{
+			Fail("%s: f_open() failed", path);
+			continue;
+		}
+		if (f_size(&fil) != f->size) Fail("%s: f_size() %llu, the entry %llu", path, (unsigned long long)f_size(&fil), (unsigned long long)f->size);
+		for (o = 0; o < f->size && o < 64 * 1024 * 1024; o += br)
+		{
+			if (f_read(&fil, Buf, CHUNK, &br) != FR_OK || br == 0) break;
+			if (ReadObject(f, o, Buf2, br) != 0 || memcmp(Buf, Buf2, br) != 0)
+			{
+				Fail("%s: ff.c reads other bytes at %llu", path, (unsigned long long)o);
+				break;
+			}
+		}
+		if (o < f->size && o < 64 * 1024 * 1024) Fail("%s: ff.c stops reading at %llu", path, (unsigned long long)o);
+		f_close(&fil);
+		read++;
+	}
+	printf("read: %u files through ff.c, as the checker reads them\n", read);
+	return 0;
+}
+
+/* BIG.DAT: 1MB, then f_lseek() to 4GB - 128KB, 256KB across the boundary
+and 64KB more at the end. */
+static void TestBig (void)
+{
+	FIL fil;
+	DWORD nfree;
+	FATFS *fs;
+	MFILE *m;
+	uint64_t at = 4 * GB - 128 * 1024;
+
+	if (f_getfree("", &nfree, &fs) != FR_OK || (uint64_t)nfree * V.clbytes < 4 * GB + 64 * 1024 * 1024)
+	{
+		printf("large file: skipped, less than 4.1GB free\n");
+		return;
+	}
+	m = AddModel(WORK "BIG.DAT", 100);
+	if (f_open(&fil, WORK "BIG.DAT", FA_WRITE | FA_CREATE_NEW) != FR_OK)
+	{
+		Fail("BIG.DAT: f_open() failed");
+		return;
+	}
+	if (WriteFile(&fil, m, 0, 1024 * 1024) != FR_OK || f_lseek(&fil, at) != FR_OK || f_tell(&fil) != at)
+	{
+		Fail("BIG.DAT: f_lseek() to %llu failed", (unsigned long long)at);
+	}
+	else if (WriteFile(&fil, m, at, 256 * 1024) != FR_OK || WriteFile(&fil, m, at + 256 * 1024, 64 * 1024) != FR_OK)
+	{
+		Fail("BIG.DAT: f_write() past 4GB failed");
+	}
+	m->from[1] = at;
+	m->to[1] = at + 320 * 1024;
+	m->ranges = 2;
+	m->size = m->to[1];
+	if (f_close(&fil) != FR_OK) Fail("BIG.DAT: f_close() failed");
+	printf("large file: BIG.DAT of %llu bytes written\n", (unsigned long long)m->size);
+}
+
+/* Four files in FRAG growing by turns by a cluster and a half. */
+static void TestFragment (void)
+{
+	static FIL fil[4];
+	MFILE *m[4];
+	char path[PATH_LEN];
+	int i, round;
+	uint32_t step = V.clbytes + V.clbytes / 2;
+
+	if (f_mkdir(WORK "FRAG") != FR_OK) Fail("f_mkdir(FRAG) failed");
+	for (i = 0; i < 4; i++)
+	{
+		snprintf(path, sizeof(path), WORK "FRAG/F%d.BIN", i);
+		m[i] = AddModel(path, 200 + i);
+		m[i]->ranges = 1;
+		if (f_open(&fil[i], path, FA_WRITE | FA_CREATE_NEW) != FR_OK) Fail("%s: f_open() failed", path);
+	}
+	for (round = 0; round < 12; round++)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			if (WriteFile(&fil[i], m[i], m[i]->size, step) != FR_OK) Fail("%s: f_write() failed", m[i]->path);
+			m[i]->size = m[i]->to[0] = m[i]->size + step;
+			if (round == 5 && i == 2 && f_sync(&fil[i]) != FR_OK) Fail("%s: f_sync() failed", m[i]->path);
+		}
+	}
+	for (i = 0; i < 4; i++) if (f_close(&fil[i]) != FR_OK) Fail("%s: f_close() failed", m[i]->path);
+	printf("fragmentation: 4 files of %llu bytes written by turns\n", (unsigned long long)m[0]->size);
+}
+
+/* 600 files in MANY. */
+static void TestMany (void)
+{
+	FIL fil;
+	MFILE *m;
+	char path[PATH_LEN];
+	int i;
+
+	if (f_mkdir(WORK "MANY") != FR_OK) Fail("f_mkdir(MANY) failed");
+	for (i = 0; i < 600; i++)
+	{
+		snprintf(path, sizeof(path), WORK "MANY/M%05d.TXT", i);
+		m = AddModel(path, 1000 + i);
+		m->ranges = 1;
+		if (f_open(&fil, path, FA_WRITE | FA_CREATE_NEW) != FR_OK)
+		{
+			Fail("%s: f_open() failed", path);
+			m->gone = 1;
+			continue;
+		}
+		if (WriteFile(&fil, m, 0, (i % 7 == 0) ? 0 : 100 + i * 37) != FR_OK) Fail("%s: f_write() failed", path);
+		m->size = m->to[0] = (i % 7 == 0) ? 0 : 100 + i * 37;
+		if (f_close(&fil) != FR_OK) Fail("%s: f_close() failed", path);
+	}
+	printf("directory growth: 600 files in MANY\n");
+}
+
+/* Truncation and deletion. */
+static void TestTruncate (void)
+{
+	static const struct
+	{
+		const char *path;
+		int half;			/* 1: to a half, 0: to 0 */
+	} cut[] = { { WORK "FRAG/F1.BIN", 1 }, { WORK "FRAG/F2.BIN", 0 }, { "PLAIN.TXT", 1 }, { "CHAIN.BIN", 1 } };
+	FIL fil;
+	MFILE *m;
+	uint32_t i, k;
+	uint64_t to;
+	char path[PATH_LEN];
+
+	for (k = 0; k < sizeof(cut) / sizeof(cut[0]); k++)
+	{
+		for (i = 0; i < NumModel && strcasecmp(Model[i].path, cut[k].path) != 0; i++) ;
+		if (i == NumModel) continue;
+		m = &Model[i];
+		to = cut[k].half ? m->size / 2 + 3 : 0;
+		if (f_open(&fil, m->path, FA_WRITE | FA_READ) != FR_OK || f_lseek(&fil, to) != FR_OK || f_truncate(&fil) != FR_OK || f_close(&fil) != FR_OK)
+		{
+			Fail("%s: truncation to %llu failed", m->path, (unsigned long long)to);
+			continue;
+		}
+		m->size = to;
+		if (m->to[0] > to) m->to[0] = to;
+	}
+
+	/* BIG.DAT back under 4GB, into its first range */
+	for (i = 0; i < NumModel && strcmp(Model[i].path, WORK "BIG.DAT") != 0; i++) ;
+	if (i < NumModel)
+	{
+		m = &Model[i];
+		to = 3 * 1024 * 1024 / 4;
+		if (f_open(&fil, m->path, FA_WRITE) != FR_OK || f_lseek(&fil, to) != FR_OK || f_truncate(&fil) != FR_OK || f_close(&fil) != FR_OK) Fail("BIG.DAT: truncation failed");
+		m->size = m->to[0] = to;
+		m->ranges = 1;
+	}
+
+	/* Half of MANY, CHAIN.BIN and F3 deleted */
+	for (i = 0; i < 600; i += 2)
+	{
+		snprintf(path, sizeof(path), WORK "MANY/M%05u.TXT", i);
+		if (f_unlink(path) != FR_OK) Fail("%s: f_unlink() failed", path);
+		for (k = 0; k < NumModel; k++) if (strcmp(Model[k].path, path) == 0) Model[k].gone = 1;
+	}
+	for (k = 0; k < NumModel; k++)
+	{
+		if (strcmp(Model[k].path, "CHAIN.BIN") != 0 && strcmp(Model[k].path, WORK "FRAG/F3.BIN") != 0) continue;
+		if (f_unlink(Model[k].path) != FR_OK) Fail("%s: f_unlink() failed", Model[k].path);
+		Model[k].gone = 1;
+	}
+
+	/* A file grown again after its truncation */
+	for (k = 0; k < NumModel && strcmp(Model[k].path, WORK "FRAG/F2.BIN") != 0; k++) ;
+	if (k < NumModel && f_open(&fil, Model[k].path, FA_WRITE) == FR_OK)
+	{
+		if (WriteFile(&fil, &Model[k], 0, 3 * V.clbytes + 11) != FR_OK) Fail("%s: f_write() after truncation failed", Model[k].path);
+		Model[k].size = Model[k].to[0] = 3 * V.clbytes + 11;
+		f_close(&fil);
+	}
+
+	/* FRAG emptied and removed: the directory must not be removable before */
+	if (f_unlink(WORK "FRAG") == FR_OK) Fail("FRAG removed while not empty");
+	for (k = 0; k < NumModel; k++)
+	{
+		if (strncmp(Model[k].path, WORK "FRAG/", strlen(WORK "FRAG/")) != 0 || Model[k].gone) continue;
+		if (f_unlink(Model[k].path) != FR_OK) Fail("%s: f_unlink() failed", Model[k].path);
+		Model[k].gone = 1;
+	}
+	if (f_unlink(WORK "FRAG") != FR_OK) Fail("f_unlink(FRAG) failed");
+	printf("truncation and deletion done\n");
+}
+
+/* Unmounts, checks the volume and mounts it again. */
+static int Remount (const char *when)
+{
+	f_mount(NULL, "", 0);
+	if (CheckVolume(when) != 0) return -1;
+	if (f_mount(&Fs, "", 1) != FR_OK)
+	{
+		Fail("ff.c does not mount the volume %s", when);
+		return -1;
+	}
+	return 0;
+}
+
+static MFILE *AddModel (const char *path, uint32_t id)
+{
+	MFILE *m = &Model[NumModel < MAX_MODEL ? NumModel++ : MAX_MODEL - 1];
+
+	memset(m, 0, sizeof(*m));
+	snprintf(m->path, sizeof(m->path), "%s", path);
+	m->id = id;
+	return m;
+}
+
+/* Writes the pattern of a file at ofs, the file pointer being there. */
+static FRESULT WriteFile (FIL *fp, MFILE *m, uint64_t ofs, uint64_t n)
+{
+	uint32_t k, len;
+	UINT bw;
+	FRESULT res;
+
+	if (f_tell(fp) != ofs && (res = f_lseek(fp, ofs)) != FR_OK) return res;
+	while (n)
+	{
+		len = (n > CHUNK) ? CHUNK : (uint32_t)n;
+		for (k = 0; k < len; k++) Buf[k] = Pattern(m->id, ofs + k);
+		res = f_write(fp, Buf, len, &bw);
+		if (res != FR_OK) return res;
+		if (bw != len) return FR_DENIED;
+		ofs += len;
+		n -= len;
+	}
+	return FR_OK;
+}
+
+/* Every file of the model, through ff.c and by the checker. */
+static void VerifyModel (void)
+{
+	FIL fil;
+	FILINFO fno;
+	const XFILE *xf;
+	uint32_t i, r, bad = 0;
+
+	for (i = 0; i < NumModel; i++)
+	{
+		MFILE *m = &Model[i];
+
+		xf = FindFile(m->path);
+		if (m->gone)
+		{
+			if (f_stat(m->path, &fno) != FR_NO_FILE && f_stat(m->path, &fno) != FR_NO_PATH) Fail("%s: still found by ff.c after its deletion", m->path);
+			if (xf != NULL) Fail("%s: still in the directory after its deletion", m->path);
+			continue;
+		}
+		if (xf == NULL)
+		{
+			Fail("%s: not in the directory", m->path);
+			continue;
+		}
+		if (xf->size != m->size) Fail("%s: DataLength %llu, %llu written", m->path, (unsigned long long)xf->size, (unsigned long long)m->size);
+		if (!xf->fits) continue;
+		if (f_open(&fil, m->path, FA_READ) != FR_OK)
+		{
+			Fail("%s: f_open() failed", m->path);
+			continue;
+		}
+		if (f_size(&fil) != m->size) Fail("%s: f_size() %llu, %llu written", m->path, (unsigned long long)f_size(&fil), (unsigned long long)m->size);
+		for (r = 0; r < (uint32_t)m->ranges; r++) bad += VerifyRange(m, &fil, xf, m->from[r], m->to[r]);
+		f_close(&fil);
+	}
+	if (bad) Fail("%u ranges read back wrong", bad);
+	else printf("  %u files read back through ff.c and by the checker\n", NumModel);
+}
+
+static int VerifyRange (const MFILE *m, FIL *fp, const XFILE *xf, uint64_t from, uint64_t to)
+{
+	uint32_t k, len;
+	UINT br;
+
+	if (f_lseek(fp, from) != FR_OK) return 1;
+	while (from < to)
+	{
+		len = (to - from > CHUNK) ? CHUNK : (uint32_t)(to - from);
+		if (f_read(fp, Buf, len, &br) != FR_OK || br != len || ReadObject(xf, from, Buf2, len) != 0)
+		{
+			Fail("%s: read at %llu failed", m->path, (unsigned long long)from);
+			return 1;
+		}
+		for (k = 0; k < len; k++)
+		{
+			if (Buf[k] != Pattern(m->id, from + k) || Buf2[k] != Buf[k])
+			{
+				Fail("%s: byte at %llu is %02X through ff.c, %02X by the checker, %02X written", m->path,
+						(unsigned long long)(from + k), Buf[k], Buf2[k], Pattern(m->id, from + k));
+				return 1;
+			}
+		}
+		from += len;
+	}
+	return 0;
+}
+
+/* fsck.exfat of exfatprogs, when installed. */
+static void RunFsck (const char *image)
+{
+	char cmd[PATH_LEN + 64];
+	int st;
+
+	snprintf(cmd, sizeof(cmd), "fsck.exfat -n '%s' > /dev/null 2>&1", image);
+	st = system(cmd);
+	if (st == -1 || !WIFEXITED(st) || WEXITSTATUS(st) == 127)
+	{
+		printf("fsck.exfat: not found, not run\n");
+		return;
+	}
+	if (WEXITSTATUS(st) != 0) Fail("fsck.exfat -n reports errors (status %d)", WEXITSTATUS(st));
+	else printf("fsck.exfat -n: no errors\n");
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
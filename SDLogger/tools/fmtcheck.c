@@ -0,0 +1,302 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file fmtcheck.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: checks that a card image is laid out on the AU.
+ *
+ * Reads the MBR and the boot sector of a FAT volume and checks that the
+ * FAT area and the data area start on an allocation unit (AU) boundary
+ * and that no cluster straddles two AUs, as VOL_Format() lays them out
+ * (see volfmt.h). The partition start is only shown: it sits the reserved
+ * sectors before an AU boundary. The exit status is 1 for a volume that
+ * is not aligned.
+ *
+ * @code
+ *   fmtcheck [-a AU_KB] IMAGE                  # default AU 4096KB
+ *   fmtcheck [-a AU_KB] -m MB [-o IMAGE]
+ * @endcode
+ *
+ *   -a  AU of the card, from the SD status (SD_ReadConfiguration())
+ *   -m  formats a RAM disk of MB megabytes with VOL_Init(), the f_mkfs()
+ *       of the firmware and a SDLOGGER.CFG asking for the format, then
+ *       checks it and that the "format" line was commented out
+ *   -o  saves the formatted RAM disk
+ *
+ * An image of a card is taken on Linux with "dd if=/dev/sdX of=card.img
+ * bs=1M count=64": the start of the card is enough.
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -I../fatfs/src -o fmtcheck fmtcheck.c ../src/volfmt.c \
+ *       ../src/config.c ../fatfs/src/ff.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "config.h"
+#include "volfmt.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static FILE *Image;
+static BYTE *Disk;							/* RAM disk of -m */
+static DWORD DiskSectors;
+static DWORD AuSectors = 4096 * 2;
+
+static const char TestCfg[] =
+		"# Test configuration of fmtcheck\n"
+		"adc = 1\n"
+		"format = 1\n"
+		"formatted = 0\n";
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static int ReadSector (DWORD sect, BYTE *buf);
+static int Check (const char *name);
+static int CheckAt (const char *what, DWORD sect);
+static int FormatDisk (DWORD mb);
+static int SaveDisk (const char *name);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	const char *out = NULL;
+	unsigned long mb = 0;
+	int i, ret;
+
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+	{
+		if (strcmp(argv[i], "-a") == 0) AuSectors = strtoul(argv[i + 1], NULL, 0) * 1024 / SS;
+		else if (strcmp(argv[i], "-m") == 0) mb = strtoul(argv[i + 1], NULL, 0);
+		else if (strcmp(argv[i], "-o") == 0) out = argv[i + 1];
+		else break;
+	}
+	if (AuSectors == 0 || (mb ? i != argc : i + 1 != argc) || (out && !mb))
+	{
+		fprintf(stderr, "usage: fmtcheck [-a AU_KB] IMAGE\n"
+				"       fmtcheck [-a AU_KB] -m MB [-o IMAGE]\n");
+		return 2;
+	}
+
+	if (mb == 0)
+	{
+		Image = fopen(argv[i], "rb");
+		if (Image == NULL)
+		{
+			perror(argv[i]);
+			return 1;
+		}
+		ret = Check(argv[i]);
+		fclose(Image);
+		return ret;
+	}
+
+	ret = FormatDisk(mb);
+	if (ret == 0) ret = Check("RAM disk");
+	if (ret == 0 && out != NULL) ret = SaveDisk(out);
+	free(Disk);
+	return ret;
+}
+
+/* RAM disk of -m, with the AU of -a as its erase block */
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DiskSectors) return RES_PARERR;
+	memcpy(buff, Disk + (size_t)sector * SS, (size_t)count * SS);
+	return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DiskSectors) return RES_PARERR;
+	memcpy(Disk + (size_t)sector * SS, buff, (size_t)count * SS);
+	return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	if (pdrv) return RES_PARERR;
+	switch (cmd)
+	{
+		case CTRL_SYNC:
+		case CTRL_TRIM:
+			return RES_OK;
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = DiskSectors;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = AuSectors;
+			return RES_OK;
+		default:
+			return RES_PARERR;
+	}
+}
+
+DWORD get_fattime (void)
+{
+	return (DWORD)(2026 - 1980) << 25 | 10UL << 21 | 18UL << 16;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static int ReadSector (DWORD sect, BYTE *buf)
+{
+	if (Disk != NULL) return disk_read(0, buf, sect, 1) == RES_OK;
+	return fseek(Image, (long)sect * SS, SEEK_SET) == 0 && fread(buf, 1, SS, Image) == SS;
+}
+
+/* Finds the volume, in the first partition or over the whole card, and
+checks its layout. */
+static int Check (const char *name)
+{
+	BYTE sect[SS];
+	DWORD b_vol = 0, spc, rsvd, nfats, fatsz, dirsz, totsec, b_fat, b_data, clusters;
+	int bad = 0, sfd;
+
+	if (!ReadSector(0, sect) || LD_WORD(&sect[510]) != 0xAA55)
+	{
+		fprintf(stderr, "%s: no MBR or boot sector\n", name);
+		return 1;
+	}
+	sfd = (sect[0] == 0xEB || sect[0] == 0xE9) && LD_WORD(&sect[11]) == SS;
+	if (!sfd)
+	{
+		b_vol = LD_DWORD(&sect[446 + 8]);
+		if (sect[446 + 4] == 0 || !ReadSector(b_vol, sect) || LD_WORD(&sect[510]) != 0xAA55)
+		{
+			fprintf(stderr, "%s: no FAT volume in partition 1\n", name);
+			return 1;
+		}
+	}
+	if (LD_WORD(&sect[11]) != SS || sect[13] == 0 || (sect[13] & (sect[13] - 1)) || sect[16] == 0)
+	{
+		fprintf(stderr, "%s: not a FAT volume with %u byte sectors\n", name, SS);
+		return 1;
+	}
+
+	spc = sect[13];
+	rsvd = LD_WORD(&sect[14]);
+	nfats = sect[16];
+	dirsz = (LD_WORD(&sect[17]) * 32 + SS - 1) / SS;
+	fatsz = LD_WORD(&sect[22]) ? LD_WORD(&sect[22]) : LD_DWORD(&sect[36]);
+	totsec = LD_WORD(&sect[19]) ? LD_WORD(&sect[19]) : LD_DWORD(&sect[32]);
+	b_fat = b_vol + rsvd;
+	b_data = b_fat + nfats * fatsz + dirsz;
+	clusters = (totsec - (b_data - b_vol)) / spc;
+
+	printf("%s: %s, %lu clusters of %luKB, AU %luKB\n", name,
+			(clusters < 4085) ? "FAT12" : (clusters < 65525) ? "FAT16" : "FAT32",
+			(unsigned long)clusters, (unsigned long)spc * SS / 1024, (unsigned long)AuSectors * SS / 1024);
+	if (!sfd) CheckAt("partition", b_vol);
+	bad |= CheckAt("FAT area", b_fat);
+	bad |= CheckAt("data area", b_data);
+	if (AuSectors % spc && spc % AuSectors)
+	{
+		printf("  clusters straddle AUs\n");
+		bad = 1;
+	}
+	return bad;
+}
+
+static int CheckAt (const char *what, DWORD sect)
+{
+	DWORD off = sect % AuSectors;
+
+	if (off == 0) printf("  %-10s at sector %10lu: aligned\n", what, (unsigned long)sect);
+	else printf("  %-10s at sector %10lu: %lu sectors into AU %lu\n", what, (unsigned long)sect,
+			(unsigned long)off, (unsigned long)(sect / AuSectors));
+	return off != 0;
+}
+
+/* Formats the RAM disk as the firmware does it on "format = 1": a first
+format to hold the configuration file, then VOL_Init(). */
+static int FormatDisk (DWORD mb)
+{
+	static FATFS fs;
+	static char buf[VOL_CFG_MAX];
+	FRESULT res;
+	FIL fil;
+	UINT n;
+
+	DiskSectors = mb * (1024 * 1024 / SS);
+	Disk = calloc(DiskSectors, SS);
+	if (Disk == NULL)
+	{
+		fprintf(stderr, "%luMB: out of memory\n", (unsigned long)mb);
+		return 1;
+	}
+
+	res = f_mount(&fs, "", 0);
+	if (res == FR_OK) res = VOL_Format("");
+	if (res == FR_OK) res = f_open(&fil, CFG_FILENAME, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res == FR_OK)
+	{
+		res = f_write(&fil, TestCfg, sizeof(TestCfg) - 1, &n);
+		f_close(&fil);
+	}
+	if (res == FR_OK) res = VOL_Init(1);
+	if (res != FR_OK)
+	{
+		fprintf(stderr, "format failed: %d\n", res);
+		return 1;
+	}
+
+	/* The format request must be gone and the rest kept. */
+	res = f_open(&fil, CFG_FILENAME, FA_OPEN_EXISTING | FA_READ);
+	if (res == FR_OK)
+	{
+		res = f_read(&fil, buf, sizeof(buf) - 1, &n);
+		f_close(&fil);
+	}
+	if (res != FR_OK || n != sizeof(TestCfg) + 1 || strstr(buf, "\n# format = 1\nformatted = 0\n") == NULL)
+	{
+		fprintf(stderr, "%s not restored\n", CFG_FILENAME);
+		return 1;
+	}
+	return 0;
+}
+
+static int SaveDisk (const char *name)
+{
+	FILE *f = fopen(name, "wb");
+
+	if (f == NULL || fwrite(Disk, SS, DiskSectors, f) != DiskSectors)
+	{
+		perror(name);
+		if (f != NULL) fclose(f);
+		return 1;
+	}
+	return (fclose(f) == 0) ? 0 : 1;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
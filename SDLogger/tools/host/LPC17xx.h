@@ -0,0 +1,254 @@
+#ifndef HOST_LPC17XX_H_
+#define HOST_LPC17XX_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file LPC17xx.h
+ * @headerfile LPC17xx.h
+ * @date Oct 18, 2026
+ *
+ * @brief Host stand-in for the device header, for the tools that run the
+ *        firmware modules on the PC (see hostsim.h).
+ *
+ * The register layouts come from the CMSIS device header itself; only the
+ * Cortex-M3 core header is left out. Every peripheral pointer is moved
+ * from its bus address to a register block in host memory, defined in
+ * hostsim.c, where the simulation reads what the firmware programs and
+ * sets what the hardware would. The NVIC keeps the enabled interrupts in
+ * HostIrqEnabled, so a simulated peripheral only raises the interrupts the
+ * firmware enabled.
+ *
+ * The firmware stores addresses in 32-bit registers (DMA linked lists),
+ * so the tools are linked with -no-pie to keep the static data below 4GB.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*
+ * Core header of the toolchain: left out, the part the firmware uses is
+ * below.
+ */
+#define __CORE_CM3_H_GENERIC
+#define __CORE_CM3_H_DEPENDANT
+
+#define __I					volatile const
+#define __O					volatile
+#define __IO				volatile
+
+#include "../../../CMSIS_CORE_LPC17xx/inc/LPC17xx.h"
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct
+{
+	__IO uint32_t CTRL;
+	__IO uint32_t LOAD;
+	__IO uint32_t VAL;
+	__I  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+	__I  uint32_t CPUID;
+	__IO uint32_t ICSR;
+	__IO uint32_t VTOR;
+	__IO uint32_t AIRCR;
+	__IO uint32_t SCR;
+	__IO uint32_t CCR;
+} SCB_Type;
+
+/* GPDMA channel registers, at their spacing on the bus. */
+typedef union
+{
+	LPC_GPDMACH_TypeDef ch;
+	uint32_t space[8];
+} HOSTDMACH;
+
+/* Register blocks whose registers act on a read or a write (a receive
+buffer, a flag cleared by reading it) fill a page of their own, so that
+HOST_Trap() can watch the accesses of the firmware to them. */
+#define HOST_PAGE_SIZE		4096
+#define HOST_PAGE(type, n)	union { type reg[n]; uint8_t page[HOST_PAGE_SIZE]; } __attribute__((aligned(HOST_PAGE_SIZE)))
+
+typedef HOST_PAGE(LPC_CAN_TypeDef, 2) HOSTCANPAGE;
+typedef HOST_PAGE(LPC_UART_TypeDef, 4) HOSTUARTPAGE;		/* 2 and 3 */
+typedef HOST_PAGE(LPC_MCPWM_TypeDef, 1) HOSTMCPWMPAGE;
+typedef HOST_PAGE(LPC_EMAC_TypeDef, 1) HOSTEMACPAGE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PUBLICAS (Globais)						   *
+ ******************************************************************************/
+extern LPC_SC_TypeDef HostSc;
+extern LPC_GPIO_TypeDef HostGpio[5];
+extern LPC_WDT_TypeDef HostWdt;
+extern LPC_TIM_TypeDef HostTim[4];
+extern LPC_RIT_TypeDef HostRit;
+extern LPC_UART0_TypeDef HostUart0;
+extern LPC_UART1_TypeDef HostUart1;
+extern HOSTUARTPAGE HostUart;
+extern LPC_PWM_TypeDef HostPwm1;
+extern LPC_I2C_TypeDef HostI2c[3];
+extern LPC_I2S_TypeDef HostI2s;
+extern LPC_SPI_TypeDef HostSpi;
+extern LPC_RTC_TypeDef HostRtc;
+extern LPC_GPIOINT_TypeDef HostGpioInt;
+extern LPC_PINCON_TypeDef HostPincon;
+extern LPC_SSP_TypeDef HostSsp[2];
+extern LPC_ADC_TypeDef HostAdc;
+extern LPC_DAC_TypeDef HostDac;
+extern LPC_CANAF_RAM_TypeDef HostCanafRam;
+extern LPC_CANAF_TypeDef HostCanaf;
+extern LPC_CANCR_TypeDef HostCancr;
+extern HOSTCANPAGE HostCan;
+extern HOSTMCPWMPAGE HostMcpwm;
+extern LPC_QEI_TypeDef HostQei;
+extern HOSTEMACPAGE HostEmac;
+extern LPC_GPDMA_TypeDef HostGpdma;
+extern HOSTDMACH HostDmaCh[8];
+extern LPC_USB_TypeDef HostUsb;
+extern SysTick_Type HostSysTick;
+extern SCB_Type HostScb;
+
+extern volatile uint64_t HostIrqEnabled;		/* Bit n: IRQn enabled */
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#undef LPC_SC
+#undef LPC_GPIO0
+#undef LPC_GPIO1
+#undef LPC_GPIO2
+#undef LPC_GPIO3
+#undef LPC_GPIO4
+#undef LPC_WDT
+#undef LPC_TIM0
+#undef LPC_TIM1
+#undef LPC_TIM2
+#undef LPC_TIM3
+#undef LPC_RIT
+#undef LPC_UART0
+#undef LPC_UART1
+#undef LPC_UART2
+#undef LPC_UART3
+#undef LPC_PWM1
+#undef LPC_I2C0
+#undef LPC_I2C1
+#undef LPC_I2C2
+#undef LPC_I2S
+#undef LPC_SPI
+#undef LPC_RTC
+#undef LPC_GPIOINT
+#undef LPC_PINCON
+#undef LPC_SSP0
+#undef LPC_SSP1
+#undef LPC_ADC
+#undef LPC_DAC
+#undef LPC_CANAF_RAM
+#undef LPC_CANAF
+#undef LPC_CANCR
+#undef LPC_CAN1
+#undef LPC_CAN2
+#undef LPC_MCPWM
+#undef LPC_QEI
+#undef LPC_EMAC
+#undef LPC_GPDMA
+#undef LPC_GPDMACH0
+#undef LPC_GPDMACH1
+#undef LPC_GPDMACH2
+#undef LPC_GPDMACH3
+#undef LPC_GPDMACH4
+#undef LPC_GPDMACH5
+#undef LPC_GPDMACH6
+#undef LPC_GPDMACH7
+#undef LPC_GPDMACH0_BASE
+#undef LPC_USB
+
+#define LPC_SC				(&HostSc)
+#define LPC_GPIO0			(&HostGpio[0])
+#define LPC_GPIO1			(&HostGpio[1])
+#define LPC_GPIO2			(&HostGpio[2])
+#define LPC_GPIO3			(&HostGpio[3])
+#define LPC_GPIO4			(&HostGpio[4])
+#define LPC_WDT				(&HostWdt)
+#define LPC_TIM0			(&HostTim[0])
+#define LPC_TIM1			(&HostTim[1])
+#define LPC_TIM2			(&HostTim[2])
+#define LPC_TIM3			(&HostTim[3])
+#define LPC_RIT				(&HostRit)
+#define LPC_UART0			(&HostUart0)
+#define LPC_UART1			(&HostUart1)
+#define LPC_UART2			(&HostUart.reg[2])
+#define LPC_UART3			(&HostUart.reg[3])
+#define LPC_PWM1			(&HostPwm1)
+#define LPC_I2C0			(&HostI2c[0])
+#define LPC_I2C1			(&HostI2c[1])
+#define LPC_I2C2			(&HostI2c[2])
+#define LPC_I2S				(&HostI2s)
+#define LPC_SPI				(&HostSpi)
+#define LPC_RTC				(&HostRtc)
+#define LPC_GPIOINT			(&HostGpioInt)
+#define LPC_PINCON			(&HostPincon)
+#define LPC_SSP0			(&HostSsp[0])
+#define LPC_SSP1			(&HostSsp[1])
+#define LPC_ADC				(&HostAdc)
+#define LPC_DAC				(&HostDac)
+#define LPC_CANAF_RAM		(&HostCanafRam)
+#define LPC_CANAF			(&HostCanaf)
+#define LPC_CANCR			(&HostCancr)
+#define LPC_CAN1			(&HostCan.reg[0])
+#define LPC_CAN2			(&HostCan.reg[1])
+#define LPC_MCPWM			(&HostMcpwm.reg[0])
+#define LPC_QEI				(&HostQei)
+#define LPC_EMAC			(&HostEmac.reg[0])
+#define LPC_GPDMA			(&HostGpdma)
+#define LPC_GPDMACH0		(&HostDmaCh[0].ch)
+#define LPC_GPDMACH1		(&HostDmaCh[1].ch)
+#define LPC_GPDMACH2		(&HostDmaCh[2].ch)
+#define LPC_GPDMACH3		(&HostDmaCh[3].ch)
+#define LPC_GPDMACH4		(&HostDmaCh[4].ch)
+#define LPC_GPDMACH5		(&HostDmaCh[5].ch)
+#define LPC_GPDMACH6		(&HostDmaCh[6].ch)
+#define LPC_GPDMACH7		(&HostDmaCh[7].ch)
+#define LPC_GPDMACH0_BASE	((uint32_t)(uintptr_t)HostDmaCh)
+#define LPC_USB				(&HostUsb)
+#define SysTick				(&HostSysTick)
+#define SCB					(&HostScb)
+
+/* Register written by the simulated hardware, read-only for the firmware */
+#define HOST_SET(reg, val)	(*(volatile uint32_t *)&(reg) = (val))
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+static inline void NVIC_EnableIRQ (IRQn_Type IRQn)
+{
+	if (IRQn >= 0) HostIrqEnabled |= 1ULL << IRQn;
+}
+
+static inline void NVIC_DisableIRQ (IRQn_Type IRQn)
+{
+	if (IRQn >= 0) HostIrqEnabled &= ~(1ULL << IRQn);
+}
+
+static inline void NVIC_SetPriority (IRQn_Type IRQn, uint32_t priority)
+{
+	(void)IRQn;
+	(void)priority;
+}
+
+static inline uint8_t __CLZ (uint32_t value)
+{
+	return value ? (uint8_t)__builtin_clz(value) : 32;
+}
+
+static inline void __disable_irq (void) {}
+static inline void __enable_irq (void) {}
+static inline void __WFI (void) {}
+static inline void __NOP (void) {}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
@@ -0,0 +1,22 @@
+#ifndef HOST_CR_SECTION_MACROS_H_
+#define HOST_CR_SECTION_MACROS_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file cr_section_macros.h
+ * @headerfile cr_section_macros.h
+ * @date Oct 18, 2026
+ *
+ * @brief Host stand-in for the section placement macros of the toolchain:
+ *        the data stays in the default sections.
+ *
+ ******************************************************************************/
+
+#define __DATA(bank)
+#define __BSS(bank)
+#define __NOINIT(bank)
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
@@ -0,0 +1,907 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file hostsim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host simulation of the board, to run the capture modules on the
+ *        PC against simulated signals and a simulated card.
+ *
+ * See hostsim.h for the description of the module.
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE									/* REG_EFL and REG_ERR of ucontext.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_gpdma.h"
+
+#include "ff.h"
+#include "diskio.h"
+#include "sdcard.h"
+#include "config.h"
+#include "volfmt.h"
+#include "timestamp.h"
+
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+#define AU_SECTORS			8192					/* 4MB */
+#define HOST_SOURCES		8
+#define TICK_NS				(10 * HOST_MS)			/* SysTick of the SD driver */
+#define STREAM_SIZE			(2 * (LOGLZ_MAX_RAW + sizeof(LOGRECHDR) + 0xFFFF))
+#define UNIX_2000			946684800UL				/* Jan 1st, 2000 in Unix time */
+#define HOST_TRAPS			4
+
+#define EFLAGS_TF			0x100					/* Trap flag: single step */
+#define PF_WRITE			0x02					/* Page fault error code: write access */
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error HOST_Trap() wants Linux on x86-64.
+#endif
+
+/* GPDMA channel fields */
+#define DMA_SIZE(ctrl)		((ctrl) & 0xFFF)
+#define DMA_DWIDTH(ctrl)	(1U << (((ctrl) >> 21) & 7))
+#define DMA_SBSIZE(ctrl)	((((ctrl) >> 12) & 7) ? 2U << (((ctrl) >> 12) & 7) : 1U)
+#define DMA_SRCPER(cfg)		(((cfg) >> 1) & 0x1F)
+#define DMA_TYPE(cfg)		(((cfg) >> 11) & 7)
+#define DMA_LINE(conn)		((conn) > 15 ? (conn) - 8 : (conn))
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagSOURCE
+{
+	HOST_SOURCE fn;
+	uint64_t next;
+} SOURCE;
+
+/* Register block watched by HOST_Trap(). */
+typedef struct tagTRAP
+{
+	uint8_t *page;
+	HOST_ACCESS access;
+} TRAP;
+
+/*******************************************************************************
+ *                        VARIAVEIS PUBLICAS (Globais)						   *
+ ******************************************************************************/
+uint64_t HOST_Ns;
+uint64_t HOST_LoopNs = 10 * HOST_US;
+
+/* SPI at 12.5MHz (SDCLOCK): 0.64us a byte. */
+HOSTCARD HOST_Card =
+{
+	.cmd_ns = 10 * HOST_US,
+	.sector_ns = 330 * HOST_US,
+	.prog_ns = 250 * HOST_US,
+	.erase_ns = 2 * HOST_MS,
+	.stall_ns = 0,
+	.stall_kb = 1024,
+};
+
+uint32_t SystemCoreClock = 100000000;
+
+/* Register blocks of LPC17xx.h */
+LPC_SC_TypeDef HostSc;
+LPC_GPIO_TypeDef HostGpio[5];
+LPC_WDT_TypeDef HostWdt;
+LPC_TIM_TypeDef HostTim[4];
+LPC_RIT_TypeDef HostRit;
+LPC_UART0_TypeDef HostUart0;
+LPC_UART1_TypeDef HostUart1;
+HOSTUARTPAGE HostUart;
+LPC_PWM_TypeDef HostPwm1;
+LPC_I2C_TypeDef HostI2c[3];
+LPC_I2S_TypeDef HostI2s;
+LPC_SPI_TypeDef HostSpi;
+LPC_RTC_TypeDef HostRtc;
+LPC_GPIOINT_TypeDef HostGpioInt;
+LPC_PINCON_TypeDef HostPincon;
+LPC_SSP_TypeDef HostSsp[2];
+LPC_ADC_TypeDef HostAdc;
+LPC_DAC_TypeDef HostDac;
+LPC_CANAF_RAM_TypeDef HostCanafRam;
+LPC_CANAF_TypeDef HostCanaf;
+LPC_CANCR_TypeDef HostCancr;
+HOSTCANPAGE HostCan;
+HOSTMCPWMPAGE HostMcpwm;
+LPC_QEI_TypeDef HostQei;
+HOSTEMACPAGE HostEmac;
+LPC_GPDMA_TypeDef HostGpdma;
+HOSTDMACH HostDmaCh[8];
+LPC_USB_TypeDef HostUsb;
+SysTick_Type HostSysTick;
+SCB_Type HostScb;
+
+volatile uint64_t HostIrqEnabled;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static FATFS Fs;
+static BYTE *Disk;
+static DWORD DiskSectors;
+static bool Timed;								/* Card model on: set after the format */
+static uint64_t BusyUntil;						/* End of the programming of the card */
+static uint64_t StallAcc;						/* Bytes written since the last stall */
+static const char *SaveDir;
+
+static SOURCE Source[HOST_SOURCES];
+static UINT Sources;
+static uint64_t NextTick = TICK_NS;
+static SD_TICK_HOOK TickHook;
+
+static uint8_t Stream[STREAM_SIZE];
+static UINT StreamFill;
+
+static TRAP Trap[HOST_TRAPS];
+static UINT Traps;
+static bool Watched;							/* The firmware runs: pages watched */
+static bool Open;								/* Pages open for the tool */
+static int Stepping = -1;						/* Trap of the access being stepped */
+static uint32_t StepOffset;
+static bool StepWrite;
+
+/* Left out of the tools that do not use the DMA */
+extern void DMA_IRQHandler (void) __attribute__((weak));
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t CardStart (void);
+static void CardEnd (uint64_t t0);
+static uint32_t DmaChannel (uint8_t conn);
+static void DmaClear (void);
+static void RunHandler (void (*handler)(void));
+static void Watch (bool on);
+static void Protect (int prot);
+static void TrapFault (int sig, siginfo_t *info, void *context);
+static void TrapStep (int sig, siginfo_t *info, void *context);
+static long ReadSegment (const char *name, HOST_RECORD callback);
+static long ParseStream (HOST_RECORD callback);
+static int CompareNames (const void *a, const void *b);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+/**
+  * @brief  Takes the options of the card model from the command line.
+  *
+  * @param  argc, argv: Arguments of main().
+  * @retval Index of the first argument left, or -1 for a bad option.
+  */
+int HOST_Options (int argc, char **argv)
+{
+	double v;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != 0; i++)
+	{
+		if (argv[i][1] == 'o' && i + 1 < argc)
+		{
+			SaveDir = argv[++i];
+			continue;
+		}
+		if (argv[i][2] != 0 || i + 1 >= argc) return -1;
+		v = strtod(argv[i + 1], NULL);
+		switch (argv[i++][1])
+		{
+			case 's': HOST_Card.stall_ns = v * HOST_MS; break;
+			case 'k': HOST_Card.stall_kb = v; break;
+			case 'e': HOST_Card.erase_ns = v * HOST_MS; break;
+			case 'p': HOST_Card.prog_ns = v * HOST_US; break;
+			case 'l': HOST_LoopNs = v * HOST_US; break;
+			default: return -1;
+		}
+	}
+	return i;
+}
+
+/**
+  * @brief  Prints the options taken by HOST_Options().
+  *
+  * @param  None
+  * @retval None
+  */
+void HOST_Usage (void)
+{
+	fprintf(stderr,
+			"  -s MS   write stall of the card (default 0)\n"
+			"  -k KB   written between stalls (default 1024)\n"
+			"  -e MS   busy after the erase of an AU (default 2)\n"
+			"  -p US   busy after a write (default 250)\n"
+			"  -l US   pass of the main loop (default 10)\n"
+			"  -o DIR  saves the files of the volume to DIR\n");
+}
+
+/**
+  * @brief  Formats a RAM disk with VOL_Format(), mounts it and writes the
+  *         configuration file, then turns the card model on.
+  *
+  * @param  mb:  Size of the volume, in MB.
+  * @param  cfg: Contents of SDLOGGER.CFG, or NULL for none.
+  * @retval 0, or -1 on error.
+  */
+int HOST_Init (uint32_t mb, const char *cfg)
+{
+	FIL fil;
+	UINT bw;
+
+	DiskSectors = mb * (1024 * 1024 / SS);
+	Disk = calloc(DiskSectors, SS);
+	if (Disk == NULL || f_mount(&Fs, "", 0) != FR_OK || VOL_Format("") != FR_OK || f_mount(&Fs, "", 1) != FR_OK)
+	{
+		fprintf(stderr, "no volume\n");
+		return -1;
+	}
+	if (cfg != NULL)
+	{
+		if (f_open(&fil, CFG_FILENAME, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK
+				|| f_write(&fil, cfg, strlen(cfg), &bw) != FR_OK || f_close(&fil) != FR_OK)
+		{
+			fprintf(stderr, "no %s\n", CFG_FILENAME);
+			return -1;
+		}
+	}
+	Timed = true;
+	return 0;
+}
+
+/**
+  * @brief  Adds an event source.
+  *
+  * @param  source: Source, see HOST_SOURCE.
+  * @param  first:  Time of its first event.
+  * @retval None
+  */
+void HOST_Source (HOST_SOURCE source, uint64_t first)
+{
+	if (Sources == HOST_SOURCES) return;
+	Source[Sources].fn = source;
+	Source[Sources].next = first;
+	Sources++;
+}
+
+/**
+  * @brief  Advances the clock, running the events due in time order.
+  *
+  * @param  ns: Time to run.
+  * @retval None
+  */
+void HOST_Run (uint64_t ns)
+{
+	HOST_RunTo(HOST_Ns + ns);
+}
+
+/**
+  * @brief  Advances the clock to a time, running the events due in time
+  *         order.
+  *
+  * @param  t: Time to run to.
+  * @retval None
+  */
+void HOST_RunTo (uint64_t t)
+{
+	uint64_t next;
+	int i, k;
+	bool watched;
+
+	for (;;)
+	{
+		next = NextTick;
+		k = -1;
+		for (i = 0; i < (int)Sources; i++)
+		{
+			if (Source[i].next < next)
+			{
+				next = Source[i].next;
+				k = i;
+			}
+		}
+		if (next > t) break;
+
+		if (next > HOST_Ns) HOST_Ns = next;
+		if (k < 0)
+		{
+			NextTick += TICK_NS;
+			if (TickHook != NULL) TickHook();
+		}
+		else
+		{
+			watched = Watched;
+			Watch(false);
+			Source[k].next = Source[k].fn(HOST_Ns);
+			Watch(watched);
+			if (Source[k].next <= HOST_Ns) Source[k].next = HOST_Ns + 1;
+		}
+	}
+	if (t > HOST_Ns) HOST_Ns = t;
+}
+
+/**
+  * @brief  Charges the time of a pass of the main loop.
+  *
+  * @param  None
+  * @retval None
+  */
+void HOST_Loop (void)
+{
+	HOST_Run(HOST_LoopNs);
+}
+
+/**
+  * @brief  DMA request of a peripheral. The enabled channel programmed with
+  *         it as the source of a peripheral to memory transfer stores the
+  *         items at the width of its destination, reloads its linked list
+  *         item on the terminal count and raises DMA_IRQHandler() if the
+  *         interrupt is enabled.
+  *
+  * @param  conn: GPDMA_CONN_xxx of the peripheral.
+  * @param  item: Items read from the peripheral, a burst.
+  * @param  n:    Number of items.
+  * @retval Items taken; 0 with no channel ready for the request.
+  */
+uint32_t HOST_DmaRequest (uint8_t conn, const uint32_t *item, uint32_t n)
+{
+	LPC_GPDMACH_TypeDef *ch;
+	const uint32_t *lli;
+	uint32_t i, c, width, raised;
+
+	DmaClear();
+	c = DmaChannel(conn);
+	if (c == 8) return 0;
+	ch = &HostDmaCh[c].ch;
+
+	raised = 0;
+	for (i = 0; i < n && (ch->DMACCConfig & GPDMA_DMACCxConfig_E); i++)
+	{
+		width = DMA_DWIDTH(ch->DMACCControl);
+		memcpy((void *)(uintptr_t)ch->DMACCDestAddr, &item[i], width);
+		if (ch->DMACCControl & GPDMA_DMACCxControl_DI) ch->DMACCDestAddr += width;
+		ch->DMACCControl--;
+		if (DMA_SIZE(ch->DMACCControl) != 0) continue;
+
+		if ((ch->DMACCControl & GPDMA_DMACCxControl_I) && (ch->DMACCConfig & GPDMA_DMACCxConfig_ITC))
+		{
+			HOST_SET(HostGpdma.DMACRawIntTCStat, HostGpdma.DMACRawIntTCStat | (1U << c));
+			HOST_SET(HostGpdma.DMACIntTCStat, HostGpdma.DMACIntTCStat | (1U << c));
+			HOST_SET(HostGpdma.DMACIntStat, HostGpdma.DMACIntStat | (1U << c));
+			raised = 1;
+		}
+		if (ch->DMACCLLI != 0)
+		{
+			lli = (const uint32_t *)(uintptr_t)ch->DMACCLLI;
+			ch->DMACCSrcAddr = lli[0];
+			ch->DMACCDestAddr = lli[1];
+			ch->DMACCLLI = lli[2];
+			ch->DMACCControl = lli[3];
+		}
+		else
+		{
+			ch->DMACCConfig &= ~GPDMA_DMACCxConfig_E;
+		}
+		if (raised && (HostIrqEnabled & (1ULL << DMA_IRQn)) && DMA_IRQHandler != NULL)
+		{
+			RunHandler(DMA_IRQHandler);
+			DmaClear();
+		}
+		raised = 0;
+	}
+	return i;
+}
+
+/**
+  * @brief  Burst size of the channel ready for the DMA requests of a
+  *         peripheral, the items a burst request of it moves.
+  *
+  * @param  conn: GPDMA_CONN_xxx of the peripheral.
+  * @retval Source burst size; 0 with no channel ready.
+  */
+uint32_t HOST_DmaBurst (uint8_t conn)
+{
+	uint32_t c = DmaChannel(conn);
+
+	return (c == 8) ? 0 : DMA_SBSIZE(HostDmaCh[c].ch.DMACCControl);
+}
+
+/**
+  * @brief  Raises an interrupt: runs its handler if the firmware enabled it.
+  *
+  * @param  irq:     Interrupt.
+  * @param  handler: Its handler.
+  * @retval None
+  */
+void HOST_Irq (IRQn_Type irq, void (*handler)(void))
+{
+	if (HostIrqEnabled & (1ULL << irq)) RunHandler(handler);
+}
+
+/**
+  * @brief  Watches the accesses of the firmware to a register block, from
+  *         now on.
+  *
+  * @param  page:   Register block, a HOST_PAGE of LPC17xx.h.
+  * @param  access: Called after each access.
+  * @retval 0, or -1 when the block is not a page or too many are watched.
+  */
+int HOST_Trap (volatile void *page, HOST_ACCESS access)
+{
+	struct sigaction sa;
+
+	if (Traps == HOST_TRAPS || ((uintptr_t)page & (HOST_PAGE_SIZE - 1)) != 0) return -1;
+	if (Traps == 0)
+	{
+		memset(&sa, 0, sizeof(sa));
+		sigemptyset(&sa.sa_mask);
+		sa.sa_flags = SA_SIGINFO;
+		sa.sa_sigaction = TrapFault;
+		sigaction(SIGSEGV, &sa, NULL);
+		sa.sa_sigaction = TrapStep;
+		sigaction(SIGTRAP, &sa, NULL);
+	}
+	Trap[Traps].page = (uint8_t *)page;
+	Trap[Traps].access = access;
+	Traps++;
+
+	Watched = true;
+	Open = true;
+	Watch(true);
+	return 0;
+}
+
+/**
+  * @brief  Reads the log segments back, in order, and hands each record of
+  *         the stream to a callback. The card model is off meanwhile.
+  *
+  * @param  callback: Called for each record.
+  * @retval Records read, or -1 when a segment cannot be read.
+  */
+long HOST_ReadLog (HOST_RECORD callback)
+{
+	static char name[512][13];
+	FILINFO fno;
+	DIR dir;
+	UINT i, n = 0;
+	long r, total = 0;
+	bool timed = Timed;
+
+	Timed = false;
+	if (f_opendir(&dir, "") != FR_OK) return -1;
+	while (n < 512 && f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0)
+	{
+		if (strncmp(fno.fname, LOGSEG_NAME_PREFIX, 3) == 0 && strstr(fno.fname, LOGSEG_NAME_EXT) != NULL)
+		{
+			strcpy(name[n++], fno.fname);
+		}
+	}
+	f_closedir(&dir);
+	qsort(name, n, sizeof(name[0]), CompareNames);
+
+	StreamFill = 0;
+	for (i = 0; i < n; i++)
+	{
+		if ((r = ReadSegment(name[i], callback)) < 0)
+		{
+			total = -1;
+			break;
+		}
+		total += r;
+	}
+	Timed = timed;
+	return total;
+}
+
+/**
+  * @brief  Copies the files of the volume to the directory of -o.
+  *
+  * @param  None
+  * @retval 0, or -1 on error.
+  */
+int HOST_Save (void)
+{
+	static BYTE buf[64 * 1024];
+	char path[1024];
+	FILINFO fno;
+	DIR dir;
+	FIL fil;
+	FILE *out;
+	UINT br;
+	bool timed = Timed;
+	int ret = 0;
+
+	if (SaveDir == NULL) return 0;
+	Timed = false;
+	mkdir(SaveDir, 0777);
+	if (f_opendir(&dir, "") != FR_OK) return -1;
+	while (ret == 0 && f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0)
+	{
+		if (fno.fattrib & AM_DIR) continue;
+		snprintf(path, sizeof(path), "%s/%s", SaveDir, fno.fname);
+		if (f_open(&fil, fno.fname, FA_READ) != FR_OK || (out = fopen(path, "wb")) == NULL)
+		{
+			ret = -1;
+			break;
+		}
+		while (f_read(&fil, buf, sizeof(buf), &br) == FR_OK && br != 0) fwrite(buf, 1, br, out);
+		fclose(out);
+		f_close(&fil);
+	}
+	f_closedir(&dir);
+	Timed = timed;
+	if (ret != 0) fprintf(stderr, "%s: cannot save the files\n", SaveDir);
+	return ret;
+}
+
+/**
+  * @brief  Turns the card model on or off. With it off the disk functions
+  *         take no simulated time, so that a tool can look at the volume
+  *         without holding up the firmware.
+  *
+  * @param  on: Card model on.
+  * @retval Previous state.
+  */
+bool HOST_Timed (bool on)
+{
+	bool timed = Timed;
+
+	Timed = on;
+	return timed;
+}
+
+/**
+  * @brief  Prints the counts of the card model.
+  *
+  * @param  None
+  * @retval None
+  */
+void HOST_Report (void)
+{
+	printf("card: %u writes, %.1fMB, %u erases, %u stalls of %.0fms; %.1f%% of the time in disk_xxx(), longest %.1fms\n",
+			HOST_Card.writes, HOST_Card.written / 1048576.0, HOST_Card.erases, HOST_Card.stalls,
+			HOST_Card.stall_ns / 1e6, HOST_Ns ? 100.0 * HOST_Card.blocked_ns / HOST_Ns : 0.0,
+			HOST_Card.longest_ns / 1e6);
+}
+
+/* Stand-ins of the board: card, time base and timestamps */
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	uint64_t t0;
+
+	if (pdrv || sector + count > DiskSectors) return RES_PARERR;
+	if (Timed)
+	{
+		t0 = CardStart();
+		HOST_Run(count * HOST_Card.sector_ns);
+		CardEnd(t0);
+		HOST_Card.reads++;
+	}
+	memcpy(buff, Disk + (size_t)sector * SS, (size_t)count * SS);
+	return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	uint64_t t0;
+	UINT i;
+
+	if (pdrv || sector + count > DiskSectors) return RES_PARERR;
+	if (!Timed) memcpy(Disk + (size_t)sector * SS, buff, (size_t)count * SS);
+	if (Timed)
+	{
+		t0 = CardStart();
+		for (i = 0; i < count; i++)
+		{
+			/* Each sector is taken from the buffer as it is sent. */
+			memcpy(Disk + (size_t)(sector + i) * SS, buff + i * SS, SS);
+			HOST_Run(HOST_Card.sector_ns);
+			StallAcc += SS;
+			if (HOST_Card.stall_kb != 0 && StallAcc >= HOST_Card.stall_kb * 1024ULL)
+			{
+				StallAcc = 0;
+				if (HOST_Card.stall_ns != 0)
+				{
+					HOST_Run(HOST_Card.stall_ns);
+					HOST_Card.stalls++;
+				}
+			}
+		}
+		BusyUntil = HOST_Ns + HOST_Card.prog_ns;
+		CardEnd(t0);
+		HOST_Card.writes++;
+		HOST_Card.written += (uint64_t)count * SS;
+	}
+	return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	DWORD *rt = buff;
+	uint64_t t0;
+
+	if (pdrv) return RES_PARERR;
+	switch (cmd)
+	{
+		case CTRL_SYNC:
+			if (Timed && HOST_Ns < BusyUntil) HOST_RunTo(BusyUntil);
+			return RES_OK;
+		case CTRL_TRIM:
+			if (rt[0] > rt[1] || rt[1] >= DiskSectors) return RES_PARERR;
+			memset(Disk + (size_t)rt[0] * SS, 0, (size_t)(rt[1] - rt[0] + 1) * SS);
+			if (Timed)
+			{
+				t0 = CardStart();
+				HOST_Run(2 * HOST_Card.cmd_ns);
+				BusyUntil = HOST_Ns + HOST_Card.erase_ns;
+				CardEnd(t0);
+				HOST_Card.erases++;
+			}
+			return RES_OK;
+		case GET_SECTOR_COUNT:
+			*(DWORD *)buff = DiskSectors;
+			return RES_OK;
+		case GET_BLOCK_SIZE:
+			*(DWORD *)buff = AU_SECTORS;
+			return RES_OK;
+		case MMC_GET_BUSY:
+			*(BYTE *)buff = Timed && HOST_Ns < BusyUntil;
+			return RES_OK;
+		default:
+			return RES_PARERR;
+	}
+}
+
+DWORD get_fattime (void)
+{
+	time_t t = UNIX_2000 + HOST_EPOCH + HOST_Ns / 1000000000ULL;
+	struct tm *tm = gmtime(&t);
+
+	return (DWORD)(tm->tm_year - 80) << 25 | (DWORD)(tm->tm_mon + 1) << 21 | (DWORD)tm->tm_mday << 16
+			| (DWORD)tm->tm_hour << 11 | (DWORD)tm->tm_min << 5 | (DWORD)tm->tm_sec >> 1;
+}
+
+void SD_SetTickHook (SD_TICK_HOOK hook)
+{
+	TickHook = hook;
+}
+
+void TS_Init (void)
+{
+}
+
+void TS_Now (TSTAMP *ts)
+{
+	ts->sec = HOST_EPOCH + HOST_Ns / 1000000000ULL;
+	ts->nsec = HOST_Ns % 1000000000ULL;
+}
+
+uint32_t TS_Seconds (void)
+{
+	return HOST_EPOCH + HOST_Ns / 1000000000ULL;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Waits for the programming of the card and sends a command; returns the
+time of the call. */
+static uint64_t CardStart (void)
+{
+	uint64_t t0 = HOST_Ns;
+
+	if (HOST_Ns < BusyUntil) HOST_RunTo(BusyUntil);
+	HOST_Run(HOST_Card.cmd_ns);
+	return t0;
+}
+
+static void CardEnd (uint64_t t0)
+{
+	uint64_t d = HOST_Ns - t0;
+
+	HOST_Card.blocked_ns += d;
+	if (d > HOST_Card.longest_ns) HOST_Card.longest_ns = d;
+}
+
+/* Enabled channel programmed for the requests of a peripheral, or 8. */
+static uint32_t DmaChannel (uint8_t conn)
+{
+	LPC_GPDMACH_TypeDef *ch;
+	uint32_t c;
+
+	for (c = 0; c < 8; c++)
+	{
+		ch = &HostDmaCh[c].ch;
+		if ((ch->DMACCConfig & (GPDMA_DMACCxConfig_E | GPDMA_DMACCxConfig_H)) == GPDMA_DMACCxConfig_E
+				&& DMA_TYPE(ch->DMACCConfig) == GPDMA_TRANSFERTYPE_P2M && DMA_SRCPER(ch->DMACCConfig) == DMA_LINE(conn))
+		{
+			break;
+		}
+	}
+	return c;
+}
+
+/* Clears the interrupt flags written to DMACIntTCClear and DMACIntErrClr. */
+static void DmaClear (void)
+{
+	uint32_t tc = HostGpdma.DMACIntTCClear, err = HostGpdma.DMACIntErrClr;
+
+	HOST_SET(HostGpdma.DMACIntTCStat, HostGpdma.DMACIntTCStat & ~tc);
+	HOST_SET(HostGpdma.DMACRawIntTCStat, HostGpdma.DMACRawIntTCStat & ~tc);
+	HOST_SET(HostGpdma.DMACIntErrStat, HostGpdma.DMACIntErrStat & ~err);
+	HOST_SET(HostGpdma.DMACRawIntErrStat, HostGpdma.DMACRawIntErrStat & ~err);
+	HOST_SET(HostGpdma.DMACIntStat, HostGpdma.DMACIntTCStat | HostGpdma.DMACIntErrStat);
+	HostGpdma.DMACIntTCClear = 0;
+	HostGpdma.DMACIntErrClr = 0;
+}
+
+/* Runs an interrupt handler with the pages watched. */
+static void RunHandler (void (*handler)(void))
+{
+	bool watched = Watched;
+
+	Watch(true);
+	handler();
+	Watch(watched);
+}
+
+/* The pages are opened to the tool on its first access only, most
+sources not touching them. */
+static void Watch (bool on)
+{
+	Watched = on;
+	if (on && Open)
+	{
+		Open = false;
+		Protect(PROT_NONE);
+	}
+}
+
+static void Protect (int prot)
+{
+	UINT i;
+
+	for (i = 0; i < Traps; i++) mprotect(Trap[i].page, HOST_PAGE_SIZE, prot);
+}
+
+/* Access to a watched page: opens the pages and steps the instruction. */
+static void TrapFault (int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = context;
+	uint8_t *addr = info->si_addr;
+	UINT i;
+
+	for (i = 0; i < Traps && (addr < Trap[i].page || addr >= Trap[i].page + HOST_PAGE_SIZE); i++);
+	if (i == Traps)
+	{
+		signal(sig, SIG_DFL);					/* A fault of its own: it faults again */
+		return;
+	}
+	Protect(PROT_READ | PROT_WRITE);
+	if (!Watched)
+	{
+		Open = true;							/* Access of the tool */
+		return;
+	}
+	Stepping = i;
+	StepOffset = addr - Trap[i].page;
+	StepWrite = (uc->uc_mcontext.gregs[REG_ERR] & PF_WRITE) != 0;
+	uc->uc_mcontext.gregs[REG_EFL] |= EFLAGS_TF;
+}
+
+/* The access is done: the tool acts on it and the pages are closed again. */
+static void TrapStep (int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = context;
+
+	(void)sig;
+	(void)info;
+	uc->uc_mcontext.gregs[REG_EFL] &= ~EFLAGS_TF;
+	if (Stepping < 0) return;
+
+	Trap[Stepping].access(StepOffset, StepWrite);
+	Stepping = -1;
+	Protect(PROT_NONE);
+}
+
+/* Adds the valid data sectors of a segment to the stream, as logcat does,
+and passes on the records completed. */
+static long ReadSegment (const char *name, HOST_RECORD callback)
+{
+	static uint8_t sect[LOGSEG_SECT_SIZE];
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+	LOGSEGHDR hdr;
+	FIL fil;
+	UINT br;
+	DWORD idx;
+	int32_t n;
+	long total = 0;
+
+	if (f_open(&fil, name, FA_READ) != FR_OK || f_read(&fil, sect, SS, &br) != FR_OK || br != SS)
+	{
+		fprintf(stderr, "%s: cannot read\n", name);
+		return -1;
+	}
+	memcpy(&hdr, sect, sizeof(hdr));
+	if (hdr.magic != LOGSEG_MAGIC || hdr.check != LOGSEG_Check(&hdr) || hdr.version != LOGSEG_VERSION)
+	{
+		fprintf(stderr, "%s: not a log segment\n", name);
+		f_close(&fil);
+		return -1;
+	}
+
+	f_lseek(&fil, hdr.hdrsize);
+	for (idx = 0; f_read(&fil, sect, SS, &br) == FR_OK && br == SS; idx++)
+	{
+		if (!LOGSEC_Valid(sect, &hdr, idx)) break;
+		if (hdr.flags & LOGSEG_FL_LZ)
+		{
+			n = LOGLZ_Unpack(sect, &Stream[StreamFill]);
+			if (n < 0)
+			{
+				fprintf(stderr, "%s: sector %lu: bad LZ block\n", name, (unsigned long)idx);
+				break;
+			}
+		}
+		else
+		{
+			n = sh->len;
+			memcpy(&Stream[StreamFill], sect + sizeof(LOGSECHDR), n);
+		}
+		StreamFill += n;
+		total += ParseStream(callback);
+		if (!(hdr.flags & LOGSEG_FL_LZ) && sh->len < LOGSEC_PAYLOAD) break;
+	}
+	f_close(&fil);
+	return total;
+}
+
+/* Passes on the complete records at the front of the stream. */
+static long ParseStream (HOST_RECORD callback)
+{
+	LOGRECHDR rec;
+	UINT pos = 0;
+	long n = 0;
+
+	while (StreamFill - pos >= sizeof(rec))
+	{
+		memcpy(&rec, &Stream[pos], sizeof(rec));
+		if (StreamFill - pos < sizeof(rec) + rec.len) break;
+		callback(&rec, &Stream[pos + sizeof(rec)]);
+		pos += sizeof(rec) + rec.len;
+		n++;
+	}
+	memmove(Stream, &Stream[pos], StreamFill - pos);
+	StreamFill -= pos;
+	return n;
+}
+
+static int CompareNames (const void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,142 @@
+#ifndef HOSTSIM_H_
+#define HOSTSIM_H_
+
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file hostsim.h
+ * @headerfile hostsim.h
+ * @date Oct 18, 2026
+ *
+ * @brief Host simulation of the board, to run the capture modules on the
+ *        PC against simulated signals and a simulated card.
+ *
+ * The firmware sources are built unchanged with the stand-in LPC17xx.h of
+ * this directory, which moves the peripheral registers to memory. The
+ * tools (adcsim.c, cansim.c, ...) model a peripheral by setting its
+ * registers and calling its interrupt handler, as the hardware would, from
+ * event sources run on a simulated clock (HOST_Ns):
+ *
+ *   - HOST_Source() adds a source, called at the time it asked for last
+ *   - HOST_Run() advances the clock, running the sources and the 10ms tick
+ *     of the SD driver (SD_SetTickHook()) in time order
+ *   - HOST_DmaRequest() is the DMA request of a peripheral: the GPDMA
+ *     channel programmed for it stores the items, reloads its linked list
+ *     and raises DMA_IRQHandler() on the terminal count, as the GPDMA does
+ *   - HOST_Trap() watches a register block (HOST_PAGE of LPC17xx.h): the
+ *     tool is called after each access of the firmware to it, to act as the
+ *     hardware does on a read or a write, such as loading the next frame
+ *     when the receive buffer is released
+ *
+ * The main loop of a tool calls the Task functions and then HOST_Loop(),
+ * which charges the time of a pass of the loop. The CPU time of the
+ * firmware is not modelled otherwise.
+ *
+ * The card is a RAM disk behind a model of the SPI card of the board
+ * (HOST_Card): every command and every sector takes its SPI time, each
+ * sector being taken from the buffer of disk_write() as it is sent, a write
+ * leaves the card busy programming for a while, an erase (CTRL_TRIM) for
+ * longer, and every stall_kb written one write blocks for stall_ns, the
+ * garbage collection of a real card. disk_read() and disk_write() run the
+ * clock while they wait, so the sources keep running during the card
+ * access, as the interrupts do on the board. MMC_GET_BUSY tells the
+ * programming time, as the driver does.
+ *
+ * HOST_ReadLog() reads the log segments back from the RAM disk and hands
+ * the records to a callback, so a tool can compare them with the signal it
+ * made. HOST_Save() copies the files of the volume to a host directory.
+ * HOST_Timed() turns the card model off while a tool looks at the volume
+ * in the middle of a run.
+ *
+ * HOST_Trap() takes the page of the block away from the firmware and steps
+ * each access that faults on it with the trap flag of the CPU, so it wants
+ * Linux on x86-64. The sources and the access callbacks run with the pages
+ * open; the firmware, interrupt handlers included, runs with them watched.
+ *
+ * @pre
+ *   The tools are linked with -no-pie, see LPC17xx.h.
+ *
+ ******************************************************************************/
+
+/*
+ * Inclusão de arquivos de cabeçalho da ferramenta de desenvolvimento.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Inclusão de arquivos de cabeçalho de outros módulos utilizados por este.
+ */
+#include "LPC17xx.h"
+#include "ff.h"
+#include "logformat.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define HOST_NEVER			UINT64_MAX				/* Source with no event to come */
+#define HOST_MS				1000000ULL				/* Nanoseconds */
+#define HOST_US				1000ULL
+
+#define HOST_EPOCH			845640000UL				/* Oct 18, 2026 12:00:00, TSTAMP seconds at HOST_Ns 0 */
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Event source: runs the event due at 'now' and returns the time of the
+next one, or HOST_NEVER. */
+typedef uint64_t (*HOST_SOURCE)(uint64_t now);
+
+/* Record read back by HOST_ReadLog(). */
+typedef void (*HOST_RECORD)(const LOGRECHDR *rec, const uint8_t *data);
+
+/* Access of the firmware to a block watched by HOST_Trap(), called after
+it: offset of the register in the block, and whether it was written. */
+typedef void (*HOST_ACCESS)(uint32_t offset, bool write);
+
+/* Card model, in nanoseconds. */
+typedef struct tagHOSTCARD
+{
+	uint64_t cmd_ns;		/* Command and response */
+	uint64_t sector_ns;		/* Transfer of a sector and its CRC */
+	uint64_t prog_ns;		/* Busy after a write */
+	uint64_t erase_ns;		/* Busy after an erase */
+	uint64_t stall_ns;		/* Write stall ... */
+	uint32_t stall_kb;		/* ... every stall_kb written (0: none) */
+
+	/* Counts */
+	uint32_t writes, reads, erases, stalls;
+	uint64_t written;		/* Bytes */
+	uint64_t blocked_ns;	/* Time spent in disk_xxx() */
+	uint64_t longest_ns;	/* Longest disk_xxx() call */
+} HOSTCARD;
+
+/*******************************************************************************
+ *                        VARIAVEIS PUBLICAS (Globais)						   *
+ ******************************************************************************/
+extern uint64_t HOST_Ns;							/* Simulated clock */
+extern uint64_t HOST_LoopNs;						/* Time of a pass of the main loop */
+extern HOSTCARD HOST_Card;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PUBLICAS						   *
+ ******************************************************************************/
+int HOST_Options (int argc, char **argv);
+void HOST_Usage (void);
+int HOST_Init (uint32_t mb, const char *cfg);
+void HOST_Source (HOST_SOURCE source, uint64_t first);
+void HOST_Run (uint64_t ns);
+void HOST_RunTo (uint64_t t);
+void HOST_Loop (void);
+uint32_t HOST_DmaRequest (uint8_t conn, const uint32_t *item, uint32_t n);
+uint32_t HOST_DmaBurst (uint8_t conn);
+void HOST_Irq (IRQn_Type irq, void (*handler)(void));
+int HOST_Trap (volatile void *page, HOST_ACCESS access);
+long HOST_ReadLog (HOST_RECORD callback);
+int HOST_Save (void);
+bool HOST_Timed (bool on);
+void HOST_Report (void);
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
+#endif
@@ -0,0 +1,358 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file i2csim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs i2clog.c and the logger against a simulated I2C
+ *        bus and card, and checks that the logged events give back the
+ *        transactions on the bus.
+ *
+ * The bus is a source of the simulation (hostsim.h) that runs random
+ * transactions back to back at the rate given, as a master talking to a
+ * few devices would: register writes, register reads with a repeated
+ * START, quick commands, general calls, and now and then a transfer cut
+ * by an illegal START or STOP. Each transaction costs its bit times: the
+ * START, 9 bits per byte with its acknowledge, the STOP and the bus free
+ * time, all of one bit.
+ *
+ * The model of I2C0 in monitor mode sets I2STAT and I2DATA_BUFFER at the
+ * end of the acknowledge bit of each byte, and at the STOP or repeated
+ * START, and calls I2C0_IRQHandler() with them, as the interrupt of the
+ * monitor would. A byte not acknowledged leaves the slave state machine
+ * not addressed, so the STOP after it gives no interrupt. The handler must
+ * release the state machine with SIC each time.
+ *
+ * The main loop runs I2CLOG_Task() and LOG_Task(), which write to the card
+ * model of hostsim.c. At the end the log is read back from the RAM disk
+ * and the events of the records are put end to end: they must give the
+ * events of the bus, in order, and each address event must carry the time
+ * of its interrupt. Missing events must be announced by LOGREC_I2C_FL_LOST
+ * and counted by I2CLOG_Lost(). It prints the events sent, the event rate
+ * and the events logged. The exit status is 1 when events are missing or
+ * differ.
+ *
+ * @code
+ *   i2csim [options] [SECONDS [RATE [IDLE_US]]]    # default 60s, 400000, no idle time
+ *   i2csim -s 20 60                                # with a 20ms card stall every MB
+ * @endcode
+ *
+ * IDLE_US adds that much idle bus between the transactions. The interrupt
+ * latency of the CPU is not modelled, so the handler always reads the
+ * byte in time and i2cstretch makes no difference here. The options of the
+ * card model are listed by hostsim.c (HOST_Usage()). Build it from this
+ * directory with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o i2csim i2csim.c host/hostsim.c ../src/i2clog.c ../src/logger.c \
+ *       ../src/lzpack.c ../src/crc16.c ../src/config.c ../src/volfmt.c \
+ *       ../fatfs/src/ff.c ../library/src/lpc17xx_i2c.c \
+ *       ../library/src/lpc17xx_clkpwr.c ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_i2c.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "i2clog.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define VOLUME_MB			256
+#define DEVICES				8						/* Slave addresses in use */
+#define XFER_MAX			40						/* Events of a transaction, at most */
+
+#define I2C					LPC_I2C0
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Interrupt of the monitor and the event it must give. */
+typedef struct tagBUSEVENT
+{
+	uint64_t t;
+	uint16_t ev;
+	uint8_t stat;
+	uint8_t byte;
+} BUSEVENT;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t Rate;
+static uint64_t BitNs;
+static uint64_t IdleNs;
+static uint64_t End;								/* No transaction starts after it */
+static uint32_t Seed = 1;
+static uint8_t Device[DEVICES];
+
+static BUSEVENT *Gen;								/* Events of the bus */
+static uint32_t GenCount, GenMax, Sent;
+static uint32_t Xfers, NotReleased;
+
+static uint32_t Pos, Records, Configs, Events, Missing, Unflagged, Bad, BadTime;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t Bus (uint64_t now);
+static uint64_t Transaction (uint64_t t);
+static void Add (uint64_t t, uint8_t stat, uint8_t byte, uint16_t ev);
+static void Check (const LOGRECHDR *rec, const uint8_t *data);
+static uint32_t Random (void);
+
+/* Handler of i2clog.c, declared by the startup code on the board */
+void I2C0_IRQHandler (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	char cfg[32];
+	uint32_t seconds, peak, i;
+	uint64_t t;
+	int a = HOST_Options(argc, argv);
+
+	if (a < 0)
+	{
+		fprintf(stderr, "usage: i2csim [options] [SECONDS [RATE [IDLE_US]]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	seconds = (a < argc) ? strtoul(argv[a], NULL, 0) : 60;
+	Rate = (a + 1 < argc) ? strtoul(argv[a + 1], NULL, 0) : 400000;
+	if (a + 2 < argc) IdleNs = strtod(argv[a + 2], NULL) * HOST_US;
+	if (Rate == 0)
+	{
+		fprintf(stderr, "no RATE\n");
+		return 2;
+	}
+	BitNs = 1000000000ULL / Rate;
+
+	/* One event per 9 bits at most */
+	GenMax = (uint32_t)((uint64_t)seconds * Rate / 9 + XFER_MAX);
+	Gen = malloc(GenMax * sizeof(BUSEVENT));
+	if (Gen == NULL) return 1;
+	for (i = 0; i < DEVICES; i++) Device[i] = 0x10 + (Random() >> 25) % 0x60;
+
+	snprintf(cfg, sizeof(cfg), "i2c = %lu\n", (unsigned long)Rate);
+	if (HOST_Init(VOLUME_MB, cfg) != 0) return 1;
+	SD_SetTickHook(LOG_TimerProc);
+	if (LOG_Init() != FR_OK || I2CLOG_Init() != FR_OK || !(I2C->MMCTRL & I2C_I2MMCTRL_MM_ENA)
+			|| !(I2C->MMCTRL & I2C_I2MMCTRL_MATCH_ALL))
+	{
+		fprintf(stderr, "no logger or no monitor at %lu Hz\n", (unsigned long)Rate);
+		return 1;
+	}
+
+	End = HOST_Ns + seconds * 1000000000ULL;
+	for (t = HOST_Ns + BitNs; t < End; ) t = Transaction(t);
+	HOST_Source(Bus, GenCount ? Gen[0].t : HOST_NEVER);
+
+	while (HOST_Ns < End)
+	{
+		I2CLOG_Task();
+		LOG_Task();
+		HOST_Loop();
+	}
+	HOST_Run(XFER_MAX * 9 * BitNs + 200 * HOST_MS);				/* The last transaction, and the last batch old */
+	I2CLOG_Task();
+	LOG_Close();
+	LOG_Staged(&peak);
+
+	printf("%lus at %lu Hz: %lu transactions, %lu events, %.0f events/s\n", (unsigned long)seconds,
+			(unsigned long)Rate, (unsigned long)Xfers, (unsigned long)GenCount, (double)GenCount / seconds);
+	HOST_Report();
+	if (HOST_ReadLog(Check) < 0) return 1;
+
+	Missing += GenCount - Pos;
+	printf("%lu records, %lu events logged, %lu missing (I2CLOG_Lost() %lu, %lu gaps not flagged), %lu damaged, %lu bad times\n",
+			(unsigned long)Records, (unsigned long)Events, (unsigned long)Missing, (unsigned long)I2CLOG_Lost(),
+			(unsigned long)Unflagged, (unsigned long)Bad, (unsigned long)BadTime);
+	printf("staging ring peak %u of %u sectors\n", peak, LOG_STAGE_SECTORS);
+	if (NotReleased) printf("%lu interrupts left the state machine held\n", (unsigned long)NotReleased);
+	if (Configs != 1) printf("configuration record wrong or missing\n");
+
+	HOST_Save();
+	return (Missing || I2CLOG_Lost() || Unflagged || Bad || BadTime || NotReleased || Configs != 1) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Interrupt of the monitor at each event of the bus. */
+static uint64_t Bus (uint64_t now)
+{
+	BUSEVENT *e = &Gen[Sent++];
+
+	(void)now;
+	HOST_SET(I2C->I2STAT, e->stat);
+	HOST_SET(I2C->I2DAT, e->byte);
+	HOST_SET(I2C->I2DATA_BUFFER, e->byte);
+	I2C->I2CONCLR = 0;
+	HOST_Irq(I2C0_IRQn, I2C0_IRQHandler);
+	if (!(I2C->I2CONCLR & I2C_I2CONCLR_SIC)) NotReleased++;
+
+	return (Sent < GenCount) ? Gen[Sent].t : HOST_NEVER;
+}
+
+/* Adds the events of a random transaction starting at t, and returns the
+time the bus is free again. */
+static uint64_t Transaction (uint64_t t)
+{
+	uint32_t r = Random(), n, i;
+	uint8_t addr = Device[(r >> 8) % DEVICES] << 1;
+	uint8_t b;
+
+	if (GenCount + XFER_MAX > GenMax) return HOST_NEVER;
+	Xfers++;
+	t += BitNs;												/* START */
+
+	switch (r % 16)
+	{
+	case 0:													/* Quick command */
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_SLAW_ACK, addr, LOGI2C_ADDR | addr);
+		break;
+
+	case 1:													/* General call */
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_GENCALL_ACK, 0, LOGI2C_ADDR);
+		b = Random() >> 24;
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_PRE_GENCALL_DAT_ACK, b, LOGI2C_DATA | b);
+		break;
+
+	case 2:													/* Cut by an illegal START or STOP */
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_SLAW_ACK, addr, LOGI2C_ADDR | addr);
+		Add(t += 4 * BitNs, I2C_I2STAT_BUS_ERROR, 0xFF, LOGI2C_ERROR);
+		return t + BitNs;
+
+	case 3: case 4: case 5: case 6: case 7: case 8:			/* Register write */
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_SLAW_ACK, addr, LOGI2C_ADDR | addr);
+		n = 1 + (Random() >> 24) % 8;
+		for (i = 0; i < n; i++)
+		{
+			b = Random() >> 24;
+			if (i == n - 1 && (Random() & 15) == 0)
+			{
+				/* Refused: the monitor stops following the transfer */
+				Add(t += 9 * BitNs, I2C_I2STAT_S_RX_PRE_SLA_DAT_NACK, b, LOGI2C_DATA | LOGI2C_NACK | b);
+				return t + 2 * BitNs;
+			}
+			Add(t += 9 * BitNs, I2C_I2STAT_S_RX_PRE_SLA_DAT_ACK, b, LOGI2C_DATA | b);
+		}
+		break;
+
+	default:												/* Register read */
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_SLAW_ACK, addr, LOGI2C_ADDR | addr);
+		b = Random() >> 24;
+		Add(t += 9 * BitNs, I2C_I2STAT_S_RX_PRE_SLA_DAT_ACK, b, LOGI2C_DATA | b);
+		Add(t += BitNs, I2C_I2STAT_S_RX_STA_STO_SLVREC_SLVTRX, b, LOGI2C_STOP);	/* Repeated START */
+		Add(t += 9 * BitNs, I2C_I2STAT_S_TX_SLAR_ACK, addr | 1, LOGI2C_ADDR | addr | 1);
+		n = 1 + (Random() >> 24) % 16;
+		for (i = 0; i < n - 1; i++)
+		{
+			b = Random() >> 24;
+			Add(t += 9 * BitNs, I2C_I2STAT_S_TX_DAT_ACK, b, LOGI2C_DATA | b);
+		}
+		/* The master ends the read with a NACK, and the STOP goes unseen */
+		b = Random() >> 24;
+		Add(t += 9 * BitNs, I2C_I2STAT_S_TX_DAT_NACK, b, LOGI2C_DATA | LOGI2C_NACK | b);
+		return t + 2 * BitNs + IdleNs;
+	}
+
+	Add(t += BitNs, I2C_I2STAT_S_RX_STA_STO_SLVREC_SLVTRX, 0, LOGI2C_STOP);
+	return t + BitNs + IdleNs;									/* Bus free time */
+}
+
+static void Add (uint64_t t, uint8_t stat, uint8_t byte, uint16_t ev)
+{
+	BUSEVENT *e = &Gen[GenCount++];
+
+	e->t = t;
+	e->stat = stat;
+	e->byte = byte;
+	e->ev = ev;
+}
+
+/* Puts the events of the I2C records end to end and compares them with
+the events of the bus. */
+static void Check (const LOGRECHDR *rec, const uint8_t *data)
+{
+	uint64_t base, ts;
+	uint32_t dt, k;
+	uint16_t ev;
+	UINT i, n;
+
+	if (rec->chan != LOGREC_CH_I2C) return;
+	if (rec->flags & LOGREC_I2C_FL_CONFIG)
+	{
+		if (rec->len == sizeof(LOGI2CCFG) && ((const LOGI2CCFG *)data)->rate == Rate) Configs++;
+		return;
+	}
+	Records++;
+	base = ((uint64_t)rec->sec - HOST_EPOCH) * 1000000000ULL + rec->nsec;
+
+	for (i = 0; i < rec->len; i += n)
+	{
+		memcpy(&ev, &data[i], 2);
+		n = (LOGI2C_KIND(ev) == LOGI2C_ADDR) ? LOGI2C_ADDR_SIZE : 2;
+		if (i + n > rec->len)
+		{
+			Bad++;
+			return;
+		}
+		ts = 0;
+		if (n == LOGI2C_ADDR_SIZE)
+		{
+			memcpy(&dt, &data[i + 2], 4);
+			ts = base + dt;
+		}
+		Events++;
+
+		/* A gap is only allowed in a LOGREC_I2C_FL_LOST record. Address
+		events are found by their time, the others by their value. */
+		for (k = Pos; k < GenCount; k++)
+		{
+			if (Gen[k].ev == ev && (n != LOGI2C_ADDR_SIZE || Gen[k].t == ts)) break;
+		}
+		if (k == GenCount)
+		{
+			for (k = Pos; k < GenCount && Gen[k].ev != ev; k++);
+			if (k == GenCount)
+			{
+				Bad++;
+				return;
+			}
+			BadTime++;
+		}
+		if (k != Pos)
+		{
+			Missing += k - Pos;
+			if (!(rec->flags & LOGREC_I2C_FL_LOST)) Unflagged++;
+		}
+		Pos = k + 1;
+	}
+}
+
+/* xorshift32 */
+static uint32_t Random (void)
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Seed;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,352 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file logcat.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: extracts the log stream of segment files.
+ *
+ * Writes the concatenated stream of the given segments (LOGnnnnn.DAT, in
+ * order) to the standard output, expanding LZ compressed sectors. Each
+ * segment is read up to its last valid sector, as LOG_Init() would keep
+ * it, so segments copied from a card that was not closed are fine.
+ *
+ * @code
+ *   logcat [-v] [-z] [-t time] LOG00001.DAT LOG00002.DAT ... > stream.bin
+ * @endcode
+ *
+ *   -t  starts at the indexed record at or before the given time, given
+ *       as "YYYY-MM-DD HH:MM:SS" or as seconds since 2000: the segment and
+ *       the position are found with a binary search of the index pages
+ *       (LOGSEG_FL_INDEX), so only a few sectors are read before the data
+ *   -v  prints the sector count, the stored and stream sizes, the
+ *       compression ratio, the sectors LZ left as they were (stored) and
+ *       the expansion time per segment
+ *   -z  compresses the stream of uncompressed segments as the logger
+ *       would with LOG_COMPRESS, and prints the ratio and the time taken;
+ *       run it on real captures to decide whether compression pays off
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -o logcat logcat.c ../src/crc16.c ../src/lzpack.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "logformat.h"
+#include "lzpack.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define LZ_RAW				4096			/* LOG_LZ_RAW of the firmware */
+#define NSEC(sec, nsec)		((uint64_t)(sec) * 1000000000 + (nsec))
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagSTATS
+{
+	unsigned long sectors;	/* Valid data sectors */
+	unsigned long stream;	/* Stream bytes */
+	double secs;			/* Time spent expanding or compressing */
+	unsigned long zsectors;	/* Sectors of the -z trial */
+	unsigned long stored;	/* Sectors stored as they are (LOGSEC_RAW_MAGIC), read or in the trial */
+} STATS;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static int Verbose, Trial;
+static uint8_t Raw[LZ_RAW];			/* -z: stream gathered as in the logger */
+static uint32_t RawFill;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static double Now (void);
+static int ParseTime (const char *s, uint64_t *t);
+static FILE *OpenSegment (const char *name, LOGSEGHDR *hdr);
+static uint32_t ReadPage (FILE *f, const LOGSEGHDR *hdr, uint32_t page, uint8_t *sect);
+static int FindTime (FILE *f, const LOGSEGHDR *hdr, uint64_t t, LOGIDXENT *ent);
+static void TrialPack (STATS *st, const uint8_t *data, uint32_t len, int flush);
+static int CatSegment (const char *name, STATS *st, const uint64_t *from);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	STATS st, total;
+	LOGSEGHDR hdr;
+	LOGIDXENT ent;
+	FILE *f;
+	uint64_t t = 0;
+	int i, start, err = 0, seek = 0;
+
+	memset(&total, 0, sizeof(total));
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i], "-v") == 0) Verbose = 1;
+		else if (strcmp(argv[i], "-z") == 0) Trial = Verbose = 1;
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc && ParseTime(argv[i + 1], &t) == 0) seek = 1, i++;
+		else break;
+	}
+	if (i == argc)
+	{
+		fprintf(stderr, "usage: logcat [-v] [-z] [-t time] LOGnnnnn.DAT ... > stream\n");
+		return 2;
+	}
+
+	/* With -t, skip the segments that start after an earlier one and
+	before the time. */
+	for (start = i; seek && i < argc; i++)
+	{
+		if ((f = OpenSegment(argv[i], &hdr)) == NULL) continue;
+		if (FindTime(f, &hdr, 0, &ent) == 0 && NSEC(ent.sec, ent.nsec) <= t) start = i;
+		fclose(f);
+	}
+
+	for (i = start; i < argc; i++)
+	{
+		memset(&st, 0, sizeof(st));
+		if (CatSegment(argv[i], &st, (seek && i == start) ? &t : NULL) != 0)
+		{
+			err = 1;
+			continue;
+		}
+		total.sectors += st.sectors;
+		total.stream += st.stream;
+		total.secs += st.secs;
+		total.zsectors += st.zsectors;
+		total.stored += st.stored;
+	}
+
+	if (Verbose && total.sectors)
+	{
+		fprintf(stderr, "total: %lu sectors, %lu stream bytes, ratio %.2f\n", total.sectors,
+				total.stream, (double)total.stream / (total.sectors * (double)LOGSEG_SECT_SIZE));
+		if (Trial && total.zsectors)
+		{
+			fprintf(stderr, "total -z: %lu sectors (%lu stored), ratio %.2f, %.2f ns/byte\n", total.zsectors,
+					total.stored, (double)total.stream / (total.zsectors * (double)LOGSEG_SECT_SIZE),
+					total.secs * 1e9 / total.stream);
+		}
+	}
+	return err;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static double Now (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Parses "YYYY-MM-DD HH:MM:SS" or seconds, to ns since 2000 (RTC time). */
+static int ParseTime (const char *s, uint64_t *t)
+{
+	static const uint16_t yday[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+	unsigned y, mo, d, h, mi, sec;
+	char *end;
+	uint32_t days;
+
+	if (sscanf(s, "%u-%u-%u%*c%u:%u:%u", &y, &mo, &d, &h, &mi, &sec) == 6)
+	{
+		if (y < 2000 || mo < 1 || mo > 12 || d < 1) return -1;
+		days = (y - 2000) * 365 + (y - 1997) / 4 + yday[mo - 1] + d - 1;
+		if (mo > 2 && (y % 4) == 0) days++;
+		*t = NSEC(((uint64_t)days * 24 + h) * 3600 + mi * 60 + sec, 0);
+		return 0;
+	}
+	*t = NSEC(strtoul(s, &end, 10), 0);
+	return (*end == 0) ? 0 : -1;
+}
+
+/* Opens a segment file and checks its header. */
+static FILE *OpenSegment (const char *name, LOGSEGHDR *hdr)
+{
+	uint8_t sect[LOGSEG_SECT_SIZE];
+	FILE *f;
+
+	f = fopen(name, "rb");
+	if (f == NULL)
+	{
+		perror(name);
+		return NULL;
+	}
+	if (fread(sect, 1, sizeof(sect), f) != sizeof(sect))
+	{
+		fprintf(stderr, "%s: too short\n", name);
+		fclose(f);
+		return NULL;
+	}
+	memcpy(hdr, sect, sizeof(*hdr));
+	if (hdr->magic != LOGSEG_MAGIC || hdr->check != LOGSEG_Check(hdr) || hdr->version != LOGSEG_VERSION)
+	{
+		fprintf(stderr, "%s: not a log segment\n", name);
+		fclose(f);
+		return NULL;
+	}
+	return f;
+}
+
+/* Reads an index page; returns its entries, 0 if it was not written. */
+static uint32_t ReadPage (FILE *f, const LOGSEGHDR *hdr, uint32_t page, uint8_t *sect)
+{
+	if (fseek(f, LOGSEG_HDR_SIZE + (long)page * LOGSEG_SECT_SIZE, SEEK_SET) != 0
+			|| fread(sect, 1, LOGSEG_SECT_SIZE, f) != LOGSEG_SECT_SIZE || !LOGIDX_Valid(sect, hdr, page))
+	{
+		return 0;
+	}
+	return ((const LOGSECHDR *)sect)->len / sizeof(LOGIDXENT);
+}
+
+/* Finds the last index entry at or before 't', or the first one. Pages
+are written in order, so a page that fails the check ends the index. */
+static int FindTime (FILE *f, const LOGSEGHDR *hdr, uint64_t t, LOGIDXENT *ent)
+{
+	uint8_t sect[LOGSEG_SECT_SIZE];
+	const LOGIDXENT *e = (const LOGIDXENT *)(sect + sizeof(LOGSECHDR));
+	uint32_t lo, hi, mid, n;
+
+	if (!(hdr->flags & LOGSEG_FL_INDEX) || hdr->hdrsize <= LOGSEG_HDR_SIZE) return -1;
+
+	/* Last page starting at or before t. */
+	lo = 0;
+	hi = hdr->hdrsize / LOGSEG_SECT_SIZE - 1;
+	while (hi - lo > 1)
+	{
+		mid = (lo + hi) / 2;
+		if (ReadPage(f, hdr, mid, sect) && NSEC(e[0].sec, e[0].nsec) <= t) lo = mid;
+		else hi = mid;
+	}
+	if ((n = ReadPage(f, hdr, lo, sect)) == 0) return -1;
+
+	/* Last entry of the page at or before t. */
+	lo = 0;
+	hi = n;
+	while (hi - lo > 1)
+	{
+		mid = (lo + hi) / 2;
+		if (NSEC(e[mid].sec, e[mid].nsec) <= t) lo = mid;
+		else hi = mid;
+	}
+	*ent = e[lo];
+	return 0;
+}
+
+/* Gathers the stream and compresses it in sectors, as LOG_Write() and
+LOG_Flush() do with LOG_COMPRESS. */
+static void TrialPack (STATS *st, const uint8_t *data, uint32_t len, int flush)
+{
+	static uint8_t sect[LOGSEG_SECT_SIZE];
+	uint32_t n, used;
+	double t;
+
+	while (len || (flush && RawFill))
+	{
+		n = LZ_RAW - RawFill;
+		if (n > len) n = len;
+		memcpy(&Raw[RawFill], data, n);
+		RawFill += n;
+		data += n;
+		len -= n;
+
+		if (RawFill == LZ_RAW || (flush && len == 0))
+		{
+			t = Now();
+			if (LZ_PackSector(Raw, RawFill, sect, &used) == 0) st->stored++;
+			st->secs += Now() - t;
+			st->zsectors++;
+			RawFill -= used;
+			memmove(Raw, &Raw[used], RawFill);
+		}
+	}
+}
+
+/* Writes the stream of one segment to stdout, from the indexed record at
+or before 'from' if given. */
+static int CatSegment (const char *name, STATS *st, const uint64_t *from)
+{
+	static uint8_t sect[LOGSEG_SECT_SIZE], out[LOGLZ_MAX_RAW];
+	LOGSEGHDR hdr;
+	LOGIDXENT ent;
+	const LOGSECHDR *sh = (const LOGSECHDR *)sect;
+	FILE *f;
+	uint32_t idx, skip = 0;
+	int32_t n;
+	double t;
+
+	if ((f = OpenSegment(name, &hdr)) == NULL) return -1;
+
+	idx = 0;
+	if (from != NULL && FindTime(f, &hdr, *from, &ent) == 0)
+	{
+		idx = ent.sector;
+		skip = ent.offset;
+	}
+	fseek(f, hdr.hdrsize + (long)idx * LOGSEG_SECT_SIZE, SEEK_SET);
+
+	for (; fread(sect, 1, sizeof(sect), f) == sizeof(sect); idx++, skip = 0)
+	{
+		if (!LOGSEC_Valid(sect, &hdr, idx)) break;
+		st->sectors++;
+
+		if (hdr.flags & LOGSEG_FL_LZ)
+		{
+			t = Now();
+			n = LOGLZ_Unpack(sect, out);
+			st->secs += Now() - t;
+			if (sh->magic == LOGSEC_RAW_MAGIC) st->stored++;
+			if (n < 0)
+			{
+				fprintf(stderr, "%s: sector %lu: bad LZ block\n", name, (unsigned long)idx);
+				break;
+			}
+			if (skip > (uint32_t)n) skip = n;
+			fwrite(out + skip, 1, n - skip, stdout);
+			st->stream += n;
+		}
+		else
+		{
+			if (skip > sh->len) skip = sh->len;
+			fwrite(sect + sizeof(LOGSECHDR) + skip, 1, sh->len - skip, stdout);
+			st->stream += sh->len;
+			if (Trial) TrialPack(st, sect + sizeof(LOGSECHDR), sh->len, 0);
+			if (sh->len < LOGSEC_PAYLOAD) break;		/* Only the last sector is short */
+		}
+	}
+	fclose(f);
+	if (Trial && !(hdr.flags & LOGSEG_FL_LZ)) TrialPack(st, NULL, 0, 1);
+
+	if (Verbose)
+	{
+		fprintf(stderr, "%s: %lu sectors, %lu stream bytes, ratio %.2f", name, st->sectors, st->stream,
+				st->sectors ? (double)st->stream / (st->sectors * (double)LOGSEG_SECT_SIZE) : 0.0);
+		if (st->stream && (hdr.flags & LOGSEG_FL_LZ))
+		{
+			fprintf(stderr, ", %lu stored, expanded at %.2f ns/byte", st->stored, st->secs * 1e9 / st->stream);
+		}
+		else if (st->zsectors)
+		{
+			fprintf(stderr, ", -z: %lu sectors (%lu stored), ratio %.2f, %.2f ns/byte", st->zsectors, st->stored,
+					(double)st->stream / (st->zsectors * (double)LOGSEG_SECT_SIZE), st->secs * 1e9 / st->stream);
+		}
+		fputc('\n', stderr);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,749 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file logquery.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: parallel query of the records in a card image.
+ *
+ * Maps a raw image of the card (whole disk with an MBR, or a bare FAT12/16/32
+ * or exFAT volume) read-only, finds the segment files (LOGnnnnn.DAT) in the
+ * root directory and follows their cluster chains with a small read-only
+ * FAT parser, so the data is read straight from the mapping with no copy.
+ * On exFAT the names are taken from the entry sets, and a file may be
+ * contiguous (NoFatChain) instead of on the FAT.
+ *
+ * The work is split at the entries of the segment indexes (see
+ * logformat.h): each entry is the position of a record boundary, so the
+ * spans between entries are decoded by a pool of threads, each one
+ * following its last record into the next span or segment as needed. A
+ * segment without an index is one unit, which is only right when it starts
+ * a session. Units that end before the start time or begin after the end
+ * time are not read. The output keeps the order of the log.
+ *
+ * @code
+ *   logquery [-j threads] [-c chanmask] [-f from] [-t to] [-o prefix] [-b] card.img
+ * @endcode
+ *
+ *   -j  worker threads (default: online CPUs)
+ *   -c  channels to keep, bit n for LOGREC_CH n (default: all)
+ *   -f  -t  time range, seconds since 2000 (RTC time)
+ *   -o  columnar output: prefix.time (uint64_t ns), prefix.chan (uint8_t),
+ *       prefix.flags (uint8_t), prefix.len (uint32_t) and prefix.data (the
+ *       payloads back to back), instead of CSV on stdout:
+ *       seconds.nanoseconds,chan,flags,len,payload (text or hex)
+ *   -b  benchmark: decode without output and report the scan rate
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -pthread -I../inc -o logquery logquery.c ../src/crc16.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "logformat.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+#define MAX_SEGMENTS		4096
+#define NSEC(sec, nsec)		((uint64_t)(sec) * 1000000000 + (nsec))
+#define LD16(p)				((uint32_t)(p)[0] | (uint32_t)(p)[1] << 8)
+#define LD32(p)				(LD16(p) | LD16((p) + 2) << 16)
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* FAT volume inside the image. */
+typedef struct tagVOLUME
+{
+	const uint8_t *base;	/* Volume boot sector */
+	const uint8_t *fat;		/* First FAT */
+	const uint8_t *root;	/* FAT12/16 root directory */
+	const uint8_t *data;	/* Cluster 2 */
+	const uint8_t *end;		/* End of the image */
+	uint32_t clbytes;		/* Cluster size */
+	uint32_t nclusters;		/* Clusters + 2 */
+	uint32_t rootents;		/* FAT12/16 root entries */
+	uint32_t rootclus;		/* FAT32 and exFAT root cluster */
+	int type;				/* 12, 16, 32 or 64 (exFAT) */
+} VOLUME;
+
+/* Segment file. */
+typedef struct tagSEGMENT
+{
+	LOGSEGHDR hdr;
+	const uint8_t **clus;	/* Mapping of each cluster of the file */
+	uint32_t size;			/* File size */
+	LOGIDXENT *ent;			/* Valid index entries */
+	uint32_t nent;
+} SEGMENT;
+
+/* Position in the stream: a segment, a data sector and a byte in it. */
+typedef struct tagSPOS
+{
+	uint32_t seg;
+	uint32_t sector;
+	uint32_t offset;
+} SPOS;
+
+/* Unit of work: the records starting in [start, end). */
+typedef struct tagUNIT
+{
+	SPOS start, end;
+	uint64_t t0, t1;		/* Time of the first record and of the next unit */
+	char *out[5];			/* Output: CSV in out[0], or the five columns */
+	size_t len[5], cap[5];
+	uint64_t records, bytes;
+	int done;
+} UNIT;
+
+/* Stream reader over the data sectors. */
+typedef struct tagCURSOR
+{
+	SPOS pos;
+	const uint8_t *data;	/* Stream bytes of the current sector */
+	uint32_t len;
+	uint64_t bytes;			/* Sector bytes read */
+	int end;				/* No more stream */
+	uint8_t lz[LOGLZ_MAX_RAW];
+} CURSOR;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static VOLUME Vol;
+static SEGMENT Seg[MAX_SEGMENTS];
+static uint32_t NumSeg;
+static UNIT *Unit;
+static uint32_t NumUnits;
+
+static uint32_t ChMask = 0xFFFF;
+static uint64_t From, To = UINT64_MAX;
+static int Bench, Columns;
+
+static pthread_mutex_t Lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t Done = PTHREAD_COND_INITIALIZER;
+static uint32_t NextUnit;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static double Now (void);
+static int Mount (const uint8_t *img, size_t size);
+static uint32_t NextCluster (uint32_t cl);
+static const uint8_t **MapChain (uint32_t cl, uint32_t size, int contig);
+static int FindSegments (void);
+static const uint8_t *DirEntry (const uint8_t **map, uint32_t size, uint32_t ofs);
+static void AddSegment (const uint8_t *name, uint32_t cl, uint64_t size, int contig);
+static const uint8_t *SegSector (const SEGMENT *s, uint32_t ofs);
+static void LoadIndex (SEGMENT *s);
+static int CmpSegment (const void *a, const void *b);
+static int CmpPos (const SPOS *a, const SPOS *b);
+static void MakeUnits (void);
+static int CurLoad (CURSOR *c);
+static int CurNext (CURSOR *c);
+static int CurRead (CURSOR *c, void *dst, uint32_t n);
+static void Put (UNIT *u, int col, const void *data, size_t n);
+static void Emit (UNIT *u, const LOGRECHDR *rec, const uint8_t *payload);
+static void RunUnit (UNIT *u, uint8_t *payload);
+static void *Worker (void *arg);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	static const char *ext[5] = { ".time", ".chan", ".flags", ".len", ".data" };
+	const char *prefix = NULL;
+	pthread_t *th;
+	struct stat st;
+	FILE *col[5];
+	char name[1024];
+	uint8_t *img;
+	uint64_t records = 0, bytes = 0;
+	double t0, t1, t2;
+	long nth = sysconf(_SC_NPROCESSORS_ONLN);
+	int fd, opt, i;
+	uint32_t u;
+
+	while ((opt = getopt(argc, argv, "j:c:f:t:o:b")) != -1)
+	{
+		switch (opt)
+		{
+		case 'j': nth = strtol(optarg, NULL, 0); break;
+		case 'c': ChMask = strtoul(optarg, NULL, 0); break;
+		case 'f': From = NSEC(strtoull(optarg, NULL, 10), 0); break;
+		case 't': To = NSEC(strtoull(optarg, NULL, 10) + 1, 0) - 1; break;
+		case 'o': prefix = optarg; Columns = 1; break;
+		case 'b': Bench = 1; break;
+		default: optind = argc + 1; break;
+		}
+	}
+	if (optind != argc - 1 || nth < 1)
+	{
+		fprintf(stderr, "usage: logquery [-j threads] [-c chanmask] [-f from] [-t to] [-o prefix] [-b] card.img\n");
+		return 2;
+	}
+
+	t0 = Now();
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	img = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (img == MAP_FAILED)
+	{
+		perror("mmap");
+		return 1;
+	}
+	madvise(img, st.st_size, MADV_WILLNEED);
+
+	if (Mount(img, st.st_size) != 0 || FindSegments() != 0) return 1;
+	MakeUnits();
+	t1 = Now();
+
+	if (Columns && !Bench)
+	{
+		for (i = 0; i < 5; i++)
+		{
+			snprintf(name, sizeof(name), "%s%s", prefix, ext[i]);
+			if ((col[i] = fopen(name, "wb")) == NULL)
+			{
+				perror(name);
+				return 1;
+			}
+		}
+	}
+
+	/* Workers take the units in order; the output is written in order. */
+	th = calloc(nth, sizeof(pthread_t));
+	for (i = 0; i < nth; i++) pthread_create(&th[i], NULL, Worker, NULL);
+
+	for (u = 0; u < NumUnits; u++)
+	{
+		pthread_mutex_lock(&Lock);
+		while (!Unit[u].done) pthread_cond_wait(&Done, &Lock);
+		pthread_mutex_unlock(&Lock);
+
+		records += Unit[u].records;
+		bytes += Unit[u].bytes;
+		for (i = 0; i < 5; i++)
+		{
+			if (Unit[u].len[i]) fwrite(Unit[u].out[i], 1, Unit[u].len[i], Columns ? col[i] : stdout);
+			free(Unit[u].out[i]);
+		}
+	}
+	for (i = 0; i < nth; i++) pthread_join(th[i], NULL);
+	t2 = Now();
+
+	if (Columns && !Bench) for (i = 0; i < 5; i++) fclose(col[i]);
+
+	fprintf(stderr, "%u segments, %u units, %llu records, %.3f GB of sectors\n", NumSeg, NumUnits,
+			(unsigned long long)records, bytes / 1e9);
+	if (Bench)
+	{
+		fprintf(stderr, "mount and index: %.3f s, scan: %.3f s, %.2f GB/s with %ld threads\n",
+				t1 - t0, t2 - t1, (t2 > t1) ? bytes / 1e9 / (t2 - t1) : 0.0, nth);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static double Now (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Finds the FAT or exFAT volume, in sector 0 or in the first MBR
+partition, and its layout, as FatFs does. */
+static int Mount (const uint8_t *img, size_t size)
+{
+	const uint8_t *bs = img;
+	uint32_t rsvd, nfats, fatsz, totsec, rootsecs, spc;
+
+	if (size < SS || LD16(bs + 510) != 0xAA55) goto fail;
+	if (memcmp(bs + 3, "EXFAT   ", 8) != 0 && (!(bs[0] == 0xEB || bs[0] == 0xE9 || bs[0] == 0xE8) || LD16(bs + 11) != SS))
+	{
+		/* A partition table: take the first entry. */
+		if (bs[446 + 4] == 0 || (uint64_t)LD32(bs + 446 + 8) * SS + SS > size) goto fail;
+		bs = img + (size_t)LD32(bs + 446 + 8) * SS;
+		if (LD16(bs + 510) != 0xAA55 || (memcmp(bs + 3, "EXFAT   ", 8) != 0 && LD16(bs + 11) != SS)) goto fail;
+	}
+	Vol.base = bs;
+	Vol.end = img + size;
+
+	if (memcmp(bs + 3, "EXFAT   ", 8) == 0)
+	{
+		/* exFAT: the first FAT only, no fixed root directory */
+		if (bs[108] != 9 || bs[109] > 25 - 9 || bs[110] == 0) goto fail;
+		Vol.clbytes = SS << bs[109];
+		Vol.fat = bs + (size_t)LD32(bs + 80) * SS;
+		Vol.data = bs + (size_t)LD32(bs + 88) * SS;
+		Vol.nclusters = LD32(bs + 92) + 2;
+		Vol.rootclus = LD32(bs + 96);
+		Vol.type = 64;
+		if (Vol.data > Vol.end) goto fail;
+		return 0;
+	}
+
+	spc = bs[13];
+	rsvd = LD16(bs + 14);
+	nfats = bs[16];
+	Vol.rootents = LD16(bs + 17);
+	totsec = LD16(bs + 19) ? LD16(bs + 19) : LD32(bs + 32);
+	fatsz = LD16(bs + 22) ? LD16(bs + 22) : LD32(bs + 36);
+	if (spc == 0 || nfats == 0 || fatsz == 0) goto fail;
+
+	rootsecs = (Vol.rootents * 32 + SS - 1) / SS;
+	Vol.clbytes = spc * SS;
+	Vol.fat = bs + (size_t)rsvd * SS;
+	Vol.root = Vol.fat + (size_t)nfats * fatsz * SS;
+	Vol.data = Vol.root + (size_t)rootsecs * SS;
+	Vol.nclusters = (totsec - rsvd - nfats * fatsz - rootsecs) / spc + 2;
+	Vol.type = (Vol.nclusters - 2 < 4085) ? 12 : (Vol.nclusters - 2 < 65525) ? 16 : 32;
+	Vol.rootclus = LD32(bs + 44);
+
+	if (Vol.data > Vol.end) goto fail;
+	return 0;
+
+fail:
+	fprintf(stderr, "no FAT or exFAT volume found\n");
+	return -1;
+}
+
+static uint32_t NextCluster (uint32_t cl)
+{
+	uint32_t v;
+
+	switch (Vol.type)
+	{
+	case 12:
+		v = LD16(Vol.fat + cl + cl / 2);
+		return (cl & 1) ? v >> 4 : v & 0xFFF;
+	case 16:
+		return LD16(Vol.fat + cl * 2);
+	case 64:
+		return LD32(Vol.fat + cl * 4);
+	default:
+		return LD32(Vol.fat + cl * 4) & 0x0FFFFFFF;
+	}
+}
+
+/* Mapping of each cluster of a chain, for 'size' bytes; a contiguous
+exFAT file (NoFatChain) has no chain on the FAT. */
+static const uint8_t **MapChain (uint32_t cl, uint32_t size, int contig)
+{
+	uint32_t i, n = (size + Vol.clbytes - 1) / Vol.clbytes;
+	const uint8_t **map = calloc(n ? n : 1, sizeof(*map));
+
+	for (i = 0; i < n; i++)
+	{
+		if (cl < 2 || cl >= Vol.nclusters) break;
+		map[i] = Vol.data + (size_t)(cl - 2) * Vol.clbytes;
+		if (map[i] + Vol.clbytes > Vol.end)
+		{
+			map[i] = NULL;
+			break;
+		}
+		cl = contig ? cl + 1 : NextCluster(cl);
+	}
+	return map;
+}
+
+/* Lists the segment files of the root directory, in sequence order. */
+static int FindSegments (void)
+{
+	const uint8_t **map;
+	const uint8_t *d, *st, *nm;
+	uint8_t name[11];
+	uint32_t i, n, size, w;
+
+	if (Vol.type >= 32)
+	{
+		/* Follow the root chain up to an arbitrary bound. */
+		size = 0;
+		for (n = Vol.rootclus; n >= 2 && n < Vol.nclusters && size < 65536 * 32; n = NextCluster(n)) size += Vol.clbytes;
+		map = MapChain(Vol.rootclus, size, 0);
+	}
+	else
+	{
+		size = Vol.rootents * 32;
+		map = NULL;
+	}
+
+	for (i = 0; i < size; i += 32)
+	{
+		d = map ? DirEntry(map, size, i) : Vol.root + i;
+		if (d == NULL || d[0] == 0) break;
+		if (Vol.type == 64)
+		{
+			/* File entry, stream entry, then the name entry: an 8.3 name
+			of 12 characters fits in the first one. */
+			if (d[0] != 0x85) continue;
+			st = DirEntry(map, size, i + 32);
+			nm = DirEntry(map, size, i + 64);
+			i += 32 * d[1];
+			if (st == NULL || nm == NULL || st[0] != 0xC0 || nm[0] != 0xC1 || st[3] != 12 || (LD16(d + 4) & 0x18)) continue;
+			for (n = 0; n < 12; n++)
+			{
+				w = LD16(nm + 2 + n * 2);
+				if (w >= 'a' && w <= 'z') w -= 0x20;
+				if (w > 0x7F || (n == 8) != (w == '.')) break;
+				if (n != 8) name[n - (n > 8)] = (uint8_t)w;
+			}
+			if (n == 12) AddSegment(name, LD32(st + 20), (uint64_t)LD32(st + 24) | (uint64_t)LD32(st + 28) << 32, st[1] & 0x02);
+			continue;
+		}
+		if (d[0] == 0xE5 || (d[11] & 0x0F) == 0x0F || (d[11] & 0x18)) continue;
+		AddSegment(d, LD16(d + 20) << 16 | LD16(d + 26), LD32(d + 28), 0);
+	}
+	free(map);
+
+	qsort(Seg, NumSeg, sizeof(SEGMENT), CmpSegment);
+	for (i = 0; i < NumSeg; i++) LoadIndex(&Seg[i]);
+	if (NumSeg == 0) fprintf(stderr, "no log segments found\n");
+	return NumSeg ? 0 : -1;
+}
+
+/* Entry at an offset of a mapped directory, or NULL past its end. */
+static const uint8_t *DirEntry (const uint8_t **map, uint32_t size, uint32_t ofs)
+{
+	if (ofs >= size || map[ofs / Vol.clbytes] == NULL) return NULL;
+	return map[ofs / Vol.clbytes] + ofs % Vol.clbytes;
+}
+
+/* Adds a file if it is a segment with a valid header; the name is in the
+11 characters of a FAT directory entry. */
+static void AddSegment (const uint8_t *name, uint32_t cl, uint64_t size, int contig)
+{
+	SEGMENT *s = &Seg[NumSeg];
+	const uint8_t *p;
+	int i;
+
+	if (NumSeg == MAX_SEGMENTS || memcmp(name, LOGSEG_NAME_PREFIX, 3) != 0 || memcmp(name + 8, LOGSEG_NAME_EXT + 1, 3) != 0) return;
+	for (i = 3; i < 8; i++) if (name[i] < '0' || name[i] > '9') return;
+	if (size > 0xFFFFFFFFUL) return;
+
+	s->size = (uint32_t)size;
+	s->clus = MapChain(cl, s->size, contig);
+	if (s->size < LOGSEG_HDR_SIZE || (p = SegSector(s, 0)) == NULL)
+	{
+		free(s->clus);
+		return;
+	}
+	memcpy(&s->hdr, p, sizeof(s->hdr));
+	if (s->hdr.magic != LOGSEG_MAGIC || s->hdr.check != LOGSEG_Check(&s->hdr) || s->hdr.version != LOGSEG_VERSION)
+	{
+		free(s->clus);
+		return;
+	}
+	NumSeg++;
+}
+
+/* Sector at a file offset, or NULL past the end. */
+static const uint8_t *SegSector (const SEGMENT *s, uint32_t ofs)
+{
+	const uint8_t *c;
+
+	if (ofs + SS > s->size || (c = s->clus[ofs / Vol.clbytes]) == NULL) return NULL;
+	return c + ofs % Vol.clbytes;
+}
+
+/* Collects the entries of the valid index pages. */
+static void LoadIndex (SEGMENT *s)
+{
+	const uint8_t *p;
+	uint32_t page, n;
+
+	if (!(s->hdr.flags & LOGSEG_FL_INDEX)) return;
+
+	s->ent = malloc((s->hdr.hdrsize / SS) * LOGIDX_ENTRIES * sizeof(LOGIDXENT));
+	for (page = 0; page + 1 < s->hdr.hdrsize / SS; page++)
+	{
+		p = SegSector(s, LOGSEG_HDR_SIZE + page * SS);
+		if (p == NULL || !LOGIDX_Valid(p, &s->hdr, page)) break;
+		n = ((const LOGSECHDR *)p)->len / sizeof(LOGIDXENT);
+		memcpy(&s->ent[s->nent], p + sizeof(LOGSECHDR), n * sizeof(LOGIDXENT));
+		s->nent += n;
+	}
+}
+
+static int CmpSegment (const void *a, const void *b)
+{
+	uint32_t x = ((const SEGMENT *)a)->hdr.seq, y = ((const SEGMENT *)b)->hdr.seq;
+
+	return (x > y) - (x < y);
+}
+
+static int CmpPos (const SPOS *a, const SPOS *b)
+{
+	if (a->seg != b->seg) return (a->seg > b->seg) ? 1 : -1;
+	if (a->sector != b->sector) return (a->sector > b->sector) ? 1 : -1;
+	return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+/* One unit per index entry, or per segment without an index. Units
+outside the time range are dropped. */
+static void MakeUnits (void)
+{
+	uint32_t i, k, n = 0;
+	UNIT *u;
+
+	for (i = 0; i < NumSeg; i++) n += Seg[i].nent ? Seg[i].nent : 1;
+	Unit = calloc(n, sizeof(UNIT));
+
+	for (i = 0; i < NumSeg; i++)
+	{
+		for (k = 0; k < (Seg[i].nent ? Seg[i].nent : 1); k++)
+		{
+			u = &Unit[NumUnits++];
+			u->start.seg = i;
+			u->t1 = UINT64_MAX;
+			if (Seg[i].nent)
+			{
+				u->start.sector = Seg[i].ent[k].sector;
+				u->start.offset = Seg[i].ent[k].offset;
+				u->t0 = NSEC(Seg[i].ent[k].sec, Seg[i].ent[k].nsec);
+			}
+		}
+	}
+	for (i = 0; i < NumUnits; i++)
+	{
+		if (i + 1 < NumUnits)
+		{
+			Unit[i].end = Unit[i + 1].start;
+			if (Seg[Unit[i + 1].start.seg].nent) Unit[i].t1 = Unit[i + 1].t0;
+		}
+		else
+		{
+			Unit[i].end.seg = UINT32_MAX;
+		}
+	}
+
+	/* The entries are nearly in time order: keep a unit of margin. */
+	for (i = k = 0; i < NumUnits; i++)
+	{
+		if ((i + 1 < NumUnits && Unit[i + 1].t1 != UINT64_MAX && Unit[i + 1].t1 < From)
+				|| (i > 0 && Unit[i - 1].t0 > To && Seg[Unit[i - 1].start.seg].nent)) continue;
+		Unit[k++] = Unit[i];
+	}
+	NumUnits = k;
+}
+
+/* Loads the sector at the cursor, moving to the next segment at the end
+of one. */
+static int CurLoad (CURSOR *c)
+{
+	const SEGMENT *s;
+	const uint8_t *p;
+	const LOGSECHDR *sh;
+	int32_t n;
+
+	for (;;)
+	{
+		if (c->end || c->pos.seg >= NumSeg) return -1;
+		s = &Seg[c->pos.seg];
+		p = SegSector(s, s->hdr.hdrsize + c->pos.sector * SS);
+		if (p != NULL && LOGSEC_Valid(p, &s->hdr, c->pos.sector)) break;
+
+		/* The stream goes on in the next segment of the same session. */
+		if (c->pos.seg + 1 >= NumSeg || Seg[c->pos.seg + 1].hdr.seq != s->hdr.seq + 1)
+		{
+			c->end = 1;
+			return -1;
+		}
+		c->pos.seg++;
+		c->pos.sector = c->pos.offset = 0;
+	}
+
+	sh = (const LOGSECHDR *)p;
+	c->bytes += SS;
+	if (s->hdr.flags & LOGSEG_FL_LZ)
+	{
+		if ((n = LOGLZ_Unpack(p, c->lz)) < 0) return -1;
+		c->data = c->lz;
+		c->len = n;
+	}
+	else
+	{
+		c->data = p + sizeof(LOGSECHDR);
+		c->len = sh->len;
+	}
+	return 0;
+}
+
+/* Moves a cursor at the end of its sector to the next one, so that it
+compares as the position of the next byte. */
+static int CurNext (CURSOR *c)
+{
+	while (c->data == NULL || c->pos.offset >= c->len)
+	{
+		if (c->data != NULL)
+		{
+			/* A short sector ends the segment. */
+			if (c->len < LOGSEC_PAYLOAD && !(Seg[c->pos.seg].hdr.flags & LOGSEG_FL_LZ))
+			{
+				if (c->pos.seg + 1 >= NumSeg || Seg[c->pos.seg + 1].hdr.seq != Seg[c->pos.seg].hdr.seq + 1)
+				{
+					c->end = 1;
+					return -1;
+				}
+				c->pos.seg++;
+				c->pos.sector = 0;
+			}
+			else
+			{
+				c->pos.sector++;
+			}
+			c->pos.offset = 0;
+			c->data = NULL;
+		}
+		if (CurLoad(c) != 0) return -1;
+	}
+	return 0;
+}
+
+/* Reads stream bytes across sectors and segments. */
+static int CurRead (CURSOR *c, void *dst, uint32_t n)
+{
+	uint8_t *d = dst;
+	uint32_t k;
+
+	while (n)
+	{
+		if (CurNext(c) != 0) return -1;
+		k = c->len - c->pos.offset;
+		if (k > n) k = n;
+		memcpy(d, c->data + c->pos.offset, k);
+		c->pos.offset += k;
+		d += k;
+		n -= k;
+	}
+	return 0;
+}
+
+/* Appends to an output column. */
+static void Put (UNIT *u, int col, const void *data, size_t n)
+{
+	if (u->len[col] + n > u->cap[col])
+	{
+		u->cap[col] = (u->len[col] + n) * 2 + 4096;
+		u->out[col] = realloc(u->out[col], u->cap[col]);
+	}
+	memcpy(u->out[col] + u->len[col], data, n);
+	u->len[col] += n;
+}
+
+/* Writes one record as a CSV line or as a row of the columns. */
+static void Emit (UNIT *u, const LOGRECHDR *rec, const uint8_t *payload)
+{
+	static const char hex[] = "0123456789abcdef";
+	char line[64], *buf;
+	uint64_t t = NSEC(rec->sec, rec->nsec);
+	uint32_t i, n, len = rec->len;
+
+	if (Columns)
+	{
+		Put(u, 0, &t, sizeof(t));
+		Put(u, 1, &rec->chan, 1);
+		Put(u, 2, &rec->flags, 1);
+		Put(u, 3, &len, sizeof(len));
+		Put(u, 4, payload, len);
+		return;
+	}
+
+	n = snprintf(line, sizeof(line), "%u.%09u,%u,%u,%u,", rec->sec, rec->nsec, rec->chan, rec->flags, len);
+	Put(u, 0, line, n);
+	buf = malloc(2 * len + 3);
+	n = 0;
+	if (rec->chan == LOGREC_CH_TEXT)
+	{
+		buf[n++] = '"';
+		for (i = 0; i < len; i++)
+		{
+			if (payload[i] == '"') buf[n++] = '"';
+			buf[n++] = (payload[i] == '\n' || payload[i] == '\r') ? ' ' : payload[i];
+		}
+		buf[n++] = '"';
+	}
+	else
+	{
+		for (i = 0; i < len; i++)
+		{
+			buf[n++] = hex[payload[i] >> 4];
+			buf[n++] = hex[payload[i] & 15];
+		}
+	}
+	buf[n++] = '\n';
+	Put(u, 0, buf, n);
+	free(buf);
+}
+
+/* Decodes the records starting in a unit. */
+static void RunUnit (UNIT *u, uint8_t *payload)
+{
+	CURSOR *c = calloc(1, sizeof(CURSOR));
+	LOGRECHDR rec;
+	uint64_t t;
+
+	c->pos = u->start;
+	while (CurNext(c) == 0 && CmpPos(&c->pos, &u->end) < 0)
+	{
+		if (CurRead(c, &rec, sizeof(rec)) != 0 || CurRead(c, payload, rec.len) != 0) break;
+
+		t = NSEC(rec.sec, rec.nsec);
+		if (t < From || t > To || !(ChMask & (1u << (rec.chan & 31)))) continue;
+		u->records++;
+		if (!Bench) Emit(u, &rec, payload);
+	}
+	u->bytes = c->bytes;
+	free(c);
+}
+
+static void *Worker (void *arg)
+{
+	uint8_t *payload = malloc(0x10000);
+	uint32_t u;
+
+	(void)arg;
+	for (;;)
+	{
+		pthread_mutex_lock(&Lock);
+		u = NextUnit++;
+		pthread_mutex_unlock(&Lock);
+		if (u >= NumUnits) break;
+
+		RunUnit(&Unit[u], payload);
+
+		pthread_mutex_lock(&Lock);
+		Unit[u].done = 1;
+		pthread_cond_broadcast(&Done);
+		pthread_mutex_unlock(&Lock);
+	}
+	free(payload);
+	return NULL;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
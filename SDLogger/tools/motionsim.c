@@ -0,0 +1,523 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file motionsim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs motionlog.c and the logger against a simulated
+ *        quadrature encoder and card, and checks the logged positions and
+ *        edges against the motion made.
+ *
+ * The encoder is a source of the simulation (hostsim.h) that moves a 1000
+ * line encoder (4000 edges and one index pulse per turn) through a cycle
+ * of 2s: back, at rest, forward twice as far, at rest, each move with a
+ * sine velocity up to the speed given. Every edge sets the PHA, PHB and IDX
+ * levels on P1.20, P1.23 and P1.24, and the model of the QEI counts it in
+ * QEIPOS (4X mode, the position wraps at 2^32) and the index pulses in
+ * INXCNT. The velocity timer is a second source: every QEILOAD ticks of
+ * the QEI clock it raises QEI_IRQHandler(), while its interrupt is enabled
+ * in QEIIES.
+ *
+ * With the edge capture on, the model of the MCPWM captures the timer of
+ * channel i in MCCRi on the edges of MCIi enabled in MCCAPCON, sets the
+ * capture flag and raises MCPWM_IRQHandler() 2us later, an interrupt
+ * latency for the handler to take back. A second edge on the input before then
+ * takes the capture over; the firmware cannot see the first one, so it is
+ * reported apart and not expected in the log. Its registers are watched with
+ * HOST_Trap(): the SET and CLR registers act on MCCON, MCCAPCON, MCINTEN,
+ * MCCNTCON and MCINTFLAG.
+ *
+ * The main loop runs MOTIONLOG_Task() and LOG_Task(), which write to the
+ * card model of hostsim.c. At the end the log is read back from the RAM
+ * disk. Each position block must be stamped at a sample time, and hold the
+ * position and index count of the encoder at that sample and at the
+ * following ones. The edges must be those made, in order, on their input,
+ * with their level, and stamped within a tick of the MCPWM timer. Samples
+ * and edges may only be missing before a record with LOGREC_MOT_FL_LOST,
+ * and must be counted by MOTIONLOG_Lost(). It prints the samples and edges
+ * made and logged, and the bytes a sample takes in the log. The exit status
+ * is 1 when data is missing without being counted, or differs.
+ *
+ * @code
+ *   motionsim [options] [SECONDS [RATE [SPEED [MCICAP]]]]  # default 60s, 10000, 100000, 0
+ *   motionsim 60 50000 1000000                             # 250 turns/s at the top rate
+ *   motionsim -s 100 60 10000 20000 1                      # edges too, card stalls
+ * @endcode
+ *
+ * SPEED is the top speed, in edges/s. The CPU time of the interrupts is not
+ * modelled, so the tool gives no load figure. The options of the card model
+ * are listed by hostsim.c (HOST_Usage()). Build it from this directory
+ * with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o motionsim motionsim.c host/hostsim.c ../src/motionlog.c \
+ *       ../src/logger.c ../src/lzpack.c ../src/crc16.c ../src/config.c \
+ *       ../src/volfmt.c ../fatfs/src/ff.c ../library/src/lpc17xx_qei.c \
+ *       ../library/src/lpc17xx_mcpwm.c ../library/src/lpc17xx_clkpwr.c \
+ *       ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_qei.h"
+#include "lpc17xx_mcpwm.h"
+#include "lpc17xx_clkpwr.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "motionlog.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define VOLUME_MB			256
+#define TURN_EDGES			4000					/* 1000 lines, 4X */
+#define CYCLE_NS			2000000000ULL
+#define LATENCY_NS			(2 * HOST_US)			/* MCPWM capture to interrupt */
+#define MCI_INPUTS			3
+
+#define QEI					(&HostQei)
+#define MCPWM				(&HostMcpwm.reg[0])
+#define MCTIM(i)			((&MCPWM->MCTIM0)[i])
+#define MCCR(i)				((&MCPWM->MCCR0)[i])
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+/* Move of the cycle: distance in edges (negative: back) over a time. */
+typedef struct tagMOVE
+{
+	int32_t edges;
+	uint64_t ns;
+} MOVE;
+
+/* Edge on an MCI input. */
+typedef struct tagEDGE
+{
+	uint64_t t;
+	uint8_t mci;
+	uint8_t level;
+	bool taken;										/* Capture overwritten by a later edge */
+} EDGE;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t Rate, Speed;
+static bool McCap;
+static uint64_t End;
+
+static MOVE Move[4];
+static uint64_t CycleStart, MoveStart;
+static uint32_t MoveIdx, Step;						/* Move of the cycle, edges done in it */
+static int32_t Position;
+static uint32_t IndexCount;
+static uint8_t Level[MCI_INPUTS];
+static uint64_t IrqAt = HOST_NEVER;					/* MCPWM interrupt pending */
+static uint32_t NsPerTick;
+
+static uint32_t Ticks;								/* Velocity timer */
+static uint64_t Period, FirstSample;
+static uint32_t *TruthPos, *TruthIndex;
+static uint32_t Samples, SamplesMax;
+static EDGE *Edges;
+static uint32_t EdgeCount, EdgeMax, EdgesMissed;
+static uint32_t LastEdge[MCI_INPUTS];
+
+static LOGMOTCFG Cfg;
+static uint32_t NextSample, NextEdge, Configs, Blocks, EdgeRecords;
+static uint32_t Missing, EdgesMissing, Unflagged, Misflagged, Bad, BadTime;
+static uint64_t PosBytes, EdgeBytes;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t Encoder (uint64_t now);
+static uint64_t NextStep (void);
+static void Step1 (int dir);
+static void Capture (uint8_t mci);
+static uint64_t Sampler (uint64_t now);
+static void Access (uint32_t offset, bool write);
+static void Check (const LOGRECHDR *rec, const uint8_t *data);
+static void CheckBlock (const LOGRECHDR *rec, const uint8_t *data, uint64_t t);
+static void CheckEdges (const LOGRECHDR *rec, const uint8_t *data, uint64_t t);
+
+/* Handlers of motionlog.c, declared by the startup code on the board */
+void QEI_IRQHandler (void);
+void MCPWM_IRQHandler (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	char cfg[48];
+	uint32_t seconds, peak, tail, edgetail;
+	bool cfgok;
+	int a = HOST_Options(argc, argv);
+
+	if (a < 0)
+	{
+		fprintf(stderr, "usage: motionsim [options] [SECONDS [RATE [SPEED [MCICAP]]]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	seconds = (a < argc) ? strtoul(argv[a], NULL, 0) : 60;
+	Rate = (a + 1 < argc) ? strtoul(argv[a + 1], NULL, 0) : 10000;
+	Speed = (a + 2 < argc) ? strtoul(argv[a + 2], NULL, 0) : 100000;
+	McCap = (a + 3 < argc) ? strtoul(argv[a + 3], NULL, 0) != 0 : false;
+	if (Rate == 0 || Rate > MOTIONLOG_MAX_RATE || Speed < 10 || Speed > 2000000)
+	{
+		fprintf(stderr, "RATE from 1 to %u, SPEED from 10 to 2000000\n", MOTIONLOG_MAX_RATE);
+		return 2;
+	}
+
+	/* The peak of a sine move of d edges over t is d * pi / (2 * t). */
+	Move[0].edges = -(int32_t)(Speed / M_PI);
+	Move[0].ns = CYCLE_NS / 4;
+	Move[1].ns = CYCLE_NS / 8;
+	Move[2].edges = 2 * (int32_t)(Speed / M_PI);
+	Move[2].ns = CYCLE_NS / 2;
+	Move[3].ns = CYCLE_NS / 8;
+
+	snprintf(cfg, sizeof(cfg), "qei = %lu\nmcicap = %d\n", (unsigned long)Rate, McCap ? 1 : 0);
+	if (HOST_Init(VOLUME_MB, cfg) != 0 || HOST_Trap(&HostMcpwm, Access) != 0) return 1;
+	SD_SetTickHook(LOG_TimerProc);
+	if (LOG_Init() != FR_OK || MOTIONLOG_Init() != FR_OK)
+	{
+		fprintf(stderr, "no logger or no QEI at %lu samples/s\n", (unsigned long)Rate);
+		return 1;
+	}
+	NsPerTick = 1000000000UL / CLKPWR_GetPCLK(CLKPWR_PCLKSEL_MC);
+	Ticks = QEI->QEILOAD + 1;							/* The timer counts QEILOAD down to 0 */
+	Period = (uint64_t)Ticks * 1000000000ULL / CLKPWR_GetPCLK(CLKPWR_PCLKSEL_QEI);
+	SamplesMax = (uint32_t)(seconds * 1000000000ULL / Period + 2);
+	TruthPos = malloc(SamplesMax * sizeof(uint32_t));
+	TruthIndex = malloc(SamplesMax * sizeof(uint32_t));
+	if (TruthPos == NULL || TruthIndex == NULL) return 1;
+
+	End = HOST_Ns + seconds * 1000000000ULL;
+	CycleStart = MoveStart = HOST_Ns;
+	Level[2] = 1;										/* Index at position 0 */
+	HOST_SET(LPC_GPIO1->FIOPIN, 1UL << 24);
+	HOST_Source(Encoder, NextStep());
+	FirstSample = HOST_Ns + Period;
+	HOST_Source(Sampler, FirstSample);
+
+	while (HOST_Ns < End)
+	{
+		MOTIONLOG_Task();
+		LOG_Task();
+		HOST_Loop();
+	}
+	HOST_Run(10 * HOST_MS);
+	MOTIONLOG_Task();
+	LOG_Close();
+	LOG_Staged(&peak);
+
+	printf("%lus at %lu samples/s, up to %lu edges/s: %lu samples, %lu edges%s\n", (unsigned long)seconds,
+			(unsigned long)(CLKPWR_GetPCLK(CLKPWR_PCLKSEL_QEI) / Ticks), (unsigned long)Speed,
+			(unsigned long)Samples, (unsigned long)EdgeCount, McCap ? " captured" : "");
+	HOST_Report();
+	if (HOST_ReadLog(Check) < 0) return 1;
+
+	/* The block being filled and the edges waiting for a record at the end
+	are not logged. */
+	tail = Samples - NextSample;
+	if (tail >= MOTIONLOG_BLOCK) Missing += tail;
+	for (edgetail = 0; NextEdge < EdgeCount; NextEdge++) if (!Edges[NextEdge].taken) edgetail++;
+	if (edgetail >= MOTIONLOG_EDGES) EdgesMissing += edgetail;
+	printf("%lu position blocks, %.2f bytes a sample; %lu samples missing, %lu not logged at the end\n",
+			(unsigned long)Blocks, Blocks ? (double)PosBytes / (Blocks * MOTIONLOG_BLOCK) : 0.0,
+			(unsigned long)Missing, (unsigned long)((tail < MOTIONLOG_BLOCK) ? tail : 0));
+	printf("%lu edge records, %.1f bytes an edge; %lu edges missing, %lu not logged at the end, %lu taken over in the capture\n",
+			(unsigned long)EdgeRecords, (EdgeCount > edgetail) ? (double)EdgeBytes / (EdgeCount - edgetail) : 0.0,
+			(unsigned long)EdgesMissing, (unsigned long)((edgetail < MOTIONLOG_EDGES) ? edgetail : 0),
+			(unsigned long)EdgesMissed);
+	printf("MOTIONLOG_Lost() %lu, %lu gaps not flagged, %lu flags without a gap, %lu damaged, %lu stamped wrong\n",
+			(unsigned long)MOTIONLOG_Lost(), (unsigned long)Unflagged, (unsigned long)Misflagged,
+			(unsigned long)Bad, (unsigned long)BadTime);
+	printf("staging ring peak %u of %u sectors\n", peak, LOG_STAGE_SECTORS);
+	cfgok = (Configs == 1 && Cfg.rate == CLKPWR_GetPCLK(CLKPWR_PCLKSEL_QEI) / Ticks && Cfg.mcicap == McCap);
+	if (!cfgok) printf("configuration record wrong or missing\n");
+
+	HOST_Save();
+	return (Missing + EdgesMissing != MOTIONLOG_Lost() || Unflagged || Misflagged || Bad || BadTime
+			|| !cfgok || Blocks == 0) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Edges of the encoder and the MCPWM interrupt they raise. */
+static uint64_t Encoder (uint64_t now)
+{
+	uint64_t next;
+	int i;
+
+	if (now >= IrqAt)
+	{
+		IrqAt = HOST_NEVER;
+		for (i = 0; i < MCI_INPUTS; i++) MCTIM(i) = now / NsPerTick;
+		if (MCPWM->MCINTFLAG & MCPWM->MCINTEN) HOST_Irq(MCPWM_IRQn, MCPWM_IRQHandler);
+	}
+	next = NextStep();
+	if (now >= next)
+	{
+		Step1((Move[MoveIdx].edges < 0) ? -1 : 1);
+		Step++;
+		next = NextStep();
+	}
+	return (IrqAt < next) ? IrqAt : next;
+}
+
+/* Time of the next edge: move k of d edges over t has its edge n at
+t * acos(1 - 2n/d) / pi, the position of a sine velocity. */
+static uint64_t NextStep (void)
+{
+	uint64_t t;
+	uint32_t d;
+
+	for (;;)
+	{
+		d = abs(Move[MoveIdx].edges);
+		if (Step < d) break;
+		MoveStart += Move[MoveIdx].ns;
+		Step = 0;
+		if (++MoveIdx == 4)
+		{
+			MoveIdx = 0;
+			CycleStart += CYCLE_NS;
+		}
+		if (MoveStart >= End) return HOST_NEVER;
+	}
+	t = MoveStart + (uint64_t)(Move[MoveIdx].ns * acos(1.0 - 2.0 * (Step + 1) / d) / M_PI);
+	return (t < End) ? t : HOST_NEVER;
+}
+
+/* One edge: the phase that changes, the index, QEIPOS and INXCNT. */
+static void Step1 (int dir)
+{
+	uint32_t s = (uint32_t)((dir > 0) ? Position : Position - 1) & 3;
+	uint8_t mci = (s & 1) ? 1 : 0;						/* 0-1 and 2-3: PHA, 1-2 and 3-0: PHB */
+	uint8_t idx;
+
+	Position += dir;
+	Level[mci] ^= 1;
+	Capture(mci);
+
+	idx = (Position % TURN_EDGES == 0);
+	if (idx != Level[2])
+	{
+		Level[2] = idx;
+		if (idx) IndexCount++;
+		Capture(2);
+	}
+
+	HOST_SET(QEI->QEIPOS, (uint32_t)Position);
+	HOST_SET(QEI->INXCNT, IndexCount);
+	HOST_SET(LPC_GPIO1->FIOPIN, (uint32_t)Level[0] << 20 | (uint32_t)Level[1] << 23 | (uint32_t)Level[2] << 24);
+}
+
+/* Edge on MCIi: capture of timer i by channel i, when enabled. */
+static void Capture (uint8_t mci)
+{
+	uint32_t capcon = MCPWM->MCCAPCON, bit;
+
+	if (!(MCPWM->MCCON & MCPWM_CON_RUN(mci))) return;
+	bit = Level[mci] ? MCPWM_CAPCON_CAPMCI_RE(mci, mci) : MCPWM_CAPCON_CAPMCI_FE(mci, mci);
+	if (!(capcon & bit)) return;
+
+	if (EdgeCount == EdgeMax)
+	{
+		EdgeMax = EdgeMax ? 2 * EdgeMax : 65536;
+		Edges = realloc(Edges, EdgeMax * sizeof(EDGE));
+		if (Edges == NULL) exit(1);
+	}
+	Edges[EdgeCount].t = HOST_Ns;
+	Edges[EdgeCount].mci = mci;
+	Edges[EdgeCount].level = Level[mci];
+	Edges[EdgeCount].taken = false;
+
+	/* A second edge before the interrupt takes the capture over. */
+	if (MCPWM->MCINTFLAG & MCPWM_INT_ICAP(mci))
+	{
+		Edges[LastEdge[mci]].taken = true;
+		EdgesMissed++;
+	}
+	LastEdge[mci] = EdgeCount++;
+	MCCR(mci) = HOST_Ns / NsPerTick;
+	HOST_SET(MCPWM->MCINTFLAG, MCPWM->MCINTFLAG | MCPWM_INT_ICAP(mci));
+	if (IrqAt == HOST_NEVER) IrqAt = HOST_Ns + LATENCY_NS;
+}
+
+/* Velocity timer: a position sample. */
+static uint64_t Sampler (uint64_t now)
+{
+	if (now >= End || Samples == SamplesMax) return HOST_NEVER;
+	if (QEI->QEIIES & QEI_INTFLAG_TIM_Int)
+	{
+		TruthPos[Samples] = (uint32_t)Position;
+		TruthIndex[Samples] = IndexCount;
+		Samples++;
+		HOST_Irq(QEI_IRQn, QEI_IRQHandler);
+	}
+	return FirstSample + Samples * Period;
+}
+
+/* Access of the firmware to the registers of the MCPWM: the SET and CLR
+registers follow the register they act on. */
+static void Access (uint32_t offset, bool write)
+{
+	static const uint32_t base[] =
+	{
+		offsetof(LPC_MCPWM_TypeDef, MCCON), offsetof(LPC_MCPWM_TypeDef, MCCAPCON),
+		offsetof(LPC_MCPWM_TypeDef, MCINTEN), offsetof(LPC_MCPWM_TypeDef, MCCNTCON),
+		offsetof(LPC_MCPWM_TypeDef, MCINTFLAG)
+	};
+	volatile uint32_t *reg;
+	uint32_t i, v;
+
+	if (!write) return;
+	if (offset == offsetof(LPC_MCPWM_TypeDef, MCCAP_CLR))
+	{
+		for (i = 0; i < MCI_INPUTS; i++) if (MCPWM->MCCAP_CLR & (1UL << i)) MCCR(i) = 0;
+		return;
+	}
+	for (i = 0; i < sizeof(base) / sizeof(base[0]); i++)
+	{
+		if (offset != base[i] + 4 && offset != base[i] + 8) continue;
+		reg = (volatile uint32_t *)((uint8_t *)MCPWM + base[i]);
+		v = reg[(offset - base[i]) / 4];
+		if (offset == base[i] + 4) *reg |= v;
+		else *reg &= ~v;
+	}
+}
+
+/* Compares the motion records with the encoder. */
+static void Check (const LOGRECHDR *rec, const uint8_t *data)
+{
+	uint64_t t;
+
+	if (rec->chan != LOGREC_CH_MOTION) return;
+	if (rec->flags & LOGREC_MOT_FL_CONFIG)
+	{
+		memcpy(&Cfg, data, sizeof(Cfg));
+		Configs++;
+		return;
+	}
+	t = ((uint64_t)rec->sec - HOST_EPOCH) * 1000000000ULL + rec->nsec;
+	if (rec->flags & LOGREC_MOT_FL_EDGES) CheckEdges(rec, data, t);
+	else CheckBlock(rec, data, t);
+}
+
+/* A position block: stamped at a sample, positions and index count of
+the encoder from there on. */
+static void CheckBlock (const LOGRECHDR *rec, const uint8_t *data, uint64_t t)
+{
+	const LOGMOTPOS *hdr = (const LOGMOTPOS *)data;
+	const uint8_t *p = data + sizeof(LOGMOTPOS), *end = data + rec->len;
+	uint32_t n, i, z, pos;
+	int shift;
+
+	Blocks++;
+	PosBytes += sizeof(LOGRECHDR) + rec->len;
+	if (rec->len < sizeof(LOGMOTPOS) || t < FirstSample || (t - FirstSample) % Period != 0)
+	{
+		BadTime++;
+		return;
+	}
+	n = (t - FirstSample) / Period;
+	if (n < NextSample || n + hdr->samples > Samples)
+	{
+		Bad++;
+		return;
+	}
+	if (n > NextSample)
+	{
+		Missing += n - NextSample;
+		if (!(rec->flags & LOGREC_MOT_FL_LOST)) Unflagged++;
+	}
+	else if (rec->flags & LOGREC_MOT_FL_LOST)
+	{
+		Misflagged++;
+	}
+	NextSample = n + hdr->samples;
+
+	pos = hdr->pos;
+	if (pos != TruthPos[n] || hdr->index != TruthIndex[n] || hdr->samples != MOTIONLOG_BLOCK)
+	{
+		Bad++;
+		return;
+	}
+	for (i = 1; i < hdr->samples; i++)
+	{
+		for (z = 0, shift = 0; p < end && shift < 35; shift += 7)
+		{
+			z |= (uint32_t)(*p & 0x7F) << shift;
+			if (!(*p++ & 0x80)) break;
+		}
+		pos += LOGMOT_UNZIGZAG(z);
+		if (pos != TruthPos[n + i])
+		{
+			Bad++;
+			return;
+		}
+	}
+	if (p != end) Bad++;
+}
+
+/* An edge record: the edges made, in order, with a gap only before the
+first edge of a flagged record. */
+static void CheckEdges (const LOGRECHDR *rec, const uint8_t *data, uint64_t t)
+{
+	uint32_t dt, k, i, gap, n = rec->len / LOGMOT_EDGE_SIZE;
+	const uint8_t *e;
+	uint64_t te;
+
+	EdgeRecords++;
+	EdgeBytes += sizeof(LOGRECHDR) + rec->len;
+	if (rec->len % LOGMOT_EDGE_SIZE != 0 || n == 0)
+	{
+		Bad++;
+		return;
+	}
+	for (i = 0; i < n; i++)
+	{
+		e = data + i * LOGMOT_EDGE_SIZE;
+		memcpy(&dt, e, 4);
+		te = t + dt;
+
+		/* The edge made on that input within a tick of the stamp; the
+		capture never saw the edges a later one took over. */
+		for (k = NextEdge; k < EdgeCount && Edges[k].t < te + NsPerTick; k++)
+		{
+			if (!Edges[k].taken && Edges[k].mci == e[4] && Edges[k].t + NsPerTick > te) break;
+		}
+		if (k == EdgeCount || Edges[k].t >= te + NsPerTick)
+		{
+			BadTime++;
+			continue;
+		}
+		if (Edges[k].level != e[5]) Bad++;
+
+		for (gap = 0; NextEdge < k; NextEdge++) if (!Edges[NextEdge].taken) gap++;
+		EdgesMissing += gap;
+		if (gap && (i > 0 || !(rec->flags & LOGREC_MOT_FL_LOST))) Unflagged++;
+		else if (!gap && i == 0 && (rec->flags & LOGREC_MOT_FL_LOST)) Misflagged++;
+		NextEdge = k + 1;
+	}
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
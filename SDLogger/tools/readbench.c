@@ -0,0 +1,345 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file readbench.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: MB/s of sequential f_read() on a simulated SPI card.
+ *
+ * Runs the FatFs of the firmware on a RAM disk behind a model of the read
+ * path of sdcard.c, writes a file and reads it back with several request
+ * sizes, checking the data. The time of every disk_read() is what the SPI
+ * bus would take: bytes of the commands and data blocks at SDCLOCK plus
+ * the access time of the card before the first block of a read command
+ * and between the blocks of a multiple block read. Each size is read with:
+ *
+ *   - single:     CMD17 per single sector read, CMD18 and STOP_TRANSMISSION
+ *                 per multiple sector read (the driver before the session)
+ *   - session:    the CMD18 is left open and continued by the next read
+ *                 when it starts at the next sector (SD_READAHEAD 0)
+ *   - read-ahead: session and read pool of MMC_disk_read(): SD_READAHEAD
+ *                 sectors read at a time by the sequential single sector
+ *                 reads, and the last other single sector kept
+ *
+ * @code
+ *   readbench [-a sectors] [-n nac_us] [MB]    # default SD_READAHEAD, 200, 8
+ * @endcode
+ *
+ *   -a  read-ahead of the third driver (SD_READAHEAD)
+ *   -n  access time of the card before the first block of a read command
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -I../fatfs/src -o readbench readbench.c ../fatfs/src/ff.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "SDLogger.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+#define DISK_SECTORS		524288			/* 256MB */
+#define MAX_READAHEAD		64
+
+/* FAT16 layout of the RAM disk */
+#define VOL_SPC				16
+#define VOL_FATSZ			129
+#define VOL_ROOTENTS		512
+
+/* Bus model: bytes on the SPI and times of the card */
+#define CMD_BYTES			9				/* Ready wait, command, R1 */
+#define BLOCK_BYTES			(1 + SS + 2)	/* Token, data, CRC */
+#define STOP_BYTES			(CMD_BYTES + 2)	/* Stuff byte and busy */
+#define NEXT_US				8.0				/* Between blocks of a CMD18 */
+#define COPY_US				4.0				/* memcpy() of a sector from the pool */
+
+#define BYTE_US				(8e6 / SDCLOCK)
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef enum { DRV_SINGLE, DRV_SESSION, DRV_READAHEAD } DRIVER;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static const char *const DrvName[] = { "single", "session", "read-ahead" };
+
+static BYTE *Disk;
+static DRIVER Driver;
+static double NacUs = 200.0;
+static UINT ReadAhead = SD_READAHEAD;
+
+/* Card and driver state */
+static double BusUs;						/* Time of the reads */
+static unsigned long Cmds;					/* Read commands sent */
+static int Reading;							/* CMD18 open */
+static DWORD RdNext;
+static BYTE RaBuf[MAX_READAHEAD + 1][SS];
+static int RaValid, OneValid;
+static DWORD RaSect, OneSect;
+static UINT RaCount;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void MakeVolume (void);
+static void StopRead (void);
+static void ReadSector (DWORD sect, BYTE *buf, UINT cnt);
+static void Fill (BYTE *buf, UINT len, DWORD pos);
+static int WriteFile (DWORD size);
+static int ReadFile (UINT chunk, DWORD size);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	static const UINT chunks[] = { 64, 512, 4096 };
+	FATFS fs;
+	DWORD size;
+	int i, d;
+
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2)
+	{
+		if (strcmp(argv[i], "-a") == 0) ReadAhead = strtoul(argv[i + 1], NULL, 0);
+		else if (strcmp(argv[i], "-n") == 0) NacUs = strtod(argv[i + 1], NULL);
+		else break;
+	}
+	if (ReadAhead < 1 || ReadAhead > MAX_READAHEAD)
+	{
+		fprintf(stderr, "usage: readbench [-a 1..%d] [-n nac_us] [MB]\n", MAX_READAHEAD);
+		return 2;
+	}
+	size = ((i < argc) ? strtoul(argv[i], NULL, 0) : 8) << 20;
+
+	Disk = calloc(DISK_SECTORS, SS);
+	MakeVolume();
+	if (f_mount(&fs, "", 1) != FR_OK || WriteFile(size) != 0)
+	{
+		fprintf(stderr, "cannot make the file\n");
+		return 1;
+	}
+
+	printf("SPI %.1f MHz, access %.0f us, read-ahead %u sectors\n", SDCLOCK / 1e6, NacUs, ReadAhead);
+	for (i = 0; i < (int)(sizeof(chunks) / sizeof(chunks[0])); i++)
+	{
+		for (d = DRV_SINGLE; d <= DRV_READAHEAD; d++)
+		{
+			Driver = d;
+			StopRead();
+			RaValid = OneValid = 0;
+			BusUs = 0;
+			Cmds = 0;
+			if (ReadFile(chunks[i], size) != 0)
+			{
+				printf("f_read(%u) with %s: wrong data\n", chunks[i], DrvName[d]);
+				return 1;
+			}
+			printf("f_read(%4u) %-10s %6.2f MB/s, %7lu read commands\n", chunks[i], DrvName[d],
+					size / BusUs, Cmds);
+		}
+	}
+	return 0;
+}
+
+/* RAM disk behind the model of MMC_disk_read() */
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	UINT n;
+
+	if (pdrv || sector + count > DISK_SECTORS) return RES_PARERR;
+
+	if (Driver == DRV_READAHEAD)
+	{
+		while (count && RaValid && sector - RaSect < RaCount)
+		{
+			memcpy(buff, RaBuf[sector - RaSect], SS);
+			BusUs += COPY_US;
+			buff += SS;
+			sector++;
+			count--;
+		}
+		if (count == 0) return RES_OK;
+
+		if (count == 1)
+		{
+			if (!OneValid || sector != OneSect)
+			{
+				if ((Reading && sector == RdNext) || (RaValid && sector == RaSect + RaCount))
+				{
+					n = DISK_SECTORS - sector;
+					if (n > ReadAhead) n = ReadAhead;
+					ReadSector(sector, RaBuf[0], n);
+					RaValid = 1;
+					RaSect = sector;
+					RaCount = n;
+					memcpy(buff, RaBuf[0], SS);
+					BusUs += COPY_US;
+					return RES_OK;
+				}
+				ReadSector(sector, RaBuf[ReadAhead], 1);
+				OneValid = 1;
+				OneSect = sector;
+			}
+			memcpy(buff, RaBuf[ReadAhead], SS);
+			BusUs += COPY_US;
+			return RES_OK;
+		}
+	}
+
+	ReadSector(sector, buff, count);
+	return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DISK_SECTORS) return RES_PARERR;
+	if (RaValid && sector < RaSect + RaCount && sector + count > RaSect) RaValid = 0;
+	if (OneValid && OneSect - sector < count) OneValid = 0;
+	StopRead();
+	memcpy(Disk + (size_t)sector * SS, buff, (size_t)count * SS);
+	return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	(void)buff;
+	if (pdrv || cmd != CTRL_SYNC) return RES_PARERR;
+	StopRead();
+	return RES_OK;
+}
+
+DWORD get_fattime (void)
+{
+	return (DWORD)(2026 - 1980) << 25 | 10UL << 21 | 18UL << 16;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Boot sector and empty FATs of a FAT16 volume over the whole disk. */
+static void MakeVolume (void)
+{
+	BYTE *bs = Disk;
+	int i;
+
+	memcpy(bs, "\xEB\x3C\x90" "MSDOS5.0", 11);
+	bs[11] = SS & 0xFF;
+	bs[12] = SS >> 8;
+	bs[13] = VOL_SPC;
+	bs[14] = 1;								/* Reserved sectors */
+	bs[16] = 2;								/* FATs */
+	bs[17] = VOL_ROOTENTS & 0xFF;
+	bs[18] = VOL_ROOTENTS >> 8;
+	bs[21] = 0xF8;
+	bs[22] = VOL_FATSZ;
+	bs[32] = DISK_SECTORS & 0xFF;			/* Total sectors, 32-bit field */
+	bs[33] = (DISK_SECTORS >> 8) & 0xFF;
+	bs[34] = (DISK_SECTORS >> 16) & 0xFF;
+	bs[38] = 0x29;
+	memcpy(&bs[54], "FAT16   ", 8);
+	bs[510] = 0x55;
+	bs[511] = 0xAA;
+
+	for (i = 0; i < 2; i++)
+	{
+		memcpy(Disk + (size_t)(1 + i * VOL_FATSZ) * SS, "\xF8\xFF\xFF\xFF", 4);
+	}
+}
+
+/* SD_StopRead() */
+static void StopRead (void)
+{
+	if (!Reading) return;
+	Reading = 0;
+	BusUs += STOP_BYTES * BYTE_US;
+}
+
+/* SD_ReadSector() of the driver in use */
+static void ReadSector (DWORD sect, BYTE *buf, UINT cnt)
+{
+	if (Driver != DRV_SINGLE && Reading && sect == RdNext)
+	{
+		BusUs += NEXT_US;					/* The card went on reading */
+	}
+	else
+	{
+		StopRead();
+		BusUs += CMD_BYTES * BYTE_US + NacUs;
+		Cmds++;
+		Reading = (Driver != DRV_SINGLE || cnt > 1);
+	}
+	memcpy(buf, Disk + (size_t)sect * SS, (size_t)cnt * SS);
+	BusUs += cnt * BLOCK_BYTES * BYTE_US + (cnt - 1) * NEXT_US;
+	RdNext = sect + cnt;
+
+	/* The old driver stops every multiple block read at once */
+	if (Driver == DRV_SINGLE && Reading) StopRead();
+}
+
+/* Contents of the file at a position */
+static void Fill (BYTE *buf, UINT len, DWORD pos)
+{
+	UINT i;
+
+	for (i = 0; i < len; i++, pos++) buf[i] = (BYTE)(pos * 2654435761UL >> 13);
+}
+
+static int WriteFile (DWORD size)
+{
+	static BYTE buf[4096];
+	FIL fil;
+	DWORD pos;
+	UINT bw;
+
+	if (f_open(&fil, "A.DAT", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) return -1;
+	for (pos = 0; pos < size; pos += sizeof(buf))
+	{
+		Fill(buf, sizeof(buf), pos);
+		if (f_write(&fil, buf, sizeof(buf), &bw) != FR_OK || bw != sizeof(buf)) return -1;
+	}
+	return (f_close(&fil) == FR_OK) ? 0 : -1;
+}
+
+static int ReadFile (UINT chunk, DWORD size)
+{
+	static BYTE buf[4096], ref[4096];
+	FIL fil;
+	DWORD pos;
+	UINT br;
+	int diff = 0;
+
+	if (f_open(&fil, "A.DAT", FA_READ) != FR_OK) return -1;
+	for (pos = 0; pos < size && !diff; pos += chunk)
+	{
+		if (f_read(&fil, buf, chunk, &br) != FR_OK || br != chunk) diff = 1;
+		Fill(ref, chunk, pos);
+		if (memcmp(buf, ref, chunk) != 0) diff = 1;
+	}
+	f_close(&fil);
+	return diff;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,209 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file ringcat.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: extracts the log stream of a raw sector ring.
+ *
+ * Reads a ring file (RINGLOG.DAT or a RINGCHnn.DAT, see ringlog.h), sorts
+ * its valid sectors by their stream number and writes the records in order
+ * to the standard output, as logcat does for the segment files. The stream is cut where a
+ * sector is missing (overwritten, torn or lost) and where the writer was
+ * restarted: the record in progress there is dropped and the stream picks
+ * up at the first record starting after the cut.
+ *
+ * @code
+ *   ringcat [-v] RINGLOG.DAT > stream.bin
+ *   ringcat RINGCH01.DAT | adccat > adc.csv
+ * @endcode
+ *
+ *   -v  prints the sectors found, the runs and the cuts
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -o ringcat ringcat.c ../src/crc16.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logformat.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					LOGSEG_SECT_SIZE
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagSLOT
+{
+	uint32_t seq;
+	uint32_t pos;			/* Ring sector */
+} SLOT;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static int Verbose;
+static uint8_t Rec[sizeof(LOGRECHDR) + 0xFFFF];		/* Record being put together */
+static uint32_t Have;								/* Bytes in Rec */
+static unsigned long Records, Cuts, Cut;			/* Cut: records dropped at the cuts */
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static int BySeq (const void *a, const void *b);
+static void Feed (const uint8_t *p, uint32_t len);
+static int Extract (const char *name);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	int i = 1;
+
+	if (i < argc && strcmp(argv[i], "-v") == 0)
+	{
+		Verbose = 1;
+		i++;
+	}
+	if (i + 1 != argc)
+	{
+		fprintf(stderr, "usage: ringcat [-v] RINGLOG.DAT > stream.bin\n");
+		return 2;
+	}
+	return Extract(argv[i]);
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+static int BySeq (const void *a, const void *b)
+{
+	uint32_t x = ((const SLOT *)a)->seq, y = ((const SLOT *)b)->seq;
+
+	return (x > y) - (x < y);
+}
+
+/* Adds stream bytes to the record in progress and writes each record
+when it is complete. */
+static void Feed (const uint8_t *p, uint32_t len)
+{
+	uint32_t n, need;
+
+	while (len)
+	{
+		need = sizeof(LOGRECHDR);
+		if (Have >= need) need += ((const LOGRECHDR *)Rec)->len;
+		n = need - Have;
+		if (n > len) n = len;
+		memcpy(&Rec[Have], p, n);
+		Have += n;
+		p += n;
+		len -= n;
+		if (Have >= sizeof(LOGRECHDR) && Have == sizeof(LOGRECHDR) + ((const LOGRECHDR *)Rec)->len)
+		{
+			fwrite(Rec, 1, Have, stdout);
+			Records++;
+			Have = 0;
+		}
+	}
+}
+
+static int Extract (const char *name)
+{
+	uint8_t sect[SS];
+	LOGRINGHDR hdr;
+	const LOGRINGSEC *sh = (const LOGRINGSEC *)sect;
+	SLOT *slot;
+	uint32_t pos, n = 0, i, prev = 0;
+	uint16_t run = 0;
+	int synced = 0;
+	FILE *f;
+
+	f = fopen(name, "rb");
+	if (f == NULL)
+	{
+		perror(name);
+		return 1;
+	}
+	if (fread(sect, 1, SS, f) != SS)
+	{
+		fprintf(stderr, "%s: too short\n", name);
+		return 1;
+	}
+	memcpy(&hdr, sect, sizeof(hdr));
+	if (hdr.magic != LOGRING_MAGIC || hdr.check != LOGRING_Check(&hdr) || hdr.version != LOGRING_VERSION)
+	{
+		fprintf(stderr, "%s: not a ring file\n", name);
+		return 1;
+	}
+
+	slot = malloc(hdr.sectors * sizeof(SLOT));
+	if (slot == NULL)
+	{
+		fprintf(stderr, "%s: out of memory\n", name);
+		return 1;
+	}
+	fseek(f, hdr.hdrsize, SEEK_SET);
+	for (pos = 0; pos < hdr.sectors && fread(sect, 1, SS, f) == SS; pos++)
+	{
+		if (!LOGRING_Valid(sect, &hdr)) continue;
+		slot[n].seq = sh->seq;
+		slot[n].pos = pos;
+		n++;
+	}
+	qsort(slot, n, sizeof(SLOT), BySeq);
+
+	for (i = 0; i < n; i++)
+	{
+		fseek(f, hdr.hdrsize + (long)slot[i].pos * SS, SEEK_SET);
+		if (fread(sect, 1, SS, f) != SS) break;
+
+		/* A cut: a missing sector or a restart. A sector flushed before it
+		filled is rewritten as it fills, so a short one ends its run. */
+		if (i > 0 && (sh->seq != prev + 1 || sh->run != run))
+		{
+			if (Verbose) fprintf(stderr, "%s: cut before sector %lu, run %u\n", name, (unsigned long)sh->seq, sh->run);
+			Cuts++;
+			if (Have) Cut++;
+			Have = 0;
+			synced = 0;
+		}
+		prev = sh->seq;
+		run = sh->run;
+
+		if (!synced)
+		{
+			if (sh->first == LOGRING_NONE) continue;
+			Feed(sect + sizeof(LOGRINGSEC) + sh->first, sh->len - sh->first);
+			synced = 1;
+		}
+		else
+		{
+			Feed(sect + sizeof(LOGRINGSEC), sh->len);
+		}
+	}
+	if (Have) Cut++;
+
+	if (Verbose)
+	{
+		fprintf(stderr, "%s: %lu of %lu sectors valid", name, (unsigned long)n, (unsigned long)hdr.sectors);
+		if (n) fprintf(stderr, ", %lu to %lu", (unsigned long)slot[0].seq, (unsigned long)slot[n - 1].seq);
+		fprintf(stderr, "\n%s: %lu records, %lu cuts, %lu records cut\n", name, Records, Cuts, Cut);
+	}
+	free(slot);
+	fclose(f);
+	return 0;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
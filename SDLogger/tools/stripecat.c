@@ -0,0 +1,278 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file stripecat.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: merges the member files of a striped segment.
+ *
+ * With LOG_STRIPES the logger writes every segment as a set of member
+ * files of the same name, one per card (see logformat.h). This tool puts
+ * the data sectors of the members back in order and writes the segment as
+ * a single card would hold it, for logcat, adccat and logquery. Each
+ * member is read up to its last valid sector, so members copied from
+ * cards that were not closed are fine; the merge ends at the first sector
+ * found in no member. A missing member file is taken as empty: the logger
+ * deletes the members that got no data.
+ *
+ * @code
+ *   stripecat [-v] LOG00001.DAT card0/LOG00001.DAT card1/LOG00001.DAT
+ * @endcode
+ *
+ *   -v  prints the sectors taken from each member and the number of runs
+ *
+ * A whole pair of cards, mounted at /mnt/sd0 and /mnt/sd1, is merged into
+ * the current directory with:
+ *
+ * @code
+ *   for f in /mnt/sd0/LOG*.DAT; do
+ *       stripecat ${f##*\/} $f /mnt/sd1/${f##*\/}
+ *   done
+ * @endcode
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -o stripecat stripecat.c ../src/crc16.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logformat.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define MAX_MEMBERS			8
+
+/*******************************************************************************
+ *                     ESTRUTURAS E DEFINICOES DE TIPOS						   *
+ ******************************************************************************/
+typedef struct tagMEMBER
+{
+	const char *name;
+	FILE *f;
+	uint8_t head[LOGSEG_SECT_SIZE];		/* Sector 0: LOGSEGHDR and LOGSTRIPEHDR */
+	LOGSEGHDR hdr;
+	LOGSTRIPEHDR sh;
+	uint8_t sect[LOGSEG_SECT_SIZE];		/* Next data sector, if 'ready' */
+	uint32_t next;						/* Lowest number the next sector may have */
+	int ready;
+	unsigned long taken;				/* Sectors moved to the output */
+} MEMBER;
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static int Verbose;
+static MEMBER Mem[MAX_MEMBERS];
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static int OpenMember (MEMBER *m);
+static void Advance (MEMBER *m);
+static int Merge (const char *out, int n);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	int i, n;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (strcmp(argv[i], "-v") == 0) Verbose = 1;
+		else break;
+	}
+	if (argc - i < 2 || argc - i - 1 > MAX_MEMBERS)
+	{
+		fprintf(stderr, "usage: stripecat [-v] OUT.DAT MEMBER.DAT ...\n");
+		return 2;
+	}
+
+	for (n = 0; i + 1 + n < argc; n++)
+	{
+		Mem[n].name = argv[i + 1 + n];
+		if (OpenMember(&Mem[n]) != 0) return 1;
+	}
+	return Merge(argv[i], n);
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Opens a member file and checks its headers. A file that does not exist
+is left closed, as an empty member. */
+static int OpenMember (MEMBER *m)
+{
+	m->f = fopen(m->name, "rb");
+	if (m->f == NULL)
+	{
+		fprintf(stderr, "%s: missing, taken as empty\n", m->name);
+		return 0;
+	}
+	if (fread(m->head, 1, sizeof(m->head), m->f) != sizeof(m->head))
+	{
+		fprintf(stderr, "%s: too short\n", m->name);
+		return -1;
+	}
+	memcpy(&m->hdr, m->head, sizeof(m->hdr));
+	memcpy(&m->sh, m->head + sizeof(m->hdr), sizeof(m->sh));
+	if (m->hdr.magic != LOGSEG_MAGIC || m->hdr.check != LOGSEG_Check(&m->hdr) || m->hdr.version != LOGSEG_VERSION)
+	{
+		fprintf(stderr, "%s: not a log segment\n", m->name);
+		return -1;
+	}
+	if (!(m->hdr.flags & LOGSEG_FL_STRIPE) || m->sh.check != LOGSTRIPE_Check(&m->sh, &m->hdr))
+	{
+		fprintf(stderr, "%s: not a stripe member\n", m->name);
+		return -1;
+	}
+	return 0;
+}
+
+/* Reads the next sector of a member. The sectors of a member are numbered
+across the set: the number only has to grow. */
+static void Advance (MEMBER *m)
+{
+	const LOGSECHDR *sh = (const LOGSECHDR *)m->sect;
+
+	if (m->ready && LOGSEC_Last(m->sect))
+	{
+		m->ready = 0;
+		return;
+	}
+	m->ready = fread(m->sect, 1, sizeof(m->sect), m->f) == sizeof(m->sect)
+			&& sh->seq >= m->next && LOGSEC_Valid(m->sect, &m->hdr, sh->seq);
+	if (m->ready) m->next = sh->seq + 1;
+}
+
+/* Writes the merged segment: the header and the index pages of member 0,
+then the data sectors in order. */
+static int Merge (const char *out, int n)
+{
+	uint8_t head[LOGSEG_SECT_SIZE], page[LOGSEG_SECT_SIZE];
+	LOGSEGHDR hdr;
+	MEMBER *base = NULL, *m, *last = NULL;
+	const LOGSECHDR *sh;
+	unsigned long runs = 0, lost = 0;
+	uint32_t idx, p;
+	FILE *f;
+	int i, j;
+
+	/* The members must be of one set, each one once. */
+	for (i = 0; i < n; i++)
+	{
+		if (Mem[i].f == NULL) continue;
+		if (base == NULL || Mem[i].sh.member == 0) base = &Mem[i];
+		for (j = 0; j < i; j++)
+		{
+			if (Mem[j].f == NULL) continue;
+			if (Mem[j].hdr.seq != Mem[i].hdr.seq || Mem[j].hdr.nonce != Mem[i].hdr.nonce
+					|| Mem[j].hdr.hdrsize != Mem[i].hdr.hdrsize || Mem[j].sh.members != Mem[i].sh.members
+					|| Mem[j].sh.member == Mem[i].sh.member)
+			{
+				fprintf(stderr, "%s and %s: not members of one segment\n", Mem[j].name, Mem[i].name);
+				return 1;
+			}
+		}
+	}
+	if (base == NULL)
+	{
+		fprintf(stderr, "%s: no member found\n", out);
+		return 1;
+	}
+
+	f = fopen(out, "wb");
+	if (f == NULL)
+	{
+		perror(out);
+		return 1;
+	}
+
+	/* Header sector, filled in at the end, and index pages. */
+	memset(head, 0, sizeof(head));
+	fwrite(head, 1, sizeof(head), f);
+	hdr = base->hdr;
+	hdr.flags &= ~LOGSEG_FL_STRIPE;
+	if (base->sh.member != 0) hdr.flags &= ~LOGSEG_FL_INDEX;
+	for (p = LOGSEG_HDR_SIZE; p < hdr.hdrsize; p += sizeof(page))
+	{
+		memset(page, 0, sizeof(page));
+		if (hdr.flags & LOGSEG_FL_INDEX)
+		{
+			fseek(base->f, p, SEEK_SET);
+			if (fread(page, 1, sizeof(page), base->f) != sizeof(page)) memset(page, 0, sizeof(page));
+		}
+		fwrite(page, 1, sizeof(page), f);
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (Mem[i].f == NULL) continue;
+		fseek(Mem[i].f, Mem[i].hdr.hdrsize, SEEK_SET);
+		Advance(&Mem[i]);
+	}
+
+	/* Sector 'idx' is the next one of one of the members. */
+	for (idx = 0;;)
+	{
+		for (i = 0; i < n; i++)
+		{
+			sh = (const LOGSECHDR *)Mem[i].sect;
+			if (Mem[i].ready && sh->seq == idx) break;
+		}
+		if (i == n) break;
+
+		m = &Mem[i];
+		fwrite(m->sect, 1, sizeof(m->sect), f);
+		m->taken++;
+		if (m != last) runs++;
+		last = m;
+		idx++;
+		if (LOGSEC_Last(m->sect))
+		{
+			m->ready = 0;
+			break;
+		}
+		Advance(m);
+	}
+
+	/* Sectors after a gap, lost in a power failure, cannot be placed. */
+	for (i = 0; i < n; i++)
+	{
+		for (m = &Mem[i]; m->f != NULL && m->ready; Advance(m)) lost++;
+	}
+	if (lost) fprintf(stderr, "%s: %lu sectors after the first %lu dropped\n", out, lost, (unsigned long)idx);
+
+	hdr.committed = idx;
+	hdr.check = LOGSEG_Check(&hdr);
+	memcpy(head, &hdr, sizeof(hdr));
+	fseek(f, 0, SEEK_SET);
+	fwrite(head, 1, sizeof(head), f);
+
+	if (Verbose)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (Mem[i].f == NULL) continue;
+			fprintf(stderr, "%s: member %u of %u, %lu sectors\n", Mem[i].name, Mem[i].sh.member,
+					Mem[i].sh.members, Mem[i].taken);
+		}
+		fprintf(stderr, "%s: %lu sectors in %lu runs\n", out, (unsigned long)hdr.committed, runs);
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (Mem[i].f != NULL) fclose(Mem[i].f);
+	}
+	return (fclose(f) == 0) ? 0 : 1;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,254 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file txtbench.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: lines per second of f_printf() and of the text log
+ *        formatter (txtfmt.h).
+ *
+ * Runs the FatFs of the firmware on a RAM disk with a FAT16 volume made
+ * here, writes the same lines once with f_printf() and once the way
+ * TXTLOG_Printf() does (TXT_VFormat() into a sector buffer, f_write() of
+ * whole sectors only), checks that both files are equal and prints the
+ * rates and the number of disk writes of each.
+ *
+ * @code
+ *   txtbench [lines]                   # default 200000
+ * @endcode
+ *
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -I../inc -I../fatfs/src -o txtbench txtbench.c ../src/txtfmt.c ../fatfs/src/ff.c
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "txtfmt.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define SS					512
+#define DISK_SECTORS		524288			/* 256MB */
+#define LINE_MAX			256
+
+/* FAT16 layout of the RAM disk */
+#define VOL_SPC				16
+#define VOL_FATSZ			129
+#define VOL_ROOTENTS		512
+
+/* The line of the test: the arguments are the same for both paths. */
+#define LINE_FMT			"%lu %5d %5d %08lX %s\n"
+#define LINE_ARGS(i)		(unsigned long)(i), (int)((i) * 7 % 4096) - 2048, (int)((i) % 1000), \
+							(unsigned long)(i) * 2654435761UL & 0xFFFFFFFF, ((i) & 15) ? "OK" : "CHECK"
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static BYTE *Disk;
+static unsigned long Writes;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static void MakeVolume (void);
+static double Now (void);
+static double RunPrintf (FATFS *fs, unsigned long lines);
+static double RunFormat (FATFS *fs, unsigned long lines);
+static int Compare (const TCHAR *a, const TCHAR *b);
+static double FileSize (const TCHAR *name);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	FATFS fs;
+	unsigned long lines = (argc > 1) ? strtoul(argv[1], NULL, 0) : 200000;
+	unsigned long w;
+	double t;
+
+	Disk = calloc(DISK_SECTORS, SS);
+	MakeVolume();
+	if (f_mount(&fs, "", 1) != FR_OK)
+	{
+		fprintf(stderr, "mount failed\n");
+		return 1;
+	}
+
+	w = Writes;
+	t = RunPrintf(&fs, lines);
+	printf("f_printf:     %9.0f lines/s, %6.1f MB/s, %lu disk writes\n", lines / t,
+			FileSize("A.TXT") / t / 1e6, Writes - w);
+
+	w = Writes;
+	t = RunFormat(&fs, lines);
+	printf("TXT_VFormat:  %9.0f lines/s, %6.1f MB/s, %lu disk writes\n", lines / t,
+			FileSize("B.TXT") / t / 1e6, Writes - w);
+
+	if (Compare("A.TXT", "B.TXT") != 0)
+	{
+		printf("the outputs differ\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* RAM disk */
+DSTATUS disk_initialize (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status (BYTE pdrv)
+{
+	return pdrv ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DISK_SECTORS) return RES_PARERR;
+	memcpy(buff, Disk + (size_t)sector * SS, (size_t)count * SS);
+	return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	if (pdrv || sector + count > DISK_SECTORS) return RES_PARERR;
+	memcpy(Disk + (size_t)sector * SS, buff, (size_t)count * SS);
+	Writes++;
+	return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
+{
+	(void)buff;
+	return (pdrv || cmd != CTRL_SYNC) ? RES_PARERR : RES_OK;
+}
+
+DWORD get_fattime (void)
+{
+	return (DWORD)(2026 - 1980) << 25 | 10UL << 21 | 18UL << 16;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Boot sector and empty FATs of a FAT16 volume over the whole disk. */
+static void MakeVolume (void)
+{
+	BYTE *bs = Disk;
+	int i;
+
+	memcpy(bs, "\xEB\x3C\x90" "MSDOS5.0", 11);
+	bs[11] = SS & 0xFF;
+	bs[12] = SS >> 8;
+	bs[13] = VOL_SPC;
+	bs[14] = 1;								/* Reserved sectors */
+	bs[16] = 2;								/* FATs */
+	bs[17] = VOL_ROOTENTS & 0xFF;
+	bs[18] = VOL_ROOTENTS >> 8;
+	bs[21] = 0xF8;
+	bs[22] = VOL_FATSZ;
+	bs[32] = DISK_SECTORS & 0xFF;			/* Total sectors, 32-bit field */
+	bs[33] = (DISK_SECTORS >> 8) & 0xFF;
+	bs[34] = (DISK_SECTORS >> 16) & 0xFF;
+	bs[38] = 0x29;
+	memcpy(&bs[54], "FAT16   ", 8);
+	bs[510] = 0x55;
+	bs[511] = 0xAA;
+
+	for (i = 0; i < 2; i++)
+	{
+		memcpy(Disk + (size_t)(1 + i * VOL_FATSZ) * SS, "\xF8\xFF\xFF\xFF", 4);
+	}
+}
+
+static double Now (void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double RunPrintf (FATFS *fs, unsigned long lines)
+{
+	FIL fil;
+	unsigned long i;
+	double t;
+
+	(void)fs;
+	f_open(&fil, "A.TXT", FA_CREATE_ALWAYS | FA_WRITE);
+	t = Now();
+	for (i = 0; i < lines; i++) f_printf(&fil, LINE_FMT, LINE_ARGS(i));
+	f_close(&fil);
+	return Now() - t;
+}
+
+/* The path of TXTLOG_Printf(), without the time stamp. */
+static double RunFormat (FATFS *fs, unsigned long lines)
+{
+	static char buf[SS + LINE_MAX];
+	FIL fil;
+	UINT fill = 0, bw;
+	unsigned long i;
+	double t;
+
+	(void)fs;
+	f_open(&fil, "B.TXT", FA_CREATE_ALWAYS | FA_WRITE);
+	t = Now();
+	for (i = 0; i < lines; i++)
+	{
+		fill += TXT_Format(&buf[fill], LINE_MAX, LINE_FMT, LINE_ARGS(i));
+		if (fill >= SS)
+		{
+			f_write(&fil, buf, SS, &bw);
+			fill -= SS;
+			memmove(buf, &buf[SS], fill);
+		}
+	}
+	f_write(&fil, buf, fill, &bw);
+	f_close(&fil);
+	return Now() - t;
+}
+
+static int Compare (const TCHAR *a, const TCHAR *b)
+{
+	FIL fa, fb;
+	static BYTE ba[4096], bb[4096];
+	UINT na, nb;
+	int diff = 0;
+
+	if (f_open(&fa, a, FA_READ) != FR_OK || f_open(&fb, b, FA_READ) != FR_OK) return -1;
+	if (f_size(&fa) != f_size(&fb)) diff = 1;
+	while (!diff)
+	{
+		f_read(&fa, ba, sizeof(ba), &na);
+		f_read(&fb, bb, sizeof(bb), &nb);
+		if (na != nb || memcmp(ba, bb, na) != 0) diff = 1;
+		if (na == 0) break;
+	}
+	f_close(&fa);
+	f_close(&fb);
+	return diff;
+}
+
+static double FileSize (const TCHAR *name)
+{
+	FILINFO fno;
+
+	return (f_stat(name, &fno) == FR_OK) ? (double)fno.fsize : 0;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
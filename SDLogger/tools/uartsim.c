@@ -0,0 +1,386 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file uartsim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs uartlog.c and the logger against a simulated
+ *        serial line and card, and checks that the logged chunks give back
+ *        the bytes sent, cut at the idle periods of the line.
+ *
+ * The line is a source of the simulation (hostsim.h) that sends messages
+ * of random length and content, 8N1 at the rate given, with idle gaps
+ * between most of them. The model of UART2 keeps the 16-byte receive FIFO:
+ * each byte received at the end of its stop bit goes in the FIFO, a FIFO
+ * at the trigger level programmed in FCR makes a DMA burst request
+ * (HOST_DmaRequest(), of the burst size of the channel), a full FIFO loses
+ * the next byte with an overrun, and a FIFO left untouched for 4 character
+ * times raises the character timeout. The registers are watched with
+ * HOST_Trap(): reading RBR pops the FIFO, reading LSR clears its error
+ * bits, writing FCR resets the FIFO and sets the trigger level, and IIR
+ * tells the interrupt pending.
+ *
+ * The main loop runs UARTLOG_Task() and LOG_Task(), which write to the
+ * card model of hostsim.c. At the end the log is read back from the RAM
+ * disk and the records are put end to end: they must give the bytes sent,
+ * in order. A missing stretch must be announced by LOGREC_UART_FL_LOST
+ * and counted by UARTLOG_Lost(). No timestamp may come before the arrival
+ * of the last byte of its record. A record with LOGREC_UART_FL_IDLE must
+ * end at the last byte of a message, and its timestamp must follow that
+ * byte by less than 16 character times. It prints the bytes sent and
+ * logged, and how many idle gaps closed a record. The exit status is 1
+ * when data is missing or differs, or a record is cut where the line was
+ * not idle.
+ *
+ * @code
+ *   uartsim [options] [SECONDS [BAUD [GAP_US]]]    # default 60s, 921600, gaps mixed
+ *   uartsim -s 50 60 921600 0                      # no gaps: a continuous stream
+ * @endcode
+ *
+ * GAP_US sets every gap between messages; without it a third of the
+ * messages follow the previous one at once and the others after 5
+ * characters to 2ms. The options of the card model are listed by hostsim.c
+ * (HOST_Usage()). Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o uartsim uartsim.c host/hostsim.c ../src/uartlog.c ../src/dma.c \
+ *       ../src/logger.c ../src/lzpack.c ../src/crc16.c ../src/config.c \
+ *       ../src/volfmt.c ../fatfs/src/ff.c ../library/src/lpc17xx_uart.c \
+ *       ../library/src/lpc17xx_gpdma.c ../library/src/lpc17xx_clkpwr.c \
+ *       ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_uart.h"
+#include "lpc17xx_gpdma.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "uartlog.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define VOLUME_MB			256
+#define FIFO_SIZE			16
+#define CTI_CHARS			4						/* Idle FIFO before the character timeout */
+#define IDLE_CHARS			5						/* Shortest gap taken as idle */
+#define TS_CHARS			16						/* Timestamp lag allowed, characters */
+#define MSG_MAX				512
+
+#define UART				(&HostUart.reg[2])
+#define UART_INDEX			2
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t Baud;
+static int64_t GapNs = -1;
+static uint64_t CharNs;								/* 10 bits, 8N1 */
+static uint64_t End;								/* No message starts after it */
+static uint32_t Seed = 1;
+
+static uint8_t *Gen;								/* Bytes sent */
+static uint64_t *Arrival;							/* End of the stop bit of each */
+static uint8_t *IdleAfter;							/* Byte followed by an idle gap */
+static uint32_t GenCount, GenMax, MsgLeft;
+static uint64_t NextByte;
+
+static uint8_t Fifo[FIFO_SIZE];
+static uint8_t FifoHead, FifoCount, Trigger = 1;
+static uint8_t LineErr;								/* LSR error bits pending */
+static uint64_t Activity;							/* Last byte in or out of the FIFO */
+static bool Timeout;								/* Character timeout raised */
+static uint32_t Overruns;
+
+static uint32_t Pos, Records, Configs, Missing, Unflagged, Bad, BadIdle, IdleRecords, IdleSeen;
+static uint64_t Logged;
+static uint64_t TsLag;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t Line (uint64_t now);
+static void Receive (uint8_t b);
+static void Burst (void);
+static void Update (void);
+static void Access (uint32_t offset, bool write);
+static void Check (const LOGRECHDR *rec, const uint8_t *data);
+static uint32_t Random (void);
+
+/* Handler of uartlog.c, declared by the startup code on the board */
+void UART2_IRQHandler (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	char cfg[32];
+	uint32_t seconds, peak, i;
+	int a = HOST_Options(argc, argv);
+
+	if (a < 0)
+	{
+		fprintf(stderr, "usage: uartsim [options] [SECONDS [BAUD [GAP_US]]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	seconds = (a < argc) ? strtoul(argv[a], NULL, 0) : 60;
+	Baud = (a + 1 < argc) ? strtoul(argv[a + 1], NULL, 0) : 921600;
+	if (a + 2 < argc) GapNs = strtod(argv[a + 2], NULL) * HOST_US;
+	if (Baud == 0)
+	{
+		fprintf(stderr, "no BAUD\n");
+		return 2;
+	}
+	CharNs = 10 * 1000000000ULL / Baud;
+
+	GenMax = (uint32_t)((uint64_t)seconds * Baud / 10 + MSG_MAX + 1);
+	Gen = malloc(GenMax);
+	Arrival = malloc(GenMax * sizeof(uint64_t));
+	IdleAfter = calloc(GenMax, 1);
+	if (Gen == NULL || Arrival == NULL || IdleAfter == NULL) return 1;
+
+	snprintf(cfg, sizeof(cfg), "uart = %lu\n", (unsigned long)Baud);
+	if (HOST_Init(VOLUME_MB, cfg) != 0 || HOST_Trap(&HostUart, Access) != 0) return 1;
+	SD_SetTickHook(LOG_TimerProc);
+	HOST_SET(UART->LSR, UART_LSR_THRE | UART_LSR_TEMT);
+	if (LOG_Init() != FR_OK || UARTLOG_Init() != FR_OK)
+	{
+		fprintf(stderr, "no logger or no UART at %lu baud\n", (unsigned long)Baud);
+		return 1;
+	}
+
+	End = HOST_Ns + seconds * 1000000000ULL;
+	NextByte = HOST_Ns + CharNs;
+	HOST_Source(Line, NextByte);
+
+	while (HOST_Ns < End)
+	{
+		UARTLOG_Task();
+		LOG_Task();
+		HOST_Loop();
+	}
+	HOST_Run(MSG_MAX * CharNs + HOST_MS);						/* The last message and its timeout */
+	UARTLOG_Task();
+	LOG_Close();
+	LOG_Staged(&peak);
+
+	for (i = 0; i < GenCount; i++) IdleRecords += IdleAfter[i];
+	printf("%lus at %lu baud: %lu bytes in %lu idle-separated messages\n", (unsigned long)seconds,
+			(unsigned long)Baud, (unsigned long)GenCount, (unsigned long)IdleRecords);
+	HOST_Report();
+	if (HOST_ReadLog(Check) < 0) return 1;
+
+	Missing += GenCount - Pos;
+	printf("%lu records, %llu bytes logged, %lu missing (UARTLOG_Lost() %lu, %lu overruns, %lu gaps not flagged), %lu damaged\n",
+			(unsigned long)Records, (unsigned long long)Logged, (unsigned long)Missing, (unsigned long)UARTLOG_Lost(),
+			(unsigned long)Overruns, (unsigned long)Unflagged, (unsigned long)Bad);
+	printf("%lu of %lu idle gaps closed a record, %lu records cut off a gap; idle records stamped within %.1f characters\n",
+			(unsigned long)IdleSeen, (unsigned long)IdleRecords, (unsigned long)BadIdle, (double)TsLag / CharNs);
+	printf("staging ring peak %u of %u sectors\n", peak, LOG_STAGE_SECTORS);
+	if (Configs != 1) printf("configuration record wrong or missing\n");
+
+	HOST_Save();
+	return (Missing || UARTLOG_Lost() || Unflagged || Bad || BadIdle || Configs != 1) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* Bytes of the line and character timeout of the FIFO. */
+static uint64_t Line (uint64_t now)
+{
+	uint64_t cti;
+	uint32_t r;
+
+	if (now >= NextByte && NextByte != HOST_NEVER)
+	{
+		if (MsgLeft == 0)
+		{
+			r = Random();
+			MsgLeft = (r & 1) ? 1 + (r >> 8) % 16 : 1 + (r >> 8) % MSG_MAX;
+		}
+		Gen[GenCount] = Random() >> 24;
+		Arrival[GenCount] = now;
+		Receive(Gen[GenCount++]);
+
+		if (--MsgLeft == 0 && GapNs != 0 && (GapNs > 0 || Random() % 3 != 0))
+		{
+			/* Idle gap: from 5 characters to 2ms unless given */
+			NextByte = now + CharNs + ((GapNs > 0) ? (uint64_t)GapNs : IDLE_CHARS * CharNs + Random() % (2 * HOST_MS));
+			if (NextByte - now - CharNs >= IDLE_CHARS * CharNs) IdleAfter[GenCount - 1] = 1;
+		}
+		else
+		{
+			NextByte = now + CharNs;
+		}
+		if ((MsgLeft == 0 && NextByte > End) || GenCount == GenMax)
+		{
+			NextByte = HOST_NEVER;
+			IdleAfter[GenCount - 1] = 1;						/* The line stays idle */
+		}
+	}
+
+	if (FifoCount && !Timeout && now >= Activity + CTI_CHARS * CharNs)
+	{
+		Timeout = true;
+		Update();
+		if (UART->IER & UART_IER_RBRINT_EN) HOST_Irq(UART2_IRQn, UART2_IRQHandler);
+	}
+
+	cti = (FifoCount && !Timeout) ? Activity + CTI_CHARS * CharNs : HOST_NEVER;
+	return (cti < NextByte) ? cti : NextByte;
+}
+
+/* End of the stop bit of a byte. */
+static void Receive (uint8_t b)
+{
+	if (FifoCount == FIFO_SIZE)
+	{
+		Overruns++;
+		LineErr |= UART_LSR_OE;
+		Update();
+		if (UART->IER & UART_IER_RLSINT_EN) HOST_Irq(UART2_IRQn, UART2_IRQHandler);
+		return;
+	}
+	Fifo[(FifoHead + FifoCount++) % FIFO_SIZE] = b;
+	Activity = HOST_Ns;
+	Timeout = false;
+	Burst();
+	Update();
+}
+
+/* DMA burst requests while the FIFO is at the trigger level. */
+static void Burst (void)
+{
+	uint32_t item[FIFO_SIZE], n, i, taken;
+
+	while (FifoCount >= Trigger && (n = HOST_DmaBurst(GPDMA_CONN_UART2_Rx)) != 0)
+	{
+		if (n > FifoCount) n = FifoCount;
+		for (i = 0; i < n; i++) item[i] = Fifo[(FifoHead + i) % FIFO_SIZE];
+		Update();
+		taken = HOST_DmaRequest(GPDMA_CONN_UART2_Rx, item, n);
+		FifoHead = (FifoHead + taken) % FIFO_SIZE;
+		FifoCount -= taken;
+		Activity = HOST_Ns;
+		if (taken < n) break;
+	}
+}
+
+/* RBR, LSR and IIR from the state of the FIFO. */
+static void Update (void)
+{
+	uint32_t ier = UART->IER, iir = UART_IIR_INTSTAT_PEND;
+
+	HOST_SET(UART->RESERVED0, FifoCount ? Fifo[FifoHead] : 0);
+	HOST_SET(*(volatile uint32_t *)&UART->LSR, UART_LSR_THRE | UART_LSR_TEMT | LineErr
+			| (FifoCount ? UART_LSR_RDR : 0) | ((LineErr & ~UART_LSR_OE) ? UART_LSR_RXFE : 0));
+
+	if ((ier & UART_IER_RLSINT_EN) && LineErr) iir = UART_IIR_INTID_RLS;
+	else if ((ier & UART_IER_RBRINT_EN) && FifoCount >= Trigger) iir = UART_IIR_INTID_RDA;
+	else if ((ier & UART_IER_RBRINT_EN) && Timeout && FifoCount) iir = UART_IIR_INTID_CTI;
+	HOST_SET(UART->IIR, iir | UART_IIR_FIFO_EN);
+}
+
+/* Access of the firmware to the registers of UART2. */
+static void Access (uint32_t offset, bool write)
+{
+	static const uint8_t trigger[4] = { 1, 4, 8, 14 };
+	uint32_t reg = offset - UART_INDEX * sizeof(LPC_UART_TypeDef);
+	uint8_t fcr;
+
+	if (offset < UART_INDEX * sizeof(LPC_UART_TypeDef) || reg >= sizeof(LPC_UART_TypeDef)) return;
+	if (UART->LCR & UART_LCR_DLAB_EN) return;
+
+	if (reg == offsetof(LPC_UART_TypeDef, RBR) && !write && FifoCount)
+	{
+		FifoHead = (FifoHead + 1) % FIFO_SIZE;
+		FifoCount--;
+		Activity = HOST_Ns;
+		Timeout = false;
+	}
+	else if (reg == offsetof(LPC_UART_TypeDef, LSR) && !write)
+	{
+		LineErr = 0;
+	}
+	else if (reg == offsetof(LPC_UART_TypeDef, FCR) && write)
+	{
+		fcr = UART->FCR;
+		if (fcr & UART_FCR_RX_RS) FifoCount = 0;
+		Trigger = trigger[fcr >> 6];
+	}
+	Update();
+}
+
+/* Puts the UART records end to end and compares them with the bytes
+sent. */
+static void Check (const LOGRECHDR *rec, const uint8_t *data)
+{
+	uint32_t k, last;
+	uint64_t ts;
+
+	if (rec->chan != LOGREC_CH_UART) return;
+	if (rec->flags & LOGREC_UART_FL_CONFIG)
+	{
+		Configs++;
+		return;
+	}
+	Records++;
+	if (rec->len == 0) return;
+
+	/* A gap is only allowed before a LOGREC_UART_FL_LOST record. */
+	for (k = Pos; k + rec->len <= GenCount; k++)
+	{
+		if (memcmp(&Gen[k], data, rec->len) == 0) break;
+		if (!(rec->flags & LOGREC_UART_FL_LOST)) break;
+	}
+	if (k + rec->len > GenCount || memcmp(&Gen[k], data, rec->len) != 0)
+	{
+		Bad++;
+		return;
+	}
+	if (k != Pos)
+	{
+		Missing += k - Pos;
+		if (!(rec->flags & LOGREC_UART_FL_LOST)) Unflagged++;
+	}
+	Pos = k + rec->len;
+	Logged += rec->len;
+
+	last = Pos - 1;
+	ts = ((uint64_t)rec->sec - HOST_EPOCH) * 1000000000ULL + rec->nsec;
+	if (ts < Arrival[last]) Bad++;
+
+	if (rec->flags & LOGREC_UART_FL_IDLE)
+	{
+		if (IdleAfter[last]) IdleSeen++;
+		else BadIdle++;
+		if (ts - Arrival[last] > TS_CHARS * CharNs) Bad++;
+		else if (ts >= Arrival[last] && ts - Arrival[last] > TsLag) TsLag = ts - Arrival[last];
+	}
+}
+
+/* xorshift32 */
+static uint32_t Random (void)
+{
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Seed;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/
@@ -0,0 +1,329 @@
+/** ************************************************************************
+ * Modulo: SDLogger
+ * @file wavsim.c
+ * @date Oct 18, 2026
+ *
+ * @brief Host tool: runs wavrec.c against a simulated I2S source and card,
+ *        and checks the WAV files byte for byte against the samples sent.
+ *
+ * The source is a source of the simulation (hostsim.h) that sends one
+ * stereo frame per sample period at the rate given: a 997Hz tone on the
+ * left and a 1409.37Hz tone on the right, 16 bits each, the left sample in
+ * the lower half of the word as the I2S receive FIFO holds it. The model
+ * of the FIFO keeps 8 words, makes a DMA burst request (HOST_DmaRequest())
+ * at the depth programmed in I2SDMA2 and loses a frame when full. It stops
+ * when I2SDAI stops the receiver.
+ *
+ * The main loop runs WAVREC_Task(), which writes to the card model of
+ * hostsim.c; at the end WAVREC_Close() closes the file. Just before, the
+ * header of the file being recorded is read as it is on the card, as after
+ * a power loss: its sizes must be those of a sync, and the samples up to
+ * them must be on the card. Then every WAV file is read back from the RAM
+ * disk. The header sector must be byte for byte the one of wavrec.h for
+ * the samples in the file, which must be its whole length. The samples
+ * must be the frames sent, in order, buffer after buffer: a buffer may
+ * only be missing when counted by WAVREC_Lost(), and must never hold parts
+ * of two. The file numbers must follow each other, and the recording must
+ * go on from one file to the next.
+ *
+ * @code
+ *   wavsim [options] [SECONDS [RATE]]              # default 60s, 48000
+ *   wavsim 700                                     # crosses to the second file
+ *   wavsim -s 100 60                               # with a 100ms card stall every MB
+ * @endcode
+ *
+ * The options of the card model are listed by hostsim.c (HOST_Usage()).
+ * Build it from this directory with:
+ *
+ * @code
+ *   gcc -O2 -no-pie -D__USE_CMSIS -Ihost -I../inc -I../library/inc -I../fatfs/src \
+ *       -o wavsim wavsim.c host/hostsim.c ../src/wavrec.c ../src/dma.c \
+ *       ../src/logger.c ../src/lzpack.c ../src/crc16.c ../src/config.c \
+ *       ../src/volfmt.c ../fatfs/src/ff.c ../library/src/lpc17xx_i2s.c \
+ *       ../library/src/lpc17xx_gpdma.c ../library/src/lpc17xx_clkpwr.c \
+ *       ../library/src/lpc17xx_pinsel.c -lm
+ * @endcode
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "LPC17xx.h"
+#include "lpc17xx_i2s.h"
+#include "lpc17xx_gpdma.h"
+
+#include "diskio.h"
+#include "sdcard.h"
+#include "logger.h"
+#include "wavrec.h"
+#include "hostsim.h"
+
+/*******************************************************************************
+ *                           DEFINICOES E MACROS							   *
+ ******************************************************************************/
+#define VOLUME_MB			400						/* Three files */
+#define FIFO_SIZE			8
+#define HDR_SIZE			_MAX_SS
+#define BUF_FRAMES			(WAVREC_BUF / 4)
+#define FILES_MAX			64
+
+#define I2S_CONN			GPDMA_CONN_I2S_Channel_1
+
+/*******************************************************************************
+ *                        VARIAVEIS PRIVADAS (Locais)						   *
+ ******************************************************************************/
+static uint32_t Rate;
+static uint64_t Sent;								/* Frames received */
+static uint32_t Fifo[FIFO_SIZE];
+static uint32_t FifoCount;
+static uint32_t Overruns;
+
+static uint64_t Next;								/* Frame expected next in the files */
+static uint64_t Blocks, Missing, Bad;
+static uint32_t Files, BadHeader;
+
+/*******************************************************************************
+ *                      PROTOTIPOS DAS FUNCOES PRIVADAS						   *
+ ******************************************************************************/
+static uint64_t Source (uint64_t now);
+static uint64_t FrameTime (uint64_t n);
+static uint32_t Frame (uint64_t n);
+static void Header (BYTE *hdr, DWORD data);
+static int CheckFile (const TCHAR *name, bool open);
+static int CheckSync (void);
+
+/*******************************************************************************
+ *                           FUNCOES PUBLICAS							       *
+ ******************************************************************************/
+int main (int argc, char **argv)
+{
+	char cfg[32];
+	TCHAR name[FILES_MAX][13];
+	FILINFO fno;
+	DIR dir;
+	DWORD seq, last = 0;
+	uint64_t end;
+	uint32_t seconds, i;
+	int a = HOST_Options(argc, argv), n = 0;
+
+	if (a < 0)
+	{
+		fprintf(stderr, "usage: wavsim [options] [SECONDS [RATE]]\n");
+		HOST_Usage();
+		return 2;
+	}
+	seconds = (a < argc) ? strtoul(argv[a], NULL, 0) : 60;
+	Rate = (a + 1 < argc) ? strtoul(argv[a + 1], NULL, 0) : 48000;
+
+	snprintf(cfg, sizeof(cfg), "wav = %lu\n", (unsigned long)Rate);
+	if (HOST_Init(VOLUME_MB, cfg) != 0) return 1;
+	if (WAVREC_Init() != FR_OK || (LPC_I2S->I2SDAI & I2S_DAI_STOP))
+	{
+		fprintf(stderr, "no recorder at %lu Hz\n", (unsigned long)Rate);
+		return 1;
+	}
+
+	end = HOST_Ns + seconds * 1000000000ULL;
+	HOST_Source(Source, HOST_Ns + FrameTime(0));
+	while (HOST_Ns < end)
+	{
+		WAVREC_Task();
+		HOST_Loop();
+	}
+	if (CheckSync() != 0) BadHeader++;
+	if (WAVREC_Close() != FR_OK || !(LPC_I2S->I2SDAI & I2S_DAI_STOP))
+	{
+		fprintf(stderr, "WAVREC_Close() failed\n");
+		return 1;
+	}
+
+	printf("%lus at %lu Hz: %llu frames, %llu buffers, %lu FIFO overruns\n", (unsigned long)seconds,
+			(unsigned long)Rate, (unsigned long long)Sent, (unsigned long long)(Sent / BUF_FRAMES),
+			(unsigned long)Overruns);
+	HOST_Report();
+	HOST_Timed(false);
+
+	/* The files in number order */
+	if (f_opendir(&dir, "") != FR_OK) return 1;
+	while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0)
+	{
+		if (strncmp(fno.fname, WAVREC_NAME_PREFIX, sizeof(WAVREC_NAME_PREFIX) - 1) != 0 || n == FILES_MAX) continue;
+		strcpy(name[n++], fno.fname);
+	}
+	f_closedir(&dir);
+	qsort(name, n, sizeof(name[0]), (int (*)(const void *, const void *))strcmp);
+	for (i = 0; i < (uint32_t)n; i++)
+	{
+		seq = strtoul(&name[i][sizeof(WAVREC_NAME_PREFIX) - 1], NULL, 10);
+		if (seq != last + 1) BadHeader++;
+		last = seq;
+		if (CheckFile(name[i], false) != 0) return 1;
+	}
+
+	/* Only the partial buffer is left out at the end */
+	Missing += (Sent - Overruns) / BUF_FRAMES - Next / BUF_FRAMES;
+	printf("%lu files, %llu buffers in them, %llu missing (WAVREC_Lost() %lu), %llu damaged, %lu bad headers or names\n",
+			(unsigned long)Files, (unsigned long long)Blocks, (unsigned long long)Missing,
+			(unsigned long)WAVREC_Lost(), (unsigned long long)Bad, (unsigned long)BadHeader);
+
+	HOST_Save();
+	return (Missing != WAVREC_Lost() || Bad || BadHeader || Overruns || Files == 0) ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                           FUNCOES PRIVADAS							       *
+ ******************************************************************************/
+/* A frame into the receive FIFO, and the DMA bursts it asks for. */
+static uint64_t Source (uint64_t now)
+{
+	uint32_t n, taken;
+
+	(void)now;
+	if (LPC_I2S->I2SDAI & I2S_DAI_STOP) return HOST_NEVER;
+
+	if (FifoCount == FIFO_SIZE) Overruns++;
+	else Fifo[FifoCount++] = Frame(Sent);
+	Sent++;
+
+	n = (LPC_I2S->I2SDMA2 & 0x01) ? (LPC_I2S->I2SDMA2 >> 8) & 0x0F : 0;	/* RX DMA on and its depth */
+	while (n && FifoCount >= n && HOST_DmaBurst(I2S_CONN) != 0)
+	{
+		taken = HOST_DmaRequest(I2S_CONN, Fifo, n);
+		memmove(Fifo, &Fifo[taken], (FifoCount - taken) * 4);
+		FifoCount -= taken;
+		if (taken < n) break;
+	}
+
+	return HOST_Ns + FrameTime(Sent) - FrameTime(Sent - 1);
+}
+
+/* Time of a frame from the start, without drift. */
+static uint64_t FrameTime (uint64_t n)
+{
+	return n * 1000000000ULL / Rate;
+}
+
+/* Left and right samples of frame n. */
+static uint32_t Frame (uint64_t n)
+{
+	double t = (double)n / Rate;
+	int16_t l = (int16_t)lrint(12000.0 * sin(2 * M_PI * 997.0 * t));
+	int16_t r = (int16_t)lrint(9000.0 * sin(2 * M_PI * 1409.37 * t));
+
+	return (uint16_t)l | ((uint32_t)(uint16_t)r << 16);
+}
+
+/* The header sector of wavrec.h, built apart from wavrec.c. */
+static void Header (BYTE *hdr, DWORD data)
+{
+	memset(hdr, 0, HDR_SIZE);
+	memcpy(hdr, "RIFF", 4);
+	ST_DWORD(hdr + 4, 4 + 8 + 16 + 8 + (HDR_SIZE - 52) + 8 + data);
+	memcpy(hdr + 8, "WAVEfmt ", 8);
+	ST_DWORD(hdr + 16, 16);
+	ST_WORD(hdr + 20, 1);
+	ST_WORD(hdr + 22, 2);
+	ST_DWORD(hdr + 24, Rate);
+	ST_DWORD(hdr + 28, Rate * 4);
+	ST_WORD(hdr + 32, 4);
+	ST_WORD(hdr + 34, 16);
+	memcpy(hdr + 36, "JUNK", 4);
+	ST_DWORD(hdr + 40, HDR_SIZE - 52);
+	memcpy(hdr + HDR_SIZE - 8, "data", 4);
+	ST_DWORD(hdr + HDR_SIZE - 4, data);
+}
+
+/* Header and samples of a file. With 'open' the file may still be
+recorded or preallocated: its size is the preallocated one, or 0 before
+its first sync, and only the samples of the header are checked, without
+counting them. */
+static int CheckFile (const TCHAR *name, bool open)
+{
+	static uint32_t buf[BUF_FRAMES];
+	BYTE hdr[HDR_SIZE], want[HDR_SIZE];
+	uint64_t k, next = Next;
+	DWORD data;
+	FIL fil;
+	UINT br, i;
+
+	if (f_open(&fil, name, FA_READ) != FR_OK) return -1;
+	if (open && f_size(&fil) == 0)
+	{
+		f_close(&fil);										/* Created, not grown yet */
+		return 0;
+	}
+	if (f_read(&fil, hdr, HDR_SIZE, &br) != FR_OK || br != HDR_SIZE) br = 0;
+	data = LD_DWORD(hdr + HDR_SIZE - 4);
+	Header(want, data);
+	if (br != HDR_SIZE || memcmp(hdr, want, HDR_SIZE) != 0 || data % WAVREC_BUF != 0
+			|| (!open && f_size(&fil) != HDR_SIZE + data) || HDR_SIZE + data > f_size(&fil))
+	{
+		printf("%s: bad header for %lu bytes in a file of %lu\n", name, (unsigned long)data, (unsigned long)f_size(&fil));
+		f_close(&fil);
+		return open ? -1 : (BadHeader++, 0);
+	}
+
+	/* Each buffer must be whole, at or after the next one expected. */
+	for (; data; data -= WAVREC_BUF)
+	{
+		if (f_read(&fil, buf, WAVREC_BUF, &br) != FR_OK || br != WAVREC_BUF) break;
+		for (k = next; k + BUF_FRAMES <= Sent; k += BUF_FRAMES)
+		{
+			for (i = 0; i < BUF_FRAMES && buf[i] == Frame(k + i); i++);
+			if (i == BUF_FRAMES) break;
+		}
+		if (k + BUF_FRAMES > Sent)
+		{
+			if (!open) Bad++;
+			else
+			{
+				f_close(&fil);
+				return -1;
+			}
+			continue;
+		}
+		if (!open)
+		{
+			Missing += (k - next) / BUF_FRAMES;
+			Blocks++;
+		}
+		next = k + BUF_FRAMES;
+	}
+	f_close(&fil);
+	if (!open)
+	{
+		Next = next;
+		Files++;
+	}
+	return 0;
+}
+
+/* The files as a power loss would leave them, the one being recorded and
+the next one included. */
+static int CheckSync (void)
+{
+	FILINFO fno;
+	DIR dir;
+	bool timed = HOST_Timed(false);
+	int ret = (f_opendir(&dir, "") == FR_OK) ? 0 : -1;
+
+	while (ret == 0 && f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0)
+	{
+		if (strncmp(fno.fname, WAVREC_NAME_PREFIX, sizeof(WAVREC_NAME_PREFIX) - 1) != 0) continue;
+		if (CheckFile(fno.fname, true) != 0)
+		{
+			printf("%s: not as the last sync left it\n", fno.fname);
+			ret = -1;
+		}
+	}
+	f_closedir(&dir);
+	HOST_Timed(timed);
+	return ret;
+}
+
+/*******************************************************************************
+ *                                   EOF									   *
+ ******************************************************************************/